@@ -0,0 +1,321 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Tilt compensated compass attitude filter                      *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "AttitudeFilter.h"
+#include "BoardConfig.h"
+#include "FastMath.h"
+
+#include <math.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+AttitudeFilter::AttitudeFilter()
+{
+    Reset();
+}
+
+AttitudeFilter::~AttitudeFilter()
+{
+}
+
+// Forget current attitude : the next sample will initialize it directly
+void AttitudeFilter::Reset()
+{
+    q0                 = 1.0f;
+    q1                 = 0.0f;
+    q2                 = 0.0f;
+    q3                 = 0.0f;
+    initialized        = false;
+    heading_deg        = 0.0f;
+    heel_deg           = 0.0f;
+    pitch_deg          = 0.0f;
+    rateOfTurn_degpmin = 0.0f;
+}
+
+// Run the filter on a new sample
+// @param accel Acceleration in compass frame, any unit
+// @param mag Calibrated magnetic field in compass frame, any unit
+// @param dt_s Time elapsed since the previous sample
+void AttitudeFilter::Update(vec *accel, vec *mag, float dt_s)
+{
+    vec accelDir = *accel;
+    vec magDir   = *mag;
+
+    // Note that we don't care about units of both acceleration and magnetic field since we
+    // are only calculating angles.
+    Normalize(&accelDir);
+    Normalize(&magDir);
+
+    if (!initialized)
+    {
+        InitAttitude(&accelDir, &magDir);
+        ComputeAngles(0.0f);
+    }
+    else
+    {
+        UpdateAttitude(&accelDir, &magDir, dt_s);
+        ComputeAngles(dt_s);
+    }
+}
+
+// Returns magnetic heading of HEADING_AXIS in degrees
+float AttitudeFilter::GetHeading()
+{
+    return heading_deg;
+}
+
+// Returns heel angle in degrees, positive when HEEL_AXIS goes down (heeling to starboard)
+float AttitudeFilter::GetHeel()
+{
+    return heel_deg;
+}
+
+// Returns pitch angle in degrees, positive when HEADING_AXIS goes up
+float AttitudeFilter::GetPitch()
+{
+    return pitch_deg;
+}
+
+// Returns rate of turn in degrees per minute, negative when turning to port
+float AttitudeFilter::GetRateOfTurn()
+{
+    return rateOfTurn_degpmin;
+}
+
+// Set attitude quaternion directly from a single accelerometer/magnetometer measurement so that the filter does not
+// need to converge from an arbitrary attitude at start-up
+void AttitudeFilter::InitAttitude(vec *accel, vec *mag)
+{
+    vec   U = *accel;
+    vec   E, W, N;
+    float r[3][3];
+    float trace, s;
+
+    // The accelerometer measures the reaction to gravity, i.e. the "Up" vector
+    // M X U = E, cross magnetic field (magnetic north + inclination) with "Up" to produce "East"
+    CrossProduct(mag, &U, &E);
+    Normalize(&E);
+    W.x = -E.x;
+    W.y = -E.y;
+    W.z = -E.z;
+    // W X U = N, cross "West" with "Up" to produce "North" (parallel to the ground)
+    CrossProduct(&W, &U, &N);
+    Normalize(&N);
+
+    // Rows of the rotation matrix are earth axes expressed in compass frame
+    r[0][0] = N.x;
+    r[0][1] = N.y;
+    r[0][2] = N.z;
+    r[1][0] = W.x;
+    r[1][1] = W.y;
+    r[1][2] = W.z;
+    r[2][0] = U.x;
+    r[2][1] = U.y;
+    r[2][2] = U.z;
+
+    // Convert rotation matrix to quaternion
+    trace = r[0][0] + r[1][1] + r[2][2];
+    if (trace > 0.0f)
+    {
+        s  = 0.5f / sqrtf(trace + 1.0f);
+        q0 = 0.25f / s;
+        q1 = (r[2][1] - r[1][2]) * s;
+        q2 = (r[0][2] - r[2][0]) * s;
+        q3 = (r[1][0] - r[0][1]) * s;
+    }
+    else if ((r[0][0] > r[1][1]) && (r[0][0] > r[2][2]))
+    {
+        s  = 2.0f * sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]);
+        q0 = (r[2][1] - r[1][2]) / s;
+        q1 = 0.25f * s;
+        q2 = (r[0][1] + r[1][0]) / s;
+        q3 = (r[0][2] + r[2][0]) / s;
+    }
+    else if (r[1][1] > r[2][2])
+    {
+        s  = 2.0f * sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]);
+        q0 = (r[0][2] - r[2][0]) / s;
+        q1 = (r[0][1] + r[1][0]) / s;
+        q2 = 0.25f * s;
+        q3 = (r[1][2] + r[2][1]) / s;
+    }
+    else
+    {
+        s  = 2.0f * sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]);
+        q0 = (r[1][0] - r[0][1]) / s;
+        q1 = (r[0][2] + r[2][0]) / s;
+        q2 = (r[1][2] + r[2][1]) / s;
+        q3 = 0.25f * s;
+    }
+
+    initialized = true;
+}
+
+// Mahony complementary filter, without gyroscope. The attitude quaternion is rotated towards the attitude measured
+// by accelerometer and magnetometer with a proportional gain. For small errors this behaves as a first order low-pass
+// filter of time constant NAVCOMPASS_RESPONSE_TIME_S on heading, heel and pitch.
+void AttitudeFilter::UpdateAttitude(vec *accel, vec *mag, float dt_s)
+{
+    vec   forward = HEADING_AXIS;
+    vec   east, north, forwardEarth;
+    float halfvx, halfvy, halfvz;
+    float halfex, halfey, halfez;
+    float gx, gy, gz;
+    float qa, qb, qc;
+
+    // Estimated direction of gravity
+    halfvx = q1 * q3 - q0 * q2;
+    halfvy = q0 * q1 + q2 * q3;
+    halfvz = q0 * q0 - 0.5f + q3 * q3;
+
+    // Heading error is the difference between the heading of the estimated attitude and the heading measured by this
+    // sample, tilt compensated with the measured gravity. Using the measured gravity keeps the lag of heel and pitch
+    // estimates, e.g. when rolling, from turning into a heading error. The correction is applied around the estimated
+    // vertical : magnetic field only corrects heading and can't disturb heel and pitch, which are given by gravity only.
+    float yawError = 0.0f;
+    CrossProduct(mag, accel, &east);
+    CrossProduct(accel, &east, &north);
+    if (vector_dot(&east, &east) > 1e-4f)
+    {
+        Rotate(&forward, &forwardEarth);
+        float measuredHeading_deg  = FastAtan2_deg(vector_dot(&east, &forward), vector_dot(&north, &forward));
+        float estimatedHeading_deg = FastAtan2_deg(-forwardEarth.y, forwardEarth.x);
+        // Heading is clockwise, i.e. a negative rotation around the vertical
+        yawError = -FastWrap180_deg(measuredHeading_deg - estimatedHeading_deg) * FASTMATH_DEG_TO_RAD;
+    }
+    halfex = (accel->y * halfvz - accel->z * halfvy) + yawError * halfvx;
+    halfey = (accel->z * halfvx - accel->x * halfvz) + yawError * halfvy;
+    halfez = (accel->x * halfvy - accel->y * halfvx) + yawError * halfvz;
+
+    // Proportional feedback is the only source of rotation since we have no gyroscope
+    gx = (2.0f / NAVCOMPASS_RESPONSE_TIME_S) * halfex * (0.5f * dt_s);
+    gy = (2.0f / NAVCOMPASS_RESPONSE_TIME_S) * halfey * (0.5f * dt_s);
+    gz = (2.0f / NAVCOMPASS_RESPONSE_TIME_S) * halfez * (0.5f * dt_s);
+
+    // Integrate rate of change of quaternion
+    qa = q0;
+    qb = q1;
+    qc = q2;
+    q0 += (-qb * gx - qc * gy - q3 * gz);
+    q1 += (qa * gx + qc * gz - q3 * gy);
+    q2 += (qa * gy - qb * gz + q3 * gx);
+    q3 += (qa * gz + qb * gy - qc * gx);
+
+    float norm = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    q0 *= norm;
+    q1 *= norm;
+    q2 *= norm;
+    q3 *= norm;
+}
+
+// Compute heading, heel, pitch and rate of turn from attitude quaternion
+// @param dt_s Time elapsed since last call, 0 to reset rate of turn
+void AttitudeFilter::ComputeAngles(float dt_s)
+{
+    vec forward   = HEADING_AXIS;
+    vec starboard = HEEL_AXIS;
+    vec forwardEarth, starboardEarth;
+
+    Rotate(&forward, &forwardEarth);
+    Rotate(&starboard, &starboardEarth);
+
+    // Earth frame is (North, West, Up) : heading is measured clockwise from North
+    float newHeading_deg = FastWrap360_deg(FastAtan2_deg(-forwardEarth.y, forwardEarth.x));
+
+    pitch_deg = asinf(fminf(fmaxf(forwardEarth.z, -1.0f), 1.0f)) * FASTMATH_RAD_TO_DEG;
+    heel_deg  = -asinf(fminf(fmaxf(starboardEarth.z, -1.0f), 1.0f)) * FASTMATH_RAD_TO_DEG;
+
+    if (dt_s > 0.0f)
+    {
+        float deltaHeading_deg = FastWrap180_deg(newHeading_deg - heading_deg);
+
+        // Low-pass filter the derivative of heading, which amplifies the heading noise left by the short attitude filter
+        float rate_degpmin = deltaHeading_deg * 60.0f / dt_s;
+        rateOfTurn_degpmin += (rate_degpmin - rateOfTurn_degpmin) * dt_s / (NAVCOMPASS_ROT_RESPONSE_TIME_S + dt_s);
+    }
+    else
+    {
+        rateOfTurn_degpmin = 0.0f;
+    }
+
+    heading_deg = newHeading_deg;
+}
+
+// Rotate a vector from compass frame to earth frame
+void AttitudeFilter::Rotate(vec *in, vec *out)
+{
+    out->x = (1.0f - 2.0f * (q2 * q2 + q3 * q3)) * in->x + 2.0f * (q1 * q2 - q0 * q3) * in->y + 2.0f * (q1 * q3 + q0 * q2) * in->z;
+    out->y = 2.0f * (q1 * q2 + q0 * q3) * in->x + (1.0f - 2.0f * (q1 * q1 + q3 * q3)) * in->y + 2.0f * (q2 * q3 - q0 * q1) * in->z;
+    out->z = 2.0f * (q1 * q3 - q0 * q2) * in->x + 2.0f * (q2 * q3 + q0 * q1) * in->y + (1.0f - 2.0f * (q1 * q1 + q2 * q2)) * in->z;
+}
+
+void AttitudeFilter::Normalize(vec *a)
+{
+    float mag = sqrtf(vector_dot(a, a));
+    if (mag == 0.0f)
+    {
+        return;
+    }
+    float invMag = 1.0f / mag;
+    a->x *= invMag;
+    a->y *= invMag;
+    a->z *= invMag;
+}
+
+void AttitudeFilter::CrossProduct(vec *a, vec *b, vec *out)
+{
+    out->x = (a->y * b->z) - (a->z * b->y);
+    out->y = (a->z * b->x) - (a->x * b->z);
+    out->z = (a->x * b->y) - (a->y * b->x);
+}
+
+float AttitudeFilter::vector_dot(vec *a, vec *b)
+{
+    return (a->x * b->x) + (a->y * b->y) + (a->z * b->z);
+}
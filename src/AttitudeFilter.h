@@ -0,0 +1,81 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Tilt compensated compass attitude filter                      *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef ATTITUDEFILTER_H_
+#define ATTITUDEFILTER_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "NavCompassDriver.h"
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class AttitudeFilter
+{
+  public:
+    AttitudeFilter();
+    virtual ~AttitudeFilter();
+
+    void  Reset();
+    void  Update(vec *accel, vec *mag, float dt_s);
+    float GetHeading();
+    float GetHeel();
+    float GetPitch();
+    float GetRateOfTurn();
+
+  private:
+    float q0, q1, q2, q3; // Attitude quaternion, rotating compass frame to earth (North, West, Up) frame
+    bool  initialized;
+    float heading_deg;
+    float heel_deg;
+    float pitch_deg;
+    float rateOfTurn_degpmin;
+
+    void  InitAttitude(vec *accel, vec *mag);
+    void  UpdateAttitude(vec *accel, vec *mag, float dt_s);
+    void  ComputeAngles(float dt_s);
+    void  Rotate(vec *in, vec *out);
+    void  Normalize(vec *a);
+    void  CrossProduct(vec *a, vec *b, vec *out);
+    float vector_dot(vec *a, vec *b);
+};
+
+#endif /* ATTITUDEFILTER_H_ */
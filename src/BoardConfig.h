@@ -77,6 +77,19 @@
 #define GNSS_TX_PIN   8
 #endif
 
+// Protocol used by the UBLOX M8N GNSS
+// 0 -> NMEA sentences (RMC, GGA, VTG), decoded and forwarded to the external NMEA port
+// 1 -> UBX NAV-PVT binary messages, decoded directly. NMEA sentences listed in GNSS_NMEA_OUTPUT are regenerated for
+//      the external NMEA port.
+#define GNSS_UBX_NAV_PVT 0
+// Navigation rate of the UBLOX M8N GNSS : 1, 5 or 10Hz
+// NMEA outputs get every fix while Micronet gets the latest fix of each network cycle : higher rates reduce the age of
+// position and SOG/COG shown on Micronet displays.
+#define GNSS_NAV_RATE_HZ 1
+// NMEA sentences regenerated from UBX NAV-PVT messages : any combination of GNSS_NMEA_RMC, GNSS_NMEA_GGA and
+// GNSS_NMEA_VTG, 0 if nothing connected to the external NMEA port needs GNSS sentences
+#define GNSS_NMEA_OUTPUT (GNSS_NMEA_RMC | GNSS_NMEA_GGA | GNSS_NMEA_VTG)
+
 // USB UART params
 #define USB_NMEA     SerialUSB
 #define USB_BAUDRATE 115200
@@ -94,14 +107,18 @@
 #define WIRED_TX_PIN   1
 #endif
 
-// The console to use for menu and NMEA output
+// The console to use for menu
 // USB_NMEA -> USB-Serial link
 // WIRED_NMEA -> Teensy's physical UART
-#define CONSOLE  USB_NMEA
-#define NMEA_EXT USB_NMEA
+#define CONSOLE USB_NMEA
+
+// Default port for external NMEA input and output, can be changed from the data links menu
+// NMEA_PORT_USB -> USB-Serial link (USB_NMEA)
+// NMEA_PORT_WIRED -> Teensy's physical UART (WIRED_NMEA)
+#define NMEA_EXT_PORT NMEA_PORT_USB
 
-// Defines which data comes from which link
-// LINK_NMEA_EXT -> data comes from external NMEA link (WIRED_NMEA)
+// Defines which data comes from which link by default, can be changed from the data links menu
+// LINK_NMEA_EXT -> data comes from external NMEA port (see NMEA_EXT_PORT)
 // LINK_NMEA_GNSS -> data comes from GNSS NMEA link (GNSS_SERIAL)
 // LINK_MICRONET -> data comes from Micronet network
 // LINK_COMPASS -> data comes from LSM303 (NAVCOMPASS_I2C)
@@ -114,20 +131,57 @@
 #define SEATEMP_SOURCE_LINK LINK_MICRONET  // Temperature data (MTW)
 #define COMPASS_SOURCE_LINK LINK_COMPASS   // Heading data (HDG)
 
-// Enable COG/SOG filtering.
+// Enable COG/SOG filtering by default, can be changed from the data links menu
 // This functionnality reduces COG/SOG noise from GNSS at the cost of responsiveness.
 // 0 -> disabled
 // 1 -> enabled
 #define SOG_COG_FILTERING 1
-// Depth of COG/SOG filter [1..20]
+// Default depth of COG/SOG filter [1..SOG_COG_MAX_FILTERING_DEPTH]
 #define SOG_COG_FILTERING_DEPTH 7
 
-// Emulate water speed (SPD) with SOG from GNSS
+// Emulate water speed (SPD) with SOG from GNSS by default, can be changed from the data links menu
 // To be used when you don't have a speedo in your network
 // 0 -> disabled
 // 1 -> enabled
 #define EMULATE_SPD_WITH_SOG 0
 
+// Time constant of true wind damping, in seconds
+// Damped values are used for MWD and VWT sentences. 0 disables damping.
+#define WIND_DAMPING_TIME_S 2.0f
+
+// Period at which navigation compass is sampled during NMEA conversion, in ms
+// Each sample is acquired in two non-blocking steps (accelerometer then magnetometer) run at twice this rate
+#define NAVCOMPASS_SAMPLE_PERIOD_MS 100
+
+// Response time of the navigation compass attitude filter, in seconds
+// Lower values follow heading changes faster but are more sensitive to boat motion and sensor noise. 0.2s gives the same
+// heading lag as the 4 samples average used before the attitude filter.
+#define NAVCOMPASS_RESPONSE_TIME_S 0.2f
+// Response time of the low-pass filter applied to rate of turn, in seconds
+#define NAVCOMPASS_ROT_RESPONSE_TIME_S 1.0f
+
+// Number of successive network cycles in which data is still sent in our sync slots when the MASTER_REQUEST is missed,
+// on the timeline predicted from the learned master period. 0 disables transmission without MASTER_REQUEST.
+#define PREDICTED_CYCLES_MAX 2
+
+// Maximum error bound of the predicted cycle start, in us, above which no data is sent without MASTER_REQUEST
+// Must stay well below the guard time of sync slots (1893us)
+#define PREDICTION_MAX_ERROR_US 300
+
+// Power down the radio during the network cycle when no device we use data from is transmitting, e.g. during display slots
+// The radio stays on for MASTER_REQUEST, sensor slots, our own slots, the asynchronous window and our ACK windows.
+// Not yet validated on a real network : a missed frame due to a wrong slot prediction would go unnoticed, keep disabled
+// until tested on hardware
+// 0 -> disabled
+// 1 -> enabled
+#define RX_GATING 0
+
+// Add the simulation of Micronet networks to the menu. It is a development tool, also run on the host by the native unit
+// tests, which is of no use on board.
+// 0 -> disabled
+// 1 -> enabled
+#define NETWORK_SIMULATOR 0
+
 // Define which compass axis will be compared to magnetic north
 // Set one of the (X, Y, Z) to 1.0 or -1.0
 #define HEADING_AXIS                                                                                                                                 \
@@ -135,6 +189,13 @@
         1.0f, 0.0f, 0.0f                                                                                                                             \
     }
 
+// Define which compass axis points to starboard, used to compute heel angle
+// Set one of the (X, Y, Z) to 1.0 or -1.0
+#define HEEL_AXIS                                                                                                                                    \
+    {                                                                                                                                                \
+        0.0f, -1.0f, 0.0f                                                                                                                            \
+    }
+
 /***************************************************************************/
 /*                                Types                                    */
 /***************************************************************************/
@@ -0,0 +1,249 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Non-blocking boot sequence                                    *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "BootSequencer.h"
+#include "BoardConfig.h"
+#include "Globals.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+void RfIsr();
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+static const char *phaseNames[BOOT_PHASE_DONE] = {"EEPROM configuration", "CC1101 reception", "Serial links", "Navigation compass",
+                                                   "Serial settling", "GNSS configuration"};
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+BootSequencer::BootSequencer()
+    : phase(BOOT_PHASE_CONFIGURATION), phaseStarted(false), startTime_ms(0), startTime_us(0), phaseStartTime_us(0), serialStartTime_ms(0)
+{
+    memset(phaseDuration_us, 0, sizeof(phaseDuration_us));
+    memset(phaseEndTime_us, 0, sizeof(phaseEndTime_us));
+}
+
+BootSequencer::~BootSequencer()
+{
+}
+
+// Start boot sequence. Phases which don't need to wait are run immediately, so that Micronet reception is started
+// as soon as possible. Remaining phases are run in background by Process().
+void BootSequencer::Start()
+{
+    startTime_ms = millis();
+    startTime_us = micros();
+    phase        = BOOT_PHASE_CONFIGURATION;
+    phaseStarted = false;
+
+    Process();
+}
+
+// Run boot phases until one has to wait or boot is complete
+// To be called periodically until IsComplete() returns true
+void BootSequencer::Process()
+{
+    while (phase < BOOT_PHASE_DONE)
+    {
+        bool phaseEntry = !phaseStarted;
+        if (phaseEntry)
+        {
+            phaseStarted      = true;
+            phaseStartTime_us = micros();
+        }
+
+        if (!RunPhase(phaseEntry))
+        {
+            return;
+        }
+
+        uint32_t now_us         = micros();
+        phaseDuration_us[phase] = now_us - phaseStartTime_us;
+        phaseEndTime_us[phase]  = now_us - startTime_us;
+        phase                   = (BootPhase_t)(phase + 1);
+        phaseStarted            = false;
+    }
+}
+
+bool BootSequencer::IsComplete()
+{
+    return (phase == BOOT_PHASE_DONE);
+}
+
+// Time at which boot sequence started, relative to reset
+uint32_t BootSequencer::GetStartTime_ms()
+{
+    return startTime_ms;
+}
+
+const char *BootSequencer::GetPhaseName(BootPhase_t phase)
+{
+    return phaseNames[phase];
+}
+
+// Time spent in a boot phase, including its waiting time
+uint32_t BootSequencer::GetPhaseDuration_us(BootPhase_t phase)
+{
+    return phaseDuration_us[phase];
+}
+
+// Time at which a boot phase completed, relative to boot sequence start. 0 if not completed yet.
+uint32_t BootSequencer::GetPhaseEndTime_us(BootPhase_t phase)
+{
+    return phaseEndTime_us[phase];
+}
+
+// Run one step of current phase, phaseEntry being true on the first step
+// Returns true if the phase is complete, false if it must be resumed later
+bool BootSequencer::RunPhase(bool phaseEntry)
+{
+    switch (phase)
+    {
+    case BOOT_PHASE_CONFIGURATION:
+        // CC1101 frequency offset is part of the configuration : it must be loaded first
+        gConfiguration.LoadFromEeprom();
+        return true;
+
+    case BOOT_PHASE_RADIO:
+        // Census is fed from RF ISR
+        gNetworkCensus.Init();
+
+        CONSOLE.print("Initializing CC1101 ... ");
+        // Check connection to CC1101
+        if (!gRfReceiver.Init(&gRxMessageFifo, gConfiguration.rfFrequencyOffset_MHz))
+        {
+            CONSOLE.println("Failed");
+            CONSOLE.println("Aborting execution : Verify connection to CC1101 board");
+            CONSOLE.println("Halted");
+
+            while (1)
+            {
+                digitalWrite(LED_BUILTIN, HIGH);
+                delay(500);
+                digitalWrite(LED_BUILTIN, LOW);
+                delay(500);
+            }
+        }
+        CONSOLE.println("OK");
+
+        // Start listening
+        gRfReceiver.RestartReception();
+
+        // Attach callback to GDO0 pin
+        // According to CC1101 configuration this callback will be executed when CC1101 will have detected Micronet's sync
+        // word
+#if defined(ARDUINO_TEENSY35) || defined(ARDUINO_TEENSY36)
+        attachInterrupt(digitalPinToInterrupt(GDO0_PIN), RfIsr, RISING);
+#else
+        attachInterrupt(digitalPinToInterrupt(GDO0_PIN), RfIsr, HIGH);
+#endif
+        return true;
+
+    case BOOT_PHASE_SERIAL_LINKS:
+        // Init GNSS NMEA serial link
+        GNSS_SERIAL.setRX(GNSS_RX_PIN);
+        GNSS_SERIAL.setTX(GNSS_TX_PIN);
+        GNSS_SERIAL.begin(GNSS_BAUDRATE);
+
+        // Init wired serial link
+        WIRED_NMEA.setRX(WIRED_RX_PIN);
+        WIRED_NMEA.setTX(WIRED_TX_PIN);
+        WIRED_NMEA.begin(WIRED_BAUDRATE);
+
+        serialStartTime_ms = millis();
+        return true;
+
+    case BOOT_PHASE_COMPASS:
+        CONSOLE.print("Initializing navigation compass ... ");
+        if (!gNavCompass.Init())
+        {
+            CONSOLE.println("NOT DETECTED");
+            gConfiguration.navCompassAvailable = false;
+        }
+        else
+        {
+            CONSOLE.print(gNavCompass.GetDeviceName().c_str());
+            CONSOLE.println(" Found");
+            gConfiguration.navCompassAvailable = true;
+        }
+        return true;
+
+    case BOOT_PHASE_SERIAL_SETTLING:
+        // Let time for serial drivers to set-up
+        return ((millis() - serialStartTime_ms) >= BOOT_SERIAL_SETTLING_TIME_MS);
+
+    case BOOT_PHASE_GNSS:
+#if (GNSS_UBLOXM8N == 1)
+        // M8N configuration steps are spaced by the delays it needs to apply them
+        if (phaseEntry)
+        {
+            uint32_t m8nConfig = (GNSS_UBX_NAV_PVT == 1) ? M8N_UBX_NAV_PVT : (M8N_GGA_ENABLE | M8N_VTG_ENABLE | M8N_RMC_ENABLE);
+            if (GNSS_NAV_RATE_HZ >= 10)
+            {
+                m8nConfig |= M8N_NAVRATE_10HZ;
+            }
+            else if (GNSS_NAV_RATE_HZ >= 5)
+            {
+                m8nConfig |= M8N_HISPEED_NAV;
+            }
+            gM8nDriver.Start(m8nConfig);
+        }
+        return gM8nDriver.Process();
+#else
+        (void)phaseEntry;
+        return true;
+#endif
+
+    default:
+        return true;
+    }
+}
+
+void RfIsr()
+{
+    gRfReceiver.RfIsr();
+}
@@ -0,0 +1,89 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Non-blocking boot sequence                                    *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef BOOTSEQUENCER_H_
+#define BOOTSEQUENCER_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Delay left to serial drivers to set-up before configuring GNSS
+#define BOOT_SERIAL_SETTLING_TIME_MS 250
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+typedef enum
+{
+    BOOT_PHASE_CONFIGURATION = 0,
+    BOOT_PHASE_RADIO,
+    BOOT_PHASE_SERIAL_LINKS,
+    BOOT_PHASE_COMPASS,
+    BOOT_PHASE_SERIAL_SETTLING,
+    BOOT_PHASE_GNSS,
+    BOOT_PHASE_DONE
+} BootPhase_t;
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class BootSequencer
+{
+  public:
+    BootSequencer();
+    virtual ~BootSequencer();
+
+    void        Start();
+    void        Process();
+    bool        IsComplete();
+    uint32_t    GetStartTime_ms();
+    const char *GetPhaseName(BootPhase_t phase);
+    uint32_t    GetPhaseDuration_us(BootPhase_t phase);
+    uint32_t    GetPhaseEndTime_us(BootPhase_t phase);
+
+  private:
+    BootPhase_t phase;
+    bool        phaseStarted;
+    uint32_t    startTime_ms;
+    uint32_t    startTime_us;
+    uint32_t    phaseStartTime_us;
+    uint32_t    serialStartTime_ms;
+    uint32_t    phaseDuration_us[BOOT_PHASE_DONE];
+    uint32_t    phaseEndTime_us[BOOT_PHASE_DONE];
+
+    bool RunPhase(bool phaseEntry);
+};
+
+#endif /* BOOTSEQUENCER_H_ */
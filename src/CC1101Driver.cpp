@@ -158,10 +158,9 @@ const uint8_t CC1101Driver::PA_TABLE[8] = {0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0
  * Initialize class attributes, SPI HW and pins
  */
 CC1101Driver::CC1101Driver()
-    : rfFreq_mHz(869.840), spiSettings(SPISettings(4000000, MSBFIRST, SPI_MODE0)), nextCSHigh(0), freqEstArrayIndex(0), currentFreqOff(0)
+    : rfFreq_mHz(869.840), spiSettings(SPISettings(4000000, MSBFIRST, SPI_MODE0)), nextCSHigh(0), currentFreqOff(0), trackedFreqOff(0),
+      trackedFreqOffVariance(FREQ_TRACKING_INITIAL_VARIANCE)
 {
-    memset(freqEstArray, 0, sizeof(freqEstArray));
-
     // Set SPI pins as per BoardConfig.h configuration
     SPI.setMOSI(MOSI_PIN);
     SPI.setMISO(MISO_PIN);
@@ -418,7 +417,10 @@ void CC1101Driver::SetFrequency(float freq_Mhz)
  */
 void CC1101Driver::Calibrate(void)
 {
-    currentFreqOff = 0;
+    // A new PLL calibration restarts frequency tracking from the nominal frequency
+    currentFreqOff         = 0;
+    trackedFreqOff         = 0;
+    trackedFreqOffVariance = FREQ_TRACKING_INITIAL_VARIANCE;
 
     // We consider here that frequencies can not be others than the ones
     // used by Micronet : 869.840 or 915.915 Mhz. Don't use this driver
@@ -893,35 +895,73 @@ void CC1101Driver::ChipDeselect(uint32_t guardTime_us)
 /*
  * Update CC1101 frequency offset compensation by checking
  * the result of the internal frequency estimator
+ * Estimations are merged with a scalar Kalman filter in which measurement
+ * noise increases when RSSI decreases. Correction is applied on each call
+ * but its amplitude is bounded to FREQ_TRACKING_MAX_STEP.
+ *   IN rssi -> RSSI of the packet which has just been received
  */
-void CC1101Driver::UpdateFreqOffset()
+void CC1101Driver::UpdateFreqOffset(int rssi)
 {
     int8_t freqEst;
+    float  measureNoise;
+    float  gain;
+    float  innovation;
+    float  correction;
+
+    // Read latest frequency offset estimation. It is relative to the offset currently programmed in FSCTRL0,
+    // which is the rounded value of trackedFreqOff : innovation is computed against what the chip actually uses.
+    freqEst    = SpiReadStatus(CC1101_FREQEST);
+    innovation = (float)(currentFreqOff + freqEst) - trackedFreqOff;
+
+    // Weak signals give noisier estimations : double measurement noise every 6dB below reference RSSI
+    measureNoise = FREQ_TRACKING_MEASURE_NOISE;
+    if (rssi < FREQ_TRACKING_RSSI_REF)
+    {
+        measureNoise *= exp2f((FREQ_TRACKING_RSSI_REF - rssi) / 6.0f);
+    }
 
-    // Read latest frequency offset estimation and store it in the averaging array
-    freqEst                           = SpiReadStatus(CC1101_FREQEST);
-    freqEstArray[freqEstArrayIndex++] = freqEst;
-
-    // Only calculate new offset when averaging array is full
-    if (freqEstArrayIndex >= FREQ_ESTIMATION_ARRAY_SIZE)
+    // Kalman update
+    trackedFreqOffVariance += FREQ_TRACKING_PROCESS_NOISE;
+    gain       = trackedFreqOffVariance / (trackedFreqOffVariance + measureNoise);
+    correction = gain * innovation;
+    trackedFreqOffVariance *= (1.0f - gain);
+
+    // Bound the correction to avoid jumps on corrupted estimations
+    if (correction > FREQ_TRACKING_MAX_STEP)
+        correction = FREQ_TRACKING_MAX_STEP;
+    if (correction < -FREQ_TRACKING_MAX_STEP)
+        correction = -FREQ_TRACKING_MAX_STEP;
+
+    // Clip value to 8 bit
+    trackedFreqOff += correction;
+    if (trackedFreqOff > 127.0f)
+        trackedFreqOff = 127.0f;
+    if (trackedFreqOff < -128.0f)
+        trackedFreqOff = -128.0f;
+
+    // Only write the register when its value actually changes
+    int8_t newFreqOff = (int8_t)lroundf(trackedFreqOff);
+    if (newFreqOff != currentFreqOff)
     {
-        int32_t avgFreqEst = 0;
-        freqEstArrayIndex  = 0;
-        // Calculate average frequency offset
-        for (int i = 0; i < FREQ_ESTIMATION_ARRAY_SIZE; i++)
-        {
-            avgFreqEst += freqEstArray[i];
-        }
-        avgFreqEst /= FREQ_ESTIMATION_ARRAY_SIZE;
-
-        // Clip value to 8 bit
-        int32_t newFreqOff = currentFreqOff + avgFreqEst;
-        if (newFreqOff >= 127)
-            newFreqOff = 127;
-        if (newFreqOff <= -128)
-            newFreqOff = -128;
-        // Update offset
         currentFreqOff = newFreqOff;
         SpiWriteReg(CC1101_FSCTRL0, currentFreqOff, 8);
     }
 }
+
+/*
+ * Get the frequency offset currently applied by the tracking loop
+ * RETURN offset in MHz, relative to the frequency given to SetFrequency
+ */
+float CC1101Driver::GetFreqOffset_MHz()
+{
+    return trackedFreqOff * FREQ_OFFSET_STEP_MHZ;
+}
+
+/*
+ * Tells if frequency tracking loop has converged
+ * RETURN true if the uncertainty of the tracked offset is low enough
+ */
+bool CC1101Driver::IsFreqTrackingLocked()
+{
+    return (trackedFreqOffVariance < FREQ_TRACKING_LOCK_VARIANCE);
+}
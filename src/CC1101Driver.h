@@ -38,11 +38,17 @@
 /*                              Constants                                  */
 /***************************************************************************/
 
-/* Number of samples that will be used to evaluate the frequency deviation
- * between MicronetToNMEA and Micronet's master device
- * A value of 32 means that frequency deviation will be averaged on 32 seconds
- * before applying a correction */
-#define FREQ_ESTIMATION_ARRAY_SIZE 32
+/* Frequency tracking loop parameters. Frequency deviation between MicronetToNMEA and
+ * Micronet's master device is tracked with a scalar Kalman filter updated on each
+ * master request (i.e. every second). Offsets and variances are expressed in FREQOFF
+ * register units (Fxosc/2^14 = ~1.59kHz) */
+#define FREQ_TRACKING_INITIAL_VARIANCE 16.0f  // Initial uncertainty of the offset, allows fast lock after boot
+#define FREQ_TRACKING_PROCESS_NOISE    0.01f  // XTAL drift allowed between two master requests
+#define FREQ_TRACKING_MEASURE_NOISE    1.0f   // FREQEST noise on a strong signal
+#define FREQ_TRACKING_RSSI_REF         -70    // RSSI above which measurement noise is considered minimal
+#define FREQ_TRACKING_MAX_STEP         0.5f   // Maximum correction applied in one cycle
+#define FREQ_TRACKING_LOCK_VARIANCE    0.2f   // Variance under which the loop is considered locked
+#define FREQ_OFFSET_STEP_MHZ           (26.0f / 16384.0f)
 
 // CC1101 Constants to define RX FIFO thresholds
 #define CC1101_RXFIFOTHR_4  0x00
@@ -123,15 +129,17 @@ class CC1101Driver
     void    SetFifoThreshold(uint8_t fifoThreshold);
     void    FlushRxFifo();
     void    FlushTxFifo();
-    void    UpdateFreqOffset();
+    void    UpdateFreqOffset(int rssi);
+    float   GetFreqOffset_MHz();
+    bool    IsFreqTrackingLocked();
 
   private:
     float                rfFreq_mHz;
     SPISettings          spiSettings;
     uint32_t             nextCSHigh;
-    int                  freqEstArrayIndex;
-    int8_t               freqEstArray[FREQ_ESTIMATION_ARRAY_SIZE];
     int8_t               currentFreqOff;
+    float                trackedFreqOff;
+    float                trackedFreqOffVariance;
     static const uint8_t PA_TABLE[8];
 
     void    Reset(void);
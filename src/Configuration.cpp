@@ -29,16 +29,32 @@
 /***************************************************************************/
 
 #include "Configuration.h"
+#include "BoardConfig.h"
 
 #include <Arduino.h>
 #include <EEPROM.h>
+#include <stddef.h>
+#include <string.h>
 
 /***************************************************************************/
 /*                              Constants                                  */
 /***************************************************************************/
 
-#define EEPROM_CONFIG_OFFSET 0
-#define CONFIG_MAGIC_NUMBER  0x4D544E4D
+#define EEPROM_CONFIG_OFFSET     0
+#define CONFIG_MAGIC_NUMBER      0x4D544E4D
+#define EEPROM_CONFIG_EXT_OFFSET (EEPROM_CONFIG_OFFSET + sizeof(ConfigBlock_t))
+#define CONFIG_EXT_MAGIC_NUMBER  0x4D544E45
+
+// The journal splits the EEPROM in two banks. Each bank starts with a header followed by a log of records, each record
+// holding the new value of one parameter. When the active bank is full, the latest values are compacted into the other
+// bank, which becomes active once its header has been written.
+#define CONFIG_JOURNAL_MAGIC_NUMBER 0x4D544E4A
+// Field ID marking the end of the log (erased EEPROM value)
+#define CONFIG_RECORD_END 0xff
+// Record overhead : field ID and CRC
+#define CONFIG_RECORD_OVERHEAD 2
+// Delay after the last save request before writing to EEPROM, so that bursts of changes are coalesced
+#define CONFIG_SAVE_DELAY_MS 5000
 
 /***************************************************************************/
 /*                             Local types                                 */
@@ -64,21 +80,72 @@ typedef struct
     float    rfFrequencyOffset_MHz;
     uint8_t  checksum;
 } ConfigBlock_t;
+
+// Extension block, stored right after the main block so that configurations saved by older versions remain valid
+typedef struct
+{
+    uint32_t magicWord;
+    float    magSoftIron[3][3];
+    uint8_t  checksum;
+} ConfigExtBlock_t;
+
+typedef struct
+{
+    uint32_t magicWord;
+    uint32_t sequence;
+    uint8_t  crc;
+} JournalHeader_t;
 #pragma pack()
 
+typedef struct
+{
+    uint8_t offset;
+    uint8_t size;
+} ConfigField_t;
+
 /***************************************************************************/
 /*                           Local prototypes                              */
 /***************************************************************************/
 
+uint8_t BlockChecksum(uint8_t *block, uint32_t length);
+uint8_t Crc8(const uint8_t *data, uint32_t length, uint8_t crc);
+
 /***************************************************************************/
 /*                               Globals                                   */
 /***************************************************************************/
 
+// Journaled parameters, indexed by field ID. Fields IDs are stored in EEPROM : only append new fields to this table.
+static const ConfigField_t configFields[] = {
+    {offsetof(ConfigImage_t, networkId), sizeof(uint32_t)},
+    {offsetof(ConfigImage_t, deviceId), sizeof(uint32_t)},
+    {offsetof(ConfigImage_t, waterSpeedFactor_per), sizeof(float)},
+    {offsetof(ConfigImage_t, waterTemperatureOffset_C), sizeof(float)},
+    {offsetof(ConfigImage_t, depthOffset_m), sizeof(float)},
+    {offsetof(ConfigImage_t, windSpeedFactor_per), sizeof(float)},
+    {offsetof(ConfigImage_t, windDirectionOffset_deg), sizeof(float)},
+    {offsetof(ConfigImage_t, headingOffset_deg), sizeof(float)},
+    {offsetof(ConfigImage_t, magneticVariation_deg), sizeof(float)},
+    {offsetof(ConfigImage_t, windShift), sizeof(float)},
+    {offsetof(ConfigImage_t, xMagOffset), sizeof(float)},
+    {offsetof(ConfigImage_t, yMagOffset), sizeof(float)},
+    {offsetof(ConfigImage_t, zMagOffset), sizeof(float)},
+    {offsetof(ConfigImage_t, rfFrequencyOffset_MHz), sizeof(float)},
+    {offsetof(ConfigImage_t, magSoftIron), sizeof(float[3][3])},
+    {offsetof(ConfigImage_t, sourceLink), sizeof(uint8_t[DATA_SOURCE_NB])},
+    {offsetof(ConfigImage_t, sogCogFilteringDepth), sizeof(uint8_t)},
+    {offsetof(ConfigImage_t, spdEmulation), sizeof(uint8_t)},
+    {offsetof(ConfigImage_t, nmeaExtPort), sizeof(uint8_t)},
+};
+
+#define CONFIG_NB_FIELDS ((int)(sizeof(configFields) / sizeof(configFields[0])))
+
 /***************************************************************************/
 /*                              Functions                                  */
 /***************************************************************************/
 
-Configuration::Configuration() : magicNumberFound(false), checksumValid(false)
+Configuration::Configuration()
+    : magicNumberFound(false), checksumValid(false), activeBank(-1), bankSequence(0), logEnd(0), compactBank(0), compactField(-1),
+      compactEnd(0), savePending(false), saveRequestTime(0), nbCompactions(0)
 {
     // Set default configuration
     navCompassAvailable      = false;
@@ -96,13 +163,220 @@ Configuration::Configuration() : magicNumberFound(false), checksumValid(false)
     yMagOffset               = 0;
     zMagOffset               = 0;
     rfFrequencyOffset_MHz    = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            magSoftIron[i][j] = (i == j) ? 1.0f : 0.0f;
+        }
+    }
+    sourceLink[DATA_SOURCE_NAV]     = NAV_SOURCE_LINK;
+    sourceLink[DATA_SOURCE_GNSS]    = GNSS_SOURCE_LINK;
+    sourceLink[DATA_SOURCE_WIND]    = WIND_SOURCE_LINK;
+    sourceLink[DATA_SOURCE_DEPTH]   = DEPTH_SOURCE_LINK;
+    sourceLink[DATA_SOURCE_SPEED]   = SPEED_SOURCE_LINK;
+    sourceLink[DATA_SOURCE_VOLTAGE] = VOLTAGE_SOURCE_LINK;
+    sourceLink[DATA_SOURCE_SEATEMP] = SEATEMP_SOURCE_LINK;
+    sourceLink[DATA_SOURCE_COMPASS] = COMPASS_SOURCE_LINK;
+    sogCogFilteringDepth            = (SOG_COG_FILTERING == 1) ? SOG_COG_FILTERING_DEPTH : 1;
+    spdEmulation                    = (EMULATE_SPD_WITH_SOG == 1);
+    nmeaExtPort                     = NMEA_EXT_PORT;
+    ToImage(&persistedImage);
 }
 
 Configuration::~Configuration()
 {
 }
 
+// Load configuration by replaying the EEPROM journal
+// Falls back to the fixed configuration blocks written by older versions if no journal is found
 void Configuration::LoadFromEeprom()
+{
+    if (!LoadJournal())
+    {
+        LoadLegacyBlocks();
+    }
+
+    // Parameters loaded from legacy blocks are only moved to the journal on the next change
+    ToImage(&persistedImage);
+}
+
+// Write all pending configuration changes to EEPROM before returning
+void Configuration::SaveToEeprom()
+{
+    while (WriteStep())
+        ;
+    savePending = false;
+}
+
+// Request configuration changes to be written to EEPROM. Writing is deferred to ProcessPendingSave so that successive
+// changes are coalesced and so that EEPROM accesses never delay time critical tasks.
+void Configuration::RequestSave()
+{
+    savePending     = true;
+    saveRequestTime = millis();
+}
+
+// Write at most one journal step, once no new save request has been made for CONFIG_SAVE_DELAY_MS
+// To be called periodically
+void Configuration::ProcessPendingSave()
+{
+    if (savePending && ((millis() - saveRequestTime) >= CONFIG_SAVE_DELAY_MS))
+    {
+        savePending = WriteStep();
+    }
+}
+
+// Returns the share of the active journal bank already used
+float Configuration::GetJournalUsage_per()
+{
+    if (activeBank < 0)
+    {
+        return 0;
+    }
+
+    return (100.0f * (logEnd - BankOffset(activeBank))) / BankSize();
+}
+
+int Configuration::GetNbCompactions()
+{
+    return nbCompactions;
+}
+
+void Configuration::ToImage(ConfigImage_t *image)
+{
+    image->networkId                = networkId;
+    image->deviceId                 = deviceId;
+    image->waterSpeedFactor_per     = waterSpeedFactor_per;
+    image->waterTemperatureOffset_C = waterTemperatureOffset_C;
+    image->depthOffset_m            = depthOffset_m;
+    image->windSpeedFactor_per      = windSpeedFactor_per;
+    image->windDirectionOffset_deg  = windDirectionOffset_deg;
+    image->headingOffset_deg        = headingOffset_deg;
+    image->magneticVariation_deg    = magneticVariation_deg;
+    image->windShift                = windShift;
+    image->xMagOffset               = xMagOffset;
+    image->yMagOffset               = yMagOffset;
+    image->zMagOffset               = zMagOffset;
+    image->rfFrequencyOffset_MHz    = rfFrequencyOffset_MHz;
+    memcpy(image->magSoftIron, magSoftIron, sizeof(magSoftIron));
+    for (int i = 0; i < DATA_SOURCE_NB; i++)
+    {
+        image->sourceLink[i] = sourceLink[i];
+    }
+    image->sogCogFilteringDepth = sogCogFilteringDepth;
+    image->spdEmulation         = spdEmulation ? 1 : 0;
+    image->nmeaExtPort          = nmeaExtPort;
+}
+
+void Configuration::FromImage(ConfigImage_t *image)
+{
+    networkId                = image->networkId;
+    deviceId                 = image->deviceId;
+    waterSpeedFactor_per     = image->waterSpeedFactor_per;
+    waterTemperatureOffset_C = image->waterTemperatureOffset_C;
+    depthOffset_m            = image->depthOffset_m;
+    windSpeedFactor_per      = image->windSpeedFactor_per;
+    windDirectionOffset_deg  = image->windDirectionOffset_deg;
+    headingOffset_deg        = image->headingOffset_deg;
+    magneticVariation_deg    = image->magneticVariation_deg;
+    windShift                = image->windShift;
+    xMagOffset               = image->xMagOffset;
+    yMagOffset               = image->yMagOffset;
+    zMagOffset               = image->zMagOffset;
+    rfFrequencyOffset_MHz    = image->rfFrequencyOffset_MHz;
+    memcpy(magSoftIron, image->magSoftIron, sizeof(magSoftIron));
+    // Out of range link settings are ignored, keeping their previous value
+    for (int i = 0; i < DATA_SOURCE_NB; i++)
+    {
+        if (image->sourceLink[i] < LINK_NB_LINKS)
+        {
+            sourceLink[i] = (LinkId_t)image->sourceLink[i];
+        }
+    }
+    if ((image->sogCogFilteringDepth >= 1) && (image->sogCogFilteringDepth <= SOG_COG_MAX_FILTERING_DEPTH))
+    {
+        sogCogFilteringDepth = image->sogCogFilteringDepth;
+    }
+    spdEmulation = (image->spdEmulation != 0);
+    if (image->nmeaExtPort < NMEA_PORT_NB)
+    {
+        nmeaExtPort = (NmeaPort_t)image->nmeaExtPort;
+    }
+}
+
+// Replay the records of the most recent journal bank on top of default values
+// Returns false if no valid journal bank has been found
+bool Configuration::LoadJournal()
+{
+    uint32_t sequence[2];
+    bool     bankValid[2];
+
+    bankValid[0] = ReadBankHeader(0, &sequence[0]);
+    bankValid[1] = ReadBankHeader(1, &sequence[1]);
+
+    if (bankValid[0] && bankValid[1])
+    {
+        activeBank = ((int32_t)(sequence[1] - sequence[0]) > 0) ? 1 : 0;
+    }
+    else if (bankValid[0] || bankValid[1])
+    {
+        activeBank = bankValid[0] ? 0 : 1;
+    }
+    else
+    {
+        return false;
+    }
+
+    ConfigImage_t image;
+    uint8_t      *pImage  = (uint8_t *)(&image);
+    uint32_t      offset  = BankOffset(activeBank) + sizeof(JournalHeader_t);
+    uint32_t      bankEnd = BankOffset(activeBank) + BankSize();
+
+    bankSequence     = sequence[activeBank];
+    magicNumberFound = true;
+    checksumValid    = true;
+    ToImage(&image);
+
+    while (offset < bankEnd)
+    {
+        uint8_t fieldId = EEPROM.read(offset);
+        if (fieldId == CONFIG_RECORD_END)
+        {
+            break;
+        }
+
+        // Unknown field or corrupted record : stop replay here, next records will overwrite it
+        uint32_t size = (fieldId < CONFIG_NB_FIELDS) ? configFields[fieldId].size : 0;
+        if ((size == 0) || (offset + size + CONFIG_RECORD_OVERHEAD > bankEnd))
+        {
+            checksumValid = false;
+            break;
+        }
+
+        uint8_t data[sizeof(ConfigImage_t)];
+        for (uint32_t i = 0; i < size; i++)
+        {
+            data[i] = EEPROM.read(offset + 1 + i);
+        }
+        if (Crc8(data, size, Crc8(&fieldId, 1, 0)) != EEPROM.read(offset + 1 + size))
+        {
+            checksumValid = false;
+            break;
+        }
+
+        memcpy(pImage + configFields[fieldId].offset, data, size);
+        offset += size + CONFIG_RECORD_OVERHEAD;
+    }
+
+    logEnd = offset;
+    FromImage(&image);
+
+    return true;
+}
+
+// Load configuration blocks written at fixed EEPROM addresses by older versions
+void Configuration::LoadLegacyBlocks()
 {
     ConfigBlock_t configBlock = {0};
 
@@ -139,47 +413,160 @@ void Configuration::LoadFromEeprom()
             rfFrequencyOffset_MHz    = configBlock.rfFrequencyOffset_MHz;
         }
     }
+
+    ConfigExtBlock_t extBlock = {0};
+
+    EEPROM.get(EEPROM_CONFIG_EXT_OFFSET, extBlock);
+    if ((extBlock.magicWord == CONFIG_EXT_MAGIC_NUMBER) &&
+        (extBlock.checksum == BlockChecksum((uint8_t *)(&extBlock), sizeof(ConfigExtBlock_t) - 1)))
+    {
+        memcpy(magSoftIron, extBlock.magSoftIron, sizeof(magSoftIron));
+    }
 }
 
-void Configuration::SaveToEeprom()
+// Write at most one step of the pending configuration changes to EEPROM : a record, a bank header or a bank
+// invalidation. Returns false once the journal is up to date.
+bool Configuration::WriteStep()
 {
-    ConfigBlock_t eepromBlock = {0};
-    ConfigBlock_t configBlock = {0};
+    ConfigImage_t image;
+    uint8_t      *pImage     = (uint8_t *)(&image);
+    uint8_t      *pPersisted = (uint8_t *)(&persistedImage);
+    uint8_t      *pCompact   = (uint8_t *)(&compactImage);
+
+    ToImage(&image);
 
-    uint8_t *pEepromBlock = (uint8_t *)(&eepromBlock);
-    uint8_t *pConfig      = (uint8_t *)(&configBlock);
-    uint8_t  checksum     = 0;
+    if (compactField < 0)
+    {
+        // Look for a parameter which changed since it was last written
+        int fieldId = -1;
+        for (int i = 0; i < CONFIG_NB_FIELDS; i++)
+        {
+            if (memcmp(pImage + configFields[i].offset, pPersisted + configFields[i].offset, configFields[i].size) != 0)
+            {
+                fieldId = i;
+                break;
+            }
+        }
 
-    EEPROM.get(0, eepromBlock);
+        if (fieldId < 0)
+        {
+            return false;
+        }
 
-    configBlock.magicWord                = CONFIG_MAGIC_NUMBER;
-    configBlock.attachedNetworkId        = networkId;
-    configBlock.deviceId                 = deviceId;
-    configBlock.waterSpeedFactor_per     = waterSpeedFactor_per;
-    configBlock.waterTemperatureOffset_C = waterTemperatureOffset_C;
-    configBlock.depthOffset_m            = depthOffset_m;
-    configBlock.windSpeedFactor_per      = windSpeedFactor_per;
-    configBlock.windDirectionOffset_deg  = windDirectionOffset_deg;
-    configBlock.headingOffset_deg        = headingOffset_deg;
-    configBlock.magneticVariation_deg    = magneticVariation_deg;
-    configBlock.windShift                = windShift;
-    configBlock.xMagOffset               = xMagOffset;
-    configBlock.yMagOffset               = yMagOffset;
-    configBlock.zMagOffset               = zMagOffset;
-    configBlock.rfFrequencyOffset_MHz    = rfFrequencyOffset_MHz;
+        // Append it to the active bank if there is room left for the record and the end marker
+        uint32_t size = configFields[fieldId].size;
+        if ((activeBank >= 0) && (logEnd + size + CONFIG_RECORD_OVERHEAD < BankOffset(activeBank) + BankSize()))
+        {
+            WriteRecord(logEnd, fieldId, &image);
+            memcpy(pPersisted + configFields[fieldId].offset, pImage + configFields[fieldId].offset, size);
+            logEnd += size + CONFIG_RECORD_OVERHEAD;
+            return true;
+        }
+
+        // Active bank is full or journal does not exist yet : compact latest values into the other bank. On first use,
+        // bank 1 is used so that legacy configuration blocks remain readable until the journal is valid.
+        compactBank  = (activeBank == 1) ? 0 : 1;
+        compactField = 0;
+        compactEnd   = BankOffset(compactBank) + sizeof(JournalHeader_t);
+        EEPROM.update(BankOffset(compactBank), 0);
+        return true;
+    }
 
-    for (uint32_t i = 0; i < sizeof(ConfigBlock_t) - 1; i++)
+    if (compactField < CONFIG_NB_FIELDS)
     {
-        checksum += pConfig[i];
+        uint32_t size = configFields[compactField].size;
+        WriteRecord(compactEnd, compactField, &image);
+        memcpy(pCompact + configFields[compactField].offset, pImage + configFields[compactField].offset, size);
+        compactEnd += size + CONFIG_RECORD_OVERHEAD;
+        compactField++;
+        return true;
     }
-    configBlock.checksum = checksum;
 
-    for (uint32_t i = 0; i < sizeof(ConfigBlock_t); i++)
+    // All parameters have been written : validate the new bank, which becomes the active one
+    WriteBankHeader(compactBank, bankSequence + 1);
+    bankSequence++;
+    activeBank     = compactBank;
+    logEnd         = compactEnd;
+    persistedImage = compactImage;
+    compactField   = -1;
+    nbCompactions++;
+
+    return true;
+}
+
+// Write one record. The end marker following the record is written first and the field ID last, so that a record
+// interrupted by a power loss is ignored at next boot.
+void Configuration::WriteRecord(uint32_t offset, uint8_t fieldId, ConfigImage_t *image)
+{
+    uint32_t size = configFields[fieldId].size;
+    uint8_t *data = ((uint8_t *)image) + configFields[fieldId].offset;
+
+    EEPROM.update(offset + size + CONFIG_RECORD_OVERHEAD, CONFIG_RECORD_END);
+    for (uint32_t i = 0; i < size; i++)
+    {
+        EEPROM.update(offset + 1 + i, data[i]);
+    }
+    EEPROM.update(offset + 1 + size, Crc8(data, size, Crc8(&fieldId, 1, 0)));
+    EEPROM.update(offset, fieldId);
+}
+
+bool Configuration::ReadBankHeader(int bank, uint32_t *sequence)
+{
+    JournalHeader_t header;
+
+    EEPROM.get(BankOffset(bank), header);
+    if ((header.magicWord != CONFIG_JOURNAL_MAGIC_NUMBER) || (header.crc != Crc8((uint8_t *)(&header), sizeof(JournalHeader_t) - 1, 0)))
+    {
+        return false;
+    }
+
+    *sequence = header.sequence;
+    return true;
+}
+
+void Configuration::WriteBankHeader(int bank, uint32_t sequence)
+{
+    JournalHeader_t header;
+
+    header.magicWord = CONFIG_JOURNAL_MAGIC_NUMBER;
+    header.sequence  = sequence;
+    header.crc       = Crc8((uint8_t *)(&header), sizeof(JournalHeader_t) - 1, 0);
+    EEPROM.put(BankOffset(bank), header);
+}
+
+uint32_t Configuration::BankOffset(int bank)
+{
+    return bank * BankSize();
+}
+
+uint32_t Configuration::BankSize()
+{
+    return EEPROM.length() / 2;
+}
+
+uint8_t BlockChecksum(uint8_t *block, uint32_t length)
+{
+    uint8_t checksum = 0;
+
+    for (uint32_t i = 0; i < length; i++)
     {
-        if (pEepromBlock[i] != pConfig[i])
+        checksum += block[i];
+    }
+
+    return checksum;
+}
+
+// CRC-8, polynomial 0x07
+uint8_t Crc8(const uint8_t *data, uint32_t length, uint8_t crc)
+{
+    for (uint32_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++)
         {
-            EEPROM.put(0, configBlock);
-            break;
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
         }
     }
+
+    return crc;
 }
@@ -37,29 +37,48 @@
 /*                              Constants                                  */
 /***************************************************************************/
 
-/***************************************************************************/
-/*                                Types                                    */
-/***************************************************************************/
+#define SOG_COG_MAX_FILTERING_DEPTH 20
 
 /***************************************************************************/
-/*                               Classes                                   */
+/*                                Types                                    */
 /***************************************************************************/
 
-class Configuration
+// Links from which data can be received
+typedef enum
 {
-  public:
-    Configuration();
-    virtual ~Configuration();
+    LINK_NMEA_EXT = 0,
+    LINK_NMEA_GNSS,
+    LINK_MICRONET,
+    LINK_COMPASS,
+    LINK_NB_LINKS
+} LinkId_t;
 
-    void LoadFromEeprom();
-    void SaveToEeprom();
+// Groups of data whose source link can be selected
+typedef enum
+{
+    DATA_SOURCE_NAV = 0, // Navigation data (RMB)
+    DATA_SOURCE_GNSS,    // Positionning data (RMC, GGA, GLL, VTG)
+    DATA_SOURCE_WIND,    // Wind data (MWV)
+    DATA_SOURCE_DEPTH,   // Depth data (DPT)
+    DATA_SOURCE_SPEED,   // Speed data (VHW, VLW)
+    DATA_SOURCE_VOLTAGE, // Battery voltage data (XDR)
+    DATA_SOURCE_SEATEMP, // Temperature data (MTW)
+    DATA_SOURCE_COMPASS, // Heading data (HDG)
+    DATA_SOURCE_NB
+} DataSource_t;
 
-    // The following parameters are NOT loaded/saved from/to EEPROM
-    bool navCompassAvailable;
-    bool magicNumberFound;
-    bool checksumValid;
+// Serial ports on which NMEA sentences can be exchanged
+typedef enum
+{
+    NMEA_PORT_USB = 0,
+    NMEA_PORT_WIRED,
+    NMEA_PORT_NB
+} NmeaPort_t;
 
-    // The following parameters are loaded/saved from/to EEPROM
+// Image of the parameters stored in the EEPROM journal
+#pragma pack(1)
+typedef struct
+{
     uint32_t networkId;
     uint32_t deviceId;
     float    waterSpeedFactor_per;
@@ -74,6 +93,80 @@ class Configuration
     float    yMagOffset;
     float    zMagOffset;
     float    rfFrequencyOffset_MHz;
+    float    magSoftIron[3][3];
+    uint8_t  sourceLink[DATA_SOURCE_NB];
+    uint8_t  sogCogFilteringDepth;
+    uint8_t  spdEmulation;
+    uint8_t  nmeaExtPort;
+} ConfigImage_t;
+#pragma pack()
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class Configuration
+{
+  public:
+    Configuration();
+    virtual ~Configuration();
+
+    void  LoadFromEeprom();
+    void  SaveToEeprom();
+    void  RequestSave();
+    void  ProcessPendingSave();
+    float GetJournalUsage_per();
+    int   GetNbCompactions();
+
+    // The following parameters are NOT loaded/saved from/to EEPROM
+    bool navCompassAvailable;
+    bool magicNumberFound;
+    bool checksumValid;
+
+    // The following parameters are loaded/saved from/to EEPROM
+    uint32_t   networkId;
+    uint32_t   deviceId;
+    float      waterSpeedFactor_per;
+    float      waterTemperatureOffset_C;
+    float      depthOffset_m;
+    float      windSpeedFactor_per;
+    float      windDirectionOffset_deg;
+    float      headingOffset_deg;
+    float      magneticVariation_deg;
+    float      windShift;
+    float      xMagOffset;
+    float      yMagOffset;
+    float      zMagOffset;
+    float      rfFrequencyOffset_MHz;
+    float      magSoftIron[3][3];          // Soft iron correction matrix, applied after hard iron offsets
+    LinkId_t   sourceLink[DATA_SOURCE_NB]; // Link from which each group of data is received
+    uint8_t    sogCogFilteringDepth;       // Depth of COG/SOG filter, 1 disables filtering
+    bool       spdEmulation;               // Emulate water speed (SPD) with SOG from GNSS
+    NmeaPort_t nmeaExtPort;                // Port on which NMEA sentences are exchanged with external devices
+
+  private:
+    ConfigImage_t persistedImage;  // Parameter values currently stored in the journal
+    ConfigImage_t compactImage;    // Parameter values written so far in the bank being compacted
+    int           activeBank;      // Journal bank holding the latest values, -1 if no journal has been written yet
+    uint32_t      bankSequence;    // Sequence number of the active bank
+    uint32_t      logEnd;          // EEPROM offset where the next record will be appended
+    int           compactBank;     // Bank being compacted
+    int           compactField;    // Next field to write in the bank being compacted, -1 if no compaction is running
+    uint32_t      compactEnd;      // EEPROM offset of the next record in the bank being compacted
+    bool          savePending;     // Some parameters changed and must be written to the journal
+    uint32_t      saveRequestTime; // Time of the last save request, in milliseconds
+    int           nbCompactions;
+
+    void     ToImage(ConfigImage_t *image);
+    void     FromImage(ConfigImage_t *image);
+    bool     LoadJournal();
+    void     LoadLegacyBlocks();
+    bool     WriteStep();
+    void     WriteRecord(uint32_t offset, uint8_t fieldId, ConfigImage_t *image);
+    bool     ReadBankHeader(int bank, uint32_t *sequence);
+    void     WriteBankHeader(int bank, uint32_t sequence);
+    uint32_t BankOffset(int bank);
+    uint32_t BankSize();
 };
 
 /***************************************************************************/
@@ -0,0 +1,165 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Learning of the master's network cycle period                 *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "CyclePeriodEstimator.h"
+
+#include <math.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Until the estimator has learned enough cycles, the prediction covers a crystal mismatch of 200ppm
+#define CYCLE_MIN_SAMPLES      4
+#define CYCLE_DEFAULT_BOUND_US 200
+#define CYCLE_MIN_BOUND_US     30
+// Error bound in number of average absolute errors (about 3 standard deviations)
+#define CYCLE_BOUND_FACTOR 4
+// Learning gain decreases as 1/n down to this value, which then sets the time constant of the average
+#define CYCLE_MIN_GAIN 0.125f
+// Intervals spanning more cycles (missed MASTER_REQUEST frames) only re-anchor the prediction
+#define CYCLE_MAX_MISSED 8
+// A cycle further than this from prediction is an outlier. Successive outliers mean that the master changed its timing.
+#define CYCLE_OUTLIER_US   2000
+#define CYCLE_MAX_OUTLIERS 3
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+CyclePeriodEstimator::CyclePeriodEstimator()
+{
+    Reset();
+}
+
+CyclePeriodEstimator::~CyclePeriodEstimator()
+{
+}
+
+void CyclePeriodEstimator::Reset()
+{
+    anchored             = false;
+    lastStart_us         = 0;
+    period_us            = CYCLE_NOMINAL_PERIOD_US;
+    residualDev_us       = 0;
+    nbSamples            = 0;
+    nbOutliers           = 0;
+    nbSuccessiveOutliers = 0;
+    maxResidual_us       = 0;
+}
+
+// Account the start time of a MASTER_REQUEST, as timestamped by RfDriver
+void CyclePeriodEstimator::AddMasterRequest(uint32_t start_us)
+{
+    if (!anchored)
+    {
+        lastStart_us = start_us;
+        anchored     = true;
+        return;
+    }
+
+    uint32_t interval_us = start_us - lastStart_us;
+    uint32_t nbCycles    = (interval_us + CYCLE_NOMINAL_PERIOD_US / 2) / CYCLE_NOMINAL_PERIOD_US;
+
+    lastStart_us = start_us;
+    if ((nbCycles == 0) || (nbCycles > CYCLE_MAX_MISSED))
+    {
+        return;
+    }
+
+    float residual_us = (float)interval_us - nbCycles * period_us;
+    if ((nbSamples >= CYCLE_MIN_SAMPLES) && (fabsf(residual_us) > CYCLE_OUTLIER_US))
+    {
+        nbOutliers++;
+        if (++nbSuccessiveOutliers >= CYCLE_MAX_OUTLIERS)
+        {
+            Reset();
+            lastStart_us = start_us;
+            anchored     = true;
+        }
+        return;
+    }
+    nbSuccessiveOutliers = 0;
+
+    nbSamples++;
+    float gain = 1.0f / nbSamples;
+    if (gain < CYCLE_MIN_GAIN)
+    {
+        gain = CYCLE_MIN_GAIN;
+    }
+
+    // The error of an interval spanning several cycles is spread over them
+    period_us += gain * residual_us / nbCycles;
+    if (nbSamples > 1)
+    {
+        // The first residual mostly measures the nominal period error, not the jitter
+        residualDev_us += gain * (fabsf(residual_us / nbCycles) - residualDev_us);
+        if (fabsf(residual_us) > maxResidual_us)
+        {
+            maxResidual_us = (uint32_t)fabsf(residual_us);
+        }
+    }
+}
+
+// Returns the predicted start of the network cycle coming nbCycles after the last MASTER_REQUEST
+uint32_t CyclePeriodEstimator::PredictStart_us(uint32_t nbCycles)
+{
+    return lastStart_us + (uint32_t)(nbCycles * period_us + 0.5f);
+}
+
+// Returns the bound of the error of PredictStart_us(nbCycles). The period error accumulates over cycles while timestamp
+// jitter does not : growing the bound linearly is conservative.
+uint32_t CyclePeriodEstimator::PredictErrorBound_us(uint32_t nbCycles)
+{
+    return nbCycles * GetErrorBound_us();
+}
+
+// Returns the bound of the prediction error : the next cycle starts within PredictStart_us(1) +/- this value
+uint32_t CyclePeriodEstimator::GetErrorBound_us()
+{
+    if (nbSamples < CYCLE_MIN_SAMPLES)
+    {
+        return CYCLE_DEFAULT_BOUND_US;
+    }
+
+    uint32_t bound_us = (uint32_t)(CYCLE_BOUND_FACTOR * residualDev_us + 0.5f);
+
+    return (bound_us < CYCLE_MIN_BOUND_US) ? CYCLE_MIN_BOUND_US : bound_us;
+}
+
+void CyclePeriodEstimator::GetStatistics(CycleStatistics_t *statistics)
+{
+    statistics->period_us      = period_us;
+    statistics->drift_ppm      = (period_us - CYCLE_NOMINAL_PERIOD_US) * (1000000.0f / CYCLE_NOMINAL_PERIOD_US);
+    statistics->errorBound_us  = GetErrorBound_us();
+    statistics->nbSamples      = nbSamples;
+    statistics->nbOutliers     = nbOutliers;
+    statistics->maxResidual_us = maxResidual_us;
+}
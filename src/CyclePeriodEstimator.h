@@ -0,0 +1,86 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Learning of the master's network cycle period                 *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef CYCLEPERIODESTIMATOR_H_
+#define CYCLEPERIODESTIMATOR_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define CYCLE_NOMINAL_PERIOD_US 1000000
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+typedef struct
+{
+    float    period_us;      // Learned period of the master's network cycle, in our clock
+    float    drift_ppm;      // Period error relative to the nominal period : positive when the master is slower than us
+    uint32_t errorBound_us;  // Error bound of the predicted start of the next cycle
+    uint32_t nbSamples;      // Cycles used for learning
+    uint32_t nbOutliers;     // Cycles rejected as too far from prediction
+    uint32_t maxResidual_us; // Largest prediction error of an accepted cycle
+} CycleStatistics_t;
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+// Learns the actual period of the master's network cycle from the start time of successive MASTER_REQUEST frames, so that
+// the start of the next cycle can be predicted despite the crystal mismatch between master and our device
+class CyclePeriodEstimator
+{
+  public:
+    CyclePeriodEstimator();
+    virtual ~CyclePeriodEstimator();
+
+    void     Reset();
+    void     AddMasterRequest(uint32_t start_us);
+    uint32_t PredictStart_us(uint32_t nbCycles);
+    uint32_t PredictErrorBound_us(uint32_t nbCycles);
+    uint32_t GetErrorBound_us();
+    void     GetStatistics(CycleStatistics_t *statistics);
+
+  private:
+    bool     anchored; // lastStart_us is valid
+    uint32_t lastStart_us;
+    float    period_us;
+    float    residualDev_us; // Average absolute prediction error
+    uint32_t nbSamples;
+    uint32_t nbOutliers;
+    uint32_t nbSuccessiveOutliers;
+    uint32_t maxResidual_us;
+};
+
+#endif /* CYCLEPERIODESTIMATOR_H_ */
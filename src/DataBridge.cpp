@@ -30,7 +30,7 @@
 
 #include "DataBridge.h"
 #include "BoardConfig.h"
-#include "Globals.h"
+#include "FastMath.h"
 
 #include <Arduino.h>
 #include <string.h>
@@ -39,6 +39,14 @@
 /*                              Constants                                  */
 /***************************************************************************/
 
+#define KT_TO_MPS  0.514444f
+#define KT_TO_KMPH 1.852f
+
+// UBX NAV-PVT flags
+#define NAV_PVT_VALID_DATE  0x01
+#define NAV_PVT_VALID_TIME  0x02
+#define NAV_PVT_GNSS_FIX_OK 0x01
+
 const uint8_t DataBridge::asciiTable[128] = {
     ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ',  ' ', ' ', ' ', ' ', ' ',  ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ',
     ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', '\"', ' ', ' ', '%', '&', '\'', ' ', ' ', ' ', '+', ' ', '-', '.', '/', '0', '1', '2', '3',
@@ -46,6 +54,21 @@ const uint8_t DataBridge::asciiTable[128] = {
     'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V',  'W', 'X', 'Y', 'Z', ' ',  ' ', ' ', ' ', ' ', ' ', 'A', '(', 'C', ')', 'E', 'F', 'G',
     'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',  'Q', 'R', 'S', 'T', 'U',  'V', 'W', 'X', 'Y', 'Z', ' ', ' ', ' ', ' ', ' '};
 
+// Must follow NmeaId_t order. Unknown sentences are handled as GNSS ones to be forwarded from the GNSS link : it is useful to
+// forward AIVDM/AIVDO sentences coming from an AIS receiver.
+const DataBridge::NmeaSentenceDesc_t DataBridge::sentenceDesc[NMEA_ID_NB] = {
+    {DATA_SOURCE_GNSS, nullptr},                           // NMEA_ID_UNKNOWN
+    {DATA_SOURCE_NAV, &DataBridge::DecodeRMBSentence},     // NMEA_ID_RMB
+    {DATA_SOURCE_GNSS, &DataBridge::DecodeRMCSentence},    // NMEA_ID_RMC
+    {DATA_SOURCE_GNSS, &DataBridge::DecodeGGASentence},    // NMEA_ID_GGA
+    {DATA_SOURCE_GNSS, &DataBridge::DecodeGLLSentence},    // NMEA_ID_GLL
+    {DATA_SOURCE_GNSS, &DataBridge::DecodeVTGSentence},    // NMEA_ID_VTG
+    {DATA_SOURCE_WIND, &DataBridge::DecodeMWVSentence},    // NMEA_ID_MWV
+    {DATA_SOURCE_DEPTH, &DataBridge::DecodeDPTSentence},   // NMEA_ID_DPT
+    {DATA_SOURCE_SPEED, &DataBridge::DecodeVHWSentence},   // NMEA_ID_VHW
+    {DATA_SOURCE_COMPASS, &DataBridge::DecodeHDGSentence}, // NMEA_ID_HDG
+};
+
 /***************************************************************************/
 /*                                Macros                                   */
 /***************************************************************************/
@@ -66,58 +89,161 @@ const uint8_t DataBridge::asciiTable[128] = {
 /*                              Functions                                  */
 /***************************************************************************/
 
-DataBridge::DataBridge(MicronetCodec *micronetCodec)
+DataBridge::DataBridge(MicronetCodec *micronetCodec, Configuration *configuration)
 {
     nmeaExtWriteIndex  = 0;
     nmeaExtBuffer[0]   = 0;
     nmeaGnssWriteIndex = 0;
     nmeaGnssBuffer[0]  = 0;
+    nmeaExtStart_us    = 0;
+    nmeaGnssStart_us   = 0;
     memset(&nmeaTimeStamps, 0, sizeof(nmeaTimeStamps));
     this->micronetCodec = micronetCodec;
-
-    // Store static link configuration from BoardConfig.h
-    navSourceLink     = NAV_SOURCE_LINK;
-    gnssSourceLink    = GNSS_SOURCE_LINK;
-    windSourceLink    = WIND_SOURCE_LINK;
-    depthSourceLink   = DEPTH_SOURCE_LINK;
-    speedSourceLink   = SPEED_SOURCE_LINK;
-    voltageSourceLink = VOLTAGE_SOURCE_LINK;
-    seaTempSourceLink = SEATEMP_SOURCE_LINK;
-    compassSourceLink = COMPASS_SOURCE_LINK;
+    latencyTracer       = nullptr;
 
     sogFilterIndex = 0;
-    memset(sogFilterBuffer, 0, SOG_COG_FILTERING_DEPTH);
+    memset(sogFilterBuffer, 0, sizeof(sogFilterBuffer));
     cogFilterIndex = 0;
-    memset(cogFilterBuffer, 0, SOG_COG_FILTERING_DEPTH);
+    memset(cogFilterBuffer, 0, sizeof(cogFilterBuffer));
+
+    // Link configuration is only read here : changes made from the menu apply to the next conversion
+    CompileDispatch(configuration);
+
+    // Subscribe to all navigation values used by NMEA encoders
+    uint32_t encodedValues = 0;
+    for (int i = 0; i < NAV_NB_VALUES; i++)
+    {
+        if (valueEncoders[i] != 0)
+        {
+            encodedValues |= NAV_BIT(i);
+        }
+    }
+    micronetCodec->navData.Subscribe("NMEA encoders", encodedValues, NavDataChanged, this);
 }
 
 DataBridge::~DataBridge()
 {
 }
 
+// Compile link configuration into the tables used for each received sentence and each navigation value change, so that
+// these paths don't have to test the configuration
+void DataBridge::CompileDispatch(Configuration *configuration)
+{
+    memcpy(dataSourceLink, configuration->sourceLink, sizeof(dataSourceLink));
+    sogCogFilteringDepth = configuration->sogCogFilteringDepth;
+    spdEmulation         = configuration->spdEmulation;
+    nmeaExt              = (configuration->nmeaExtPort == NMEA_PORT_WIRED) ? static_cast<Stream *>(&WIRED_NMEA) : static_cast<Stream *>(&USB_NMEA);
+    ubxInput             = (GNSS_UBLOXM8N == 1) && (GNSS_UBX_NAV_PVT == 1) && (dataSourceLink[DATA_SOURCE_GNSS] == LINK_NMEA_GNSS);
+
+    // Sentences are only decoded when received on the link selected for their data. GNSS sentences are also forwarded to
+    // the external NMEA port, unless they come from it.
+    for (int i = 0; i < NMEA_ID_NB; i++)
+    {
+        for (int j = 0; j < LINK_NB_LINKS; j++)
+        {
+            nmeaDispatch[i][j].decoder = nullptr;
+            nmeaDispatch[i][j].forward = false;
+        }
+
+        LinkId_t link                 = dataSourceLink[sentenceDesc[i].source];
+        nmeaDispatch[i][link].decoder = sentenceDesc[i].decoder;
+        nmeaDispatch[i][link].forward = (sentenceDesc[i].source == DATA_SOURCE_GNSS) && (link != LINK_NMEA_EXT);
+    }
+
+    // NMEA encoders only run for data received from Micronet or from the navigation compass. GNSS sentences are
+    // regenerated when received as UBX messages, NMEA ones being forwarded as is.
+    uint32_t enabledEncoders = 0;
+    if (dataSourceLink[DATA_SOURCE_WIND] == LINK_MICRONET)
+    {
+        enabledEncoders |= ENCODER_MWV_R | ENCODER_MWV_T | ENCODER_MWD | ENCODER_VWT;
+    }
+    if (dataSourceLink[DATA_SOURCE_DEPTH] == LINK_MICRONET)
+    {
+        enabledEncoders |= ENCODER_DPT;
+    }
+    if (dataSourceLink[DATA_SOURCE_SEATEMP] == LINK_MICRONET)
+    {
+        enabledEncoders |= ENCODER_MTW;
+    }
+    if (dataSourceLink[DATA_SOURCE_SPEED] == LINK_MICRONET)
+    {
+        enabledEncoders |= ENCODER_VLW | ENCODER_VHW;
+    }
+    if ((dataSourceLink[DATA_SOURCE_COMPASS] == LINK_MICRONET) || (dataSourceLink[DATA_SOURCE_COMPASS] == LINK_COMPASS))
+    {
+        enabledEncoders |= ENCODER_HDG;
+    }
+    if (dataSourceLink[DATA_SOURCE_VOLTAGE] == LINK_MICRONET)
+    {
+        enabledEncoders |= ENCODER_XDR;
+    }
+    if (ubxInput)
+    {
+        enabledEncoders |= ((GNSS_NMEA_OUTPUT & GNSS_NMEA_RMC) ? ENCODER_RMC : 0) | ((GNSS_NMEA_OUTPUT & GNSS_NMEA_GGA) ? ENCODER_GGA : 0) |
+                           ((GNSS_NMEA_OUTPUT & GNSS_NMEA_VTG) ? ENCODER_VTG : 0);
+    }
+
+    for (int i = 0; i < NAV_NB_VALUES; i++)
+    {
+        valueEncoders[i] = EncodersOfValue((NavValueId_t)i) & enabledEncoders;
+    }
+}
+
+// Returns the serial port on which NMEA sentences are exchanged with external devices
+Stream *DataBridge::GetNmeaExtPort()
+{
+    return nmeaExt;
+}
+
+// Send NMEA sentences to another port than the configured one
+void DataBridge::SetNmeaExtPort(Stream *port)
+{
+    nmeaExt = port;
+}
+
+// Give the tracer recording the latency of the sentences sent to the external NMEA port, nullptr for none
+void DataBridge::SetLatencyTracer(LatencyTracer *latencyTracer)
+{
+    this->latencyTracer = latencyTracer;
+}
+
 void DataBridge::PushNmeaChar(char c, LinkId_t sourceLink)
 {
-    char *nmeaBuffer     = nullptr;
-    int  *nmeaWriteIndex = 0;
+    char     *nmeaBuffer       = nullptr;
+    int      *nmeaWriteIndex   = 0;
+    uint32_t *sentenceStart_us = nullptr;
 
     switch (sourceLink)
     {
     case LINK_NMEA_EXT:
-        nmeaBuffer     = nmeaExtBuffer;
-        nmeaWriteIndex = &nmeaExtWriteIndex;
+        nmeaBuffer       = nmeaExtBuffer;
+        nmeaWriteIndex   = &nmeaExtWriteIndex;
+        sentenceStart_us = &nmeaExtStart_us;
         break;
     case LINK_NMEA_GNSS:
-        nmeaBuffer     = nmeaGnssBuffer;
-        nmeaWriteIndex = &nmeaGnssWriteIndex;
+        nmeaBuffer       = nmeaGnssBuffer;
+        nmeaWriteIndex   = &nmeaGnssWriteIndex;
+        sentenceStart_us = &nmeaGnssStart_us;
         break;
     default:
         return;
     }
 
+    // In UBX mode, GNSS link carries binary frames. NMEA parsing still handles sentences sent by the M8N before its
+    // configuration.
+    if (ubxInput && (sourceLink == LINK_NMEA_GNSS) && ubxParser.PushByte((uint8_t)c, micros()))
+    {
+        micronetCodec->navData.SetOrigin(ubxParser.GetFrameStart_us());
+        DecodeUbxFrame();
+        micronetCodec->navData.ResetOrigin();
+        return;
+    }
+
     if (((nmeaBuffer[0] != '$') && (nmeaBuffer[0] != '!')) || (c == '$') || (c == '!'))
     {
-        nmeaBuffer[0]   = c;
-        *nmeaWriteIndex = 1;
+        nmeaBuffer[0]     = c;
+        *nmeaWriteIndex   = 1;
+        *sentenceStart_us = micros();
         return;
     }
 
@@ -129,89 +255,22 @@ void DataBridge::PushNmeaChar(char c, LinkId_t sourceLink)
         {
             if (IsSentenceValid(nmeaBuffer))
             {
+                NmeaDispatch_t *dispatch = &nmeaDispatch[SentenceId(nmeaBuffer)][sourceLink];
 
-                NmeaId_t sId = SentenceId(nmeaBuffer);
-
-                switch (sId)
+                // Decoded values originate from the reception of the first character of the sentence
+                if (dispatch->decoder != nullptr)
                 {
-                case NMEA_ID_RMB:
-                    if (sourceLink == navSourceLink)
-                    {
-                        DecodeRMBSentence(nmeaBuffer);
-                    }
-                    break;
-                case NMEA_ID_RMC:
-                    if (sourceLink == gnssSourceLink)
-                    {
-                        DecodeRMCSentence(nmeaBuffer);
-                        if (sourceLink != LINK_NMEA_EXT)
-                        {
-                            NMEA_EXT.println(nmeaBuffer);
-                        }
-                    }
-                    break;
-                case NMEA_ID_GGA:
-                    if (sourceLink == gnssSourceLink)
-                    {
-                        DecodeGGASentence(nmeaBuffer);
-                        if (sourceLink != LINK_NMEA_EXT)
-                        {
-                            NMEA_EXT.println(nmeaBuffer);
-                        }
-                    }
-                    break;
-                case NMEA_ID_GLL:
-                    if (sourceLink == gnssSourceLink)
-                    {
-                        DecodeGLLSentence(nmeaBuffer);
-                        if (sourceLink != LINK_NMEA_EXT)
-                        {
-                            NMEA_EXT.println(nmeaBuffer);
-                        }
-                    }
-                    break;
-                case NMEA_ID_VTG:
-                    if (sourceLink == gnssSourceLink)
-                    {
-                        DecodeVTGSentence(nmeaBuffer);
-                        if (sourceLink != LINK_NMEA_EXT)
-                        {
-                            NMEA_EXT.println(nmeaBuffer);
-                        }
-                    }
-                    break;
-                case NMEA_ID_MWV:
-                    if (sourceLink == windSourceLink)
-                    {
-                        DecodeMWVSentence(nmeaBuffer);
-                    }
-                    break;
-                case NMEA_ID_DPT:
-                    if (sourceLink == depthSourceLink)
-                    {
-                        DecodeDPTSentence(nmeaBuffer);
-                    }
-                    break;
-                case NMEA_ID_VHW:
-                    if (sourceLink == speedSourceLink)
-                    {
-                        DecodeVHWSentence(nmeaBuffer);
-                    }
-                    break;
-                case NMEA_ID_HDG:
-                    if (sourceLink == compassSourceLink)
-                    {
-                        DecodeHDGSentence(nmeaBuffer);
-                    }
-                    break;
-                default:
-                    // An unknown sentence is forwarded to NMEA_EXT if it is coming from the GNSS link. It is useful to forward AIVDM/AIVDO
-                    // sentences coming from an AIS receiver.
-                    if ((sourceLink == gnssSourceLink) && (sourceLink != LINK_NMEA_EXT))
+                    micronetCodec->navData.SetOrigin(*sentenceStart_us);
+                    (this->*(dispatch->decoder))(nmeaBuffer);
+                    micronetCodec->navData.ResetOrigin();
+                }
+                if (dispatch->forward)
+                {
+                    nmeaExt->println(nmeaBuffer);
+                    if (latencyTracer != nullptr)
                     {
-                        NMEA_EXT.println(nmeaBuffer);
+                        latencyTracer->Record(LATENCY_NMEA_FORWARDED, micros() - *sentenceStart_us);
                     }
-                    break;
                 }
             }
         }
@@ -234,57 +293,156 @@ void DataBridge::PushNmeaChar(char c, LinkId_t sourceLink)
 
 void DataBridge::UpdateCompassData(float heading_deg)
 {
-    if (COMPASS_SOURCE_LINK == LINK_COMPASS)
-    {
-        while (heading_deg < 0.0f)
-            heading_deg += 360.0f;
-        while (heading_deg >= 360.0f)
-            heading_deg -= 360.0f;
-        micronetCodec->navData.magHdg_deg.value     = heading_deg;
-        micronetCodec->navData.magHdg_deg.valid     = true;
-        micronetCodec->navData.magHdg_deg.timeStamp = millis();
+    if (dataSourceLink[DATA_SOURCE_COMPASS] == LINK_COMPASS)
+    {
+        micronetCodec->navData.Set(NAV_ID_MAG_HDG_DEG, FastWrap360_deg(heading_deg));
         EncodeHDG();
     }
 }
 
-void DataBridge::UpdateMicronetData()
+void DataBridge::UpdateAttitudeData(float heel_deg, float pitch_deg, float rot_degpmin)
+{
+    if (dataSourceLink[DATA_SOURCE_COMPASS] == LINK_COMPASS)
+    {
+        micronetCodec->navData.Set(NAV_ID_HEEL_DEG, heel_deg);
+        micronetCodec->navData.Set(NAV_ID_PITCH_DEG, pitch_deg);
+        micronetCodec->navData.Set(NAV_ID_ROT_DEGPMIN, rot_degpmin);
+        EncodeROT();
+        EncodeXDR_Attitude();
+    }
+}
+
+// Navigation data subscription callback : send NMEA sentences whose input values changed
+void DataBridge::NavDataChanged(void *context, uint32_t changedMask)
+{
+    static_cast<DataBridge *>(context)->EncodeChangedValues(changedMask);
+}
+
+void DataBridge::EncodeChangedValues(uint32_t changedMask)
+{
+    uint32_t changed  = changedMask;
+    uint32_t encoders = 0;
+    while (changed != 0)
+    {
+        int id = __builtin_ctz(changed);
+        changed &= changed - 1;
+        encoders |= valueEncoders[id];
+    }
+
+    RunEncoders(encoders);
+}
+
+// Run NMEA encoders whatever their rate limit, so that each call encodes and sends sentences. Used by benchmarks.
+void DataBridge::ForceEncoders(uint32_t encoders)
+{
+    memset(&nmeaTimeStamps, 0, sizeof(nmeaTimeStamps));
+    RunEncoders(encoders);
+}
+
+void DataBridge::RunEncoders(uint32_t encoders)
 {
-    EncodeMWV_R();
-    EncodeMWV_T();
-    EncodeDPT();
-    EncodeMTW();
-    EncodeVLW();
-    EncodeVHW();
-    EncodeHDG();
-    EncodeXDR();
+    if (encoders & ENCODER_MWV_R)
+        EncodeMWV_R();
+    if (encoders & ENCODER_MWV_T)
+        EncodeMWV_T();
+    if (encoders & ENCODER_MWD)
+        EncodeMWD();
+    if (encoders & ENCODER_VWT)
+        EncodeVWT();
+    if (encoders & ENCODER_DPT)
+        EncodeDPT();
+    if (encoders & ENCODER_MTW)
+        EncodeMTW();
+    if (encoders & ENCODER_VLW)
+        EncodeVLW();
+    if (encoders & ENCODER_VHW)
+        EncodeVHW();
+    if (encoders & ENCODER_HDG)
+        EncodeHDG();
+    if (encoders & ENCODER_XDR)
+        EncodeXDR();
+    if (encoders & ENCODER_RMC)
+        EncodeRMC();
+    if (encoders & ENCODER_GGA)
+        EncodeGGA();
+    if (encoders & ENCODER_VTG)
+        EncodeVTG();
+    if (encoders & ENCODER_ROT)
+        EncodeROT();
+    if (encoders & ENCODER_XDR_ATTITUDE)
+        EncodeXDR_Attitude();
+}
+
+// Returns the mask of NMEA encoders using a navigation value, whatever the link configuration
+uint32_t DataBridge::EncodersOfValue(NavValueId_t id)
+{
+    switch (id)
+    {
+    case NAV_ID_AWA_DEG:
+    case NAV_ID_AWS_KT:
+        return ENCODER_MWV_R;
+    case NAV_ID_TWA_DEG:
+    case NAV_ID_TWS_KT:
+        return ENCODER_MWV_T;
+    case NAV_ID_DAMPED_TWD_DEG:
+        return ENCODER_MWD;
+    case NAV_ID_DAMPED_TWA_DEG:
+        return ENCODER_VWT;
+    case NAV_ID_DAMPED_TWS_KT:
+        return ENCODER_MWD | ENCODER_VWT;
+    case NAV_ID_DPT_M:
+        return ENCODER_DPT;
+    case NAV_ID_STP_DEGC:
+        return ENCODER_MTW;
+    case NAV_ID_LOG_NM:
+    case NAV_ID_TRIP_NM:
+        return ENCODER_VLW;
+    case NAV_ID_SPD_KT:
+        return ENCODER_VHW;
+    case NAV_ID_MAG_HDG_DEG:
+        return ENCODER_VHW | ENCODER_HDG;
+    case NAV_ID_VCC_V:
+        return ENCODER_XDR;
+    case NAV_ID_LATITUDE_DEG:
+        return ENCODER_RMC | ENCODER_GGA;
+    case NAV_ID_SOG_KT:
+        return ENCODER_VTG;
+    default:
+        return 0;
+    }
 }
 
 float DataBridge::FilteredSOG(float newSog_kt)
 {
-#if (SOG_COG_FILTERING == 1)
+    if (sogCogFilteringDepth <= 1)
+    {
+        return newSog_kt;
+    }
+
     sogFilterBuffer[sogFilterIndex++] = newSog_kt;
-    if (sogFilterIndex >= SOG_COG_FILTERING_DEPTH)
+    if (sogFilterIndex >= sogCogFilteringDepth)
     {
         sogFilterIndex = 0;
     }
 
     float filteredSog_kt = sogFilterBuffer[0];
-    for (int i = 1; i < SOG_COG_FILTERING_DEPTH; i++)
+    for (int i = 1; i < sogCogFilteringDepth; i++)
     {
         filteredSog_kt += sogFilterBuffer[i];
     }
 
-    return filteredSog_kt / SOG_COG_FILTERING_DEPTH;
-#else
-    return newSog_kt;
-#endif
+    return filteredSog_kt / sogCogFilteringDepth;
 }
 
 float DataBridge::FilteredCOG(float newCog_deg)
 {
-#if (SOG_COG_FILTERING == 1)
+    if (sogCogFilteringDepth <= 1)
+    {
+        return newCog_deg;
+    }
+
     cogFilterBuffer[cogFilterIndex++] = newCog_deg;
-    if (cogFilterIndex >= SOG_COG_FILTERING_DEPTH)
+    if (cogFilterIndex >= sogCogFilteringDepth)
     {
         cogFilterIndex = 0;
     }
@@ -292,7 +450,7 @@ float DataBridge::FilteredCOG(float newCog_deg)
     float filteredCog_deg = cogFilterBuffer[0];
     float previousCog_deg = filteredCog_deg;
     float bufferedCog_deg;
-    for (int i = 1; i < SOG_COG_FILTERING_DEPTH; i++)
+    for (int i = 1; i < sogCogFilteringDepth; i++)
     {
         bufferedCog_deg = cogFilterBuffer[i];
         if (bufferedCog_deg - previousCog_deg > 180)
@@ -307,21 +465,7 @@ float DataBridge::FilteredCOG(float newCog_deg)
         filteredCog_deg += bufferedCog_deg;
     }
 
-    filteredCog_deg = filteredCog_deg / SOG_COG_FILTERING_DEPTH;
-
-    if (filteredCog_deg < 0)
-    {
-        filteredCog_deg += 360;
-    }
-    else if (filteredCog_deg >= 360)
-    {
-        filteredCog_deg -= 360;
-    }
-
-    return filteredCog_deg;
-#else
-    return newCog_deg;
-#endif
+    return FastWrap360_deg(filteredCog_deg / sogCogFilteringDepth);
 }
 
 bool DataBridge::IsSentenceValid(char *nmeaBuffer)
@@ -412,17 +556,14 @@ void DataBridge::DecodeRMBSentence(char *sentence)
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
     sentence++;
-    if (sscanf(sentence, "%f", &value) == 1)
-    {
-        micronetCodec->navData.xte_nm.value     = value;
-        micronetCodec->navData.xte_nm.valid     = true;
-        micronetCodec->navData.xte_nm.timeStamp = millis();
-    }
+    bool xteFound = (sscanf(sentence, "%f", &value) == 1);
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
     sentence++;
-    if (sentence[0] == 'R')
-        micronetCodec->navData.xte_nm.value = -micronetCodec->navData.xte_nm.value;
+    if (xteFound)
+    {
+        micronetCodec->navData.Set(NAV_ID_XTE_NM, (sentence[0] == 'R') ? -value : value);
+    }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
     sentence++;
@@ -467,27 +608,21 @@ void DataBridge::DecodeRMBSentence(char *sentence)
     }
     if (sscanf(sentence, "%f", &value) == 1)
     {
-        micronetCodec->navData.dtw_nm.value     = value;
-        micronetCodec->navData.dtw_nm.valid     = true;
-        micronetCodec->navData.dtw_nm.timeStamp = millis();
+        micronetCodec->navData.Set(NAV_ID_DTW_NM, value);
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
     sentence++;
     if (sscanf(sentence, "%f", &value) == 1)
     {
-        micronetCodec->navData.btw_deg.value     = value;
-        micronetCodec->navData.btw_deg.valid     = true;
-        micronetCodec->navData.btw_deg.timeStamp = millis();
+        micronetCodec->navData.Set(NAV_ID_BTW_DEG, value);
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
     sentence++;
     if (sscanf(sentence, "%f", &value) == 1)
     {
-        micronetCodec->navData.vmgwp_kt.value     = value;
-        micronetCodec->navData.vmgwp_kt.valid     = true;
-        micronetCodec->navData.vmgwp_kt.timeStamp = millis();
+        micronetCodec->navData.Set(NAV_ID_VMGWP_KT, value);
     }
 }
 
@@ -500,10 +635,12 @@ void DataBridge::DecodeRMCSentence(char *sentence)
 
     if (sentence[0] != ',')
     {
-        micronetCodec->navData.time.hour      = (sentence[0] - '0') * 10 + (sentence[1] - '0');
-        micronetCodec->navData.time.minute    = (sentence[2] - '0') * 10 + (sentence[3] - '0');
-        micronetCodec->navData.time.valid     = true;
-        micronetCodec->navData.time.timeStamp = millis();
+        micronetCodec->navData.time.hour        = (sentence[0] - '0') * 10 + (sentence[1] - '0');
+        micronetCodec->navData.time.minute      = (sentence[2] - '0') * 10 + (sentence[3] - '0');
+        micronetCodec->navData.time.second      = (sentence[4] - '0') * 10 + (sentence[5] - '0');
+        micronetCodec->navData.time.centisecond = 0;
+        micronetCodec->navData.time.valid       = true;
+        micronetCodec->navData.time.timeStamp   = millis();
     }
 
     for (int i = 0; i < 2; i++)
@@ -517,14 +654,13 @@ void DataBridge::DecodeRMCSentence(char *sentence)
     {
         degs = (sentence[0] - '0') * 10 + (sentence[1] - '0');
         sscanf(sentence + 2, "%f,", &mins);
-        micronetCodec->navData.latitude_deg.value = degs + mins / 60.0f;
+        float latitude_deg = degs + mins / 60.0f;
         if ((sentence = strchr(sentence, ',')) == nullptr)
             return;
         sentence++;
         if (sentence[0] == 'S')
-            micronetCodec->navData.latitude_deg.value = -micronetCodec->navData.latitude_deg.value;
-        micronetCodec->navData.latitude_deg.valid     = true;
-        micronetCodec->navData.latitude_deg.timeStamp = millis();
+            latitude_deg = -latitude_deg;
+        micronetCodec->navData.Set(NAV_ID_LATITUDE_DEG, latitude_deg);
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
@@ -534,14 +670,13 @@ void DataBridge::DecodeRMCSentence(char *sentence)
     {
         degs = (sentence[0] - '0') * 100 + (sentence[1] - '0') * 10 + (sentence[2] - '0');
         sscanf(sentence + 3, "%f,", &mins);
-        micronetCodec->navData.longitude_deg.value = degs + mins / 60.0f;
+        float longitude_deg = degs + mins / 60.0f;
         if ((sentence = strchr(sentence, ',')) == nullptr)
             return;
         sentence++;
         if (sentence[0] == 'W')
-            micronetCodec->navData.longitude_deg.value = -micronetCodec->navData.longitude_deg.value;
-        micronetCodec->navData.longitude_deg.valid     = true;
-        micronetCodec->navData.longitude_deg.timeStamp = millis();
+            longitude_deg = -longitude_deg;
+        micronetCodec->navData.Set(NAV_ID_LONGITUDE_DEG, longitude_deg);
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
@@ -549,15 +684,12 @@ void DataBridge::DecodeRMCSentence(char *sentence)
 
     if (sscanf(sentence, "%f", &value) == 1)
     {
-        micronetCodec->navData.sog_kt.value     = FilteredSOG(value);
-        micronetCodec->navData.sog_kt.valid     = true;
-        micronetCodec->navData.sog_kt.timeStamp = millis();
-
-#if (EMULATE_SPD_WITH_SOG == 1)
-        micronetCodec->navData.spd_kt.value     = FilteredSOG(value);
-        micronetCodec->navData.spd_kt.valid     = true;
-        micronetCodec->navData.spd_kt.timeStamp = millis();
-#endif
+        float sog_kt = FilteredSOG(value);
+        micronetCodec->navData.Set(NAV_ID_SOG_KT, sog_kt);
+        if (spdEmulation)
+        {
+            micronetCodec->navData.Set(NAV_ID_SPD_KT, sog_kt);
+        }
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
@@ -568,9 +700,7 @@ void DataBridge::DecodeRMCSentence(char *sentence)
         if (value < 0)
             value += 360.0f;
 
-        micronetCodec->navData.cog_deg.value     = FilteredCOG(value);
-        micronetCodec->navData.cog_deg.valid     = true;
-        micronetCodec->navData.cog_deg.timeStamp = millis();
+        micronetCodec->navData.Set(NAV_ID_COG_DEG, FilteredCOG(value));
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
@@ -600,14 +730,13 @@ void DataBridge::DecodeGGASentence(char *sentence)
     {
         degs = (sentence[0] - '0') * 10 + (sentence[1] - '0');
         sscanf(sentence + 2, "%f,", &mins);
-        micronetCodec->navData.latitude_deg.value = degs + mins / 60.0f;
+        float latitude_deg = degs + mins / 60.0f;
         if ((sentence = strchr(sentence, ',')) == nullptr)
             return;
         sentence++;
         if (sentence[0] == 'S')
-            micronetCodec->navData.latitude_deg.value = -micronetCodec->navData.latitude_deg.value;
-        micronetCodec->navData.latitude_deg.valid     = true;
-        micronetCodec->navData.latitude_deg.timeStamp = millis();
+            latitude_deg = -latitude_deg;
+        micronetCodec->navData.Set(NAV_ID_LATITUDE_DEG, latitude_deg);
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
@@ -616,14 +745,13 @@ void DataBridge::DecodeGGASentence(char *sentence)
     {
         degs = (sentence[0] - '0') * 100 + (sentence[1] - '0') * 10 + (sentence[2] - '0');
         sscanf(sentence + 3, "%f,", &mins);
-        micronetCodec->navData.longitude_deg.value = degs + mins / 60.0f;
+        float longitude_deg = degs + mins / 60.0f;
         if ((sentence = strchr(sentence, ',')) == nullptr)
             return;
         sentence++;
         if (sentence[0] == 'W')
-            micronetCodec->navData.longitude_deg.value = -micronetCodec->navData.longitude_deg.value;
-        micronetCodec->navData.longitude_deg.valid     = true;
-        micronetCodec->navData.longitude_deg.timeStamp = millis();
+            longitude_deg = -longitude_deg;
+        micronetCodec->navData.Set(NAV_ID_LONGITUDE_DEG, longitude_deg);
     }
 }
 
@@ -637,14 +765,13 @@ void DataBridge::DecodeGLLSentence(char *sentence)
     {
         degs = (sentence[0] - '0') * 10 + (sentence[1] - '0');
         sscanf(sentence + 2, "%f,", &mins);
-        micronetCodec->navData.latitude_deg.value = degs + mins / 60.0f;
+        float latitude_deg = degs + mins / 60.0f;
         if ((sentence = strchr(sentence, ',')) == nullptr)
             return;
         sentence++;
         if (sentence[0] == 'S')
-            micronetCodec->navData.latitude_deg.value = -micronetCodec->navData.latitude_deg.value;
-        micronetCodec->navData.latitude_deg.valid     = true;
-        micronetCodec->navData.latitude_deg.timeStamp = millis();
+            latitude_deg = -latitude_deg;
+        micronetCodec->navData.Set(NAV_ID_LATITUDE_DEG, latitude_deg);
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
@@ -653,14 +780,13 @@ void DataBridge::DecodeGLLSentence(char *sentence)
     {
         degs = (sentence[0] - '0') * 100 + (sentence[1] - '0') * 10 + (sentence[2] - '0');
         sscanf(sentence + 3, "%f,", &mins);
-        micronetCodec->navData.longitude_deg.value = degs + mins / 60.0f;
+        float longitude_deg = degs + mins / 60.0f;
         if ((sentence = strchr(sentence, ',')) == nullptr)
             return;
         sentence++;
         if (sentence[0] == 'W')
-            micronetCodec->navData.longitude_deg.value = -micronetCodec->navData.longitude_deg.value;
-        micronetCodec->navData.longitude_deg.valid     = true;
-        micronetCodec->navData.longitude_deg.timeStamp = millis();
+            longitude_deg = -longitude_deg;
+        micronetCodec->navData.Set(NAV_ID_LONGITUDE_DEG, longitude_deg);
     }
 }
 
@@ -696,9 +822,7 @@ void DataBridge::DecodeVTGSentence(char *sentence)
         if (value < 0)
             value += 360.0f;
 
-        micronetCodec->navData.cog_deg.value     = FilteredCOG(value);
-        micronetCodec->navData.cog_deg.valid     = true;
-        micronetCodec->navData.cog_deg.timeStamp = millis();
+        micronetCodec->navData.Set(NAV_ID_COG_DEG, FilteredCOG(value));
     }
     for (int i = 0; i < fieldsToSkip; i++)
     {
@@ -708,15 +832,12 @@ void DataBridge::DecodeVTGSentence(char *sentence)
     }
     if (sscanf(sentence, "%f", &value) == 1)
     {
-        micronetCodec->navData.sog_kt.value     = FilteredSOG(value);
-        micronetCodec->navData.sog_kt.valid     = true;
-        micronetCodec->navData.sog_kt.timeStamp = millis();
-
-#if (EMULATE_SPD_WITH_SOG == 1)
-        micronetCodec->navData.spd_kt.value     = FilteredSOG(value);
-        micronetCodec->navData.spd_kt.valid     = true;
-        micronetCodec->navData.spd_kt.timeStamp = millis();
-#endif
+        float sog_kt = FilteredSOG(value);
+        micronetCodec->navData.Set(NAV_ID_SOG_KT, sog_kt);
+        if (spdEmulation)
+        {
+            micronetCodec->navData.Set(NAV_ID_SPD_KT, sog_kt);
+        }
     }
 }
 
@@ -743,9 +864,7 @@ void DataBridge::DecodeMWVSentence(char *sentence)
     {
         if (awa > 180.0)
             awa -= 360.0f;
-        micronetCodec->navData.awa_deg.value     = awa;
-        micronetCodec->navData.awa_deg.valid     = true;
-        micronetCodec->navData.awa_deg.timeStamp = millis();
+        micronetCodec->navData.Set(NAV_ID_AWA_DEG, awa);
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
@@ -773,10 +892,7 @@ void DataBridge::DecodeMWVSentence(char *sentence)
         return;
     }
 
-    micronetCodec->navData.aws_kt.value     = aws;
-    micronetCodec->navData.aws_kt.valid     = true;
-    micronetCodec->navData.aws_kt.timeStamp = millis();
-    micronetCodec->CalculateTrueWind();
+    micronetCodec->navData.Set(NAV_ID_AWS_KT, aws);
 }
 
 void DataBridge::DecodeDPTSentence(char *sentence)
@@ -797,9 +913,7 @@ void DataBridge::DecodeDPTSentence(char *sentence)
     sentence++;
     if (sscanf(sentence, "%f", &value) == 1)
     {
-        micronetCodec->navData.dpt_m.value     = depth + value;
-        micronetCodec->navData.dpt_m.valid     = true;
-        micronetCodec->navData.dpt_m.timeStamp = millis();
+        micronetCodec->navData.Set(NAV_ID_DPT_M, depth + value);
     }
 }
 
@@ -824,9 +938,7 @@ void DataBridge::DecodeVHWSentence(char *sentence)
     {
         if (value < 0)
             value += 360.0f;
-        micronetCodec->navData.magHdg_deg.value     = value;
-        micronetCodec->navData.magHdg_deg.valid     = true;
-        micronetCodec->navData.magHdg_deg.timeStamp = millis();
+        micronetCodec->navData.Set(NAV_ID_MAG_HDG_DEG, value);
     }
     if ((sentence = strchr(sentence, ',')) == nullptr)
         return;
@@ -838,9 +950,7 @@ void DataBridge::DecodeVHWSentence(char *sentence)
     sentence++;
     if (sentence[0] == 'N')
     {
-        micronetCodec->navData.spd_kt.value     = value;
-        micronetCodec->navData.spd_kt.valid     = true;
-        micronetCodec->navData.spd_kt.timeStamp = millis();
+        micronetCodec->navData.Set(NAV_ID_SPD_KT, value);
     }
 }
 
@@ -852,13 +962,69 @@ void DataBridge::DecodeHDGSentence(char *sentence)
 
     if (sscanf(sentence, "%f", &value) != 1)
         return;
-    while (value < 0)
-        value += 360.0f;
-    while (value >= 360.0)
-        value -= 360.0f;
-    micronetCodec->navData.magHdg_deg.value     = value;
-    micronetCodec->navData.magHdg_deg.valid     = true;
-    micronetCodec->navData.magHdg_deg.timeStamp = millis();
+    micronetCodec->navData.Set(NAV_ID_MAG_HDG_DEG, FastWrap360_deg(value));
+}
+
+void DataBridge::DecodeUbxFrame()
+{
+    if ((ubxParser.GetClass() == UBX_CLASS_NAV) && (ubxParser.GetId() == UBX_ID_NAV_PVT) && (ubxParser.GetLength() == UBX_NAV_PVT_LENGTH))
+    {
+        DecodeNavPvtMessage(ubxParser.GetPayload());
+    }
+}
+
+// Decode UBX NAV-PVT message : time, date, position, velocity and their accuracy in a single binary frame
+void DataBridge::DecodeNavPvtMessage(uint8_t *payload)
+{
+    NavigationData *navData = &micronetCodec->navData;
+    uint8_t         valid   = UbxParser::U1(payload, 11);
+    uint8_t         fixType = UbxParser::U1(payload, 20);
+    bool            fixOk   = (UbxParser::U1(payload, 21) & NAV_PVT_GNSS_FIX_OK) && (fixType >= 2) && (fixType <= 4);
+
+    if (valid & NAV_PVT_VALID_TIME)
+    {
+        int32_t nano_ns           = UbxParser::I4(payload, 16);
+        navData->time.hour        = UbxParser::U1(payload, 8);
+        navData->time.minute      = UbxParser::U1(payload, 9);
+        navData->time.second      = UbxParser::U1(payload, 10);
+        navData->time.centisecond = (nano_ns > 0) ? nano_ns / 10000000 : 0;
+        navData->time.valid       = true;
+        navData->time.timeStamp   = millis();
+    }
+
+    if (valid & NAV_PVT_VALID_DATE)
+    {
+        navData->date.day       = UbxParser::U1(payload, 7);
+        navData->date.month     = UbxParser::U1(payload, 6);
+        navData->date.year      = UbxParser::U2(payload, 4) % 100;
+        navData->date.valid     = true;
+        navData->date.timeStamp = millis();
+    }
+
+    navData->gnssFix.fixType       = fixType;
+    navData->gnssFix.nbSatellites  = UbxParser::U1(payload, 23);
+    navData->gnssFix.altitude_m    = UbxParser::I4(payload, 36) * 0.001f;
+    navData->gnssFix.hAccuracy_m   = UbxParser::U4(payload, 40) * 0.001f;
+    navData->gnssFix.vAccuracy_m   = UbxParser::U4(payload, 44) * 0.001f;
+    navData->gnssFix.sAccuracy_kt  = UbxParser::U4(payload, 68) * 0.001f / KT_TO_MPS;
+    navData->gnssFix.cAccuracy_deg = UbxParser::U4(payload, 72) * 1e-5f;
+    navData->gnssFix.pdop          = UbxParser::U2(payload, 76) * 0.01f;
+    navData->gnssFix.valid         = true;
+    navData->gnssFix.timeStamp     = millis();
+
+    if (fixOk)
+    {
+        navData->Set(NAV_ID_LATITUDE_DEG, UbxParser::I4(payload, 28) * 1e-7f);
+        navData->Set(NAV_ID_LONGITUDE_DEG, UbxParser::I4(payload, 24) * 1e-7f);
+
+        float sog_kt = FilteredSOG(UbxParser::I4(payload, 60) * 0.001f / KT_TO_MPS);
+        navData->Set(NAV_ID_SOG_KT, sog_kt);
+        if (spdEmulation)
+        {
+            navData->Set(NAV_ID_SPD_KT, sog_kt);
+        }
+        navData->Set(NAV_ID_COG_DEG, FilteredCOG(FastWrap360_deg(UbxParser::I4(payload, 64) * 1e-5f)));
+    }
 }
 
 int16_t DataBridge::NibbleValue(char c)
@@ -881,188 +1047,343 @@ int16_t DataBridge::NibbleValue(char c)
 
 void DataBridge::EncodeMWV_R()
 {
-    if (WIND_SOURCE_LINK == LINK_MICRONET)
-    {
-        bool update;
+    bool               update;
+    NavGroupSnapshot_t wind;
 
-        update = (micronetCodec->navData.awa_deg.timeStamp > nmeaTimeStamps.vwr + NMEA_SENTENCE_MIN_PERIOD_MS);
-        update = update && (micronetCodec->navData.aws_kt.timeStamp > nmeaTimeStamps.vwr + NMEA_SENTENCE_MIN_PERIOD_MS);
-        update = update && (micronetCodec->navData.awa_deg.valid && micronetCodec->navData.aws_kt.valid);
+    micronetCodec->navData.GetSnapshot(NAV_GROUP_APPARENT_WIND, &wind);
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_AWA_DEG) > nmeaTimeStamps.vwr + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && (micronetCodec->navData.GetTimeStamp(NAV_ID_AWS_KT) > nmeaTimeStamps.vwr + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && (wind.validMask == (NAV_BIT(NAV_ID_AWA_DEG) | NAV_BIT(NAV_ID_AWS_KT)));
 
-        if (update)
-        {
-            char  sentence[NMEA_SENTENCE_MAX_LENGTH];
-            float absAwa = micronetCodec->navData.awa_deg.value;
-            if (absAwa < 0.0f)
-                absAwa += 360.0f;
-            sprintf(sentence, "$INMWV,%.1f,R,%.1f,N,A", absAwa, micronetCodec->navData.aws_kt.value);
-            AddNmeaChecksum(sentence);
-            nmeaTimeStamps.vwr = millis();
-            NMEA_EXT.println(sentence);
-        }
+    if (update)
+    {
+        char  sentence[NMEA_SENTENCE_MAX_LENGTH];
+        float absAwa = FastWrap360_deg(wind.value[0]);
+        sprintf(sentence, "$INMWV,%.1f,R,%.1f,N,A", absAwa, wind.value[1]);
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.vwr = millis();
+        SendSentence(sentence, LATENCY_NMEA_MWV_R, NAV_BIT(NAV_ID_AWA_DEG) | NAV_BIT(NAV_ID_AWS_KT));
     }
 }
 
 void DataBridge::EncodeMWV_T()
 {
-    if (WIND_SOURCE_LINK == LINK_MICRONET)
+    bool update;
+
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_TWA_DEG) > nmeaTimeStamps.vwt + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && (micronetCodec->navData.GetTimeStamp(NAV_ID_TWS_KT) > nmeaTimeStamps.vwt + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && (micronetCodec->navData.IsValid(NAV_ID_TWA_DEG) && micronetCodec->navData.IsValid(NAV_ID_TWS_KT));
+
+    if (update)
+    {
+        char  sentence[NMEA_SENTENCE_MAX_LENGTH];
+        float absTwa = FastWrap360_deg(micronetCodec->navData.Get(NAV_ID_TWA_DEG));
+        sprintf(sentence, "$INMWV,%.1f,T,%.1f,N,A", absTwa, micronetCodec->navData.Get(NAV_ID_TWS_KT));
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.vwt = millis();
+        SendSentence(sentence, LATENCY_NMEA_MWV_T, NAV_BIT(NAV_ID_TWA_DEG) | NAV_BIT(NAV_ID_TWS_KT));
+    }
+}
+
+void DataBridge::EncodeMWD()
+{
+    bool update;
+
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_DAMPED_TWD_DEG) > nmeaTimeStamps.mwd + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && (micronetCodec->navData.IsValid(NAV_ID_DAMPED_TWD_DEG) && micronetCodec->navData.IsValid(NAV_ID_DAMPED_TWS_KT));
+
+    if (update)
     {
-        bool update;
+        char  sentence[NMEA_SENTENCE_MAX_LENGTH];
+        float twd_deg    = micronetCodec->navData.Get(NAV_ID_DAMPED_TWD_DEG);
+        float twdMag_deg = FastWrap360_deg(twd_deg - micronetCodec->navData.magneticVariation_deg);
+        float tws_kt     = micronetCodec->navData.Get(NAV_ID_DAMPED_TWS_KT);
+        sprintf(sentence, "$INMWD,%.1f,T,%.1f,M,%.1f,N,%.1f,M", twd_deg, twdMag_deg, tws_kt, tws_kt * KT_TO_MPS);
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.mwd = millis();
+        SendSentence(sentence, LATENCY_NMEA_MWD, NAV_BIT(NAV_ID_DAMPED_TWD_DEG) | NAV_BIT(NAV_ID_DAMPED_TWS_KT));
+    }
+}
 
-        update = (micronetCodec->navData.twa_deg.timeStamp > nmeaTimeStamps.vwt + NMEA_SENTENCE_MIN_PERIOD_MS);
-        update = update && (micronetCodec->navData.tws_kt.timeStamp > nmeaTimeStamps.vwt + NMEA_SENTENCE_MIN_PERIOD_MS);
-        update = update && (micronetCodec->navData.twa_deg.valid && micronetCodec->navData.tws_kt.valid);
+void DataBridge::EncodeVWT()
+{
+    bool update;
 
-        if (update)
-        {
-            char  sentence[NMEA_SENTENCE_MAX_LENGTH];
-            float absTwa = micronetCodec->navData.twa_deg.value;
-            if (absTwa < 0.0f)
-                absTwa += 360.0f;
-            sprintf(sentence, "$INMWV,%.1f,T,%.1f,N,A", absTwa, micronetCodec->navData.tws_kt.value);
-            AddNmeaChecksum(sentence);
-            nmeaTimeStamps.vwt = millis();
-            NMEA_EXT.println(sentence);
-        }
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_DAMPED_TWA_DEG) > nmeaTimeStamps.vwtSentence + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && (micronetCodec->navData.IsValid(NAV_ID_DAMPED_TWA_DEG) && micronetCodec->navData.IsValid(NAV_ID_DAMPED_TWS_KT));
+
+    if (update)
+    {
+        char  sentence[NMEA_SENTENCE_MAX_LENGTH];
+        float twa_deg = FastWrap180_deg(micronetCodec->navData.Get(NAV_ID_DAMPED_TWA_DEG));
+        float tws_kt  = micronetCodec->navData.Get(NAV_ID_DAMPED_TWS_KT);
+        sprintf(sentence, "$INVWT,%.1f,%c,%.1f,N,%.1f,M,%.1f,K", fabsf(twa_deg), (twa_deg < 0.0f) ? 'L' : 'R', tws_kt, tws_kt * KT_TO_MPS,
+                tws_kt * KT_TO_KMPH);
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.vwtSentence = millis();
+        SendSentence(sentence, LATENCY_NMEA_VWT, NAV_BIT(NAV_ID_DAMPED_TWA_DEG) | NAV_BIT(NAV_ID_DAMPED_TWS_KT));
     }
 }
 
 void DataBridge::EncodeDPT()
 {
-    if (DEPTH_SOURCE_LINK == LINK_MICRONET)
-    {
-        bool update;
+    bool update;
 
-        update = (micronetCodec->navData.dpt_m.timeStamp > nmeaTimeStamps.dpt + NMEA_SENTENCE_MIN_PERIOD_MS);
-        update = update && micronetCodec->navData.dpt_m.valid;
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_DPT_M) > nmeaTimeStamps.dpt + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && micronetCodec->navData.IsValid(NAV_ID_DPT_M);
 
-        if (update)
-        {
-            char sentence[NMEA_SENTENCE_MAX_LENGTH];
-            sprintf(sentence, "$INDPT,%.1f,%.1f,", micronetCodec->navData.dpt_m.value - micronetCodec->navData.depthOffset_m,
-                    micronetCodec->navData.depthOffset_m);
-            AddNmeaChecksum(sentence);
-            nmeaTimeStamps.dpt = millis();
-            NMEA_EXT.println(sentence);
-        }
+    if (update)
+    {
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        sprintf(sentence, "$INDPT,%.1f,%.1f,", micronetCodec->navData.Get(NAV_ID_DPT_M) - micronetCodec->navData.depthOffset_m,
+                micronetCodec->navData.depthOffset_m);
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.dpt = millis();
+        SendSentence(sentence, LATENCY_NMEA_DPT, NAV_BIT(NAV_ID_DPT_M));
     }
 }
 
 void DataBridge::EncodeMTW()
 {
-    if (SEATEMP_SOURCE_LINK == LINK_MICRONET)
-    {
-        bool update;
+    bool update;
 
-        update = (micronetCodec->navData.stp_degc.timeStamp > (nmeaTimeStamps.mtw + NMEA_SENTENCE_MIN_PERIOD_MS));
-        update = update && micronetCodec->navData.stp_degc.valid;
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_STP_DEGC) > (nmeaTimeStamps.mtw + NMEA_SENTENCE_MIN_PERIOD_MS));
+    update = update && micronetCodec->navData.IsValid(NAV_ID_STP_DEGC);
 
-        if (update)
-        {
-            char sentence[NMEA_SENTENCE_MAX_LENGTH];
-            sprintf(sentence, "$INMTW,%.1f,C", micronetCodec->navData.stp_degc.value);
-            AddNmeaChecksum(sentence);
-            nmeaTimeStamps.mtw = millis();
-            NMEA_EXT.println(sentence);
-        }
+    if (update)
+    {
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        sprintf(sentence, "$INMTW,%.1f,C", micronetCodec->navData.Get(NAV_ID_STP_DEGC));
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.mtw = millis();
+        SendSentence(sentence, LATENCY_NMEA_MTW, NAV_BIT(NAV_ID_STP_DEGC));
     }
 }
 
 void DataBridge::EncodeVLW()
 {
-    if (SPEED_SOURCE_LINK == LINK_MICRONET)
-    {
-        bool update;
+    bool update;
 
-        update = (micronetCodec->navData.log_nm.timeStamp > nmeaTimeStamps.vlw + NMEA_SENTENCE_MIN_PERIOD_MS);
-        update = update && (micronetCodec->navData.trip_nm.timeStamp > nmeaTimeStamps.vlw + NMEA_SENTENCE_MIN_PERIOD_MS);
-        update = update && (micronetCodec->navData.log_nm.valid && micronetCodec->navData.trip_nm.valid);
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_LOG_NM) > nmeaTimeStamps.vlw + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && (micronetCodec->navData.GetTimeStamp(NAV_ID_TRIP_NM) > nmeaTimeStamps.vlw + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && (micronetCodec->navData.IsValid(NAV_ID_LOG_NM) && micronetCodec->navData.IsValid(NAV_ID_TRIP_NM));
 
-        if (update)
-        {
-            char sentence[NMEA_SENTENCE_MAX_LENGTH];
-            sprintf(sentence, "$INVLW,%.1f,N,%.1f,N,,N,,N", micronetCodec->navData.log_nm.value, micronetCodec->navData.trip_nm.value);
-            AddNmeaChecksum(sentence);
-            nmeaTimeStamps.vlw = millis();
-            NMEA_EXT.println(sentence);
-        }
+    if (update)
+    {
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        sprintf(sentence, "$INVLW,%.1f,N,%.1f,N,,N,,N", micronetCodec->navData.Get(NAV_ID_LOG_NM), micronetCodec->navData.Get(NAV_ID_TRIP_NM));
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.vlw = millis();
+        SendSentence(sentence, LATENCY_NMEA_VLW, NAV_BIT(NAV_ID_LOG_NM) | NAV_BIT(NAV_ID_TRIP_NM));
     }
 }
 
 void DataBridge::EncodeVHW()
 {
-    if (SPEED_SOURCE_LINK == LINK_MICRONET)
-    {
-        bool update =
-            (micronetCodec->navData.spd_kt.timeStamp > nmeaTimeStamps.vhw + NMEA_SENTENCE_MIN_PERIOD_MS) && (micronetCodec->navData.spd_kt.valid);
+    bool update = (micronetCodec->navData.GetTimeStamp(NAV_ID_SPD_KT) > nmeaTimeStamps.vhw + NMEA_SENTENCE_MIN_PERIOD_MS) &&
+                  micronetCodec->navData.IsValid(NAV_ID_SPD_KT);
 
-        if (update)
+    if (update)
+    {
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        if (micronetCodec->navData.IsValid(NAV_ID_MAG_HDG_DEG) && micronetCodec->navData.IsValid(NAV_ID_SPD_KT))
         {
-            char sentence[NMEA_SENTENCE_MAX_LENGTH];
-            if ((micronetCodec->navData.magHdg_deg.valid) && (micronetCodec->navData.spd_kt.valid))
+            float trueHeading = micronetCodec->navData.Get(NAV_ID_MAG_HDG_DEG) + micronetCodec->navData.magneticVariation_deg;
+            if (trueHeading < 0.0f)
             {
-                float trueHeading = micronetCodec->navData.magHdg_deg.value + micronetCodec->navData.magneticVariation_deg;
-                if (trueHeading < 0.0f)
-                {
-                    trueHeading += 360.0f;
-                }
-                if (trueHeading >= 360.0f)
-                {
-                    trueHeading -= 360.0f;
-                }
-                sprintf(sentence, "$INVHW,%.1f,T,%.1f,M,%.1f,N,,K", trueHeading, micronetCodec->navData.magHdg_deg.value,
-                        micronetCodec->navData.spd_kt.value);
+                trueHeading += 360.0f;
             }
-            else if (micronetCodec->navData.spd_kt.valid)
+            if (trueHeading >= 360.0f)
             {
-                sprintf(sentence, "$INVHW,,T,,M,%.1f,N,,K", micronetCodec->navData.spd_kt.value);
+                trueHeading -= 360.0f;
             }
-            AddNmeaChecksum(sentence);
-            nmeaTimeStamps.vhw = millis();
-            NMEA_EXT.println(sentence);
+            sprintf(sentence, "$INVHW,%.1f,T,%.1f,M,%.1f,N,,K", trueHeading, micronetCodec->navData.Get(NAV_ID_MAG_HDG_DEG),
+                    micronetCodec->navData.Get(NAV_ID_SPD_KT));
+        }
+        else if (micronetCodec->navData.IsValid(NAV_ID_SPD_KT))
+        {
+            sprintf(sentence, "$INVHW,,T,,M,%.1f,N,,K", micronetCodec->navData.Get(NAV_ID_SPD_KT));
         }
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.vhw = millis();
+        SendSentence(sentence, LATENCY_NMEA_VHW, NAV_BIT(NAV_ID_SPD_KT));
     }
 }
 
 void DataBridge::EncodeHDG()
 {
-    if ((COMPASS_SOURCE_LINK == LINK_MICRONET) || (COMPASS_SOURCE_LINK == LINK_COMPASS))
-    {
-        bool update;
+    bool update;
 
-        update = (micronetCodec->navData.magHdg_deg.timeStamp > nmeaTimeStamps.hdg + NMEA_SENTENCE_MIN_PERIOD_MS);
-        update = update && micronetCodec->navData.magHdg_deg.valid;
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_MAG_HDG_DEG) > nmeaTimeStamps.hdg + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && micronetCodec->navData.IsValid(NAV_ID_MAG_HDG_DEG);
 
-        if (update)
-        {
-            char sentence[NMEA_SENTENCE_MAX_LENGTH];
-            sprintf(sentence, "$INHDG,%.1f,0,E,%.1f,%c", micronetCodec->navData.magHdg_deg.value, fabsf(micronetCodec->navData.magneticVariation_deg),
-                    (micronetCodec->navData.magneticVariation_deg < 0.0f) ? 'W' : 'E');
-            AddNmeaChecksum(sentence);
-            nmeaTimeStamps.hdg = millis();
-            NMEA_EXT.println(sentence);
-        }
+    if (update)
+    {
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        sprintf(sentence, "$INHDG,%.1f,0,E,%.1f,%c", micronetCodec->navData.Get(NAV_ID_MAG_HDG_DEG),
+                fabsf(micronetCodec->navData.magneticVariation_deg), (micronetCodec->navData.magneticVariation_deg < 0.0f) ? 'W' : 'E');
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.hdg = millis();
+        SendSentence(sentence, LATENCY_NMEA_HDG, NAV_BIT(NAV_ID_MAG_HDG_DEG));
     }
 }
 
 void DataBridge::EncodeXDR()
 {
-    if (VOLTAGE_SOURCE_LINK == LINK_MICRONET)
+    bool update;
+
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_VCC_V) > nmeaTimeStamps.vcc + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && micronetCodec->navData.IsValid(NAV_ID_VCC_V);
+
+    if (update)
     {
-        bool update;
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        sprintf(sentence, "$INXDR,U,%.1f,V,TACKTICK#0", micronetCodec->navData.Get(NAV_ID_VCC_V));
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.vcc = millis();
+        SendSentence(sentence, LATENCY_NMEA_XDR, NAV_BIT(NAV_ID_VCC_V));
+    }
+}
+
+void DataBridge::EncodeROT()
+{
+    bool update;
 
-        update = (micronetCodec->navData.vcc_v.timeStamp > nmeaTimeStamps.vcc + NMEA_SENTENCE_MIN_PERIOD_MS);
-        update = update && micronetCodec->navData.vcc_v.valid;
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_ROT_DEGPMIN) > nmeaTimeStamps.rot + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && micronetCodec->navData.IsValid(NAV_ID_ROT_DEGPMIN);
 
-        if (update)
+    if (update)
+    {
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        sprintf(sentence, "$INROT,%.1f,A", micronetCodec->navData.Get(NAV_ID_ROT_DEGPMIN));
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.rot = millis();
+        SendSentence(sentence, LATENCY_NMEA_ROT, NAV_BIT(NAV_ID_ROT_DEGPMIN));
+    }
+}
+
+void DataBridge::EncodeXDR_Attitude()
+{
+    bool update;
+
+    update = (micronetCodec->navData.GetTimeStamp(NAV_ID_HEEL_DEG) > nmeaTimeStamps.att + NMEA_SENTENCE_MIN_PERIOD_MS);
+    update = update && micronetCodec->navData.IsValid(NAV_ID_HEEL_DEG) && micronetCodec->navData.IsValid(NAV_ID_PITCH_DEG);
+
+    if (update)
+    {
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        sprintf(sentence, "$INXDR,A,%.1f,D,ROLL,A,%.1f,D,PTCH", micronetCodec->navData.Get(NAV_ID_HEEL_DEG),
+                micronetCodec->navData.Get(NAV_ID_PITCH_DEG));
+        AddNmeaChecksum(sentence);
+        nmeaTimeStamps.att = millis();
+        SendSentence(sentence, LATENCY_NMEA_XDR_ATTITUDE, NAV_BIT(NAV_ID_HEEL_DEG) | NAV_BIT(NAV_ID_PITCH_DEG));
+    }
+}
+
+void DataBridge::EncodeRMC()
+{
+    NavigationData    *navData = &micronetCodec->navData;
+    NavGroupSnapshot_t position, sogCog;
+
+    navData->GetSnapshot(NAV_GROUP_POSITION, &position);
+    if (position.validMask == (NAV_BIT(NAV_ID_LATITUDE_DEG) | NAV_BIT(NAV_ID_LONGITUDE_DEG)))
+    {
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        char time[16], latitude[16], longitude[16], date[12] = "";
+
+        navData->GetSnapshot(NAV_GROUP_SOGCOG, &sogCog);
+        FormatTime(time, sizeof(time));
+        FormatCoordinate(latitude, sizeof(latitude), position.value[0], false);
+        FormatCoordinate(longitude, sizeof(longitude), position.value[1], true);
+        if (navData->date.valid)
         {
-            char sentence[NMEA_SENTENCE_MAX_LENGTH];
-            sprintf(sentence, "$INXDR,U,%.1f,V,TACKTICK#0", micronetCodec->navData.vcc_v.value);
-            AddNmeaChecksum(sentence);
-            nmeaTimeStamps.vcc = millis();
-            NMEA_EXT.println(sentence);
+            snprintf(date, sizeof(date), "%02d%02d%02d", navData->date.day, navData->date.month, navData->date.year);
         }
+        sprintf(sentence, "$GNRMC,%s,A,%s,%s,%.1f,%.1f,%s,,,A", time, latitude, longitude, sogCog.value[0], sogCog.value[1], date);
+        AddNmeaChecksum(sentence);
+        SendSentence(sentence, LATENCY_NMEA_RMC, NAV_BIT(NAV_ID_LATITUDE_DEG) | NAV_BIT(NAV_ID_LONGITUDE_DEG));
+    }
+}
+
+// GGA only carries PDOP since NAV-PVT doesn't provide HDOP
+void DataBridge::EncodeGGA()
+{
+    NavigationData    *navData = &micronetCodec->navData;
+    NavGroupSnapshot_t position;
+
+    navData->GetSnapshot(NAV_GROUP_POSITION, &position);
+    if ((position.validMask == (NAV_BIT(NAV_ID_LATITUDE_DEG) | NAV_BIT(NAV_ID_LONGITUDE_DEG))) && navData->gnssFix.valid)
+    {
+        char sentence[NMEA_SENTENCE_MAX_LENGTH];
+        char time[16], latitude[16], longitude[16];
+
+        FormatTime(time, sizeof(time));
+        FormatCoordinate(latitude, sizeof(latitude), position.value[0], false);
+        FormatCoordinate(longitude, sizeof(longitude), position.value[1], true);
+        sprintf(sentence, "$GNGGA,%s,%s,%s,1,%02d,%.1f,%.1f,M,,M,,", time, latitude, longitude, navData->gnssFix.nbSatellites,
+                navData->gnssFix.pdop, navData->gnssFix.altitude_m);
+        AddNmeaChecksum(sentence);
+        SendSentence(sentence, LATENCY_NMEA_GGA, NAV_BIT(NAV_ID_LATITUDE_DEG) | NAV_BIT(NAV_ID_LONGITUDE_DEG));
+    }
+}
+
+void DataBridge::EncodeVTG()
+{
+    NavigationData    *navData = &micronetCodec->navData;
+    NavGroupSnapshot_t sogCog;
+
+    navData->GetSnapshot(NAV_GROUP_SOGCOG, &sogCog);
+    if (sogCog.validMask == (NAV_BIT(NAV_ID_SOG_KT) | NAV_BIT(NAV_ID_COG_DEG)))
+    {
+        char  sentence[NMEA_SENTENCE_MAX_LENGTH];
+        float cog_deg    = sogCog.value[1];
+        float cogMag_deg = FastWrap360_deg(cog_deg - navData->magneticVariation_deg);
+        float sog_kt     = sogCog.value[0];
+
+        sprintf(sentence, "$GNVTG,%.1f,T,%.1f,M,%.1f,N,%.1f,K,A", cog_deg, cogMag_deg, sog_kt, sog_kt * KT_TO_KMPH);
+        AddNmeaChecksum(sentence);
+        SendSentence(sentence, LATENCY_NMEA_VTG, NAV_BIT(NAV_ID_SOG_KT) | NAV_BIT(NAV_ID_COG_DEG));
+    }
+}
+
+// Send an encoded NMEA sentence on the external port and account its latency, from the reception of the oldest value it
+// carries
+void DataBridge::SendSentence(char *sentence, LatencyOutput_t output, uint32_t valueMask)
+{
+    nmeaExt->println(sentence);
+    if (latencyTracer != nullptr)
+    {
+        latencyTracer->Record(output, micros() - micronetCodec->navData.GetOldestOrigin_us(valueMask));
+    }
+}
+
+// Format UTC time as hhmmss.ss, empty if time is unknown
+void DataBridge::FormatTime(char *buffer, size_t size)
+{
+    TimeValue_t *time = &micronetCodec->navData.time;
+
+    buffer[0] = 0;
+    if (time->valid)
+    {
+        snprintf(buffer, size, "%02d%02d%02d.%02d", time->hour, time->minute, time->second, time->centisecond);
+    }
+}
+
+// Format a latitude (ddmm.mmmm,N) or longitude (dddmm.mmmm,E)
+void DataBridge::FormatCoordinate(char *buffer, size_t size, float value_deg, bool isLongitude)
+{
+    char  hemisphere = isLongitude ? ((value_deg < 0) ? 'W' : 'E') : ((value_deg < 0) ? 'S' : 'N');
+    float absValue   = fabsf(value_deg);
+    int   degs       = (int)absValue;
+    // Minutes are rounded to the 4 decimals sent, a value rounded up to 60 minutes is carried into degrees
+    int   mins_e4    = (int)lroundf((absValue - degs) * 600000.0f);
+
+    if (mins_e4 >= 600000)
+    {
+        mins_e4 -= 600000;
+        degs++;
     }
+    snprintf(buffer, size, isLongitude ? "%03d%02d.%04d,%c" : "%02d%02d.%04d,%c", degs, mins_e4 / 10000, mins_e4 % 10000, hemisphere);
 }
 
 uint8_t DataBridge::AddNmeaChecksum(char *sentence)
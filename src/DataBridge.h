@@ -31,9 +31,13 @@
 /*                              Includes                                   */
 /***************************************************************************/
 
+#include "Configuration.h"
+#include "LatencyTracer.h"
 #include "MicronetCodec.h"
 #include "NavigationData.h"
+#include "UbxParser.h"
 
+#include <Arduino.h>
 #include <stdint.h>
 
 /***************************************************************************/
@@ -43,18 +47,34 @@
 #define NMEA_SENTENCE_MAX_LENGTH   128
 #define NMEA_SENTENCE_HISTORY_SIZE 24
 
+// NMEA sentences which can be regenerated from UBX NAV-PVT messages (see GNSS_NMEA_OUTPUT)
+#define GNSS_NMEA_RMC 0x01
+#define GNSS_NMEA_GGA 0x02
+#define GNSS_NMEA_VTG 0x04
+
+// NMEA encoders run on navigation data changes
+#define ENCODER_MWV_R 0x0001
+#define ENCODER_MWV_T 0x0002
+#define ENCODER_MWD   0x0004
+#define ENCODER_VWT   0x0008
+#define ENCODER_DPT   0x0010
+#define ENCODER_MTW   0x0020
+#define ENCODER_VLW   0x0040
+#define ENCODER_VHW   0x0080
+#define ENCODER_HDG   0x0100
+#define ENCODER_XDR   0x0200
+#define ENCODER_RMC   0x0400
+#define ENCODER_GGA   0x0800
+#define ENCODER_VTG   0x1000
+
+// Encoders run on compass updates only
+#define ENCODER_ROT          0x2000
+#define ENCODER_XDR_ATTITUDE 0x4000
+
 /***************************************************************************/
 /*                                Types                                    */
 /***************************************************************************/
 
-typedef enum
-{
-    LINK_NMEA_EXT,
-    LINK_NMEA_GNSS,
-    LINK_MICRONET,
-    LINK_COMPASS
-} LinkId_t;
-
 typedef enum
 {
     NMEA_ID_UNKNOWN,
@@ -66,19 +86,24 @@ typedef enum
     NMEA_ID_MWV,
     NMEA_ID_DPT,
     NMEA_ID_VHW,
-    NMEA_ID_HDG
+    NMEA_ID_HDG,
+    NMEA_ID_NB
 } NmeaId_t;
 
 typedef struct
 {
     uint32_t vwr;
     uint32_t vwt;
+    uint32_t mwd;
+    uint32_t vwtSentence;
     uint32_t dpt;
     uint32_t mtw;
     uint32_t vlw;
     uint32_t vhw;
     uint32_t hdg;
     uint32_t vcc;
+    uint32_t rot;
+    uint32_t att;
 } NmeaTimeStamps_t;
 
 #define NMEA_SENTENCE_MIN_PERIOD_MS 500
@@ -86,33 +111,65 @@ typedef struct
 class DataBridge
 {
   public:
-    DataBridge(MicronetCodec *micronetCodec);
+    DataBridge(MicronetCodec *micronetCodec, Configuration *configuration);
     virtual ~DataBridge();
 
-    void PushNmeaChar(char c, LinkId_t sourceLink);
-    void UpdateCompassData(float heading_deg);
-    void UpdateMicronetData();
+    void    PushNmeaChar(char c, LinkId_t sourceLink);
+    Stream *GetNmeaExtPort();
+    void    SetNmeaExtPort(Stream *port);
+    void    SetLatencyTracer(LatencyTracer *latencyTracer);
+    void    ForceEncoders(uint32_t encoders);
+    void    UpdateCompassData(float heading_deg);
+    void    UpdateAttitudeData(float heel_deg, float pitch_deg, float rot_degpmin);
 
   private:
-    static const uint8_t asciiTable[128];
+    typedef void (DataBridge::*NmeaDecoder_t)(char *sentence);
+
+    // Processing of a NMEA sentence received on a link
+    typedef struct
+    {
+        NmeaDecoder_t decoder; // nullptr if the sentence is not decoded
+        bool          forward; // Sentence is forwarded to the external NMEA port
+    } NmeaDispatch_t;
+
+    // Source and decoder of each NMEA sentence, indexed by NmeaId_t
+    typedef struct
+    {
+        DataSource_t  source;
+        NmeaDecoder_t decoder;
+    } NmeaSentenceDesc_t;
+
+    static const uint8_t            asciiTable[128];
+    static const NmeaSentenceDesc_t sentenceDesc[NMEA_ID_NB];
+
     char                 nmeaExtBuffer[NMEA_SENTENCE_MAX_LENGTH];
     char                 nmeaGnssBuffer[NMEA_SENTENCE_MAX_LENGTH];
     int                  nmeaExtWriteIndex;
     int                  nmeaGnssWriteIndex;
+    uint32_t             nmeaExtStart_us; // micros() time at which the first character of the current sentence was received
+    uint32_t             nmeaGnssStart_us;
     NmeaTimeStamps_t     nmeaTimeStamps;
-    LinkId_t             navSourceLink;
-    LinkId_t             gnssSourceLink;
-    LinkId_t             windSourceLink;
-    LinkId_t             depthSourceLink;
-    LinkId_t             speedSourceLink;
-    LinkId_t             voltageSourceLink;
-    LinkId_t             seaTempSourceLink;
-    LinkId_t             compassSourceLink;
+    LinkId_t             dataSourceLink[DATA_SOURCE_NB];
+    NmeaDispatch_t       nmeaDispatch[NMEA_ID_NB][LINK_NB_LINKS]; // Processing of each sentence on each link
+    uint32_t             valueEncoders[NAV_NB_VALUES];            // NMEA encoders to run when a navigation value changes
+    Stream              *nmeaExt;                                 // External NMEA port
+    LatencyTracer       *latencyTracer;                           // Latency of the sentences sent, nullptr for none
     MicronetCodec       *micronetCodec;
     int                  sogFilterIndex;
-    float                sogFilterBuffer[SOG_COG_FILTERING_DEPTH];
+    float                sogFilterBuffer[SOG_COG_MAX_FILTERING_DEPTH];
     int                  cogFilterIndex;
-    float                cogFilterBuffer[SOG_COG_FILTERING_DEPTH];
+    float                cogFilterBuffer[SOG_COG_MAX_FILTERING_DEPTH];
+    int                  sogCogFilteringDepth;
+    bool                 spdEmulation;
+    bool                 ubxInput; // GNSS link carries UBX NAV-PVT messages
+    UbxParser            ubxParser;
+
+    void        CompileDispatch(Configuration *configuration);
+
+    static void NavDataChanged(void *context, uint32_t changedMask);
+    void        EncodeChangedValues(uint32_t changedMask);
+    void        RunEncoders(uint32_t encoders);
+    uint32_t    EncodersOfValue(NavValueId_t id);
 
     float FilteredSOG(float newSog_kt);
     float FilteredCOG(float newCog_deg);
@@ -128,16 +185,28 @@ class DataBridge
     void     DecodeDPTSentence(char *sentence);
     void     DecodeVHWSentence(char *sentence);
     void     DecodeHDGSentence(char *sentence);
+    void     DecodeUbxFrame();
+    void     DecodeNavPvtMessage(uint8_t *payload);
     int16_t  NibbleValue(char c);
 
     void EncodeMWV_R();
     void EncodeMWV_T();
+    void EncodeMWD();
+    void EncodeVWT();
     void EncodeDPT();
     void EncodeMTW();
     void EncodeVLW();
     void EncodeVHW();
     void EncodeHDG();
     void EncodeXDR();
+    void EncodeROT();
+    void EncodeXDR_Attitude();
+    void EncodeRMC();
+    void EncodeGGA();
+    void EncodeVTG();
+    void SendSentence(char *sentence, LatencyOutput_t output, uint32_t valueMask);
+    void FormatTime(char *buffer, size_t size);
+    void FormatCoordinate(char *buffer, size_t size, float value_deg, bool isLongitude);
 
     uint8_t AddNmeaChecksum(char *sentence);
 };
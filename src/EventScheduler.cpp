@@ -0,0 +1,274 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Cooperative event driven task scheduler                       *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "EventScheduler.h"
+
+#include <string.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+EventScheduler::EventScheduler(SchedulerPlatform *platform) : platform(platform), nbTasks(0)
+{
+    memset(tasks, 0, sizeof(tasks));
+}
+
+EventScheduler::~EventScheduler()
+{
+}
+
+// Register a new task
+// @param name Name of the task, used in statistics report
+// @param priority Priority of the task, 0 being the highest. Tasks with the same priority run in registration order.
+// @param callback Function executed each time the task is run
+// @param context Opaque pointer given to callback
+// @param period_us Period at which the task is automatically woken-up, 0 if the task is only woken-up by Signal
+// @return Task ID to be used with Signal, -1 if the task table is full
+int EventScheduler::AddTask(const char *name, uint8_t priority, TaskCallback_t callback, void *context, uint32_t period_us)
+{
+    if (nbTasks >= SCHEDULER_MAX_TASKS)
+    {
+        return -1;
+    }
+
+    SchedulerTask_t *task = &tasks[nbTasks];
+    memset(task, 0, sizeof(SchedulerTask_t));
+    task->name       = name;
+    task->priority   = priority;
+    task->callback   = callback;
+    task->context    = context;
+    task->period_us  = period_us;
+    task->nextRun_us = platform->GetTime_us() + period_us;
+
+    return nbTasks++;
+}
+
+// Wake-up a task. Can be called from ISR or main loop. Signalling a task which is already pending does not change
+// its signal time, so that latency statistics reflect the oldest event.
+void EventScheduler::Signal(int taskId)
+{
+    if ((taskId < 0) || (taskId >= nbTasks))
+    {
+        return;
+    }
+
+    platform->DisableInterrupts();
+    if (!tasks[taskId].pending)
+    {
+        tasks[taskId].signalTime_us = platform->GetTime_us();
+        tasks[taskId].pending       = true;
+    }
+    platform->EnableInterrupts();
+}
+
+// Wake-up an event task at a given time, from the main loop only. A new call replaces the previously armed time.
+// Ignored for periodic tasks.
+void EventScheduler::SignalAt(int taskId, uint32_t time_us)
+{
+    if ((taskId < 0) || (taskId >= nbTasks) || (tasks[taskId].period_us != 0))
+    {
+        return;
+    }
+
+    tasks[taskId].nextRun_us  = time_us;
+    tasks[taskId].wakeUpArmed = true;
+}
+
+// Run the highest priority pending task
+// @return true if a task has been run, false if there was nothing to do
+bool EventScheduler::RunNext()
+{
+    int      selected = -1;
+    uint32_t signalTime_us, startTime_us, runTime_us, latency_us;
+
+    ReleasePeriodicTasks(platform->GetTime_us());
+
+    for (int i = 0; i < nbTasks; i++)
+    {
+        if (tasks[i].pending && ((selected < 0) || (tasks[i].priority < tasks[selected].priority)))
+        {
+            selected = i;
+        }
+    }
+
+    if (selected < 0)
+    {
+        return false;
+    }
+
+    SchedulerTask_t *task = &tasks[selected];
+
+    // Clear pending flag before running the task so that events occurring during its execution wake it up again
+    platform->DisableInterrupts();
+    task->pending = false;
+    signalTime_us = task->signalTime_us;
+    platform->EnableInterrupts();
+
+    startTime_us = platform->GetTime_us();
+    task->callback(task->context);
+    runTime_us = platform->GetTime_us() - startTime_us;
+    latency_us = startTime_us - signalTime_us;
+
+    task->nbRuns++;
+    task->totalRunTime_us += runTime_us;
+    task->totalLatency_us += latency_us;
+    if (runTime_us > task->maxRunTime_us)
+    {
+        task->maxRunTime_us = runTime_us;
+    }
+    if (latency_us > task->maxLatency_us)
+    {
+        task->maxLatency_us = latency_us;
+    }
+
+    return true;
+}
+
+// Returns the delay until the next periodic task must run, 0xffffffff if there is no periodic task
+uint32_t EventScheduler::GetNextDeadlineDelay_us()
+{
+    uint32_t now_us   = platform->GetTime_us();
+    uint32_t delay_us = 0xffffffff;
+
+    for (int i = 0; i < nbTasks; i++)
+    {
+        if ((tasks[i].period_us != 0) || tasks[i].wakeUpArmed)
+        {
+            int32_t taskDelay_us = tasks[i].nextRun_us - now_us;
+            if (taskDelay_us <= 0)
+            {
+                return 0;
+            }
+            if ((uint32_t)taskDelay_us < delay_us)
+            {
+                delay_us = taskDelay_us;
+            }
+        }
+    }
+
+    return delay_us;
+}
+
+int EventScheduler::GetNbTasks()
+{
+    return nbTasks;
+}
+
+// Get a copy of a task descriptor, including its statistics
+bool EventScheduler::GetTaskStatistics(int taskId, SchedulerTask_t *task)
+{
+    if ((taskId < 0) || (taskId >= nbTasks))
+    {
+        return false;
+    }
+
+    platform->DisableInterrupts();
+    *task = tasks[taskId];
+    platform->EnableInterrupts();
+
+    return true;
+}
+
+void EventScheduler::ResetStatistics()
+{
+    for (int i = 0; i < nbTasks; i++)
+    {
+        tasks[i].nbRuns          = 0;
+        tasks[i].maxRunTime_us   = 0;
+        tasks[i].totalRunTime_us = 0;
+        tasks[i].maxLatency_us   = 0;
+        tasks[i].totalLatency_us = 0;
+    }
+}
+
+void EventScheduler::RemoveAllTasks()
+{
+    platform->DisableInterrupts();
+    nbTasks = 0;
+    memset(tasks, 0, sizeof(tasks));
+    platform->EnableInterrupts();
+}
+
+// Wake-up periodic and armed tasks which reached their deadline. The deadline is used as signal time so that latency
+// statistics show how late these tasks are run.
+void EventScheduler::ReleasePeriodicTasks(uint32_t now_us)
+{
+    for (int i = 0; i < nbTasks; i++)
+    {
+        SchedulerTask_t *task = &tasks[i];
+
+        if ((task->period_us != 0) && ((int32_t)(now_us - task->nextRun_us) >= 0))
+        {
+            platform->DisableInterrupts();
+            if (!task->pending)
+            {
+                task->signalTime_us = task->nextRun_us;
+                task->pending       = true;
+            }
+            platform->EnableInterrupts();
+
+            task->nextRun_us += task->period_us;
+            if ((int32_t)(now_us - task->nextRun_us) >= 0)
+            {
+                // We are late by more than one period : don't try to catch-up
+                task->nextRun_us = now_us + task->period_us;
+            }
+        }
+        else if (task->wakeUpArmed && ((int32_t)(now_us - task->nextRun_us) >= 0))
+        {
+            platform->DisableInterrupts();
+            if (!task->pending)
+            {
+                task->signalTime_us = task->nextRun_us;
+                task->pending       = true;
+            }
+            platform->EnableInterrupts();
+
+            task->wakeUpArmed = false;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Cooperative event driven task scheduler                       *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef EVENTSCHEDULER_H_
+#define EVENTSCHEDULER_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "SchedulerPlatform.h"
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define SCHEDULER_MAX_TASKS 12
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+typedef void (*TaskCallback_t)(void *context);
+
+typedef struct
+{
+    const char       *name;
+    uint8_t           priority; // 0 is the highest priority
+    TaskCallback_t    callback;
+    void             *context;
+    uint32_t          period_us; // 0 for tasks only woken-up by events
+    uint32_t          nextRun_us; // Next periodic release, or one-shot wake-up time when wakeUpArmed is set
+    bool              wakeUpArmed;
+    volatile bool     pending;
+    volatile uint32_t signalTime_us;
+    uint32_t          nbRuns;
+    uint32_t          maxRunTime_us;
+    uint64_t          totalRunTime_us;
+    uint32_t          maxLatency_us;
+    uint64_t          totalLatency_us;
+} SchedulerTask_t;
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class EventScheduler
+{
+  public:
+    EventScheduler(SchedulerPlatform *platform);
+    virtual ~EventScheduler();
+
+    int      AddTask(const char *name, uint8_t priority, TaskCallback_t callback, void *context, uint32_t period_us);
+    void     Signal(int taskId);
+    void     SignalAt(int taskId, uint32_t time_us);
+    bool     RunNext();
+    uint32_t GetNextDeadlineDelay_us();
+    int      GetNbTasks();
+    bool     GetTaskStatistics(int taskId, SchedulerTask_t *task);
+    void     ResetStatistics();
+    void     RemoveAllTasks();
+
+  private:
+    SchedulerPlatform *platform;
+    SchedulerTask_t    tasks[SCHEDULER_MAX_TASKS];
+    int                nbTasks;
+
+    void ReleasePeriodicTasks(uint32_t now_us);
+};
+
+#endif /* EVENTSCHEDULER_H_ */
@@ -0,0 +1,128 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Bounded-error fast math for navigation angles                 *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "FastMath.h"
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Arctangent polynomial on [0, 1] (Abramowitz & Stegun 4.4.49)
+#define ATAN_A2  -0.3333314528f
+#define ATAN_A4  0.1999355085f
+#define ATAN_A6  -0.1420889944f
+#define ATAN_A8  0.1065626393f
+#define ATAN_A10 -0.0752896400f
+#define ATAN_A12 0.0429096138f
+#define ATAN_A14 -0.0161657367f
+#define ATAN_A16 0.0028662257f
+
+#define FASTMATH_PI   3.14159265358979f
+#define FASTMATH_PI_2 1.57079632679490f
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+// Four-quadrant arctangent in radians, result in [-pi, pi]
+// Argument is reduced to [0, 1] by swapping |x| and |y| so that a single polynomial covers all octants
+float FastAtan2(float y, float x)
+{
+    float ax = x < 0.0f ? -x : x;
+    float ay = y < 0.0f ? -y : y;
+    float mx = ax > ay ? ax : ay;
+    float mn = ax > ay ? ay : ax;
+
+    if (mx == 0.0f)
+    {
+        return 0.0f;
+    }
+
+    float z  = mn / mx;
+    float z2 = z * z;
+    float a  = ATAN_A16;
+    a        = a * z2 + ATAN_A14;
+    a        = a * z2 + ATAN_A12;
+    a        = a * z2 + ATAN_A10;
+    a        = a * z2 + ATAN_A8;
+    a        = a * z2 + ATAN_A6;
+    a        = a * z2 + ATAN_A4;
+    a        = a * z2 + ATAN_A2;
+    a        = z + z * z2 * a;
+
+    if (ay > ax)
+        a = FASTMATH_PI_2 - a;
+    if (x < 0.0f)
+        a = FASTMATH_PI - a;
+    if (y < 0.0f)
+        a = -a;
+
+    return a;
+}
+
+// Four-quadrant arctangent in degrees, result in [-180, 180]
+float FastAtan2_deg(float y, float x)
+{
+    return FastAtan2(y, x) * FASTMATH_RAD_TO_DEG;
+}
+
+// Wrap an angle to [0, 360[
+float FastWrap360_deg(float angle_deg)
+{
+    float turns = angle_deg * (1.0f / 360.0f);
+    angle_deg -= 360.0f * (float)(int32_t)(turns < 0.0f ? turns - 1.0f : turns);
+    // Rounding may land exactly on one of the bounds
+    if (angle_deg >= 360.0f)
+        angle_deg -= 360.0f;
+    if (angle_deg < 0.0f)
+        angle_deg += 360.0f;
+
+    return angle_deg;
+}
+
+// Wrap an angle to [-180, 180[
+float FastWrap180_deg(float angle_deg)
+{
+    return FastWrap360_deg(angle_deg + 180.0f) - 180.0f;
+}
@@ -0,0 +1,56 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Bounded-error fast math for navigation angles                 *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef FASTMATH_H_
+#define FASTMATH_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define FASTMATH_DEG_TO_RAD 0.017453292519943295f
+#define FASTMATH_RAD_TO_DEG 57.29577951308232f
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Prototypes                                 */
+/***************************************************************************/
+
+// Four-quadrant arctangent, max error 3e-7 rad
+float FastAtan2(float y, float x);
+float FastAtan2_deg(float y, float x);
+// Angle wrapping to [0, 360[ and [-180, 180[
+float FastWrap360_deg(float angle_deg);
+float FastWrap180_deg(float angle_deg);
+
+#endif /* FASTMATH_H_ */
@@ -56,6 +56,10 @@ MicronetMessageFifo gRxMessageFifo; // Micronet message fifo store, used for com
 Configuration       gConfiguration;
 NavCompass          gNavCompass;
 M8NDriver           gM8nDriver;
+NetworkCensus       gNetworkCensus; // Census of Micronet networks and devices received in background
+PowerManager        gPowerManager;  // CPU sleep and power state statistics
+BootSequencer       gBootSequencer; // Boot phases still running in background
+LatencyTracer       gLatencyTracer; // Latency of the data sent on NMEA and Micronet, from the reception of their input
 
 /***************************************************************************/
 /*                              Functions                                  */
@@ -31,8 +31,10 @@
 /*                              Includes                                   */
 /***************************************************************************/
 
+#include "BootSequencer.h"
 #include "Configuration.h"
 #include "DataBridge.h"
+#include "LatencyTracer.h"
 #include "M8NDriver.h"
 #include "MenuManager.h"
 #include "MicronetCodec.h"
@@ -40,6 +42,8 @@
 #include "MicronetSlaveDevice.h"
 #include "NavCompass.h"
 #include "NavigationData.h"
+#include "NetworkCensus.h"
+#include "PowerManager.h"
 #include "RfDriver.h"
 
 /***************************************************************************/
@@ -60,6 +64,10 @@ extern MicronetMessageFifo gRxMessageFifo;
 extern Configuration       gConfiguration;
 extern NavCompass          gNavCompass;
 extern M8NDriver           gM8nDriver;
+extern NetworkCensus       gNetworkCensus;
+extern PowerManager        gPowerManager;
+extern BootSequencer       gBootSequencer;
+extern LatencyTracer       gLatencyTracer;
 
 /***************************************************************************/
 /*                              Prototypes                                 */
@@ -82,6 +82,17 @@
 #define TEMP_OUT_H_M    0x31
 #define TEMP_OUT_L_M    0x32
 
+// MSB of register address enables address auto-increment on accelerometer
+#define AUTO_INCREMENT_A 0x80
+
+// FIFO_SRC_REG_A fields
+#define FIFO_SRC_OVRN  0x40
+#define FIFO_SRC_EMPTY 0x20
+#define FIFO_SRC_FSS   0x1f
+
+// Maximum number of samples read in a single I2C transaction, limited by Wire's buffer size (32 bytes)
+#define FIFO_BURST_SAMPLES 5
+
 /***************************************************************************/
 /*                             Local types                                 */
 /***************************************************************************/
@@ -116,6 +127,8 @@ bool LSM303DLHCDriver::Init()
     uint8_t whoami = 0;
 
     NAVCOMPASS_I2C.begin();
+    // Use I2C fast mode to keep each compass transaction short
+    NAVCOMPASS_I2C.setClock(400000);
 
     if (!I2CRead(LSM303DLHC_ACC_ADDR, STATUS_REG_A, &sr))
     {
@@ -142,10 +155,12 @@ bool LSM303DLHCDriver::Init()
     }
 
     // DLHC Acceleration register
-    I2CWrite(accAddr, 0x47, CTRL_REG1_A); // 0x47=0b01000111 Normal Mode, ODR 50Hz, all axes on
-    I2CWrite(accAddr, 0x08, CTRL_REG4_A); // 0x08=0b00001000 Range: +/-2 Gal, Sens.: 1mGal/LSB, highRes on
+    I2CWrite(accAddr, 0x47, CTRL_REG1_A);     // 0x47=0b01000111 Normal Mode, ODR 50Hz, all axes on
+    I2CWrite(accAddr, 0x08, CTRL_REG4_A);     // 0x08=0b00001000 Range: +/-2 Gal, Sens.: 1mGal/LSB, highRes on
+    I2CWrite(accAddr, 0x40, CTRL_REG5_A);     // 0x40=0b01000000 FIFO enabled
+    I2CWrite(accAddr, 0x80, FIFO_CTRL_REG_A); // 0x80=0b10000000 FIFO in stream mode
     // DLHC Magnetic register
-    I2CWrite(magAddr, 0x10, CRA_REG_M); // 0x10=0b00010000 ODR 15Hz
+    I2CWrite(magAddr, 0x1c, CRA_REG_M); // 0x1c=0b00011100 ODR 220Hz (highest continuous rate)
     I2CWrite(magAddr, 0x20, CRB_REG_M); // 0x20=0b00100000 Range: +/-1.3 Gauss gain: 1100LSB/Gauss
     LSB_per_Gauss_XY = 1100.0f;
     LSB_per_Gauss_Z  = 980.0f;
@@ -175,30 +190,85 @@ void LSM303DLHCDriver::GetMagneticField(vec *mag)
     mag->z = ((float)mz) / LSB_per_Gauss_Z;
 }
 
+// Returns the average of all acceleration measurements stored in FIFO since last call
 void LSM303DLHCDriver::GetAcceleration(vec *acc)
 {
+    vec batch[NAVCOMPASS_MAX_BATCH_SIZE];
+    int nbSamples;
+
+    acc->x = 0;
+    acc->y = 0;
+    acc->z = 0;
+
+    nbSamples = GetAccelerationBatch(batch, NAVCOMPASS_MAX_BATCH_SIZE);
+    for (int i = 0; i < nbSamples; i++)
+    {
+        acc->x += batch[i].x;
+        acc->y += batch[i].y;
+        acc->z += batch[i].z;
+    }
+    if (nbSamples > 1)
+    {
+        acc->x /= nbSamples;
+        acc->y /= nbSamples;
+        acc->z /= nbSamples;
+    }
+}
+
+// Returns all acceleration measurements stored in FIFO since last call, oldest first
+// FIFO is emptied with burst reads : address rolls back from OUT_Z_H_A to OUT_X_L_A in FIFO mode so that several samples
+// can be read in a single I2C transaction
+int LSM303DLHCDriver::GetAccelerationBatch(vec *acc, int maxSamples)
+{
+    uint8_t fifoSrc = 0;
+    uint8_t accBuffer[6 * FIFO_BURST_SAMPLES];
     int16_t ax, ay, az;
-    uint8_t regValue = 0;
-
-    I2CRead(accAddr, OUT_X_H_A, &regValue);
-    ax = regValue;
-    I2CRead(accAddr, OUT_X_L_A, &regValue);
-    ax = (ax << 8) | regValue;
-
-    I2CRead(accAddr, OUT_Y_H_A, &regValue);
-    ay = regValue;
-    I2CRead(accAddr, OUT_Y_L_A, &regValue);
-    ay = (ay << 8) | regValue;
-
-    I2CRead(accAddr, OUT_Z_H_A, &regValue);
-    az = regValue;
-    I2CRead(accAddr, OUT_Z_L_A, &regValue);
-    az = (az << 8) | regValue;
-
-    acc->x = ((float)(ax >> 4)) *
-             mGal_per_LSB; // DLHC registers contain a left-aligned 12-bit number, so values should be shifted right by 4 bits (divided by 16)
-    acc->y = ((float)(ay >> 4)) * mGal_per_LSB;
-    acc->z = ((float)(az >> 4)) * mGal_per_LSB;
+    int     nbSamples, nbRead;
+
+    if (!I2CRead(accAddr, FIFO_SRC_REG_A, &fifoSrc))
+    {
+        return 0;
+    }
+
+    if (fifoSrc & FIFO_SRC_EMPTY)
+    {
+        return 0;
+    }
+    nbSamples = (fifoSrc & FIFO_SRC_OVRN) ? NAVCOMPASS_MAX_BATCH_SIZE : (fifoSrc & FIFO_SRC_FSS);
+    if (nbSamples > maxSamples)
+    {
+        nbSamples = maxSamples;
+    }
+
+    nbRead = 0;
+    while (nbRead < nbSamples)
+    {
+        int burstSamples = nbSamples - nbRead;
+        if (burstSamples > FIFO_BURST_SAMPLES)
+        {
+            burstSamples = FIFO_BURST_SAMPLES;
+        }
+
+        if (!I2CBurstRead(accAddr, OUT_X_L_A | AUTO_INCREMENT_A, accBuffer, 6 * burstSamples))
+        {
+            break;
+        }
+
+        for (int i = 0; i < burstSamples; i++)
+        {
+            ax = ((int16_t)(accBuffer[6 * i + 1] << 8)) | accBuffer[6 * i];
+            ay = ((int16_t)(accBuffer[6 * i + 3] << 8)) | accBuffer[6 * i + 2];
+            az = ((int16_t)(accBuffer[6 * i + 5] << 8)) | accBuffer[6 * i + 4];
+
+            // DLHC registers contain a left-aligned 12-bit number, so values should be shifted right by 4 bits (divided by 16)
+            acc[nbRead].x = ((float)(ax >> 4)) * mGal_per_LSB;
+            acc[nbRead].y = ((float)(ay >> 4)) * mGal_per_LSB;
+            acc[nbRead].z = ((float)(az >> 4)) * mGal_per_LSB;
+            nbRead++;
+        }
+    }
+
+    return nbRead;
 }
 
 bool LSM303DLHCDriver::I2CRead(uint8_t i2cAddress, uint8_t address, uint8_t *data)
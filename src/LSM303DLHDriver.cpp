@@ -69,6 +69,9 @@
 #define INT2_THS_A        0x36
 #define INT2_DURATION_A   0x37
 
+// MSB of register address enables address auto-increment on accelerometer
+#define AUTO_INCREMENT_A 0x80
+
 // LSM303DLH magnetic register map
 #define CRA_REG_M  0x00
 #define CRB_REG_M  0x01
@@ -119,6 +122,8 @@ bool LSM303DLHDriver::Init()
     uint8_t ira = 0, irb = 0, irc = 0, sr, whoami = 0;
 
     NAVCOMPASS_I2C.begin();
+    // Use I2C fast mode to keep each compass transaction short
+    NAVCOMPASS_I2C.setClock(400000);
 
     // First we search for linear acceleration address which depends on SA0 pin level on LSM303DLH
     if (!I2CRead(LSM303DLH_ACC_ADDR_1, STATUS_REG_A, &sr))
@@ -163,7 +168,7 @@ bool LSM303DLHDriver::Init()
     // Okay : if we are here, we have a LSM303DLH
 
     // Initialize registers and conversion coefficients
-    I2CWrite(magAddr, 0x18, CRA_REG_M);   // 0x18=0b00011000 ODR 75Hz
+    I2CWrite(magAddr, 0x18, CRA_REG_M);   // 0x18=0b00011000 ODR 75Hz (highest continuous rate)
     I2CWrite(accAddr, 0x27, CTRL_REG1_A); // 0x27=0b00100111 Normal Mode, ODR 50hz, all axes on
     I2CWrite(accAddr, 0x00, CTRL_REG4_A); // 0x00=0b00000000 Range: +/-2 Gal, Sens.: 1mGal/LSB
     GPerLsb = 1.0 / 16384.0;
@@ -206,25 +211,16 @@ void LSM303DLHDriver::GetMagneticField(vec *mag)
 // Unit is G
 void LSM303DLHDriver::GetAcceleration(vec *acc)
 {
+    uint8_t accBuffer[6];
     int16_t ax, ay, az;
-    uint8_t regValue = 0;
-
-    // Read of all acceleration measurements
-    // X axis
-    I2CRead(accAddr, OUT_X_H_A, &regValue);
-    ax = regValue;
-    I2CRead(accAddr, OUT_X_L_A, &regValue);
-    ax = (ax << 8) | regValue;
-    // Y axis
-    I2CRead(accAddr, OUT_Y_H_A, &regValue);
-    ay = regValue;
-    I2CRead(accAddr, OUT_Y_L_A, &regValue);
-    ay = (ay << 8) | regValue;
-    // Z axis
-    I2CRead(accAddr, OUT_Z_H_A, &regValue);
-    az = regValue;
-    I2CRead(accAddr, OUT_Z_L_A, &regValue);
-    az = (az << 8) | regValue;
+
+    // Single read of all acceleration measurements : MSB of register address enables address auto-increment
+    I2CBurstRead(accAddr, OUT_X_L_A | AUTO_INCREMENT_A, accBuffer, 6);
+
+    // Rebuilt integers values
+    ax = ((int16_t)(accBuffer[1] << 8)) | accBuffer[0];
+    ay = ((int16_t)(accBuffer[3] << 8)) | accBuffer[2];
+    az = ((int16_t)(accBuffer[5] << 8)) | accBuffer[4];
 
     // Convert to G
     acc->x = -ax * GPerLsb;
@@ -232,6 +228,19 @@ void LSM303DLHDriver::GetAcceleration(vec *acc)
     acc->z = az * GPerLsb;
 }
 
+// Returns all linear acceleration measurements available since last call
+// LSM303DLH has no FIFO : only the latest measurement is returned
+int LSM303DLHDriver::GetAccelerationBatch(vec *acc, int maxSamples)
+{
+    if (maxSamples < 1)
+    {
+        return 0;
+    }
+
+    GetAcceleration(acc);
+    return 1;
+}
+
 // TODO : Create a static class to drive I2C so that this code will not be duplicated for each compass driver
 bool LSM303DLHDriver::I2CRead(uint8_t i2cAddress, uint8_t address, uint8_t *data)
 {
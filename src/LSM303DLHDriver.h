@@ -57,6 +57,7 @@ class LSM303DLHDriver : public NavCompassDriver
     virtual string GetDeviceName() override;
     virtual void   GetMagneticField(vec *mag) override;
     virtual void   GetAcceleration(vec *acc) override;
+    virtual int    GetAccelerationBatch(vec *acc, int maxSamples) override;
 
   private:
     uint8_t accAddr, magAddr;
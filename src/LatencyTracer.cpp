@@ -0,0 +1,189 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Latency histograms of the data sent on NMEA and Micronet      *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "LatencyTracer.h"
+
+#include <string.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                                Macros                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+// Must follow LatencyOutput_t order
+const char *LatencyTracer::outputName[LATENCY_NB_OUTPUTS] = {
+    "NMEA MWV (R)",      // LATENCY_NMEA_MWV_R
+    "NMEA MWV (T)",      // LATENCY_NMEA_MWV_T
+    "NMEA MWD",          // LATENCY_NMEA_MWD
+    "NMEA VWT",          // LATENCY_NMEA_VWT
+    "NMEA DPT",          // LATENCY_NMEA_DPT
+    "NMEA MTW",          // LATENCY_NMEA_MTW
+    "NMEA VLW",          // LATENCY_NMEA_VLW
+    "NMEA VHW",          // LATENCY_NMEA_VHW
+    "NMEA HDG",          // LATENCY_NMEA_HDG
+    "NMEA XDR (VCC)",    // LATENCY_NMEA_XDR
+    "NMEA ROT",          // LATENCY_NMEA_ROT
+    "NMEA XDR (ATT)",    // LATENCY_NMEA_XDR_ATTITUDE
+    "NMEA RMC",          // LATENCY_NMEA_RMC
+    "NMEA GGA",          // LATENCY_NMEA_GGA
+    "NMEA VTG",          // LATENCY_NMEA_VTG
+    "NMEA forwarded",    // LATENCY_NMEA_FORWARDED
+    "Micronet SOG/COG",  // LATENCY_MNET_SOGCOG
+    "Micronet position", // LATENCY_MNET_POSITION
+    "Micronet XTE",      // LATENCY_MNET_XTE
+    "Micronet DTW",      // LATENCY_MNET_DTW
+    "Micronet BTW",      // LATENCY_MNET_BTW
+    "Micronet VMG-WP",   // LATENCY_MNET_VMGWP
+    "Micronet HDG",      // LATENCY_MNET_HDG
+    "Micronet AWS",      // LATENCY_MNET_AWS
+    "Micronet AWA",      // LATENCY_MNET_AWA
+    "Micronet DPT",      // LATENCY_MNET_DPT
+    "Micronet SPD",      // LATENCY_MNET_SPD
+};
+
+LatencyTracer::LatencyTracer()
+{
+    Reset();
+}
+
+LatencyTracer::~LatencyTracer()
+{
+}
+
+void LatencyTracer::Reset()
+{
+    memset(histogram, 0, sizeof(histogram));
+    memset(nbSamples, 0, sizeof(nbSamples));
+    memset(max_us, 0, sizeof(max_us));
+}
+
+// Account the latency of an output
+// Micronet outputs are recorded from RfDriver ISR and NMEA outputs from main loop : each histogram has a single writer.
+void LatencyTracer::Record(LatencyOutput_t output, uint32_t latency_us)
+{
+    if (latency_us > LATENCY_MAX_US)
+    {
+        latency_us = LATENCY_MAX_US;
+    }
+
+    histogram[output][BucketIndex(latency_us)]++;
+    nbSamples[output]++;
+    if (latency_us > max_us[output])
+    {
+        max_us[output] = latency_us;
+    }
+}
+
+const char *LatencyTracer::GetName(LatencyOutput_t output)
+{
+    return outputName[output];
+}
+
+uint32_t LatencyTracer::GetNbSamples(LatencyOutput_t output)
+{
+    return nbSamples[output];
+}
+
+// Returns the upper bound of the bucket containing the given percentile, capped to the maximum latency seen
+uint32_t LatencyTracer::GetPercentile_us(LatencyOutput_t output, uint32_t percent)
+{
+    uint32_t rank  = (nbSamples[output] * percent + 99) / 100;
+    uint32_t count = 0;
+
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    for (int i = 0; i < LATENCY_NB_BUCKETS; i++)
+    {
+        count += histogram[output][i];
+        if (count >= rank)
+        {
+            uint32_t upperBound_us = GetBucketStart_us(i + 1) - 1;
+            return (upperBound_us < max_us[output]) ? upperBound_us : max_us[output];
+        }
+    }
+
+    return max_us[output];
+}
+
+uint32_t LatencyTracer::GetMax_us(LatencyOutput_t output)
+{
+    return max_us[output];
+}
+
+uint32_t LatencyTracer::GetBucketCount(LatencyOutput_t output, int bucket)
+{
+    return histogram[output][bucket];
+}
+
+// Returns the lowest latency accounted in a bucket
+uint32_t LatencyTracer::GetBucketStart_us(int bucket)
+{
+    if (bucket < 4)
+    {
+        return bucket * 4;
+    }
+
+    int octave = (bucket / 4) + 3;
+    return (4 + (bucket % 4)) << (octave - 2);
+}
+
+// Buckets are 4us wide below 16us, then each octave is split in 4 buckets using the two bits following the MSB
+int LatencyTracer::BucketIndex(uint32_t latency_us)
+{
+    if (latency_us < 16)
+    {
+        return latency_us >> 2;
+    }
+
+    int octave = 31 - __builtin_clz(latency_us);
+    return ((octave - 3) * 4) + ((latency_us >> (octave - 2)) & 3);
+}
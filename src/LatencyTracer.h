@@ -0,0 +1,110 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Latency histograms of the data sent on NMEA and Micronet      *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef LATENCYTRACER_H_
+#define LATENCYTRACER_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Histograms have 4 buckets per octave above 16us (+/-12% resolution), latencies are saturated to 8.4s
+#define LATENCY_NB_BUCKETS 80
+#define LATENCY_MAX_US     ((1UL << 23) - 1)
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+// Outputs whose latency is traced, from the reception of their input (RF frame, NMEA sentence or compass sample)
+typedef enum
+{
+    LATENCY_NMEA_MWV_R = 0,
+    LATENCY_NMEA_MWV_T,
+    LATENCY_NMEA_MWD,
+    LATENCY_NMEA_VWT,
+    LATENCY_NMEA_DPT,
+    LATENCY_NMEA_MTW,
+    LATENCY_NMEA_VLW,
+    LATENCY_NMEA_VHW,
+    LATENCY_NMEA_HDG,
+    LATENCY_NMEA_XDR,
+    LATENCY_NMEA_ROT,
+    LATENCY_NMEA_XDR_ATTITUDE,
+    LATENCY_NMEA_RMC,
+    LATENCY_NMEA_GGA,
+    LATENCY_NMEA_VTG,
+    LATENCY_NMEA_FORWARDED, // NMEA sentences forwarded as received
+    LATENCY_MNET_SOGCOG,
+    LATENCY_MNET_POSITION,
+    LATENCY_MNET_XTE,
+    LATENCY_MNET_DTW,
+    LATENCY_MNET_BTW,
+    LATENCY_MNET_VMGWP,
+    LATENCY_MNET_HDG,
+    LATENCY_MNET_AWS,
+    LATENCY_MNET_AWA,
+    LATENCY_MNET_DPT,
+    LATENCY_MNET_SPD,
+    LATENCY_NB_OUTPUTS
+} LatencyOutput_t;
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class LatencyTracer
+{
+  public:
+    LatencyTracer();
+    virtual ~LatencyTracer();
+
+    void            Reset();
+    void            Record(LatencyOutput_t output, uint32_t latency_us);
+    const char     *GetName(LatencyOutput_t output);
+    uint32_t        GetNbSamples(LatencyOutput_t output);
+    uint32_t        GetPercentile_us(LatencyOutput_t output, uint32_t percent);
+    uint32_t        GetMax_us(LatencyOutput_t output);
+    uint32_t        GetBucketCount(LatencyOutput_t output, int bucket);
+    static uint32_t GetBucketStart_us(int bucket);
+
+  private:
+    static const char *outputName[LATENCY_NB_OUTPUTS];
+
+    uint32_t histogram[LATENCY_NB_OUTPUTS][LATENCY_NB_BUCKETS];
+    uint32_t nbSamples[LATENCY_NB_OUTPUTS];
+    uint32_t max_us[LATENCY_NB_OUTPUTS];
+
+    static int BucketIndex(uint32_t latency_us);
+};
+
+#endif /* LATENCYTRACER_H_ */
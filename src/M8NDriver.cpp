@@ -9,6 +9,9 @@
 
 #include "M8NDriver.h"
 #include "BoardConfig.h"
+#include "UbxParser.h"
+
+#include <string.h>
 
 const PROGMEM uint8_t M8NDriver::ClearConfig[] = {0xB5, 0x62, 0x06, 0x09, 0x0D, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x00,
                                                   0x00, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x01, 0x19, 0x98};
@@ -45,9 +48,15 @@ const PROGMEM char ZDA_off[] = "$PUBX,40,ZDA,0,0,0,0,0,0*44";
 
 #define GNSS_SERIAL_BUFFER_SIZE 512
 
+// Delay which followed each UBX configuration message when GPS_SendConfig was blocking, kept in the step spacing below
+#define M8N_CONFIG_SETTLE_MS 100
+
+// Delay between two PUBX messages, long enough for one message to leave UART TX buffer at 38400 baud
+#define M8N_PUBX_INTERVAL_MS 10
+
 DMAMEM uint8_t gnss_serial_rx_buffer[GNSS_SERIAL_BUFFER_SIZE];
 
-M8NDriver::M8NDriver()
+M8NDriver::M8NDriver() : configStep(M8N_STEP_IDLE), nextStepTime(0), nmeaSentences(0), nbPubxMessages(0), pubxIndex(0)
 {
 }
 
@@ -72,7 +81,6 @@ void M8NDriver::GPS_SendConfig(const uint8_t *progmemPtr, uint8_t arraySize)
         byteread = pgm_read_byte_near(progmemPtr++);
         GNSS_SERIAL.write(byteread);
     }
-    delay(100);
 }
 
 void M8NDriver::GPS_SendPUBX(const char pubxMsg[])
@@ -80,42 +88,151 @@ void M8NDriver::GPS_SendPUBX(const char pubxMsg[])
     GNSS_SERIAL.println(pubxMsg);
 }
 
+// Start configuration of the M8N
+// Configuration is made in background by Process(), without blocking the caller during the delays required by the M8N
 void M8NDriver::Start(uint32_t nmeaSentences)
 {
-    GPS_SendConfig(ClearConfig, 21);
-    delay(500);
-    GPS_SendConfig(UART1_38400, 28);
-    GNSS_SERIAL.begin(38400);
-    delay(100);
-    GNSS_SERIAL.println("");
-    GPS_SendConfig(GNSSSetup, 68);
-    delay(200);
-    GNSS_SERIAL.println("");
-    GPS_SendPUBX(DTM_off);
-    GPS_SendPUBX(GBS_off);
-    if (nmeaSentences & M8N_GGA_ENABLE)
-        GPS_SendPUBX(GGA_on);
-    else
-        GPS_SendPUBX(GGA_off);
-
-    GPS_SendPUBX(GLL_off);
-    GPS_SendPUBX(GNS_off);
-    GPS_SendPUBX(GRS_off);
-    GPS_SendPUBX(GSA_off);
-    GPS_SendPUBX(GST_off);
-    GPS_SendPUBX(GSV_off);
-    if (nmeaSentences & M8N_RMC_ENABLE)
-        GPS_SendPUBX(RMC_on);
-    else
-        GPS_SendPUBX(RMC_off);
-
-    GPS_SendPUBX(VLW_off);
-    if (nmeaSentences & M8N_VTG_ENABLE)
-        GPS_SendPUBX(VTG_on);
-    else
-        GPS_SendPUBX(VTG_off);
-    // GPS_SendPUBX(THS_off);
-    GPS_SendPUBX(ZDA_off);
-    if (nmeaSentences & M8N_HISPEED_NAV)
-        GPS_SendConfig(Navrate5hz, 14);
+    nbPubxMessages = 0;
+    pubxIndex      = 0;
+
+    // In UBX mode, all NMEA sentences are disabled
+    if (nmeaSentences & M8N_UBX_NAV_PVT)
+    {
+        nmeaSentences &= ~(M8N_GGA_ENABLE | M8N_VTG_ENABLE | M8N_RMC_ENABLE);
+    }
+
+    pubxMessages[nbPubxMessages++] = DTM_off;
+    pubxMessages[nbPubxMessages++] = GBS_off;
+    pubxMessages[nbPubxMessages++] = (nmeaSentences & M8N_GGA_ENABLE) ? GGA_on : GGA_off;
+    pubxMessages[nbPubxMessages++] = GLL_off;
+    pubxMessages[nbPubxMessages++] = GNS_off;
+    pubxMessages[nbPubxMessages++] = GRS_off;
+    pubxMessages[nbPubxMessages++] = GSA_off;
+    pubxMessages[nbPubxMessages++] = GST_off;
+    pubxMessages[nbPubxMessages++] = GSV_off;
+    pubxMessages[nbPubxMessages++] = (nmeaSentences & M8N_RMC_ENABLE) ? RMC_on : RMC_off;
+    pubxMessages[nbPubxMessages++] = VLW_off;
+    pubxMessages[nbPubxMessages++] = (nmeaSentences & M8N_VTG_ENABLE) ? VTG_on : VTG_off;
+    // pubxMessages[nbPubxMessages++] = THS_off;
+    pubxMessages[nbPubxMessages++] = ZDA_off;
+
+    this->nmeaSentences = nmeaSentences;
+
+    NextStep(M8N_STEP_CLEAR_CONFIG, 0);
+}
+
+// Run the next configuration step if its delay has elapsed. Each step writes at most one message.
+// Returns true once configuration is complete
+bool M8NDriver::Process()
+{
+    if ((configStep == M8N_STEP_IDLE) || (configStep == M8N_STEP_DONE))
+    {
+        return (configStep == M8N_STEP_DONE);
+    }
+
+    if ((int32_t)(millis() - nextStepTime) < 0)
+    {
+        return false;
+    }
+
+    switch (configStep)
+    {
+    case M8N_STEP_CLEAR_CONFIG:
+        GPS_SendConfig(ClearConfig, 21);
+        NextStep(M8N_STEP_SET_BAUDRATE, M8N_CONFIG_SETTLE_MS + 500);
+        break;
+    case M8N_STEP_SET_BAUDRATE:
+        GPS_SendConfig(UART1_38400, 28);
+        NextStep(M8N_STEP_SWITCH_BAUDRATE, M8N_CONFIG_SETTLE_MS);
+        break;
+    case M8N_STEP_SWITCH_BAUDRATE:
+        GNSS_SERIAL.begin(38400);
+        NextStep(M8N_STEP_SETUP_GNSS, 100);
+        break;
+    case M8N_STEP_SETUP_GNSS:
+        GNSS_SERIAL.println("");
+        GPS_SendConfig(GNSSSetup, 68);
+        NextStep(M8N_STEP_SETUP_NMEA, M8N_CONFIG_SETTLE_MS + 200);
+        break;
+    case M8N_STEP_SETUP_NMEA:
+        if (pubxIndex == 0)
+        {
+            GNSS_SERIAL.println("");
+        }
+        GPS_SendPUBX(pubxMessages[pubxIndex++]);
+        if (pubxIndex < nbPubxMessages)
+        {
+            NextStep(M8N_STEP_SETUP_NMEA, M8N_PUBX_INTERVAL_MS);
+        }
+        else
+        {
+            NextStep(M8N_STEP_SET_NAV_RATE, M8N_PUBX_INTERVAL_MS);
+        }
+        break;
+    case M8N_STEP_SET_NAV_RATE:
+        if (nmeaSentences & M8N_NAVRATE_10HZ)
+        {
+            // CFG-RATE : 100ms measurement period, one navigation solution per measurement, aligned on GPS time
+            const uint8_t cfgRate[] = {100, 0, 1, 0, 1, 0};
+            SendUbx(UBX_CLASS_CFG, UBX_ID_CFG_RATE, cfgRate, sizeof(cfgRate));
+        }
+        else if (nmeaSentences & M8N_HISPEED_NAV)
+        {
+            GPS_SendConfig(Navrate5hz, 14);
+        }
+        NextStep((nmeaSentences & M8N_UBX_NAV_PVT) ? M8N_STEP_ENABLE_UBX_OUTPUT : M8N_STEP_DONE, M8N_PUBX_INTERVAL_MS);
+        break;
+    case M8N_STEP_ENABLE_UBX_OUTPUT:
+    {
+        // CFG-PRT : UART1 settings of UART1_38400 (8N1, 38400 baud, UBX+NMEA+RTCM input) with UBX output instead of NMEA
+        const uint8_t cfgPrt[] = {0x01, 0x00, 0x00, 0x00, 0xD0, 0x08, 0x00, 0x00, 0x00, 0x96,
+                                  0x00, 0x00, 0x07, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00};
+        SendUbx(UBX_CLASS_CFG, UBX_ID_CFG_PRT, cfgPrt, sizeof(cfgPrt));
+        NextStep(M8N_STEP_ENABLE_NAV_PVT, M8N_CONFIG_SETTLE_MS);
+    }
+    break;
+    case M8N_STEP_ENABLE_NAV_PVT:
+    {
+        // CFG-MSG : output NAV-PVT on each navigation solution of the current port
+        const uint8_t cfgMsg[] = {UBX_CLASS_NAV, UBX_ID_NAV_PVT, 1};
+        SendUbx(UBX_CLASS_CFG, UBX_ID_CFG_MSG, cfgMsg, sizeof(cfgMsg));
+        NextStep(M8N_STEP_DONE, 0);
+    }
+    break;
+    default:
+        break;
+    }
+
+    return (configStep == M8N_STEP_DONE);
+}
+
+void M8NDriver::NextStep(M8NConfigStep_t step, uint32_t delay_ms)
+{
+    configStep   = step;
+    nextStepTime = millis() + delay_ms;
+}
+
+// Send a UBX message built from its class, ID and payload
+void M8NDriver::SendUbx(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length)
+{
+    uint8_t frame[4 + UBX_MAX_PAYLOAD_LENGTH];
+    uint8_t ckA, ckB;
+
+    if (length > UBX_MAX_PAYLOAD_LENGTH)
+    {
+        return;
+    }
+
+    frame[0] = msgClass;
+    frame[1] = msgId;
+    frame[2] = length & 0xff;
+    frame[3] = length >> 8;
+    memcpy(frame + 4, payload, length);
+    UbxParser::Checksum(frame, length + 4, &ckA, &ckB);
+
+    GNSS_SERIAL.write(UBX_SYNC_CHAR_1);
+    GNSS_SERIAL.write(UBX_SYNC_CHAR_2);
+    GNSS_SERIAL.write(frame, length + 4);
+    GNSS_SERIAL.write(ckA);
+    GNSS_SERIAL.write(ckB);
 }
@@ -12,10 +12,29 @@
 
 #include <Arduino.h>
 
-#define M8N_GGA_ENABLE  0x00000001
-#define M8N_VTG_ENABLE  0x00000002
-#define M8N_RMC_ENABLE  0x00000004
-#define M8N_HISPEED_NAV 0x00000008
+#define M8N_GGA_ENABLE   0x00000001
+#define M8N_VTG_ENABLE   0x00000002
+#define M8N_RMC_ENABLE   0x00000004
+#define M8N_HISPEED_NAV  0x00000008
+#define M8N_UBX_NAV_PVT  0x00000010 // Output UBX NAV-PVT binary messages instead of NMEA sentences
+#define M8N_NAVRATE_10HZ 0x00000020
+
+// Maximum number of PUBX messages sent to configure NMEA output
+#define M8N_MAX_PUBX_MESSAGES 16
+
+typedef enum
+{
+    M8N_STEP_IDLE = 0,
+    M8N_STEP_CLEAR_CONFIG,
+    M8N_STEP_SET_BAUDRATE,
+    M8N_STEP_SWITCH_BAUDRATE,
+    M8N_STEP_SETUP_GNSS,
+    M8N_STEP_SETUP_NMEA,
+    M8N_STEP_SET_NAV_RATE,
+    M8N_STEP_ENABLE_UBX_OUTPUT,
+    M8N_STEP_ENABLE_NAV_PVT,
+    M8N_STEP_DONE
+} M8NConfigStep_t;
 
 class M8NDriver
 {
@@ -29,8 +48,18 @@ class M8NDriver
     static const PROGMEM uint8_t GNSSSetup[];
 
     void Start(uint32_t nmeaSentences);
+    bool Process();
 
   private:
+    M8NConfigStep_t configStep;
+    uint32_t        nextStepTime;
+    uint32_t        nmeaSentences;
+    const char     *pubxMessages[M8N_MAX_PUBX_MESSAGES];
+    int             nbPubxMessages;
+    int             pubxIndex;
+
+    void NextStep(M8NConfigStep_t step, uint32_t delay_ms);
+    void SendUbx(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length);
     void GPS_SendConfig(const uint8_t *progmemPtr, uint8_t arraySize);
     void GPS_SendPUBX(const char pubxMsg[]);
 };
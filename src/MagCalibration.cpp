@@ -0,0 +1,394 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Streaming hard/soft iron magnetometer calibration             *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "MagCalibration.h"
+
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Minimum number of samples before trying to fit an ellipsoid
+#define MAGCAL_MIN_SAMPLES 50
+// Pivot under which the normal equations are considered singular (not enough coverage)
+#define MAGCAL_MIN_PIVOT 1e-9
+// Number of Jacobi rotation sweeps for eigen decomposition
+#define JACOBI_NB_SWEEPS 10
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+MagCalibration::MagCalibration()
+{
+    Reset();
+}
+
+MagCalibration::~MagCalibration()
+{
+}
+
+void MagCalibration::Reset()
+{
+    memset(dtd, 0, sizeof(dtd));
+    memset(dt1, 0, sizeof(dt1));
+    memset(matrix, 0, sizeof(matrix));
+    memset(offset, 0, sizeof(offset));
+    nbSamples    = 0;
+    coverageMask = 0;
+    fitError_per = 100.0f;
+    for (int i = 0; i < 3; i++)
+    {
+        minField[i]  = 1000.0f;
+        maxField[i]  = -1000.0f;
+        matrix[i][i] = 1.0f;
+    }
+}
+
+// Accumulate a new magnetic field sample. Memory usage is constant whatever is the number of samples : only the
+// normal equations of the least-squares ellipsoid fit are updated.
+void MagCalibration::AddSample(float mx, float my, float mz)
+{
+    double d[MAGCAL_NB_PARAMETERS];
+    float  field[3] = {mx, my, mz};
+
+    // Ellipsoid model : a.x2 + b.y2 + c.z2 + 2d.xy + 2e.xz + 2f.yz + 2g.x + 2h.y + 2i.z = 1
+    d[0] = (double)mx * mx;
+    d[1] = (double)my * my;
+    d[2] = (double)mz * mz;
+    d[3] = 2.0 * mx * my;
+    d[4] = 2.0 * mx * mz;
+    d[5] = 2.0 * my * mz;
+    d[6] = 2.0 * mx;
+    d[7] = 2.0 * my;
+    d[8] = 2.0 * mz;
+
+    // Only upper triangle is accumulated, the matrix being symmetric
+    for (int i = 0; i < MAGCAL_NB_PARAMETERS; i++)
+    {
+        for (int j = i; j < MAGCAL_NB_PARAMETERS; j++)
+        {
+            dtd[i][j] += d[i] * d[j];
+        }
+        dt1[i] += d[i];
+    }
+    nbSamples++;
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (field[i] < minField[i])
+            minField[i] = field[i];
+        if (field[i] > maxField[i])
+            maxField[i] = field[i];
+    }
+
+    // Record sample direction relative to the min/max center to measure how much of the sphere has been covered
+    float x         = mx - (minField[0] + maxField[0]) / 2;
+    float y         = my - (minField[1] + maxField[1]) / 2;
+    float z         = mz - (minField[2] + maxField[2]) / 2;
+    float norm      = sqrtf(x * x + y * y + z * z);
+    int   azimuth   = (int)((atan2f(y, x) + PI) * 8 / (2 * PI)) & 7;
+    int   elevation = (norm > 0.0f) ? (int)((z / norm + 1.0f) * 2.0f) : 0;
+    if (elevation > 3)
+        elevation = 3;
+    coverageMask |= 1UL << (elevation * 8 + azimuth);
+}
+
+// Fit an ellipsoid on the accumulated samples and compute the corresponding hard iron offset and soft iron correction
+// matrix. The correction matrix is symmetric so that it does not rotate the magnetic field relative to the accelerometer
+// frame, and it is scaled to keep the average field strength.
+// @return true if the fit is valid
+bool MagCalibration::Solve()
+{
+    double m[MAGCAL_NB_PARAMETERS][MAGCAL_NB_PARAMETERS + 1];
+    double p[MAGCAL_NB_PARAMETERS];
+
+    if (nbSamples < MAGCAL_MIN_SAMPLES)
+    {
+        return false;
+    }
+
+    // Build augmented normal equations
+    for (int i = 0; i < MAGCAL_NB_PARAMETERS; i++)
+    {
+        for (int j = 0; j < MAGCAL_NB_PARAMETERS; j++)
+        {
+            m[i][j] = (j >= i) ? dtd[i][j] : dtd[j][i];
+        }
+        m[i][MAGCAL_NB_PARAMETERS] = dt1[i];
+    }
+
+    // Gauss elimination with partial pivoting
+    for (int col = 0; col < MAGCAL_NB_PARAMETERS; col++)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < MAGCAL_NB_PARAMETERS; row++)
+        {
+            if (fabs(m[row][col]) > fabs(m[pivot][col]))
+                pivot = row;
+        }
+        if (fabs(m[pivot][col]) < MAGCAL_MIN_PIVOT * nbSamples)
+        {
+            return false;
+        }
+        if (pivot != col)
+        {
+            for (int j = col; j <= MAGCAL_NB_PARAMETERS; j++)
+            {
+                double tmp  = m[col][j];
+                m[col][j]   = m[pivot][j];
+                m[pivot][j] = tmp;
+            }
+        }
+        for (int row = col + 1; row < MAGCAL_NB_PARAMETERS; row++)
+        {
+            double factor = m[row][col] / m[col][col];
+            for (int j = col; j <= MAGCAL_NB_PARAMETERS; j++)
+            {
+                m[row][j] -= factor * m[col][j];
+            }
+        }
+    }
+    for (int i = MAGCAL_NB_PARAMETERS - 1; i >= 0; i--)
+    {
+        double sum = m[i][MAGCAL_NB_PARAMETERS];
+        for (int j = i + 1; j < MAGCAL_NB_PARAMETERS; j++)
+        {
+            sum -= m[i][j] * p[j];
+        }
+        p[i] = sum / m[i][i];
+    }
+
+    // Quadric matrix A and linear term g of the model x'.A.x + 2.g'.x = 1
+    double a[3][3] = {{p[0], p[3], p[4]}, {p[3], p[1], p[5]}, {p[4], p[5], p[2]}};
+    double g[3]    = {p[6], p[7], p[8]};
+
+    // Center is the solution of A.c = -g, computed with the adjugate of A
+    double cof[3][3];
+    cof[0][0]  = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+    cof[0][1]  = a[0][2] * a[2][1] - a[0][1] * a[2][2];
+    cof[0][2]  = a[0][1] * a[1][2] - a[0][2] * a[1][1];
+    cof[1][0]  = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+    cof[1][1]  = a[0][0] * a[2][2] - a[0][2] * a[2][0];
+    cof[1][2]  = a[0][2] * a[1][0] - a[0][0] * a[1][2];
+    cof[2][0]  = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+    cof[2][1]  = a[0][1] * a[2][0] - a[0][0] * a[2][1];
+    cof[2][2]  = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+    double det = a[0][0] * cof[0][0] + a[0][1] * cof[1][0] + a[0][2] * cof[2][0];
+    if (fabs(det) < 1e-12)
+    {
+        return false;
+    }
+    double center[3];
+    for (int i = 0; i < 3; i++)
+    {
+        center[i] = -(cof[i][0] * g[0] + cof[i][1] * g[1] + cof[i][2] * g[2]) / det;
+    }
+
+    // Normalize quadric so that (x-c)'.A.(x-c) = 1
+    double k = 1.0;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            k += center[i] * a[i][j] * center[j];
+        }
+    }
+    if (k <= 0.0)
+    {
+        return false;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            a[i][j] /= k;
+        }
+    }
+
+    // Correction matrix is the square root of A, scaled by the geometric mean of ellipsoid radii
+    double eigenValues[3], eigenVectors[3][3];
+    Jacobi(a, eigenValues, eigenVectors);
+    if ((eigenValues[0] <= 0.0) || (eigenValues[1] <= 0.0) || (eigenValues[2] <= 0.0))
+    {
+        // Not an ellipsoid
+        return false;
+    }
+    double radius = pow(eigenValues[0] * eigenValues[1] * eigenValues[2], -1.0 / 6.0);
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            double sum = 0.0;
+            for (int l = 0; l < 3; l++)
+            {
+                sum += eigenVectors[i][l] * sqrt(eigenValues[l]) * eigenVectors[j][l];
+            }
+            matrix[i][j] = radius * sum;
+        }
+        offset[i] = center[i];
+    }
+
+    // RMS of residuals, computed from the sufficient statistics : sum((d.p - 1)^2) = p'.DtD.p - 2.p'.Dt1 + N
+    // A residual e corresponds to a relative radius error of about e / 2k
+    double residual = nbSamples;
+    for (int i = 0; i < MAGCAL_NB_PARAMETERS; i++)
+    {
+        for (int j = 0; j < MAGCAL_NB_PARAMETERS; j++)
+        {
+            residual += p[i] * ((j >= i) ? dtd[i][j] : dtd[j][i]) * p[j];
+        }
+        residual -= 2.0 * p[i] * dt1[i];
+    }
+    fitError_per = (residual > 0.0) ? (float)(100.0 * sqrt(residual / nbSamples) / (2.0 * k)) : 0.0f;
+
+    return true;
+}
+
+void MagCalibration::GetOffset(float offset[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        offset[i] = this->offset[i];
+    }
+}
+
+void MagCalibration::GetMatrix(float matrix[3][3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            matrix[i][j] = this->matrix[i][j];
+        }
+    }
+}
+
+// Returns RMS radius error of the samples relative to the fitted ellipsoid, as computed by the last successful Solve
+float MagCalibration::GetFitError_per()
+{
+    return fitError_per;
+}
+
+// Returns the percentage of sample direction bins that have been hit
+float MagCalibration::GetCoverage_per()
+{
+    int nbBins = 0;
+
+    for (int i = 0; i < MAGCAL_NB_COVERAGE_BINS; i++)
+    {
+        if (coverageMask & (1UL << i))
+            nbBins++;
+    }
+
+    return (100.0f * nbBins) / MAGCAL_NB_COVERAGE_BINS;
+}
+
+uint32_t MagCalibration::GetNbSamples()
+{
+    return nbSamples;
+}
+
+// Eigen decomposition of a 3x3 symmetric matrix with the cyclic Jacobi method
+// Eigen vectors are returned as columns of eigenVectors
+void MagCalibration::Jacobi(double a[3][3], double eigenValues[3], double eigenVectors[3][3])
+{
+    double m[3][3];
+
+    memcpy(m, a, sizeof(m));
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            eigenVectors[i][j] = (i == j) ? 1.0 : 0.0;
+        }
+    }
+
+    for (int sweep = 0; sweep < JACOBI_NB_SWEEPS; sweep++)
+    {
+        for (int p = 0; p < 2; p++)
+        {
+            for (int q = p + 1; q < 3; q++)
+            {
+                if (fabs(m[p][q]) < 1e-15)
+                {
+                    continue;
+                }
+
+                double theta = (m[q][q] - m[p][p]) / (2.0 * m[p][q]);
+                double t     = ((theta >= 0.0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c     = 1.0 / sqrt(t * t + 1.0);
+                double s     = t * c;
+
+                for (int k = 0; k < 3; k++)
+                {
+                    double mkp = m[k][p];
+                    double mkq = m[k][q];
+                    m[k][p]    = c * mkp - s * mkq;
+                    m[k][q]    = s * mkp + c * mkq;
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    double mpk = m[p][k];
+                    double mqk = m[q][k];
+                    m[p][k]    = c * mpk - s * mqk;
+                    m[q][k]    = s * mpk + c * mqk;
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    double vkp         = eigenVectors[k][p];
+                    double vkq         = eigenVectors[k][q];
+                    eigenVectors[k][p] = c * vkp - s * vkq;
+                    eigenVectors[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        eigenValues[i] = m[i][i];
+    }
+}
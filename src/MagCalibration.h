@@ -0,0 +1,83 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Streaming hard/soft iron magnetometer calibration             *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef MAGCALIBRATION_H_
+#define MAGCALIBRATION_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Number of parameters of the general ellipsoid model
+#define MAGCAL_NB_PARAMETERS 9
+// Number of direction bins used to measure coverage : 8 azimuth sectors x 4 elevation bands
+#define MAGCAL_NB_COVERAGE_BINS 32
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class MagCalibration
+{
+  public:
+    MagCalibration();
+    virtual ~MagCalibration();
+
+    void     Reset();
+    void     AddSample(float mx, float my, float mz);
+    bool     Solve();
+    void     GetOffset(float offset[3]);
+    void     GetMatrix(float matrix[3][3]);
+    float    GetFitError_per();
+    float    GetCoverage_per();
+    uint32_t GetNbSamples();
+
+  private:
+    // Sufficient statistics of the least-squares problem : D^T.D and D^T.1, D being the design matrix of samples
+    double   dtd[MAGCAL_NB_PARAMETERS][MAGCAL_NB_PARAMETERS];
+    double   dt1[MAGCAL_NB_PARAMETERS];
+    uint32_t nbSamples;
+    uint32_t coverageMask;
+    float    minField[3];
+    float    maxField[3];
+    float    offset[3];
+    float    matrix[3][3];
+    float    fitError_per;
+
+    static void Jacobi(double a[3][3], double eigenValues[3], double eigenVectors[3][3]);
+};
+
+#endif /* MAGCALIBRATION_H_ */
@@ -55,8 +55,6 @@
 /*                           Local prototypes                              */
 /***************************************************************************/
 
-void RfIsr();
-
 /***************************************************************************/
 /*                               Globals                                   */
 /***************************************************************************/
@@ -69,71 +67,14 @@ bool firstLoop;
 
 void setup()
 {
-    // Load configuration from EEPROM
-    gConfiguration.LoadFromEeprom();
+    // Configure CPU low power mode
+    gPowerManager.Init();
 
     // Init USB serial link
     USB_NMEA.begin(USB_BAUDRATE);
 
-    // Init GNSS NMEA serial link
-    GNSS_SERIAL.setRX(GNSS_RX_PIN);
-    GNSS_SERIAL.setTX(GNSS_TX_PIN);
-    GNSS_SERIAL.begin(GNSS_BAUDRATE);
-
-    // Init wired serial link
-    WIRED_NMEA.setRX(WIRED_RX_PIN);
-    WIRED_NMEA.setTX(WIRED_TX_PIN);
-    WIRED_NMEA.begin(WIRED_BAUDRATE);
-
-    // Let time for serial drivers to set-up
-    delay(250);
-
-#if (GNSS_UBLOXM8N == 1)
-    CONSOLE.println("Configuring UBlox M8N GNSS");
-    gM8nDriver.Start(M8N_GGA_ENABLE | M8N_VTG_ENABLE | M8N_RMC_ENABLE);
-#endif
-
-    CONSOLE.print("Initializing CC1101 ... ");
-    // Check connection to CC1101
-    if (!gRfReceiver.Init(&gRxMessageFifo, gConfiguration.rfFrequencyOffset_MHz))
-    {
-        CONSOLE.println("Failed");
-        CONSOLE.println("Aborting execution : Verify connection to CC1101 board");
-        CONSOLE.println("Halted");
-
-        while (1)
-        {
-            digitalWrite(LED_BUILTIN, HIGH);
-            delay(500);
-            digitalWrite(LED_BUILTIN, LOW);
-            delay(500);
-        }
-    }
-    CONSOLE.println("OK");
-
-    CONSOLE.print("Initializing navigation compass ... ");
-    if (!gNavCompass.Init())
-    {
-        CONSOLE.println("NOT DETECTED");
-        gConfiguration.navCompassAvailable = false;
-    }
-    else
-    {
-        CONSOLE.print(gNavCompass.GetDeviceName().c_str());
-        CONSOLE.println(" Found");
-        gConfiguration.navCompassAvailable = true;
-    }
-
-    // Start listening
-    gRfReceiver.RestartReception();
-
-    // Attach callback to GDO0 pin
-    // According to CC1101 configuration this callback will be executed when CC1101 will have detected Micronet's sync word
-#if defined(ARDUINO_TEENSY35) || defined(ARDUINO_TEENSY36)
-    attachInterrupt(digitalPinToInterrupt(GDO0_PIN), RfIsr, RISING);
-#else
-    attachInterrupt(digitalPinToInterrupt(GDO0_PIN), RfIsr, HIGH);
-#endif
+    // Load configuration and start Micronet reception. GNSS configuration continues in background.
+    gBootSequencer.Start();
 
     // Display serial menu
     gMenuManager.PrintMenu();
@@ -144,6 +85,9 @@ void setup()
 
 void loop()
 {
+    // Complete boot phases still running in background
+    gBootSequencer.Process();
+
     // If this is the first loop, we verify if we are already attached to a Micronet network. if yes,
     // We directly jump to NMEA conversion mode.
     if ((firstLoop) && (gConfiguration.networkId != 0))
@@ -162,8 +106,3 @@ void loop()
     firstLoop = false;
 }
 
-void RfIsr()
-{
-    gRfReceiver.RfIsr();
-}
-
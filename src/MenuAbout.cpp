@@ -50,6 +50,8 @@
 /*                           Local prototypes                              */
 /***************************************************************************/
 
+void PrintBootReport();
+
 /***************************************************************************/
 /*                               Globals                                   */
 /***************************************************************************/
@@ -80,6 +82,11 @@ void MenuAbout()
             CONSOLE.println("Invalid configuration found in EEPROM");
         }
     }
+    PrintBootReport();
+
+    CONSOLE.print("Configuration journal usage : ");
+    CONSOLE.print(gConfiguration.GetJournalUsage_per(), 1);
+    CONSOLE.println("%");
 
     CONSOLE.print("Device ID : ");
     CONSOLE.println(gConfiguration.deviceId, HEX);
@@ -132,3 +139,30 @@ void MenuAbout()
         CONSOLE.println((int)gConfiguration.windShift);
     }
 }
+
+// Print the time spent in each boot phase
+void PrintBootReport()
+{
+    CONSOLE.print("Boot started ");
+    CONSOLE.print(gBootSequencer.GetStartTime_ms());
+    CONSOLE.println("ms after reset :");
+    for (int i = 0; i < BOOT_PHASE_DONE; i++)
+    {
+        BootPhase_t phase = (BootPhase_t)i;
+
+        CONSOLE.print("  ");
+        CONSOLE.print(gBootSequencer.GetPhaseName(phase));
+        if (gBootSequencer.GetPhaseEndTime_us(phase) == 0)
+        {
+            CONSOLE.println(" : running");
+        }
+        else
+        {
+            CONSOLE.print(" : ");
+            CONSOLE.print(gBootSequencer.GetPhaseDuration_us(phase) / 1000.0f, 1);
+            CONSOLE.print("ms, done at ");
+            CONSOLE.print(gBootSequencer.GetPhaseEndTime_us(phase) / 1000.0f, 1);
+            CONSOLE.println("ms");
+        }
+    }
+}
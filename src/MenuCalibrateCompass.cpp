@@ -33,6 +33,7 @@
 #include "BoardConfig.h"
 #include "Configuration.h"
 #include "Globals.h"
+#include "MagCalibration.h"
 #include "Micronet.h"
 #include "MicronetCodec.h"
 #include "MicronetMessageFifo.h"
@@ -41,6 +42,9 @@
 /*                              Constants                                  */
 /***************************************************************************/
 
+#define MAGCAL_SAMPLE_PERIOD_MS  100
+#define MAGCAL_DISPLAY_PERIOD_MS 1000
+
 /***************************************************************************/
 /*                             Local types                                 */
 /***************************************************************************/
@@ -59,17 +63,13 @@
 
 void MenuCalibrateCompass()
 {
-    bool     exitLoop     = false;
-    uint32_t pDisplayTime = 0;
-    uint32_t pSampleTime  = 0;
-    float    mx, my, mz;
-    float    xMin = 1000;
-    float    xMax = -1000;
-    float    yMin = 1000;
-    float    yMax = -1000;
-    float    zMin = 1000;
-    float    zMax = -1000;
-    char     c;
+    bool           exitLoop     = false;
+    uint32_t       pDisplayTime = 0;
+    uint32_t       pSampleTime  = 0;
+    float          mx, my, mz;
+    float          offset[3];
+    MagCalibration magCalibration;
+    char           c;
 
     if (gConfiguration.navCompassAvailable == false)
     {
@@ -78,54 +78,45 @@ void MenuCalibrateCompass()
     }
 
     CONSOLE.println("Calibrating magnetometer ... ");
+    CONSOLE.println("Slowly rotate the compass in all directions until coverage is close to 100%.");
+    CONSOLE.println("Press ESC key when done.");
 
     do
     {
         uint32_t currentTime = millis();
-        if ((currentTime - pSampleTime) > 100)
+        if ((currentTime - pSampleTime) > MAGCAL_SAMPLE_PERIOD_MS)
         {
+            pSampleTime = currentTime;
             gNavCompass.GetMagneticField(&mx, &my, &mz);
-            if ((currentTime - pDisplayTime) > 250)
+            magCalibration.AddSample(mx, my, mz);
+
+            if ((currentTime - pDisplayTime) > MAGCAL_DISPLAY_PERIOD_MS)
             {
                 pDisplayTime = currentTime;
-                if (mx < xMin)
-                    xMin = mx;
-                if (mx > xMax)
-                    xMax = mx;
-
-                if (my < yMin)
-                    yMin = my;
-                if (my > yMax)
-                    yMax = my;
-
-                if (mz < zMin)
-                    zMin = mz;
-                if (mz > zMax)
-                    zMax = mz;
-
-                CONSOLE.print("(");
-                CONSOLE.print(mx);
-                CONSOLE.print(" ");
-                CONSOLE.print(my);
-                CONSOLE.print(" ");
-                CONSOLE.print(mz);
-                CONSOLE.println(")");
-
-                CONSOLE.print("[");
-                CONSOLE.print((xMin + xMax) / 2);
-                CONSOLE.print(" ");
-                CONSOLE.print(xMax - xMin);
-                CONSOLE.print("] ");
-                CONSOLE.print("[");
-                CONSOLE.print((yMin + yMax) / 2);
-                CONSOLE.print(" ");
-                CONSOLE.print(yMax - yMin);
-                CONSOLE.print("] ");
-                CONSOLE.print("[");
-                CONSOLE.print((zMin + zMax) / 2);
-                CONSOLE.print(" ");
-                CONSOLE.print(zMax - zMin);
-                CONSOLE.println("]");
+
+                CONSOLE.print("Samples ");
+                CONSOLE.print(magCalibration.GetNbSamples());
+                CONSOLE.print(", coverage ");
+                CONSOLE.print(magCalibration.GetCoverage_per(), 0);
+                CONSOLE.print("%");
+                if (magCalibration.Solve())
+                {
+                    magCalibration.GetOffset(offset);
+                    CONSOLE.print(", fit error ");
+                    CONSOLE.print(magCalibration.GetFitError_per(), 2);
+                    CONSOLE.print("%, offset [");
+                    CONSOLE.print(offset[0]);
+                    CONSOLE.print(" ");
+                    CONSOLE.print(offset[1]);
+                    CONSOLE.print(" ");
+                    CONSOLE.print(offset[2]);
+                    CONSOLE.print("]");
+                }
+                else
+                {
+                    CONSOLE.print(", not enough data to fit");
+                }
+                CONSOLE.println("");
             }
         }
 
@@ -139,15 +130,24 @@ void MenuCalibrateCompass()
         }
         yield();
     } while (!exitLoop);
+
+    if (!magCalibration.Solve())
+    {
+        CONSOLE.println("Calibration failed : not enough rotation coverage. Configuration discarded");
+        return;
+    }
+
     CONSOLE.println("Do you want to save the new calibration values (y/n) ?");
     while (CONSOLE.available() == 0)
         ;
     c = CONSOLE.read();
     if ((c == 'y') || (c == 'Y'))
     {
-        gConfiguration.xMagOffset = (xMin + xMax) / 2;
-        gConfiguration.yMagOffset = (yMin + yMax) / 2;
-        gConfiguration.zMagOffset = (zMin + zMax) / 2;
+        magCalibration.GetOffset(offset);
+        magCalibration.GetMatrix(gConfiguration.magSoftIron);
+        gConfiguration.xMagOffset = offset[0];
+        gConfiguration.yMagOffset = offset[1];
+        gConfiguration.zMagOffset = offset[2];
         gConfiguration.SaveToEeprom();
         CONSOLE.println("Configuration saved");
     }
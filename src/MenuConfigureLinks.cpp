@@ -0,0 +1,198 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Configure data links                                          *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <Arduino.h>
+
+#include "BoardConfig.h"
+#include "Configuration.h"
+#include "Globals.h"
+#include "MenuConfigureLinks.h"
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define KEY_FILTERING_DEPTH 'f'
+#define KEY_SPD_EMULATION   's'
+#define KEY_NMEA_PORT       'p'
+
+#define LINK_BIT(link) (1 << (link))
+#define NMEA_LINKS     (LINK_BIT(LINK_NMEA_EXT) | LINK_BIT(LINK_NMEA_GNSS) | LINK_BIT(LINK_MICRONET))
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+typedef struct
+{
+    const char *name;
+    uint32_t    allowedLinks; // Mask of the links which can provide this data
+} DataSourceDesc_t;
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+static void        PrintLinkConfiguration();
+static const char *LinkName(LinkId_t link);
+static LinkId_t    NextLink(DataSource_t source, LinkId_t link);
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+// Must follow DataSource_t order
+static const DataSourceDesc_t dataSourceDesc[DATA_SOURCE_NB] = {
+    {"Navigation (RMB)", NMEA_LINKS},                       // DATA_SOURCE_NAV
+    {"GNSS (RMC, GGA, GLL, VTG)", NMEA_LINKS},              // DATA_SOURCE_GNSS
+    {"Wind (MWV)", NMEA_LINKS},                             // DATA_SOURCE_WIND
+    {"Depth (DPT)", NMEA_LINKS},                            // DATA_SOURCE_DEPTH
+    {"Speed (VHW, VLW)", NMEA_LINKS},                       // DATA_SOURCE_SPEED
+    {"Battery voltage (XDR)", NMEA_LINKS},                  // DATA_SOURCE_VOLTAGE
+    {"Sea temperature (MTW)", NMEA_LINKS},                  // DATA_SOURCE_SEATEMP
+    {"Heading (HDG)", NMEA_LINKS | LINK_BIT(LINK_COMPASS)}, // DATA_SOURCE_COMPASS
+};
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+// Let the user select the source link of each group of data, COG/SOG filtering, SPD emulation and the external NMEA port.
+// The configuration is saved on exit and applies from the next NMEA conversion start.
+void MenuConfigureLinks()
+{
+    char c;
+
+    PrintLinkConfiguration();
+
+    do
+    {
+        if (CONSOLE.available())
+        {
+            c = CONSOLE.read();
+            if ((c == 0x1b) || (c == 0x0d))
+            {
+                break;
+            }
+            else if ((c >= '1') && (c < '1' + DATA_SOURCE_NB))
+            {
+                DataSource_t source               = (DataSource_t)(c - '1');
+                gConfiguration.sourceLink[source] = NextLink(source, gConfiguration.sourceLink[source]);
+            }
+            else if (c == KEY_FILTERING_DEPTH)
+            {
+                gConfiguration.sogCogFilteringDepth =
+                    (gConfiguration.sogCogFilteringDepth >= SOG_COG_MAX_FILTERING_DEPTH) ? 1 : gConfiguration.sogCogFilteringDepth + 1;
+            }
+            else if (c == KEY_SPD_EMULATION)
+            {
+                gConfiguration.spdEmulation = !gConfiguration.spdEmulation;
+            }
+            else if (c == KEY_NMEA_PORT)
+            {
+                gConfiguration.nmeaExtPort = (gConfiguration.nmeaExtPort == NMEA_PORT_USB) ? NMEA_PORT_WIRED : NMEA_PORT_USB;
+            }
+            else
+            {
+                continue;
+            }
+
+            PrintLinkConfiguration();
+        }
+    } while (1);
+
+    gConfiguration.SaveToEeprom();
+    CONSOLE.println("Data links configuration saved, it will apply from the next NMEA conversion start.");
+}
+
+static void PrintLinkConfiguration()
+{
+    CONSOLE.println("");
+    CONSOLE.println("Data links configuration :");
+    for (int i = 0; i < DATA_SOURCE_NB; i++)
+    {
+        CONSOLE.print("  ");
+        CONSOLE.print(i + 1);
+        CONSOLE.print(" - ");
+        CONSOLE.print(dataSourceDesc[i].name);
+        CONSOLE.print(" : ");
+        CONSOLE.println(LinkName(gConfiguration.sourceLink[i]));
+    }
+    CONSOLE.print("  ");
+    CONSOLE.print(KEY_FILTERING_DEPTH);
+    CONSOLE.print(" - COG/SOG filtering depth : ");
+    if (gConfiguration.sogCogFilteringDepth <= 1)
+    {
+        CONSOLE.println("disabled");
+    }
+    else
+    {
+        CONSOLE.println(gConfiguration.sogCogFilteringDepth);
+    }
+    CONSOLE.print("  ");
+    CONSOLE.print(KEY_SPD_EMULATION);
+    CONSOLE.print(" - SPD emulation with SOG : ");
+    CONSOLE.println(gConfiguration.spdEmulation ? "enabled" : "disabled");
+    CONSOLE.print("  ");
+    CONSOLE.print(KEY_NMEA_PORT);
+    CONSOLE.print(" - External NMEA port : ");
+    CONSOLE.println((gConfiguration.nmeaExtPort == NMEA_PORT_WIRED) ? "wired UART" : "USB");
+    CONSOLE.println("Press a key to change the matching setting, ESC or ENTER to save and exit.");
+}
+
+static const char *LinkName(LinkId_t link)
+{
+    switch (link)
+    {
+    case LINK_NMEA_EXT:
+        return "external NMEA";
+    case LINK_NMEA_GNSS:
+        return "GNSS";
+    case LINK_MICRONET:
+        return "Micronet";
+    case LINK_COMPASS:
+        return "navigation compass";
+    default:
+        return "unknown";
+    }
+}
+
+// Returns the link following the current one among the links allowed for a group of data
+static LinkId_t NextLink(DataSource_t source, LinkId_t link)
+{
+    int nextLink = link;
+
+    do
+    {
+        nextLink = (nextLink + 1) % LINK_NB_LINKS;
+    } while ((dataSourceDesc[source].allowedLinks & LINK_BIT(nextLink)) == 0);
+
+    return (LinkId_t)nextLink;
+}
@@ -32,19 +32,62 @@
 
 #include "BoardConfig.h"
 #include "Configuration.h"
+#include "EventScheduler.h"
 #include "Globals.h"
 #include "Micronet.h"
 #include "MicronetCodec.h"
 #include "MicronetMessageFifo.h"
+#include "MenuNetworkCensus.h"
+#include "TeensySchedulerPlatform.h"
 
 /***************************************************************************/
 /*                              Constants                                  */
 /***************************************************************************/
 
+// Period at which the frequency offset learned by the tracking loop is written back to EEPROM
+#define FREQ_OFFSET_SAVE_PERIOD_MS 600000
+// Minimum change of the learned frequency offset to trigger an EEPROM write
+#define FREQ_OFFSET_SAVE_THRESHOLD_MHZ 0.001f
+// Period at which heading is sent to NMEA & Micronet
+#define COMPASS_OUTPUT_PERIOD_MS 100
+// Period of housekeeping task (console, data validity)
+#define HOUSEKEEPING_PERIOD_MS 50
+// Maximum number of characters processed by each run of NMEA input task, so that a long burst of NMEA data (e.g. AIS)
+// can't delay RF processing
+#define NMEA_INPUT_BURST_SIZE 32
+// Console key printing the network census without stopping conversion (CTRL-N). A control character is used since the
+// console may also be the NMEA input port.
+#define CONSOLE_KEY_CENSUS 0x0e
+
 /***************************************************************************/
 /*                             Local types                                 */
 /***************************************************************************/
 
+// Conversion tasks, by decreasing priority
+typedef enum
+{
+    TASK_PRIORITY_RF_FRAMES = 0,
+    TASK_PRIORITY_TX_PLANNING,
+    TASK_PRIORITY_NMEA_INPUT,
+    TASK_PRIORITY_NMEA_OUTPUT,
+    TASK_PRIORITY_COMPASS_SAMPLING,
+    TASK_PRIORITY_COMPASS,
+    TASK_PRIORITY_HOUSEKEEPING
+} ConversionTaskPriority_t;
+
+// Data shared by conversion tasks
+typedef struct
+{
+    MicronetCodec       *micronetCodec;
+    DataBridge          *dataBridge;
+    MicronetSlaveDevice *micronetDevice;
+    MicronetMessageFifo *txMessageFifo;
+    int                  txPlanningTaskId;
+    int                  missedCycleTaskId;
+    int                  nmeaInputTaskId;
+    bool                 exitNmeaLoop;
+} ConversionContext_t;
+
 /***************************************************************************/
 /*                           Local prototypes                              */
 /***************************************************************************/
@@ -52,25 +95,46 @@
 void MenuConvertToNmea();
 void SaveCalibration(MicronetCodec &micronetCodec);
 void LoadCalibration(MicronetCodec &micronetCodec);
+void SaveFrequencyOffset();
+void PrintPowerReport();
+void PrintSchedulerReport();
+void PrintNavDataReport(NavigationData &navData);
+void PrintGnssAgeReport(MicronetSlaveDevice &micronetDevice);
+void PrintCycleReport(MicronetSlaveDevice &micronetDevice);
+void PrintDataAge(const char *name, DataAgeStatistics_t *statistics, DataAgeStatistics_t *requestStatistics);
+void RfRxCallback();
+void NavDataPublishHook();
+void RfFramesTask(void *context);
+void TxPlanningTask(void *context);
+void MissedCycleTask(void *context);
+void NmeaInputTask(void *context);
+void NmeaOutputTask(void *context);
+void CompassSamplingTask(void *context);
+void CompassTask(void *context);
+void HousekeepingTask(void *context);
+void FrequencyOffsetTask(void *context);
 void ConfigureSlaveDevice(MicronetSlaveDevice &micronetDevice);
 
 /***************************************************************************/
 /*                               Globals                                   */
 /***************************************************************************/
 
+TeensySchedulerPlatform schedulerPlatform;                      // Time and interrupt source of conversion scheduler
+EventScheduler          conversionScheduler(&schedulerPlatform); // Schedules conversion tasks according to their priority
+int                     rfFramesTaskId = -1;                     // ID of the RF frames task, signalled from RF ISR
+int                     navDataTaskId  = -1;                     // ID of the navigation data dispatching task, signalled on value changes
+
 /***************************************************************************/
 /*                              Functions                                  */
 /***************************************************************************/
 
 void MenuConvertToNmea()
 {
-    bool                exitNmeaLoop = false;
-    MicronetMessage_t  *rxMessage;
     MicronetMessageFifo txMessageFifo;
-    uint32_t            lastHeadingTime = millis();
     MicronetCodec       micronetCodec;
-    DataBridge          dataBridge(&micronetCodec);
+    DataBridge          dataBridge(&micronetCodec, &gConfiguration);
     MicronetSlaveDevice micronetDevice(&micronetCodec);
+    ConversionContext_t context;
 
     // Check that we have been attached to a network
     if (gConfiguration.networkId == 0)
@@ -83,6 +147,7 @@ void MenuConvertToNmea()
     CONSOLE.println("");
     CONSOLE.println("Starting Micronet to NMEA0183 conversion.");
     CONSOLE.println("Press ESC key at any time to stop conversion and come back to menu.");
+    CONSOLE.println("Press CTRL-N to print the Micronet network census.");
     CONSOLE.println("");
 
     // Load sensor calibration data into Micronet codec
@@ -90,85 +155,245 @@ void MenuConvertToNmea()
 
     // Configure Micronet device according to board configuration
     ConfigureSlaveDevice(micronetDevice);
+    dataBridge.SetLatencyTracer(&gLatencyTracer);
+
+    // Create conversion tasks
+    context.micronetCodec     = &micronetCodec;
+    context.dataBridge        = &dataBridge;
+    context.micronetDevice    = &micronetDevice;
+    context.txMessageFifo     = &txMessageFifo;
+    context.exitNmeaLoop      = false;
+    rfFramesTaskId            = conversionScheduler.AddTask("RF frames", TASK_PRIORITY_RF_FRAMES, RfFramesTask, &context, 0);
+    context.txPlanningTaskId  = conversionScheduler.AddTask("TX planning", TASK_PRIORITY_TX_PLANNING, TxPlanningTask, &context, 0);
+    context.missedCycleTaskId = conversionScheduler.AddTask("Missed cycles", TASK_PRIORITY_TX_PLANNING, MissedCycleTask, &context, 0);
+    context.nmeaInputTaskId   = conversionScheduler.AddTask("NMEA input", TASK_PRIORITY_NMEA_INPUT, NmeaInputTask, &context, 0);
+    navDataTaskId             = conversionScheduler.AddTask("NMEA output", TASK_PRIORITY_NMEA_OUTPUT, NmeaOutputTask, &context, 0);
+    if (gConfiguration.navCompassAvailable == true)
+    {
+        conversionScheduler.AddTask("Compass sampling", TASK_PRIORITY_COMPASS_SAMPLING, CompassSamplingTask, nullptr,
+                                    NAVCOMPASS_SAMPLE_PERIOD_MS * 1000 / 2);
+        conversionScheduler.AddTask("Compass", TASK_PRIORITY_COMPASS, CompassTask, &context, COMPASS_OUTPUT_PERIOD_MS * 1000);
+    }
+    conversionScheduler.AddTask("Housekeeping", TASK_PRIORITY_HOUSEKEEPING, HousekeepingTask, &context, HOUSEKEEPING_PERIOD_MS * 1000);
+    conversionScheduler.AddTask("Freq. offset", TASK_PRIORITY_HOUSEKEEPING, FrequencyOffsetTask, &context, FREQ_OFFSET_SAVE_PERIOD_MS * 1000);
 
     // Enable frequency tracking to keep master's frequency as reference in case of XTAL/PLL drift
     gRfReceiver.EnableFrequencyTracking(gConfiguration.networkId);
 
     gRxMessageFifo.ResetFifo();
+    gPowerManager.ResetStatistics();
+    micronetCodec.navData.ResetStatistics();
+    micronetCodec.navData.SetPublishHook(NavDataPublishHook);
+    gRfReceiver.SetRxCallback(RfRxCallback);
+    gRfReceiver.SetEncoderCallback(MicronetSlaveDevice::LateEncoderCallback, &micronetDevice);
 
     do
     {
-        if ((rxMessage = gRxMessageFifo.Peek()) != nullptr)
+        // Serial drivers don't provide reception callbacks : detect incoming NMEA data here and let the scheduler decide
+        // when to process it
+        if ((GNSS_SERIAL.available() > 0) || (dataBridge.GetNmeaExtPort()->available() > 0))
         {
-            micronetDevice.ProcessMessage(rxMessage, &txMessageFifo);
-            gRfReceiver.Transmit(&txMessageFifo);
+            conversionScheduler.Signal(context.nmeaInputTaskId);
+        }
 
-            dataBridge.UpdateMicronetData();
+        if (!conversionScheduler.RunNext())
+        {
+            yield();
 
-            if (micronetCodec.navData.calibrationUpdated)
+            // Nothing to do : enter sleep mode to save power until the next RF event or periodic task. CPU will be
+            // waken-up earlier by any interrupt (RF, serial links, system tick).
+            uint32_t maxSleepTime_us = gRfReceiver.GetNextEventDelay_us();
+            uint32_t taskDelay_us    = conversionScheduler.GetNextDeadlineDelay_us();
+            if (taskDelay_us < maxSleepTime_us)
             {
-                micronetCodec.navData.calibrationUpdated = false;
-                SaveCalibration(micronetCodec);
+                maxSleepTime_us = taskDelay_us;
             }
-
-            gRxMessageFifo.DeleteMessage();
+            gPowerManager.Sleep(maxSleepTime_us);
         }
+    } while (!context.exitNmeaLoop);
+
+    gRfReceiver.SetRxCallback(nullptr);
+    gRfReceiver.SetEncoderCallback(nullptr, nullptr);
+    micronetCodec.navData.SetPublishHook(nullptr);
+    PrintPowerReport();
+    PrintSchedulerReport();
+    PrintNavDataReport(micronetCodec.navData);
+    PrintGnssAgeReport(micronetDevice);
+    PrintCycleReport(micronetDevice);
+    conversionScheduler.RemoveAllTasks();
+    rfFramesTaskId = -1;
+    navDataTaskId  = -1;
+    SaveFrequencyOffset();
+    gConfiguration.SaveToEeprom();
+    gRfReceiver.DisableFrequencyTracking();
+}
+
+// Called from RF ISR each time a message has been received
+void RfRxCallback()
+{
+    conversionScheduler.Signal(rfFramesTaskId);
+}
+
+// Process all received Micronet frames : decode their content and plan our responses
+void RfFramesTask(void *context)
+{
+    ConversionContext_t *ctx = static_cast<ConversionContext_t *>(context);
+    MicronetMessage_t   *rxMessage;
+
+    while ((rxMessage = gRxMessageFifo.Peek()) != nullptr)
+    {
+        ctx->micronetDevice->ProcessMessage(rxMessage, ctx->txMessageFifo);
+        gRxMessageFifo.DeleteMessage();
+    }
+
+    // Wake-up missed cycle detection at the time the next MASTER_REQUEST should have been received
+    uint32_t deadline_us;
+    if (ctx->micronetDevice->GetMissedCycleDeadline(&deadline_us))
+    {
+        conversionScheduler.SignalAt(ctx->missedCycleTaskId, deadline_us);
+    }
+
+    if (ctx->txMessageFifo->GetNbMessages() > 0)
+    {
+        conversionScheduler.Signal(ctx->txPlanningTaskId);
+    }
+}
+
+// Called each time a navigation data subscriber gets a new pending change
+void NavDataPublishHook()
+{
+    conversionScheduler.Signal(navDataTaskId);
+}
+
+// Hand over planned transmissions to RF driver
+void TxPlanningTask(void *context)
+{
+    ConversionContext_t *ctx = static_cast<ConversionContext_t *>(context);
+
+    gRfReceiver.Transmit(ctx->txMessageFifo);
+}
 
-        while (GNSS_SERIAL.available() > 0)
+// Run when no MASTER_REQUEST has been received in the expected window : keep on transmitting on the predicted timeline
+void MissedCycleTask(void *context)
+{
+    ConversionContext_t *ctx = static_cast<ConversionContext_t *>(context);
+    uint32_t             deadline_us;
+
+    ctx->micronetDevice->ProcessMissedCycle(micros(), ctx->txMessageFifo);
+    if (ctx->micronetDevice->GetMissedCycleDeadline(&deadline_us))
+    {
+        conversionScheduler.SignalAt(ctx->missedCycleTaskId, deadline_us);
+    }
+
+    if (ctx->txMessageFifo->GetNbMessages() > 0)
+    {
+        conversionScheduler.Signal(ctx->txPlanningTaskId);
+    }
+}
+
+// Feed NMEA data received from GNSS and external NMEA link to the data bridge
+void NmeaInputTask(void *context)
+{
+    ConversionContext_t *ctx = static_cast<ConversionContext_t *>(context);
+    int                  nbChars;
+
+    nbChars = 0;
+    while ((GNSS_SERIAL.available() > 0) && (nbChars++ < NMEA_INPUT_BURST_SIZE))
+    {
+        ctx->dataBridge->PushNmeaChar(GNSS_SERIAL.read(), LINK_NMEA_GNSS);
+    }
+
+    char    c;
+    Stream *nmeaExt = ctx->dataBridge->GetNmeaExtPort();
+    nbChars         = 0;
+    while ((nmeaExt->available() > 0) && (nbChars++ < NMEA_INPUT_BURST_SIZE))
+    {
+        c = nmeaExt->read();
+        if ((nmeaExt == static_cast<Stream *>(&CONSOLE)) && (c == 0x1b))
         {
-            dataBridge.PushNmeaChar(GNSS_SERIAL.read(), LINK_NMEA_GNSS);
+            CONSOLE.println("ESC key pressed, stopping conversion.");
+            ctx->exitNmeaLoop = true;
         }
-
-        char c;
-        while (NMEA_EXT.available() > 0)
+        else if ((nmeaExt == static_cast<Stream *>(&CONSOLE)) && (c == CONSOLE_KEY_CENSUS))
         {
-            c = NMEA_EXT.read();
-            if (((void *)(&CONSOLE) == (void *)(&NMEA_EXT)) && (c == 0x1b))
-            {
-                CONSOLE.println("ESC key pressed, stopping conversion.");
-                exitNmeaLoop = true;
-            }
-            dataBridge.PushNmeaChar(c, LINK_NMEA_EXT);
+            MenuNetworkCensus();
+            continue;
         }
+        ctx->dataBridge->PushNmeaChar(c, LINK_NMEA_EXT);
+    }
+}
+
+// Notify navigation data subscribers (wind engine, NMEA encoders) of changed values
+void NmeaOutputTask(void *context)
+{
+    ConversionContext_t *ctx = static_cast<ConversionContext_t *>(context);
+
+    ctx->micronetCodec->navData.Dispatch();
+}
+
+// Acquire navigation compass data, one short I2C transaction at a time
+void CompassSamplingTask(void *context)
+{
+    (void)context;
+
+    gNavCompass.SamplingStep();
+}
+
+// Send heading, attitude and rate of turn computed from the latest compass samples
+void CompassTask(void *context)
+{
+    ConversionContext_t *ctx = static_cast<ConversionContext_t *>(context);
+
+    ctx->micronetCodec->navData.SetOrigin(gNavCompass.GetSampleTime_us());
+    ctx->dataBridge->UpdateCompassData(gNavCompass.GetHeading() + ctx->micronetCodec->navData.headingOffset_deg);
+    ctx->dataBridge->UpdateAttitudeData(gNavCompass.GetHeel(), gNavCompass.GetPitch(), gNavCompass.GetRateOfTurn());
+    ctx->micronetCodec->navData.ResetOrigin();
+}
+
+void HousekeepingTask(void *context)
+{
+    ConversionContext_t *ctx = static_cast<ConversionContext_t *>(context);
 
-        // Only execute magnetic heading code if navigation compass is available
-        if (gConfiguration.navCompassAvailable == true)
+    if (ctx->dataBridge->GetNmeaExtPort() != static_cast<Stream *>(&CONSOLE))
+    {
+        while (CONSOLE.available() > 0)
         {
-            // Handle magnetic compass
-            // Only request new reading if previous is at least 100ms old
-            if ((millis() - lastHeadingTime) > 100)
+            int c = CONSOLE.read();
+            if (c == 0x1b)
             {
-                lastHeadingTime = millis();
-                dataBridge.UpdateCompassData(gNavCompass.GetHeading() + micronetCodec.navData.headingOffset_deg);
+                CONSOLE.println("ESC key pressed, stopping conversion.");
+                ctx->exitNmeaLoop = true;
             }
-        }
-
-        if ((void *)(&CONSOLE) != (void *)(&NMEA_EXT))
-        {
-            while (CONSOLE.available() > 0)
+            else if (c == CONSOLE_KEY_CENSUS)
             {
-                if (CONSOLE.read() == 0x1b)
-                {
-                    CONSOLE.println("ESC key pressed, stopping conversion.");
-                    exitNmeaLoop = true;
-                }
+                MenuNetworkCensus();
             }
         }
+    }
 
-        micronetCodec.navData.UpdateValidity();
-
-        yield();
+    ctx->micronetCodec->navData.UpdateValidity();
 
-#if defined(ARDUINO_TEENSY35) || defined(ARDUINO_TEENSY36)
-        // Enter sleep mode to save power. CPU will be waken-up on next interrupt
-        asm("wfi\n");
-#endif
+    // Store calibration changes made from Micronet displays
+    if (ctx->micronetCodec->navData.calibrationUpdated)
+    {
+        ctx->micronetCodec->navData.calibrationUpdated = false;
+        SaveCalibration(*ctx->micronetCodec);
+    }
 
-    } while (!exitNmeaLoop);
+    // Write configuration changes to EEPROM, one record at a time
+    gConfiguration.ProcessPendingSave();
 
-    gRfReceiver.DisableFrequencyTracking();
+    // Complete boot phases started before conversion (e.g. GNSS configuration)
+    gBootSequencer.Process();
 }
 
+// Periodically store learned frequency offset so that next boot starts with a locked frequency
+void FrequencyOffsetTask(void *context)
+{
+    (void)context;
+
+    SaveFrequencyOffset();
+}
 
 void SaveCalibration(MicronetCodec &micronetCodec)
 {
@@ -181,7 +406,185 @@ void SaveCalibration(MicronetCodec &micronetCodec)
     gConfiguration.magneticVariation_deg    = micronetCodec.navData.magneticVariation_deg;
     gConfiguration.windShift                = micronetCodec.navData.windShift_min;
 
-    gConfiguration.SaveToEeprom();
+    gConfiguration.RequestSave();
+}
+
+// Write the frequency offset learned by the RF tracking loop back to configuration
+// Only done once the loop is locked and if the offset changed significantly, to limit EEPROM wear
+void SaveFrequencyOffset()
+{
+    if (gRfReceiver.IsFrequencyTrackingLocked())
+    {
+        float learnedOffset_MHz = gRfReceiver.GetFrequencyOffset();
+        if (fabsf(learnedOffset_MHz - gConfiguration.rfFrequencyOffset_MHz) > FREQ_OFFSET_SAVE_THRESHOLD_MHZ)
+        {
+            gConfiguration.rfFrequencyOffset_MHz = learnedOffset_MHz;
+            gConfiguration.RequestSave();
+        }
+    }
+}
+
+// Print the share of time spent by CPU and CC1101 in each of their power states during conversion
+void PrintPowerReport()
+{
+    CONSOLE.println("");
+    CONSOLE.println("Power states during conversion :");
+    CONSOLE.print("  CPU    : run ");
+    CONSOLE.print(100.0f - gPowerManager.GetCpuSleepRatio_per(), 1);
+    CONSOLE.print("%, sleep ");
+    CONSOLE.print(gPowerManager.GetCpuSleepRatio_per(), 1);
+    CONSOLE.print("% (wake-up latency ");
+    CONSOLE.print(gPowerManager.GetWakeUpLatency_us());
+    CONSOLE.println("us)");
+    CONSOLE.print("  CC1101 : RX ");
+    CONSOLE.print(gPowerManager.GetRadioStateRatio_per(RADIO_STATE_RX), 1);
+    CONSOLE.print("%, TX ");
+    CONSOLE.print(gPowerManager.GetRadioStateRatio_per(RADIO_STATE_TX), 1);
+    CONSOLE.print("%, power down ");
+    CONSOLE.print(gPowerManager.GetRadioStateRatio_per(RADIO_STATE_POWER_DOWN), 1);
+    CONSOLE.println("%");
+}
+
+// Print run time and latency statistics of conversion tasks
+void PrintSchedulerReport()
+{
+    SchedulerTask_t task;
+
+    CONSOLE.println("");
+    CONSOLE.println("Conversion tasks (runs, avg/max run time, avg/max latency) :");
+    for (int i = 0; i < conversionScheduler.GetNbTasks(); i++)
+    {
+        if (conversionScheduler.GetTaskStatistics(i, &task))
+        {
+            CONSOLE.print("  ");
+            CONSOLE.print(task.name);
+            CONSOLE.print(" : ");
+            CONSOLE.print(task.nbRuns);
+            if (task.nbRuns > 0)
+            {
+                CONSOLE.print(", ");
+                CONSOLE.print((uint32_t)(task.totalRunTime_us / task.nbRuns));
+                CONSOLE.print("/");
+                CONSOLE.print(task.maxRunTime_us);
+                CONSOLE.print("us, ");
+                CONSOLE.print((uint32_t)(task.totalLatency_us / task.nbRuns));
+                CONSOLE.print("/");
+                CONSOLE.print(task.maxLatency_us);
+                CONSOLE.print("us");
+            }
+            CONSOLE.println("");
+        }
+    }
+}
+
+void PrintNavDataReport(NavigationData &navData)
+{
+    NavSubscriber_t subscriber;
+
+    CONSOLE.println("");
+    CONSOLE.println("Navigation data subscribers (changes, coalesced, notifications, avg/max depth, max latency) :");
+    for (int i = 0; i < navData.GetNbSubscribers(); i++)
+    {
+        if (navData.GetSubscriberStatistics(i, &subscriber))
+        {
+            CONSOLE.print("  ");
+            CONSOLE.print(subscriber.name);
+            CONSOLE.print(" : ");
+            CONSOLE.print(subscriber.nbEvents);
+            CONSOLE.print(", ");
+            CONSOLE.print(subscriber.nbCoalesced);
+            CONSOLE.print(", ");
+            CONSOLE.print(subscriber.nbNotifications);
+            if (subscriber.nbNotifications > 0)
+            {
+                CONSOLE.print(", ");
+                CONSOLE.print((float)subscriber.totalDepth / subscriber.nbNotifications, 1);
+                CONSOLE.print("/");
+                CONSOLE.print(subscriber.maxDepth);
+                CONSOLE.print(", ");
+                CONSOLE.print(subscriber.maxLatency_us);
+                CONSOLE.print("us");
+            }
+            CONSOLE.println("");
+        }
+    }
+}
+
+// Print the age of GNSS data when sent to Micronet displays
+void PrintGnssAgeReport(MicronetSlaveDevice &micronetDevice)
+{
+    DataAgeStatistics_t positionAge, sogCogAge;
+    DataAgeStatistics_t positionRequestAge, sogCogRequestAge;
+
+    micronetDevice.GetGnssAgeStatistics(&positionAge, &sogCogAge);
+    micronetDevice.GetGnssRequestAgeStatistics(&positionRequestAge, &sogCogRequestAge);
+
+    CONSOLE.println("");
+    CONSOLE.print("GNSS data age at Micronet transmission (avg/max), navigation rate ");
+    CONSOLE.print(GNSS_NAV_RATE_HZ);
+    CONSOLE.println("Hz :");
+    PrintDataAge("Position", &positionAge, &positionRequestAge);
+    PrintDataAge("SOG/COG", &sogCogAge, &sogCogRequestAge);
+}
+
+// Print the period of the master's network cycle as learned to predict the start of the next cycle
+void PrintCycleReport(MicronetSlaveDevice &micronetDevice)
+{
+    CycleStatistics_t statistics;
+    CycleCounters_t   counters;
+
+    micronetDevice.GetCycleStatistics(&statistics);
+    micronetDevice.GetCycleCounters(&counters);
+
+    CONSOLE.println("");
+    CONSOLE.print("Master cycle period : ");
+    CONSOLE.print(statistics.period_us, 1);
+    CONSOLE.print("us (");
+    CONSOLE.print(statistics.drift_ppm, 1);
+    CONSOLE.print("ppm), prediction error bound ");
+    CONSOLE.print(statistics.errorBound_us);
+    CONSOLE.print("us, max error ");
+    CONSOLE.print(statistics.maxResidual_us);
+    CONSOLE.print("us, ");
+    CONSOLE.print(statistics.nbSamples);
+    CONSOLE.print(" cycles, ");
+    CONSOLE.print(statistics.nbOutliers);
+    CONSOLE.println(" outliers");
+    CONSOLE.print("Network cycles : ");
+    CONSOLE.print(counters.nbConfirmed);
+    CONSOLE.print(" confirmed, ");
+    CONSOLE.print(counters.nbPredicted);
+    CONSOLE.print(" predicted, ");
+    CONSOLE.print(counters.nbUnpredicted);
+    CONSOLE.println(" missed beyond prediction limits");
+}
+
+// Print data age at slot time, compared to the age it would have had if encoded at master request
+void PrintDataAge(const char *name, DataAgeStatistics_t *statistics, DataAgeStatistics_t *requestStatistics)
+{
+    CONSOLE.print("  ");
+    CONSOLE.print(name);
+    CONSOLE.print(" : ");
+    if (statistics->nbSamples == 0)
+    {
+        CONSOLE.println("not sent");
+    }
+    else
+    {
+        CONSOLE.print(statistics->totalAge_ms / statistics->nbSamples);
+        CONSOLE.print("/");
+        CONSOLE.print(statistics->maxAge_ms);
+        CONSOLE.print("ms");
+        if (requestStatistics->nbSamples != 0)
+        {
+            CONSOLE.print(" (");
+            CONSOLE.print(requestStatistics->totalAge_ms / requestStatistics->nbSamples);
+            CONSOLE.print("/");
+            CONSOLE.print(requestStatistics->maxAge_ms);
+            CONSOLE.print("ms if encoded at master request)");
+        }
+        CONSOLE.println("");
+    }
 }
 
 void LoadCalibration(MicronetCodec &micronetCodec)
@@ -203,31 +606,34 @@ void ConfigureSlaveDevice(MicronetSlaveDevice &micronetDevice)
     // Configure Micronet's slave devices
     micronetDevice.SetNetworkId(gConfiguration.networkId);
     micronetDevice.SetDeviceId(gConfiguration.deviceId);
+    micronetDevice.SetPredictionLimits(PREDICTED_CYCLES_MAX, PREDICTION_MAX_ERROR_US);
+    micronetDevice.SetRxGating(RX_GATING != 0);
+    micronetDevice.SetLatencyTracer(&gLatencyTracer);
 
     // All these fields are sent to Micronet whatever is the configuration
     micronetDevice.SetDataFields(DATA_FIELD_TIME | DATA_FIELD_SOGCOG | DATA_FIELD_DATE | DATA_FIELD_POSITION | DATA_FIELD_XTE | DATA_FIELD_DTW |
                                  DATA_FIELD_BTW | DATA_FIELD_VMGWP | DATA_FIELD_NODE_INFO);
 
     // Only send Heading to Micronet if configured so
-    if (COMPASS_SOURCE_LINK != LINK_MICRONET)
+    if (gConfiguration.sourceLink[DATA_SOURCE_COMPASS] != LINK_MICRONET)
     {
         micronetDevice.AddDataFields(DATA_FIELD_HDG);
     }
 
     // Only send depth to Micronet if configured so
-    if (DEPTH_SOURCE_LINK != LINK_MICRONET)
+    if (gConfiguration.sourceLink[DATA_SOURCE_DEPTH] != LINK_MICRONET)
     {
         micronetDevice.AddDataFields(DATA_FIELD_DPT);
     }
 
     // Only send speed to Micronet if configured so or if SPD emulation is enabled
-    if ((EMULATE_SPD_WITH_SOG == 1) || (SPEED_SOURCE_LINK != LINK_MICRONET))
+    if (gConfiguration.spdEmulation || (gConfiguration.sourceLink[DATA_SOURCE_SPEED] != LINK_MICRONET))
     {
         micronetDevice.AddDataFields(DATA_FIELD_SPD);
     }
 
     // Only send wind data to Micronet if configured so or if wind repeating is enabled
-    if (WIND_SOURCE_LINK != LINK_MICRONET)
+    if (gConfiguration.sourceLink[DATA_SOURCE_WIND] != LINK_MICRONET)
     {
         micronetDevice.AddDataFields(DATA_FIELD_AWS | DATA_FIELD_AWA);
     }
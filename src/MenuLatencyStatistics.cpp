@@ -0,0 +1,166 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Show latency of the data sent on NMEA and Micronet            *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <Arduino.h>
+
+#include "BoardConfig.h"
+#include "Globals.h"
+#include "LatencyTracer.h"
+#include "MenuLatencyStatistics.h"
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define KEY_EXPORT_CSV 'c'
+#define KEY_RESET      'r'
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+static void PrintLatencyTable();
+static void ExportLatencyCsv();
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+// Print latency percentiles of each NMEA sentence and Micronet field sent during the last NMEA conversions. Latency is
+// measured from the reception of the input the data comes from (RF frame, NMEA sentence or compass sample) to the
+// emission of the sentence, or the start of the Micronet slot carrying the field.
+void MenuLatencyStatistics()
+{
+    char c;
+
+    PrintLatencyTable();
+
+    do
+    {
+        if (CONSOLE.available())
+        {
+            c = CONSOLE.read();
+            if (c == KEY_EXPORT_CSV)
+            {
+                ExportLatencyCsv();
+            }
+            else if (c == KEY_RESET)
+            {
+                gLatencyTracer.Reset();
+                CONSOLE.println("Latency statistics cleared");
+            }
+            else
+            {
+                break;
+            }
+        }
+    } while (1);
+}
+
+static void PrintLatencyTable()
+{
+    bool empty = true;
+
+    CONSOLE.println("Latency from input reception :");
+    for (int i = 0; i < LATENCY_NB_OUTPUTS; i++)
+    {
+        LatencyOutput_t output = (LatencyOutput_t)i;
+
+        if (gLatencyTracer.GetNbSamples(output) > 0)
+        {
+            CONSOLE.print(gLatencyTracer.GetName(output));
+            CONSOLE.print(" : ");
+            CONSOLE.print(gLatencyTracer.GetNbSamples(output));
+            CONSOLE.print(" samples, p50 ");
+            CONSOLE.print(gLatencyTracer.GetPercentile_us(output, 50) / 1000.0f, 1);
+            CONSOLE.print("ms, p99 ");
+            CONSOLE.print(gLatencyTracer.GetPercentile_us(output, 99) / 1000.0f, 1);
+            CONSOLE.print("ms, max ");
+            CONSOLE.print(gLatencyTracer.GetMax_us(output) / 1000.0f, 1);
+            CONSOLE.println("ms");
+            empty = false;
+        }
+    }
+
+    if (empty)
+    {
+        CONSOLE.println("No data sent yet, start NMEA conversion first.");
+    }
+    CONSOLE.println("");
+    CONSOLE.println("Press 'c' to export histograms as CSV, 'r' to clear statistics, any other key to exit");
+}
+
+// Export the summary then the histograms of all outputs. Each histogram row gives the number of samples whose latency is
+// between bucket_us and the bucket_us of the next row.
+static void ExportLatencyCsv()
+{
+    CONSOLE.println("output,samples,p50_us,p99_us,max_us");
+    for (int i = 0; i < LATENCY_NB_OUTPUTS; i++)
+    {
+        LatencyOutput_t output = (LatencyOutput_t)i;
+
+        CONSOLE.print(gLatencyTracer.GetName(output));
+        CONSOLE.print(",");
+        CONSOLE.print(gLatencyTracer.GetNbSamples(output));
+        CONSOLE.print(",");
+        CONSOLE.print(gLatencyTracer.GetPercentile_us(output, 50));
+        CONSOLE.print(",");
+        CONSOLE.print(gLatencyTracer.GetPercentile_us(output, 99));
+        CONSOLE.print(",");
+        CONSOLE.println(gLatencyTracer.GetMax_us(output));
+    }
+
+    CONSOLE.println("");
+    CONSOLE.print("bucket_us");
+    for (int i = 0; i < LATENCY_NB_OUTPUTS; i++)
+    {
+        CONSOLE.print(",");
+        CONSOLE.print(gLatencyTracer.GetName((LatencyOutput_t)i));
+    }
+    CONSOLE.println("");
+    for (int bucket = 0; bucket < LATENCY_NB_BUCKETS; bucket++)
+    {
+        CONSOLE.print(LatencyTracer::GetBucketStart_us(bucket));
+        for (int i = 0; i < LATENCY_NB_OUTPUTS; i++)
+        {
+            CONSOLE.print(",");
+            CONSOLE.print(gLatencyTracer.GetBucketCount((LatencyOutput_t)i, bucket));
+        }
+        CONSOLE.println("");
+    }
+}
@@ -34,9 +34,13 @@
 #include "MenuAttachNetwork.h"
 #include "MenuCalibrateCompass.h"
 #include "MenuCalibrateXtal.h"
+#include "MenuConfigureLinks.h"
 #include "MenuConvertToNmea.h"
+#include "MenuLatencyStatistics.h"
+#include "MenuNetworkCensus.h"
 #include "MenuScanMicronetTraffic.h"
 #include "MenuScanNetworks.h"
+#include "MenuSimulateNetwork.h"
 #include "MenuTestRfQuality.h"
 
 #include <Arduino.h>
@@ -66,6 +70,12 @@ MenuEntry_t MenuManager::menu[] = {{"MicronetToNMEA", nullptr},
                                    {"Calibrate RF XTAL", MenuCalibrateXtal},
                                    {"Calibrate compass", MenuCalibrateCompass},
                                    {"Test RF quality", MenuTestRfQuality},
+                                   {"Show background Micronet network census", MenuNetworkCensus},
+                                   {"Configure data links", MenuConfigureLinks},
+                                   {"Show data latency statistics", MenuLatencyStatistics},
+#if (NETWORK_SIMULATOR == 1)
+                                   {"Simulate Micronet networks", MenuSimulateNetwork},
+#endif
                                    {nullptr, nullptr}};
 
 /***************************************************************************/
@@ -86,21 +96,22 @@ MenuManager::~MenuManager()
 
 void MenuManager::PushChar(char c)
 {
-    if ((c > 0x30) && (c <= 0x39))
+    int entry = KeyEntry(c);
+
+    if (entry > 0)
     {
-        int entry = c - 0x30;
         if (entry < menuLength)
         {
             if (menu[entry].entryCallback != nullptr)
             {
-                CONSOLE.println(entry);
+                CONSOLE.println(c);
                 CONSOLE.println("");
                 menu[entry].entryCallback();
                 PrintPrompt();
             }
         }
     }
-    else if (c == 0x30)
+    else if (entry == 0)
     {
         CONSOLE.println("0");
         PrintMenu();
@@ -122,7 +133,7 @@ void MenuManager::PrintMenu()
     CONSOLE.println("0 - Print this menu");
     for (int i = 1; i < menuLength; i++)
     {
-        CONSOLE.print(i);
+        CONSOLE.print(EntryKey(i));
         CONSOLE.print(" - ");
         CONSOLE.println(menu[i].description);
     }
@@ -149,3 +160,24 @@ void MenuManager::PrintPrompt()
     CONSOLE.println("");
     CONSOLE.print("Choice : ");
 }
+
+// Entries are selected with keys 0 to 9, then a to z
+char MenuManager::EntryKey(int entry)
+{
+    return (entry < 10) ? ('0' + entry) : ('a' + entry - 10);
+}
+
+// Returns the entry selected by a key, -1 if the key doesn't select any entry
+int MenuManager::KeyEntry(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    else if ((c >= 'a') && (c <= 'z'))
+    {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
@@ -68,6 +68,8 @@ class MenuManager
     int                menuLength;
 
     void PrintPrompt();
+    char EntryKey(int entry);
+    int  KeyEntry(char c);
 };
 
 #endif /* MENUMANAGER_H_ */
@@ -0,0 +1,130 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Decode data from Micronet devices send it on an NMEA network  *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <Arduino.h>
+
+#include "BoardConfig.h"
+#include "Configuration.h"
+#include "Globals.h"
+#include "NetworkCensus.h"
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+static void PrintRssi(int16_t rssiMin, int16_t rssiMax, int32_t rssiAvg_q4);
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+// Print the census of Micronet networks and devices heard in background since power-up. Contrary to MenuScanNetworks, this
+// menu does not need to listen to the network : the census is updated by RfDriver ISR for each received message.
+void MenuNetworkCensus()
+{
+    CensusNetwork_t networkList[CENSUS_MAX_NETWORKS];
+    CensusDevice_t  deviceList[CENSUS_MAX_DEVICES];
+    int             nbNetworks;
+    uint32_t        now = millis();
+
+    nbNetworks = gNetworkCensus.GetNetworks(networkList, CENSUS_MAX_NETWORKS);
+
+    if (nbNetworks == 0)
+    {
+        CONSOLE.println("/!\\ No Micronet network heard since power-up /!\\");
+        CONSOLE.println("Check that your Micronet network is powered on.");
+        return;
+    }
+
+    CONSOLE.println("Micronet networks heard since power-up :");
+    for (int i = 0; i < nbNetworks; i++)
+    {
+        CensusNetwork_t *network = &networkList[i];
+
+        CONSOLE.println("");
+        CONSOLE.print("Network ");
+        CONSOLE.print(network->networkId, HEX);
+        if ((gConfiguration.networkId != 0) && (network->networkId == gConfiguration.networkId))
+        {
+            CONSOLE.print(" (attached)");
+        }
+        CONSOLE.print(" - ");
+        CONSOLE.print(network->nbFrames);
+        CONSOLE.print(" frames, last ");
+        CONSOLE.print((now - network->lastSeen_ms) / 1000);
+        CONSOLE.print("s ago, ");
+        PrintRssi(network->rssiMin, network->rssiMax, network->rssiAvg_q4);
+        CONSOLE.println("");
+        if (network->masterDeviceId != 0)
+        {
+            CONSOLE.print("  Master ");
+            CONSOLE.println(network->masterDeviceId, HEX);
+        }
+
+        int nbDevices = gNetworkCensus.GetDevices(network->networkId, deviceList, CENSUS_MAX_DEVICES);
+        for (int j = 0; j < nbDevices; j++)
+        {
+            CensusDevice_t *device = &deviceList[j];
+
+            CONSOLE.print("  Device ");
+            CONSOLE.print(device->deviceId, HEX);
+            CONSOLE.print(" - ");
+            CONSOLE.print(device->nbFrames);
+            CONSOLE.print(" frames, last ");
+            CONSOLE.print((now - device->lastSeen_ms) / 1000);
+            CONSOLE.print("s ago, ");
+            PrintRssi(device->rssiMin, device->rssiMax, device->rssiAvg_q4);
+            CONSOLE.println("");
+        }
+    }
+}
+
+static void PrintRssi(int16_t rssiMin, int16_t rssiMax, int32_t rssiAvg_q4)
+{
+    CONSOLE.print("RSSI ");
+    CONSOLE.print(rssiAvg_q4 / 16);
+    CONSOLE.print("dBm (");
+    CONSOLE.print(rssiMin);
+    CONSOLE.print("/");
+    CONSOLE.print(rssiMax);
+    CONSOLE.print(")");
+}
@@ -106,7 +106,7 @@ void MenuScanNetworks()
                         // New network to be inserted in the list : shift the list down
                         if (rssi > rssiArray[i])
                         {
-                            for (int j = (MAX_SCANNED_NETWORKS - 1); j > i; j++)
+                            for (int j = (MAX_SCANNED_NETWORKS - 1); j > i; j--)
                             {
                                 nidArray[j]  = nidArray[j - 1];
                                 rssiArray[j] = rssiArray[j - 1];
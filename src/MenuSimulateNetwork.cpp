@@ -0,0 +1,233 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Simulation of Micronet networks of growing size               *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <Arduino.h>
+
+#include "BoardConfig.h"
+#include "MenuSimulateNetwork.h"
+#include "NetworkSimulator.h"
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define SIMULATION_NB_CYCLES        300
+#define SIMULATION_GNSS_PERIOD_US   100000
+#define SIMULATION_PARAMETER_PERIOD 10
+#define SIMULATION_SEED             0x2f6b8a13
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+static void PrintRatio(uint32_t value, uint32_t total);
+static void PrintPercent(uint64_t value, uint64_t total);
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+// Simulate our device in networks from zero to the maximum number of other devices, then print how well it keeps its slots
+// Each network is simulated with and without RX gating to show the radio time it saves and the frames it costs.
+// Results are also printed as CSV so that they can be compared between firmware versions.
+void MenuSimulateNetwork()
+{
+    NetworkSimulator simulator;
+    SimConfig_t      config;
+    SimResult_t      results[SIM_MAX_DEVICES + 1];
+    SimResult_t      ungatedResults[SIM_MAX_DEVICES + 1];
+    uint32_t         start_ms = millis();
+
+    config.nbCycles        = SIMULATION_NB_CYCLES;
+    config.gnssPeriod_us   = SIMULATION_GNSS_PERIOD_US;
+    config.parameterPeriod = SIMULATION_PARAMETER_PERIOD;
+    config.lateEncoding    = true;
+
+    CONSOLE.print("Simulating ");
+    CONSOLE.print(SIMULATION_NB_CYCLES);
+    CONSOLE.print(" network cycles with 0 to ");
+    CONSOLE.print(SIM_MAX_DEVICES);
+    CONSOLE.println(" hull, wind and display devices besides master and our device");
+    CONSOLE.print("A MASTER_REQUEST can't list more than ");
+    CONSOLE.print(MICRONET_MAX_DEVICES_PER_REQUEST);
+    CONSOLE.print(" devices in ");
+    CONSOLE.print(MICRONET_MAX_MESSAGE_LENGTH);
+    CONSOLE.println(" bytes, master and our virtual slaves included");
+    CONSOLE.println("");
+
+    for (uint32_t nbDevices = 0; nbDevices <= SIM_MAX_DEVICES; nbDevices++)
+    {
+        SimResult_t *result = &results[nbDevices];
+
+        config.nbDevices = nbDevices;
+        config.seed      = SIMULATION_SEED + nbDevices;
+        config.rxGating  = false;
+        simulator.Run(config, &ungatedResults[nbDevices]);
+        config.rxGating = true;
+        simulator.Run(config, result);
+
+        CONSOLE.print(nbDevices);
+        if (result->joinCycle != 0)
+        {
+            CONSOLE.print(" devices : joined at cycle ");
+            CONSOLE.print(result->joinCycle);
+        }
+        else
+        {
+            CONSOLE.print(" devices : never joined");
+        }
+        CONSOLE.print(", slot hits ");
+        PrintRatio(result->nbSlotHits, result->nbDataMessages);
+        CONSOLE.print(", dropped ");
+        CONSOLE.print(result->nbDropped);
+        CONSOLE.print(", collisions ");
+        CONSOLE.print(result->nbCollisions);
+        CONSOLE.print(", async collisions ");
+        PrintRatio(result->nbAsyncCollisions, result->nbAsyncRequests);
+        CONSOLE.print(", acks ");
+        PrintRatio(result->nbAcksSent, result->nbAcksExpected);
+        CONSOLE.print(", airtime ");
+        PrintPercent(result->slaveAirtime_us, (uint64_t)result->nbCycles * 1000000);
+        CONSOLE.print(" (network ");
+        PrintPercent(result->networkAirtime_us, (uint64_t)result->nbCycles * 1000000);
+        CONSOLE.print(")");
+        CONSOLE.print(", position age ");
+        CONSOLE.print((result->nbAgeSamples > 0) ? (uint32_t)(result->totalAge_us / result->nbAgeSamples / 1000) : 0);
+        CONSOLE.print("ms (max ");
+        CONSOLE.print(result->maxAge_us / 1000);
+        CONSOLE.println("ms)");
+    }
+
+    CONSOLE.println("");
+    CONSOLE.println("RX gating (without -> with) :");
+    for (uint32_t nbDevices = 0; nbDevices <= SIM_MAX_DEVICES; nbDevices++)
+    {
+        SimResult_t *result        = &results[nbDevices];
+        SimResult_t *ungatedResult = &ungatedResults[nbDevices];
+        uint64_t     duration_us   = (uint64_t)result->nbCycles * 1000000;
+
+        CONSOLE.print(nbDevices);
+        CONSOLE.print(" devices : radio on ");
+        PrintPercent(ungatedResult->radioOn_us, duration_us);
+        CONSOLE.print(" -> ");
+        PrintPercent(result->radioOn_us, duration_us);
+        CONSOLE.print(", useful frames heard ");
+        PrintPercent(ungatedResult->nbUsefulHeard, ungatedResult->nbUsefulFrames);
+        CONSOLE.print(" -> ");
+        PrintRatio(result->nbUsefulHeard, result->nbUsefulFrames);
+        CONSOLE.print(", all frames heard ");
+        PrintPercent(ungatedResult->nbOtherHeard, ungatedResult->nbOtherFrames);
+        CONSOLE.print(" -> ");
+        PrintRatio(result->nbOtherHeard, result->nbOtherFrames);
+        CONSOLE.println("");
+    }
+
+    uint32_t duration_ms = millis() - start_ms;
+    CONSOLE.println("");
+    CONSOLE.print(2 * (SIM_MAX_DEVICES + 1) * SIMULATION_NB_CYCLES);
+    CONSOLE.print("s of network time simulated in ");
+    CONSOLE.print(duration_ms);
+    CONSOLE.println("ms");
+    CONSOLE.println("");
+
+    CONSOLE.println("devices,cycles,join_cycle,data_messages,slot_hits,dropped,collisions,async_requests,async_collisions,acks_expected,"
+                    "acks_sent,slave_airtime_us,network_airtime_us,age_samples,avg_age_us,max_age_us,radio_on_us,ungated_radio_on_us,"
+                    "useful_frames,useful_heard,ungated_useful_heard,other_frames,other_heard,ungated_other_heard");
+    for (uint32_t nbDevices = 0; nbDevices <= SIM_MAX_DEVICES; nbDevices++)
+    {
+        SimResult_t *result        = &results[nbDevices];
+        SimResult_t *ungatedResult = &ungatedResults[nbDevices];
+
+        CONSOLE.print(nbDevices);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbCycles);
+        CONSOLE.print(",");
+        CONSOLE.print(result->joinCycle);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbDataMessages);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbSlotHits);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbDropped);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbCollisions);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbAsyncRequests);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbAsyncCollisions);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbAcksExpected);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbAcksSent);
+        CONSOLE.print(",");
+        CONSOLE.print((uint32_t)result->slaveAirtime_us);
+        CONSOLE.print(",");
+        CONSOLE.print((uint32_t)result->networkAirtime_us);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbAgeSamples);
+        CONSOLE.print(",");
+        CONSOLE.print((result->nbAgeSamples > 0) ? (uint32_t)(result->totalAge_us / result->nbAgeSamples) : 0);
+        CONSOLE.print(",");
+        CONSOLE.print(result->maxAge_us);
+        CONSOLE.print(",");
+        CONSOLE.print((uint32_t)result->radioOn_us);
+        CONSOLE.print(",");
+        CONSOLE.print((uint32_t)ungatedResult->radioOn_us);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbUsefulFrames);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbUsefulHeard);
+        CONSOLE.print(",");
+        CONSOLE.print(ungatedResult->nbUsefulHeard);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbOtherFrames);
+        CONSOLE.print(",");
+        CONSOLE.print(result->nbOtherHeard);
+        CONSOLE.print(",");
+        CONSOLE.println(ungatedResult->nbOtherHeard);
+    }
+}
+
+// Print "value/total (percent%)"
+static void PrintRatio(uint32_t value, uint32_t total)
+{
+    CONSOLE.print(value);
+    CONSOLE.print("/");
+    CONSOLE.print(total);
+    CONSOLE.print(" (");
+    PrintPercent(value, total);
+    CONSOLE.print(")");
+}
+
+static void PrintPercent(uint64_t value, uint64_t total)
+{
+    CONSOLE.print((total > 0) ? (100.0f * value) / total : 0.0f, 1);
+    CONSOLE.print("%");
+}
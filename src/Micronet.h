@@ -138,9 +138,13 @@
 /*                                Types                                    */
 /***************************************************************************/
 
-#define MICRONET_ACTION_RF_NO_ACTION    0
-#define MICRONET_ACTION_RF_LOW_POWER    1
-#define MICRONET_ACTION_RF_ACTIVE_POWER 2
+#define MICRONET_ACTION_RF_NO_ACTION     0
+#define MICRONET_ACTION_RF_LOW_POWER     1
+#define MICRONET_ACTION_RF_ACTIVE_POWER  2
+#define MICRONET_ACTION_RF_LATE_ENCODING 3
+
+// Delay before the start of a late encoded transmission at which its encoder is called
+#define LATE_ENCODING_LEAD_US 500
 
 typedef struct
 {
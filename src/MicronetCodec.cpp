@@ -29,7 +29,6 @@
 /***************************************************************************/
 
 #include "MicronetCodec.h"
-#include "Globals.h"
 #include "NavigationData.h"
 #include "Version.h"
 #include <Arduino.h>
@@ -60,6 +59,7 @@
 
 MicronetCodec::MicronetCodec()
 {
+    navData.Subscribe("Wind engine", WIND_ENGINE_INPUTS, WindInputsChanged, this);
 }
 
 MicronetCodec::~MicronetCodec()
@@ -136,6 +136,9 @@ bool MicronetCodec::DecodeMessage(MicronetMessage_t *message)
 {
     bool ackRequested = false;
 
+    // Decoded values originate from the start of the RF frame
+    navData.SetOrigin(message->startTime_us);
+
     switch (message->data[MICRONET_MI_OFFSET])
     {
     case MICRONET_MESSAGE_ID_SEND_DATA:
@@ -147,6 +150,8 @@ bool MicronetCodec::DecodeMessage(MicronetMessage_t *message)
         break;
     }
 
+    navData.ResetOrigin();
+
     return ackRequested;
 }
 
@@ -161,7 +166,6 @@ void MicronetCodec::DecodeSendDataMessage(MicronetMessage_t *message)
             break;
         }
     }
-    CalculateTrueWind();
 }
 
 void MicronetCodec::DecodeSetParameterMessage(MicronetMessage_t *message)
@@ -322,9 +326,7 @@ void MicronetCodec::UpdateMicronetData(uint8_t fieldId, int8_t value)
     switch (fieldId)
     {
     case MICRONET_FIELD_ID_STP:
-        navData.stp_degc.value     = (((float)value) / 2.0f) + navData.waterTemperatureOffset_degc;
-        navData.stp_degc.valid     = true;
-        navData.stp_degc.timeStamp = millis();
+        navData.Set(NAV_ID_STP_DEGC, (((float)value) / 2.0f) + navData.waterTemperatureOffset_degc);
         break;
     }
 }
@@ -336,27 +338,21 @@ void MicronetCodec::UpdateMicronetData(uint8_t fieldId, int16_t value)
     switch (fieldId)
     {
     case MICRONET_FIELD_ID_SPD:
-        navData.spd_kt.value     = (((float)value) / 100.0f) * navData.waterSpeedFactor_per;
-        navData.spd_kt.valid     = true;
-        navData.spd_kt.timeStamp = millis();
+        navData.Set(NAV_ID_SPD_KT, (((float)value) / 100.0f) * navData.waterSpeedFactor_per);
 
         break;
     case MICRONET_FIELD_ID_DPT:
         if (value < MAXIMUM_VALID_DEPTH_FT * 10)
         {
-            navData.dpt_m.value     = (((float)value) * 0.3048f / 10.0f) + navData.depthOffset_m;
-            navData.dpt_m.valid     = true;
-            navData.dpt_m.timeStamp = millis();
+            navData.Set(NAV_ID_DPT_M, (((float)value) * 0.3048f / 10.0f) + navData.depthOffset_m);
         }
         else
         {
-            navData.dpt_m.valid = false;
+            navData.Invalidate(NAV_ID_DPT_M);
         }
         break;
     case MICRONET_FIELD_ID_AWS:
-        navData.aws_kt.value     = (((float)value) / 10.0f) * navData.windSpeedFactor_per;
-        navData.aws_kt.valid     = true;
-        navData.aws_kt.timeStamp = millis();
+        navData.Set(NAV_ID_AWS_KT, (((float)value) / 10.0f) * navData.windSpeedFactor_per);
         break;
     case MICRONET_FIELD_ID_AWA:
         newValue = ((float)value) + navData.windDirectionOffset_deg;
@@ -364,9 +360,7 @@ void MicronetCodec::UpdateMicronetData(uint8_t fieldId, int16_t value)
             newValue -= 360.0f;
         if (newValue < -180.0f)
             newValue += 360.0f;
-        navData.awa_deg.value     = newValue;
-        navData.awa_deg.valid     = true;
-        navData.awa_deg.timeStamp = millis();
+        navData.Set(NAV_ID_AWA_DEG, newValue);
         break;
     case MICRONET_FIELD_ID_HDG:
         newValue = ((float)value) + navData.headingOffset_deg;
@@ -378,14 +372,10 @@ void MicronetCodec::UpdateMicronetData(uint8_t fieldId, int16_t value)
         {
             newValue -= 360.0f;
         }
-        navData.magHdg_deg.value     = newValue;
-        navData.magHdg_deg.valid     = true;
-        navData.magHdg_deg.timeStamp = millis();
+        navData.Set(NAV_ID_MAG_HDG_DEG, newValue);
         break;
     case MICRONET_FIELD_ID_VCC:
-        navData.vcc_v.value     = ((float)value) / 10.0f;
-        navData.vcc_v.valid     = true;
-        navData.vcc_v.timeStamp = millis();
+        navData.Set(NAV_ID_VCC_V, ((float)value) / 10.0f);
         break;
     }
 }
@@ -395,36 +385,18 @@ void MicronetCodec::UpdateMicronetData(uint8_t fieldId, int32_t value1, int32_t
     switch (fieldId)
     {
     case MICRONET_FIELD_ID_LOG:
-        navData.trip_nm.value     = ((float)value1) / 100.0f;
-        navData.trip_nm.valid     = true;
-        navData.trip_nm.timeStamp = millis();
-        navData.log_nm.value      = ((float)value2) / 10.0f;
-        navData.log_nm.valid      = true;
-        navData.log_nm.timeStamp  = millis();
+        navData.Set(NAV_ID_TRIP_NM, ((float)value1) / 100.0f);
+        navData.Set(NAV_ID_LOG_NM, ((float)value2) / 10.0f);
         break;
     }
 }
 
-void MicronetCodec::CalculateTrueWind()
+// Navigation data subscription callback : update wind values derived from changed inputs
+void MicronetCodec::WindInputsChanged(void *context, uint32_t changedMask)
 {
-    if ((navData.awa_deg.valid) && (navData.aws_kt.valid) && (navData.spd_kt.valid))
-    {
-        if ((!navData.twa_deg.valid) || (!navData.tws_kt.valid) || (navData.awa_deg.timeStamp > navData.twa_deg.timeStamp) ||
-            (navData.aws_kt.timeStamp > navData.tws_kt.timeStamp) || (navData.spd_kt.timeStamp > navData.twa_deg.timeStamp))
-        {
-            float twLon, twLat;
-            twLon = (navData.aws_kt.value * cosf(navData.awa_deg.value * M_PI / 180.0f)) - navData.spd_kt.value;
-            twLat = (navData.aws_kt.value * sinf(navData.awa_deg.value * M_PI / 180.0f));
+    MicronetCodec *codec = static_cast<MicronetCodec *>(context);
 
-            navData.tws_kt.value     = sqrtf(twLon * twLon + twLat * twLat);
-            navData.tws_kt.valid     = true;
-            navData.tws_kt.timeStamp = millis();
-
-            navData.twa_deg.value     = atan2f(twLat, twLon) * 180.0f / M_PI;
-            navData.twa_deg.valid     = true;
-            navData.twa_deg.timeStamp = millis();
-        }
-    }
+    codec->windEngine.Update(&codec->navData, changedMask);
 }
 
 uint8_t MicronetCodec::GetDataMessageLength(uint32_t dataFields)
@@ -494,7 +466,8 @@ uint8_t MicronetCodec::GetDataMessageLength(uint32_t dataFields)
 uint8_t MicronetCodec::EncodeDataMessage(MicronetMessage_t *message, uint8_t signalStrength, uint32_t networkId, uint32_t deviceId,
                                          uint32_t dataFields)
 {
-    int offset = 0;
+    int                offset = 0;
+    NavGroupSnapshot_t snapshot;
 
     // Network ID
     message->data[offset++] = (networkId >> 24) & 0xff;
@@ -525,48 +498,60 @@ uint8_t MicronetCodec::EncodeDataMessage(MicronetMessage_t *message, uint8_t sig
         offset +=
             Add24bitField(message->data + offset, MICRONET_FIELD_ID_DATE, (navData.date.day << 16) + (navData.date.month << 8) + navData.date.year);
     }
-    if ((dataFields & DATA_FIELD_SOGCOG) && ((navData.sog_kt.valid) || (navData.cog_deg.valid)))
+    // Values decoded together are read from consistent snapshots : this message can be encoded from RF timer ISR
+    if (dataFields & DATA_FIELD_SOGCOG)
     {
-        offset += AddDual16bitField(message->data + offset, MICRONET_FIELD_ID_SOGCOG, navData.sog_kt.value * 10.0f, navData.cog_deg.value);
+        navData.GetSnapshot(NAV_GROUP_SOGCOG, &snapshot);
+        if (snapshot.validMask != 0)
+        {
+            offset += AddDual16bitField(message->data + offset, MICRONET_FIELD_ID_SOGCOG, snapshot.value[0] * 10.0f, snapshot.value[1]);
+        }
     }
-    if ((dataFields & DATA_FIELD_POSITION) && ((navData.latitude_deg.valid) || (navData.longitude_deg.valid)))
+    if (dataFields & DATA_FIELD_POSITION)
     {
-        offset += AddPositionField(message->data + offset, navData.latitude_deg.value, navData.longitude_deg.value);
+        navData.GetSnapshot(NAV_GROUP_POSITION, &snapshot);
+        if (snapshot.validMask != 0)
+        {
+            offset += AddPositionField(message->data + offset, snapshot.value[0], snapshot.value[1]);
+        }
     }
-    if ((dataFields & DATA_FIELD_XTE) && (navData.xte_nm.valid))
+    if ((dataFields & DATA_FIELD_XTE) && navData.IsValid(NAV_ID_XTE_NM))
     {
-        offset += Add16bitField(message->data + offset, MICRONET_FIELD_ID_XTE, (short)(navData.xte_nm.value * 100));
+        offset += Add16bitField(message->data + offset, MICRONET_FIELD_ID_XTE, (short)(navData.Get(NAV_ID_XTE_NM) * 100));
     }
-    if ((dataFields & DATA_FIELD_DTW) && (navData.dtw_nm.valid))
+    if ((dataFields & DATA_FIELD_DTW) && navData.IsValid(NAV_ID_DTW_NM))
     {
-        offset += Add32bitField(message->data + offset, MICRONET_FIELD_ID_DTW, (short)(navData.dtw_nm.value * 100));
+        offset += Add32bitField(message->data + offset, MICRONET_FIELD_ID_DTW, (short)(navData.Get(NAV_ID_DTW_NM) * 100));
     }
-    if ((dataFields & DATA_FIELD_BTW) && ((navData.btw_deg.valid) || (navData.waypoint.valid)))
+    if ((dataFields & DATA_FIELD_BTW) && (navData.IsValid(NAV_ID_BTW_DEG) || (navData.waypoint.valid)))
     {
-        offset += Add16bitAndSix8bitField(message->data + offset, MICRONET_FIELD_ID_BTW, (short)navData.btw_deg.value, navData.waypoint.name,
+        offset += Add16bitAndSix8bitField(message->data + offset, MICRONET_FIELD_ID_BTW, (short)navData.Get(NAV_ID_BTW_DEG), navData.waypoint.name,
                                           navData.waypoint.nameLength);
     }
-    if ((dataFields & DATA_FIELD_VMGWP) && (navData.vmgwp_kt.valid))
+    if ((dataFields & DATA_FIELD_VMGWP) && navData.IsValid(NAV_ID_VMGWP_KT))
     {
-        offset += Add16bitField(message->data + offset, MICRONET_FIELD_ID_VMGWP, (short)(navData.vmgwp_kt.value * 100));
+        offset += Add16bitField(message->data + offset, MICRONET_FIELD_ID_VMGWP, (short)(navData.Get(NAV_ID_VMGWP_KT) * 100));
     }
-    if ((dataFields & DATA_FIELD_HDG) && (navData.magHdg_deg.valid))
+    if ((dataFields & DATA_FIELD_HDG) && navData.IsValid(NAV_ID_MAG_HDG_DEG))
     {
-        int16_t headingValue = navData.magHdg_deg.value - navData.headingOffset_deg;
+        int16_t headingValue = navData.Get(NAV_ID_MAG_HDG_DEG) - navData.headingOffset_deg;
         while (headingValue < 0)
             headingValue += 360;
         while (headingValue >= 360)
             headingValue -= 360;
         offset += Add16bitField(message->data + offset, MICRONET_FIELD_ID_HDG, headingValue);
     }
-    if ((dataFields & DATA_FIELD_AWS) && ((navData.aws_kt.valid)))
+    if (dataFields & (DATA_FIELD_AWS | DATA_FIELD_AWA))
     {
-        offset +=
-            Add16bitField(message->data + offset, MICRONET_FIELD_ID_AWS, (uint32_t)(navData.aws_kt.value * 10.0f / navData.windSpeedFactor_per));
+        navData.GetSnapshot(NAV_GROUP_APPARENT_WIND, &snapshot);
+    }
+    if ((dataFields & DATA_FIELD_AWS) && (snapshot.validMask & NAV_BIT(NAV_ID_AWS_KT)))
+    {
+        offset += Add16bitField(message->data + offset, MICRONET_FIELD_ID_AWS, (uint32_t)(snapshot.value[1] * 10.0f / navData.windSpeedFactor_per));
     }
-    if ((dataFields & DATA_FIELD_AWA) && ((navData.awa_deg.valid)))
+    if ((dataFields & DATA_FIELD_AWA) && (snapshot.validMask & NAV_BIT(NAV_ID_AWA_DEG)))
     {
-        int16_t awaValue = navData.awa_deg.value - navData.windDirectionOffset_deg;
+        int16_t awaValue = snapshot.value[0] - navData.windDirectionOffset_deg;
         if (awaValue > 180.0f)
             awaValue -= 360.0f;
         if (awaValue < -180.0f)
@@ -578,13 +563,14 @@ uint8_t MicronetCodec::EncodeDataMessage(MicronetMessage_t *message, uint8_t sig
         offset += AddQuad8bitField(message->data + offset, MICRONET_FIELD_ID_NODE_INFO, MNET2NMEA_SW_MINOR_VERSION, MNET2NMEA_SW_MAJOR_VERSION, 0x33,
                                    signalStrength);
     }
-    if ((dataFields & DATA_FIELD_DPT) && ((navData.dpt_m.valid)))
+    if ((dataFields & DATA_FIELD_DPT) && navData.IsValid(NAV_ID_DPT_M))
     {
-        offset += Add16bitField(message->data + offset, MICRONET_FIELD_ID_DPT, (navData.dpt_m.value - navData.depthOffset_m) * 10.0f / 0.3048f);
+        offset += Add16bitField(message->data + offset, MICRONET_FIELD_ID_DPT, (navData.Get(NAV_ID_DPT_M) - navData.depthOffset_m) * 10.0f / 0.3048f);
     }
-    if ((dataFields & DATA_FIELD_SPD) && ((navData.spd_kt.valid)))
+    if ((dataFields & DATA_FIELD_SPD) && navData.IsValid(NAV_ID_SPD_KT))
     {
-        offset += Add16bitField(message->data + offset, MICRONET_FIELD_ID_SPD, (short)(navData.spd_kt.value * 100.0f / navData.waterSpeedFactor_per));
+        offset +=
+            Add16bitField(message->data + offset, MICRONET_FIELD_ID_SPD, (short)(navData.Get(NAV_ID_SPD_KT) * 100.0f / navData.waterSpeedFactor_per));
     }
 
     message->len = offset;
@@ -790,6 +776,118 @@ uint8_t MicronetCodec::EncodePingMessage(MicronetMessage_t *message, uint8_t sig
     return offset - MICRONET_PAYLOAD_OFFSET;
 }
 
+// Encode the MASTER_REQUEST of a network whose master is deviceId. The master is listed first, followed by each device with the
+// payload length of its sync slot (0 for no slot). Returns 0 if the list does not fit in a message.
+uint8_t MicronetCodec::EncodeMasterRequestMessage(MicronetMessage_t *message, uint8_t signalStrength, uint32_t networkId, uint32_t deviceId,
+                                                  uint32_t nbDevices, uint32_t const *deviceIdList, uint8_t const *payloadBytesList)
+{
+    int offset = 0;
+
+    if (nbDevices > MICRONET_MAX_DEVICES_PER_REQUEST - 1)
+    {
+        return 0;
+    }
+
+    // Network ID
+    message->data[offset++] = (networkId >> 24) & 0xff;
+    message->data[offset++] = (networkId >> 16) & 0xff;
+    message->data[offset++] = (networkId >> 8) & 0xff;
+    message->data[offset++] = networkId & 0xff;
+    // Device ID
+    message->data[offset++] = (deviceId >> 24) & 0xff;
+    message->data[offset++] = (deviceId >> 16) & 0xff;
+    message->data[offset++] = (deviceId >> 8) & 0xff;
+    message->data[offset++] = deviceId & 0xff;
+    // Message info
+    message->data[offset++] = MICRONET_MESSAGE_ID_MASTER_REQUEST;
+    message->data[offset++] = 0x09;
+    message->data[offset++] = signalStrength;
+    // Header CRC
+    message->data[offset++] = 0x00;
+    // Message size
+    message->data[offset++] = 0x00;
+    message->data[offset++] = 0x00;
+    // Master device
+    message->data[offset++] = (deviceId >> 24) & 0xff;
+    message->data[offset++] = (deviceId >> 16) & 0xff;
+    message->data[offset++] = (deviceId >> 8) & 0xff;
+    message->data[offset++] = deviceId & 0xff;
+    message->data[offset++] = 0x00;
+    // Slave devices
+    for (uint32_t i = 0; i < nbDevices; i++)
+    {
+        message->data[offset++] = (deviceIdList[i] >> 24) & 0xff;
+        message->data[offset++] = (deviceIdList[i] >> 16) & 0xff;
+        message->data[offset++] = (deviceIdList[i] >> 8) & 0xff;
+        message->data[offset++] = deviceIdList[i] & 0xff;
+        message->data[offset++] = payloadBytesList[i];
+    }
+    message->data[offset++] = 0x00;
+    message->data[offset++] = 0x00;
+
+    uint8_t crc = 0;
+    for (int i = MICRONET_PAYLOAD_OFFSET; i < offset; i++)
+    {
+        crc += message->data[i];
+    }
+    message->data[offset++] = crc;
+
+    message->len = offset;
+
+    WriteHeaderLengthAndCrc(message);
+
+    return offset - MICRONET_PAYLOAD_OFFSET;
+}
+
+// Encode a SET_PARAMETER message of page FF, with a parameter value of one or two bytes
+uint8_t MicronetCodec::EncodeSetParameterMessage(MicronetMessage_t *message, uint8_t signalStrength, uint32_t networkId, uint32_t deviceId,
+                                                 uint8_t parameterId, uint8_t valueSize, int16_t value)
+{
+    int offset = 0;
+
+    // Network ID
+    message->data[offset++] = (networkId >> 24) & 0xff;
+    message->data[offset++] = (networkId >> 16) & 0xff;
+    message->data[offset++] = (networkId >> 8) & 0xff;
+    message->data[offset++] = networkId & 0xff;
+    // Device ID
+    message->data[offset++] = (deviceId >> 24) & 0xff;
+    message->data[offset++] = (deviceId >> 16) & 0xff;
+    message->data[offset++] = (deviceId >> 8) & 0xff;
+    message->data[offset++] = deviceId & 0xff;
+    // Message info
+    message->data[offset++] = MICRONET_MESSAGE_ID_SET_PARAMETER;
+    message->data[offset++] = 0x09;
+    message->data[offset++] = signalStrength;
+    // Header CRC
+    message->data[offset++] = 0x00;
+    // Message size
+    message->data[offset++] = 0x00;
+    message->data[offset++] = 0x00;
+    // Parameter
+    message->data[offset++] = 0xff;
+    message->data[offset++] = parameterId;
+    message->data[offset++] = valueSize;
+    message->data[offset++] = value & 0xff;
+    if (valueSize > 1)
+    {
+        message->data[offset++] = (value >> 8) & 0xff;
+    }
+
+    uint8_t crc = 0;
+    for (int i = MICRONET_PAYLOAD_OFFSET; i < offset; i++)
+    {
+        crc += message->data[i];
+    }
+    message->data[offset++] = crc;
+
+    message->len = offset;
+
+    WriteHeaderLengthAndCrc(message);
+
+    return offset - MICRONET_PAYLOAD_OFFSET;
+}
+
 void MicronetCodec::WriteHeaderLengthAndCrc(MicronetMessage_t *message)
 {
     message->data[MICRONET_LEN_OFFSET_1] = message->len - 2;
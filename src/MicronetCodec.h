@@ -35,6 +35,7 @@
 
 #include "Micronet.h"
 #include "NavigationData.h"
+#include "WindEngine.h"
 
 /***************************************************************************/
 /*                              Constants                                  */
@@ -46,6 +47,8 @@
 #define DEVICE_TYPE_ANALOG_WIND_DISPLAY 0x83
 
 #define MAX_DEVICES_PER_NETWORK 32
+// A MASTER_REQUEST lists 5 bytes per device, master included : a network cycle can't hold more devices than fit in a message
+#define MICRONET_MAX_DEVICES_PER_REQUEST ((MICRONET_MAX_MESSAGE_LENGTH - MICRONET_PAYLOAD_OFFSET - 3) / 5)
 
 #define DATA_FIELD_TIME      0x00000001
 #define DATA_FIELD_DATE      0x00000002
@@ -129,9 +132,15 @@ class MicronetCodec
     uint8_t EncodeResetMessage(MicronetMessage_t *message, uint8_t signalStrength, uint32_t networkId, uint32_t deviceId);
     uint8_t EncodeAckParamMessage(MicronetMessage_t *message, uint8_t signalStrength, uint32_t networkId, uint32_t deviceId);
     uint8_t EncodePingMessage(MicronetMessage_t *message, uint8_t signalStrength, uint32_t networkId, uint32_t deviceId);
-    void    CalculateTrueWind();
+    uint8_t EncodeMasterRequestMessage(MicronetMessage_t *message, uint8_t signalStrength, uint32_t networkId, uint32_t deviceId, uint32_t nbDevices,
+                                       uint32_t const *deviceIdList, uint8_t const *payloadBytesList);
+    uint8_t EncodeSetParameterMessage(MicronetMessage_t *message, uint8_t signalStrength, uint32_t networkId, uint32_t deviceId, uint8_t parameterId,
+                                      uint8_t valueSize, int16_t value);
 
   private:
+    WindEngine windEngine;
+
+    static void WindInputsChanged(void *context, uint32_t changedMask);
     void    DecodeSendDataMessage(MicronetMessage_t *message);
     void    DecodeSetParameterMessage(MicronetMessage_t *message);
     void    DecodePageFF(MicronetMessage_t *message);
@@ -30,16 +30,42 @@
 
 #include "MicronetSlaveDevice.h"
 #include "BoardConfig.h"
-#include "Globals.h"
 
 /***************************************************************************/
 /*                              Constants                                  */
 /***************************************************************************/
 
+// Time needed by CC1101 to restart its XTAL and calibrate its PLL when leaving low power mode. With the default error bound of
+// the cycle prediction, the radio wakes up 1ms before the next cycle as long as the master period is not learned.
+#define RF_WAKE_UP_TIME_US 800
+// Processing time of a received MASTER_REQUEST, after which it is considered missed
+#define MISSED_CYCLE_MARGIN_US 500
+// Radio is woken up this time earlier than strictly needed before a window we listen to
+#define RX_GATING_MARGIN_US 200
+// Shortest power down worth the cost of waking the radio up again
+#define RX_GATING_MIN_SLEEP_US 1000
+// Power downs planned in one cycle, each one using two entries of RfDriver's transmit list
+#define RX_GATING_MAX_SLEEPS 4
+
 /***************************************************************************/
 /*                             Local types                                 */
 /***************************************************************************/
 
+// Time during which the radio can be powered down between two windows we listen to
+typedef struct
+{
+    uint32_t lowPower_us;
+    uint32_t activePower_us;
+} RxGap_t;
+
+// Navigation value carried by a data field, and output in which the latency of this field is accounted
+typedef struct
+{
+    uint32_t        field;
+    NavValueId_t    id;
+    LatencyOutput_t output;
+} FieldLatencyDesc_t;
+
 /***************************************************************************/
 /*                           Local prototypes                              */
 /***************************************************************************/
@@ -48,13 +74,38 @@
 /*                               Globals                                   */
 /***************************************************************************/
 
+static const FieldLatencyDesc_t fieldLatencyDesc[] = {
+    {DATA_FIELD_SOGCOG, NAV_ID_SOG_KT, LATENCY_MNET_SOGCOG},
+    {DATA_FIELD_POSITION, NAV_ID_LATITUDE_DEG, LATENCY_MNET_POSITION},
+    {DATA_FIELD_XTE, NAV_ID_XTE_NM, LATENCY_MNET_XTE},
+    {DATA_FIELD_DTW, NAV_ID_DTW_NM, LATENCY_MNET_DTW},
+    {DATA_FIELD_BTW, NAV_ID_BTW_DEG, LATENCY_MNET_BTW},
+    {DATA_FIELD_VMGWP, NAV_ID_VMGWP_KT, LATENCY_MNET_VMGWP},
+    {DATA_FIELD_HDG, NAV_ID_MAG_HDG_DEG, LATENCY_MNET_HDG},
+    {DATA_FIELD_AWS, NAV_ID_AWS_KT, LATENCY_MNET_AWS},
+    {DATA_FIELD_AWA, NAV_ID_AWA_DEG, LATENCY_MNET_AWA},
+    {DATA_FIELD_DPT, NAV_ID_DPT_M, LATENCY_MNET_DPT},
+    {DATA_FIELD_SPD, NAV_ID_SPD_KT, LATENCY_MNET_SPD},
+};
+
+#define NB_FIELD_LATENCY_DESC ((int)(sizeof(fieldLatencyDesc) / sizeof(fieldLatencyDesc[0])))
+
 /***************************************************************************/
 /*                              Functions                                  */
 /***************************************************************************/
 
-MicronetSlaveDevice::MicronetSlaveDevice(MicronetCodec *micronetCodec) : deviceId(0), networkId(0), dataFields(0), latestSignalStrength(0)
+MicronetSlaveDevice::MicronetSlaveDevice(MicronetCodec *micronetCodec)
+    : deviceId(0), networkId(0), dataFields(0), latestSignalStrength(0), networkMapValid(false), nbSuccessiveMissed(0),
+      missedCycleDeadline_us(0), maxPredictedCycles(0), maxPredictionError_us(0), rxGating(false),
+      latencyTracer(nullptr)
 {
     memset(&networkMap, 0, sizeof(networkMap));
+    memset(&positionAge, 0, sizeof(positionAge));
+    memset(&sogCogAge, 0, sizeof(sogCogAge));
+    memset(&positionRequestAge, 0, sizeof(positionRequestAge));
+    memset(&sogCogRequestAge, 0, sizeof(sogCogRequestAge));
+    memset(syncSlotPayloadBytes, 0, sizeof(syncSlotPayloadBytes));
+    memset(&cycleCounters, 0, sizeof(cycleCounters));
     this->micronetCodec = micronetCodec;
 }
 
@@ -95,46 +146,15 @@ void MicronetSlaveDevice::ProcessMessage(MicronetMessage_t *message, MicronetMes
     {
         if (micronetCodec->GetMessageId(message) == MICRONET_MESSAGE_ID_MASTER_REQUEST)
         {
-            micronetCodec->GetNetworkMap(message, &networkMap);
-
-            // We schedule the low power mode of CC1101 just at the end of the network cycle
-            txMessage.action       = MICRONET_ACTION_RF_LOW_POWER;
-            txMessage.startTime_us = micronetCodec->GetEndOfNetwork(&networkMap);
-            txMessage.len          = 0;
-            messageFifo->Push(txMessage);
-
-            // We schedule exit of CC1101's low power mode 1ms before actual start of the next network cycle.
-            // It will let time for the PLL calibration loop to complete.
-            txMessage.action       = MICRONET_ACTION_RF_ACTIVE_POWER;
-            txMessage.startTime_us = micronetCodec->GetNextStartOfNetwork(&networkMap) - 1000;
-            txMessage.len          = 0;
-            messageFifo->Push(txMessage);
-
-            latestSignalStrength = micronetCodec->CalculateSignalStrength(message);
-
-            for (int i = 0; i < NUMBER_OF_VIRTUAL_SLAVES; i++)
+            if (micronetCodec->GetNetworkMap(message, &networkMap))
             {
-                txSlot = micronetCodec->GetSyncTransmissionSlot(&networkMap, deviceId + i);
-                if (txSlot.start_us != 0)
-                {
-                    uint32_t payloadLength =
-                        micronetCodec->EncodeDataMessage(&txMessage, latestSignalStrength, networkId, deviceId + i, splitDataFields[i]);
-                    if (txSlot.payloadBytes < payloadLength)
-                    {
-                        txSlot = micronetCodec->GetAsyncTransmissionSlot(&networkMap);
-                        micronetCodec->EncodeSlotUpdateMessage(&txMessage, latestSignalStrength, networkId, deviceId + i, payloadLength);
-                    }
-                }
-                else
-                {
-                    txSlot = micronetCodec->GetAsyncTransmissionSlot(&networkMap);
-                    micronetCodec->EncodeSlotRequestMessage(&txMessage, latestSignalStrength, networkId, deviceId + i,
-                                                            micronetCodec->GetDataMessageLength(splitDataFields[i]));
-                }
+                networkMapValid = true;
+                cycleEstimator.AddMasterRequest(micronetCodec->GetStartOfNetwork(&networkMap));
+                cycleCounters.nbConfirmed++;
+                nbSuccessiveMissed   = 0;
+                latestSignalStrength = micronetCodec->CalculateSignalStrength(message);
 
-                txMessage.action       = MICRONET_ACTION_RF_NO_ACTION;
-                txMessage.startTime_us = txSlot.start_us;
-                messageFifo->Push(txMessage);
+                PlanCycle(messageFifo);
             }
         }
         else
@@ -154,6 +174,364 @@ void MicronetSlaveDevice::ProcessMessage(MicronetMessage_t *message, MicronetMes
     }
 }
 
+// Returns the time after which the MASTER_REQUEST of the next cycle should have been received, false if no network map is known
+bool MicronetSlaveDevice::GetMissedCycleDeadline(uint32_t *deadline_us)
+{
+    *deadline_us = missedCycleDeadline_us;
+
+    return networkMapValid;
+}
+
+// To be called once the missed cycle deadline has passed. If the MASTER_REQUEST of the cycle has not been received, the last network
+// map is moved on the predicted timeline and our data messages are planned in their known sync slots, as long as the prediction stays
+// within the confidence limits.
+void MicronetSlaveDevice::ProcessMissedCycle(uint32_t now_us, MicronetMessageFifo *messageFifo)
+{
+    if ((!networkMapValid) || ((int32_t)(now_us - missedCycleDeadline_us) < 0))
+    {
+        return;
+    }
+
+    nbSuccessiveMissed++;
+    uint32_t start_us      = cycleEstimator.PredictStart_us(nbSuccessiveMissed);
+    uint32_t errorBound_us = cycleEstimator.PredictErrorBound_us(nbSuccessiveMissed);
+
+    if ((nbSuccessiveMissed > maxPredictedCycles) || (errorBound_us > maxPredictionError_us))
+    {
+        // The radio is left active so that the next MASTER_REQUEST is not missed
+        cycleCounters.nbUnpredicted++;
+        ArmMissedCycleDeadline();
+        return;
+    }
+
+    cycleCounters.nbPredicted++;
+    ShiftNetworkMap(start_us - networkMap.networkStart);
+    PlanCycle(messageFifo);
+}
+
+void MicronetSlaveDevice::SetPredictionLimits(uint32_t maxPredictedCycles, uint32_t maxPredictionError_us)
+{
+    this->maxPredictedCycles    = maxPredictedCycles;
+    this->maxPredictionError_us = maxPredictionError_us;
+}
+
+// Enable power down of the radio during the parts of the network cycle we don't need to listen to
+void MicronetSlaveDevice::SetRxGating(bool enable)
+{
+    rxGating = enable;
+}
+
+// Give the tracer recording the latency of the fields sent to Micronet, nullptr for none
+void MicronetSlaveDevice::SetLatencyTracer(LatencyTracer *latencyTracer)
+{
+    this->latencyTracer = latencyTracer;
+}
+
+// Returns true if the data sent by this device is used by ours. Displays don't send anything we use.
+bool MicronetSlaveDevice::IsListenedDevice(uint32_t deviceId)
+{
+    return ((deviceId >> 24) & 0x80) == 0;
+}
+
+// Plan the transmissions of the cycle described by the network map : radio power transitions, data messages in our sync slots
+// and slot requests or updates in the asynchronous window. On a predicted cycle, only sync slots are used.
+void MicronetSlaveDevice::PlanCycle(MicronetMessageFifo *messageFifo)
+{
+    TxSlotDesc_t      txSlot;
+    MicronetMessage_t txMessage;
+    uint32_t          nbCycles = nbSuccessiveMissed + 1; // Cycles from the last MASTER_REQUEST to the next one
+
+    // We schedule the low power mode of CC1101 just at the end of the network cycle, or at the end of the last window we
+    // listen to with RX gating. Slot timing is only trusted on a received MASTER_REQUEST.
+    txMessage.action       = MICRONET_ACTION_RF_LOW_POWER;
+    txMessage.startTime_us = micronetCodec->GetEndOfNetwork(&networkMap);
+    txMessage.len          = 0;
+    if (rxGating && (nbSuccessiveMissed == 0))
+    {
+        txMessage.startTime_us = PlanRxGating(messageFifo);
+    }
+    messageFifo->Push(txMessage);
+
+    // We schedule exit of CC1101's low power mode RF_WAKE_UP_TIME_US before the earliest predicted start of the next
+    // network cycle. It will let time for the PLL calibration loop to complete, even if the master is early.
+    txMessage.action = MICRONET_ACTION_RF_ACTIVE_POWER;
+    txMessage.startTime_us =
+        cycleEstimator.PredictStart_us(nbCycles) - cycleEstimator.PredictErrorBound_us(nbCycles) - RF_WAKE_UP_TIME_US;
+    txMessage.len = 0;
+    messageFifo->Push(txMessage);
+
+    ArmMissedCycleDeadline();
+
+    for (int i = 0; i < NUMBER_OF_VIRTUAL_SLAVES; i++)
+    {
+        txSlot = micronetCodec->GetSyncTransmissionSlot(&networkMap, deviceId + i);
+        if (txSlot.start_us != 0)
+        {
+            uint32_t payloadLength =
+                micronetCodec->EncodeDataMessage(&txMessage, latestSignalStrength, networkId, deviceId + i, splitDataFields[i]);
+            if (txSlot.payloadBytes < payloadLength)
+            {
+                txSlot = micronetCodec->GetAsyncTransmissionSlot(&networkMap);
+                micronetCodec->EncodeSlotUpdateMessage(&txMessage, latestSignalStrength, networkId, deviceId + i, payloadLength);
+                txMessage.action = MICRONET_ACTION_RF_NO_ACTION;
+            }
+            else
+            {
+                // Data message will be encoded again by RF driver just before its slot, with the latest data. Age of the data
+                // at master request is still accounted to measure the benefit.
+                syncSlotPayloadBytes[i] = txSlot.payloadBytes;
+                txMessage.action        = MICRONET_ACTION_RF_LATE_ENCODING;
+                if (splitDataFields[i] & DATA_FIELD_POSITION)
+                {
+                    UpdateDataAge(&positionRequestAge, NAV_ID_LATITUDE_DEG, txSlot.start_us);
+                }
+                if (splitDataFields[i] & DATA_FIELD_SOGCOG)
+                {
+                    UpdateDataAge(&sogCogRequestAge, NAV_ID_SOG_KT, txSlot.start_us);
+                }
+            }
+        }
+        else
+        {
+            txSlot = micronetCodec->GetAsyncTransmissionSlot(&networkMap);
+            micronetCodec->EncodeSlotRequestMessage(&txMessage, latestSignalStrength, networkId, deviceId + i,
+                                                    micronetCodec->GetDataMessageLength(splitDataFields[i]));
+            txMessage.action = MICRONET_ACTION_RF_NO_ACTION;
+        }
+
+        // Without MASTER_REQUEST, the asynchronous window is not ours to use
+        if ((nbSuccessiveMissed == 0) || (txMessage.action == MICRONET_ACTION_RF_LATE_ENCODING))
+        {
+            txMessage.startTime_us = txSlot.start_us;
+            messageFifo->Push(txMessage);
+        }
+    }
+}
+
+// Power the radio down between the windows we listen to : sync slots of the devices we use data from, our own slots, the
+// asynchronous window and our ACK windows. Only the longest gaps are used, to bound the number of power transitions.
+// Returns the end of the last window we listen to.
+uint32_t MicronetSlaveDevice::PlanRxGating(MicronetMessageFifo *messageFifo)
+{
+    RxGap_t           gaps[MAX_DEVICES_PER_NETWORK + 2];
+    int               nbGaps = 0;
+    uint32_t          windowEnd_us;
+    MicronetMessage_t txMessage;
+
+    // The MASTER_REQUEST has already been received : the first gap starts at the first slot
+    windowEnd_us = networkMap.firstSlot;
+    for (uint32_t i = 0; i < networkMap.nbSyncSlots + 1 + networkMap.nbAckSlots; i++)
+    {
+        TxSlotDesc_t *window;
+        bool          listened;
+
+        // Windows are walked in time order
+        if (i < networkMap.nbSyncSlots)
+        {
+            window   = &networkMap.syncSlot[i];
+            listened = (window->start_us != 0) && (IsListenedDevice(window->deviceId) || IsOwnDevice(window->deviceId));
+        }
+        else if (i == networkMap.nbSyncSlots)
+        {
+            window   = &networkMap.asyncSlot;
+            listened = true;
+        }
+        else
+        {
+            window   = &networkMap.ackSlot[i - networkMap.nbSyncSlots - 1];
+            listened = IsOwnDevice(window->deviceId);
+        }
+
+        if (!listened)
+        {
+            continue;
+        }
+
+        uint32_t activePower_us = window->start_us - RF_WAKE_UP_TIME_US - RX_GATING_MARGIN_US;
+        if (((int32_t)(activePower_us - windowEnd_us) >= RX_GATING_MIN_SLEEP_US) && (nbGaps < (int)(sizeof(gaps) / sizeof(gaps[0]))))
+        {
+            gaps[nbGaps].lowPower_us    = windowEnd_us;
+            gaps[nbGaps].activePower_us = activePower_us;
+            nbGaps++;
+        }
+        if ((int32_t)(window->start_us + window->length_us - windowEnd_us) > 0)
+        {
+            windowEnd_us = window->start_us + window->length_us;
+        }
+    }
+
+    for (int sleep = 0; (sleep < RX_GATING_MAX_SLEEPS) && (nbGaps > 0); sleep++)
+    {
+        int longest = 0;
+        for (int i = 1; i < nbGaps; i++)
+        {
+            if ((gaps[i].activePower_us - gaps[i].lowPower_us) > (gaps[longest].activePower_us - gaps[longest].lowPower_us))
+            {
+                longest = i;
+            }
+        }
+
+        // Wake-up is pushed first : should the transmit list of RfDriver be full, the radio is never left powered down
+        txMessage.len          = 0;
+        txMessage.action       = MICRONET_ACTION_RF_ACTIVE_POWER;
+        txMessage.startTime_us = gaps[longest].activePower_us;
+        messageFifo->Push(txMessage);
+        txMessage.action       = MICRONET_ACTION_RF_LOW_POWER;
+        txMessage.startTime_us = gaps[longest].lowPower_us;
+        messageFifo->Push(txMessage);
+
+        gaps[longest] = gaps[--nbGaps];
+    }
+
+    return windowEnd_us;
+}
+
+// Returns true if the device is one of our virtual slaves
+bool MicronetSlaveDevice::IsOwnDevice(uint32_t deviceId)
+{
+    return (deviceId >= this->deviceId) && (deviceId < this->deviceId + NUMBER_OF_VIRTUAL_SLAVES);
+}
+
+// The MASTER_REQUEST of the next cycle is considered missed if it has not been received at the latest predicted time its
+// reception should be complete
+void MicronetSlaveDevice::ArmMissedCycleDeadline()
+{
+    uint32_t nbCycles = nbSuccessiveMissed + 1;
+
+    missedCycleDeadline_us = cycleEstimator.PredictStart_us(nbCycles) + cycleEstimator.PredictErrorBound_us(nbCycles) +
+                             (networkMap.firstSlot - networkMap.networkStart) + MISSED_CYCLE_MARGIN_US;
+}
+
+// Move all the slots of the network map by the given time
+void MicronetSlaveDevice::ShiftNetworkMap(uint32_t offset_us)
+{
+    networkMap.networkStart += offset_us;
+    networkMap.networkEnd += offset_us;
+    networkMap.firstSlot += offset_us;
+    for (uint32_t i = 0; i < networkMap.nbSyncSlots; i++)
+    {
+        if (networkMap.syncSlot[i].start_us != 0)
+        {
+            networkMap.syncSlot[i].start_us += offset_us;
+        }
+    }
+    networkMap.asyncSlot.start_us += offset_us;
+    for (uint32_t i = 0; i < networkMap.nbAckSlots; i++)
+    {
+        networkMap.ackSlot[i].start_us += offset_us;
+    }
+}
+
+// Returns the number of confirmed and predicted network cycles
+void MicronetSlaveDevice::GetCycleCounters(CycleCounters_t *counters)
+{
+    *counters = cycleCounters;
+}
+
+// Returns the age of GNSS data sent to Micronet displays
+void MicronetSlaveDevice::GetGnssAgeStatistics(DataAgeStatistics_t *positionAge, DataAgeStatistics_t *sogCogAge)
+{
+    noInterrupts();
+    *positionAge = this->positionAge;
+    *sogCogAge   = this->sogCogAge;
+    interrupts();
+}
+
+// Returns the age GNSS data would have had if data messages were encoded at master request
+void MicronetSlaveDevice::GetGnssRequestAgeStatistics(DataAgeStatistics_t *positionAge, DataAgeStatistics_t *sogCogAge)
+{
+    *positionAge = positionRequestAge;
+    *sogCogAge   = sogCogRequestAge;
+}
+
+// Returns the learned period of the master's network cycle
+void MicronetSlaveDevice::GetCycleStatistics(CycleStatistics_t *statistics)
+{
+    cycleEstimator.GetStatistics(statistics);
+}
+
+// Called from RF timer ISR just before the slot of a late encoded data message
+bool MicronetSlaveDevice::LateEncoderCallback(void *context, MicronetMessage_t *message)
+{
+    return static_cast<MicronetSlaveDevice *>(context)->EncodeLateDataMessage(message);
+}
+
+// Encode a data message again with the latest navigation data
+// The new message is only used if it still fits in the slot allocated by the master
+bool MicronetSlaveDevice::EncodeLateDataMessage(MicronetMessage_t *message)
+{
+    MicronetMessage_t lateMessage;
+    uint32_t          slaveIndex = micronetCodec->GetDeviceId(message) - deviceId;
+
+    if (slaveIndex >= NUMBER_OF_VIRTUAL_SLAVES)
+    {
+        return false;
+    }
+
+    uint32_t payloadLength =
+        micronetCodec->EncodeDataMessage(&lateMessage, latestSignalStrength, networkId, deviceId + slaveIndex, splitDataFields[slaveIndex]);
+    if (payloadLength > syncSlotPayloadBytes[slaveIndex])
+    {
+        return false;
+    }
+
+    memcpy(message->data, lateMessage.data, lateMessage.len);
+    message->len = lateMessage.len;
+
+    if (splitDataFields[slaveIndex] & DATA_FIELD_POSITION)
+    {
+        UpdateDataAge(&positionAge, NAV_ID_LATITUDE_DEG, message->startTime_us);
+    }
+    if (splitDataFields[slaveIndex] & DATA_FIELD_SOGCOG)
+    {
+        UpdateDataAge(&sogCogAge, NAV_ID_SOG_KT, message->startTime_us);
+    }
+    RecordFieldLatency(splitDataFields[slaveIndex], message->startTime_us);
+
+    return true;
+}
+
+// Account the latency each valid field of a data message will have when its slot starts, from the reception of the value
+// it carries
+void MicronetSlaveDevice::RecordFieldLatency(uint32_t fields, uint32_t slotStart_us)
+{
+    NavigationData *navData = &micronetCodec->navData;
+
+    if (latencyTracer == nullptr)
+    {
+        return;
+    }
+
+    for (int i = 0; i < NB_FIELD_LATENCY_DESC; i++)
+    {
+        const FieldLatencyDesc_t *desc = &fieldLatencyDesc[i];
+
+        if ((fields & desc->field) && navData->IsValid(desc->id))
+        {
+            latencyTracer->Record(desc->output, slotStart_us - navData->GetOrigin_us(desc->id));
+        }
+    }
+}
+
+// Account the age a value will have when its slot starts. Slot start and value origin are both micros() times : no other
+// clock is read, so that the same code runs on the virtual time of NetworkSimulator.
+void MicronetSlaveDevice::UpdateDataAge(DataAgeStatistics_t *statistics, NavValueId_t id, uint32_t slotStart_us)
+{
+    NavigationData *navData = &micronetCodec->navData;
+
+    if (navData->IsValid(id))
+    {
+        uint32_t age_ms = (slotStart_us - navData->GetOrigin_us(id)) / 1000;
+
+        statistics->nbSamples++;
+        statistics->totalAge_ms += age_ms;
+        if (age_ms > statistics->maxAge_ms)
+        {
+            statistics->maxAge_ms = age_ms;
+        }
+    }
+}
+
 // Distribute requested data fields to the virtual slave devices
 // This distribution is made to balance the size of the data message of each slave
 void MicronetSlaveDevice::SplitDataFields()
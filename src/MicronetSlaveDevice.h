@@ -31,6 +31,8 @@
 /*                              Includes                                   */
 /***************************************************************************/
 
+#include "CyclePeriodEstimator.h"
+#include "LatencyTracer.h"
 #include "Micronet.h"
 #include "MicronetCodec.h"
 #include "MicronetMessageFifo.h"
@@ -46,6 +48,23 @@
 /*                                Types                                    */
 /***************************************************************************/
 
+// Age of a value sent to Micronet, from the reception of its source to the start of the slot carrying it
+typedef struct
+{
+    uint32_t nbSamples;
+    uint32_t totalAge_ms;
+    uint32_t maxAge_ms;
+} DataAgeStatistics_t;
+
+// Network cycles in which data was planned, on a received MASTER_REQUEST or on the predicted timeline, and cycles missed
+// beyond the prediction limits
+typedef struct
+{
+    uint32_t nbConfirmed;
+    uint32_t nbPredicted;
+    uint32_t nbUnpredicted;
+} CycleCounters_t;
+
 /***************************************************************************/
 /*                               Classes                                   */
 /***************************************************************************/
@@ -62,6 +81,17 @@ class MicronetSlaveDevice
     void            AddDataFields(uint32_t dataMask);
     NavigationData *GetNavigationData();
     void            ProcessMessage(MicronetMessage_t *message, MicronetMessageFifo *messageFifo);
+    bool            GetMissedCycleDeadline(uint32_t *deadline_us);
+    void            ProcessMissedCycle(uint32_t now_us, MicronetMessageFifo *messageFifo);
+    void            SetPredictionLimits(uint32_t maxPredictedCycles, uint32_t maxPredictionError_us);
+    void            SetRxGating(bool enable);
+    void            SetLatencyTracer(LatencyTracer *latencyTracer);
+    void            GetGnssAgeStatistics(DataAgeStatistics_t *positionAge, DataAgeStatistics_t *sogCogAge);
+    void            GetGnssRequestAgeStatistics(DataAgeStatistics_t *positionAge, DataAgeStatistics_t *sogCogAge);
+    void            GetCycleStatistics(CycleStatistics_t *statistics);
+    void            GetCycleCounters(CycleCounters_t *counters);
+    static bool     LateEncoderCallback(void *context, MicronetMessage_t *message);
+    static bool     IsListenedDevice(uint32_t deviceId);
 
   private:
     MicronetCodec            *micronetCodec;
@@ -70,10 +100,32 @@ class MicronetSlaveDevice
     uint32_t                  networkId;
     uint32_t                  dataFields;
     uint32_t                  splitDataFields[NUMBER_OF_VIRTUAL_SLAVES];
+    uint8_t                   syncSlotPayloadBytes[NUMBER_OF_VIRTUAL_SLAVES];
     uint8_t                   latestSignalStrength;
+    DataAgeStatistics_t       positionAge;
+    DataAgeStatistics_t       sogCogAge;
+    DataAgeStatistics_t       positionRequestAge;
+    DataAgeStatistics_t       sogCogRequestAge;
+    CyclePeriodEstimator      cycleEstimator;
+    bool                      networkMapValid;
+    uint32_t                  nbSuccessiveMissed;
+    uint32_t                  missedCycleDeadline_us;
+    uint32_t                  maxPredictedCycles;
+    uint32_t                  maxPredictionError_us;
+    bool                      rxGating;
+    LatencyTracer            *latencyTracer;
+    CycleCounters_t           cycleCounters;
 
-    void    SplitDataFields();
-    uint8_t GetShortestSlave();
+    void     SplitDataFields();
+    uint8_t  GetShortestSlave();
+    bool     EncodeLateDataMessage(MicronetMessage_t *message);
+    void     UpdateDataAge(DataAgeStatistics_t *statistics, NavValueId_t id, uint32_t slotStart_us);
+    void     RecordFieldLatency(uint32_t fields, uint32_t slotStart_us);
+    void     PlanCycle(MicronetMessageFifo *messageFifo);
+    uint32_t PlanRxGating(MicronetMessageFifo *messageFifo);
+    bool     IsOwnDevice(uint32_t deviceId);
+    void     ArmMissedCycleDeadline();
+    void     ShiftNetworkMap(uint32_t offset_us);
 };
 
 #endif /* MICRONETSLAVEDEVICE_H_ */
@@ -37,12 +37,16 @@
 #include "LSM303DLHDriver.h"
 
 #include <cmath>
+#include <string.h>
 #include <vector>
 
 /***************************************************************************/
 /*                              Constants                                  */
 /***************************************************************************/
 
+// Attitude filter sampling period
+#define ATTITUDE_DT_S (NAVCOMPASS_SAMPLE_PERIOD_MS / 1000.0f)
+
 /***************************************************************************/
 /*                             Local types                                 */
 /***************************************************************************/
@@ -59,12 +63,12 @@
 /*                              Functions                                  */
 /***************************************************************************/
 
-NavCompass::NavCompass() : headingIndex(0), navCompassDetected(false), navCompassDriver(nullptr)
+NavCompass::NavCompass()
+    : sampleIndex(0), nbSamples(0), lastSampleTime_us(0), samplingStep(COMPASS_STEP_ACCELERATION), navCompassDetected(false),
+      navCompassDriver(nullptr)
 {
-    for (int i = 0; i < HEADING_HISTORY_LENGTH; i++)
-    {
-        headingHistory[i] = 0.0f;
-    }
+    memset(sampleRing, 0, sizeof(sampleRing));
+    memset(&pendingSample, 0, sizeof(pendingSample));
 }
 
 NavCompass::~NavCompass()
@@ -102,71 +106,114 @@ string NavCompass::GetDeviceName()
     return string("");
 }
 
-float NavCompass::GetHeading()
+// Execute the next step of compass acquisition. A sample is made of two steps : accelerometer reading then magnetic
+// field reading, each of them being a short I2C exchange. This way, the caller is never blocked for a whole
+// acquisition and can interleave more urgent work (e.g. RF) between steps. Complete samples are pushed in a ring which
+// is processed by the attitude filter. Must be called at twice the rate of NAVCOMPASS_SAMPLE_PERIOD_MS.
+void NavCompass::SamplingStep()
 {
-    vec accel;
-    vec mag;
-    vec E;
-    vec N;
-
-    vec from = HEADING_AXIS;
-
-    // Get Acceleration and Magnetic data from LSM303
-    // Note that we don't care about units of both acceleration and magnetic field since we
-    // are only calculating angles.
-    navCompassDriver->GetAcceleration(&accel);
-    navCompassDriver->GetMagneticField(&mag);
-
-    // Substract calibration offsets from magnetic readings
-    mag.x -= gConfiguration.xMagOffset;
-    mag.y -= gConfiguration.yMagOffset;
-    mag.z -= gConfiguration.zMagOffset;
-
-    // normalize
-    Normalize(&accel);
-    Normalize(&mag);
-
-    // D X M = E, cross acceleration vector Down with M (magnetic north + inclination) to produce "East"
-    CrossProduct(&mag, &accel, &E);
-    Normalize(&E);
-    // E X D = N, cross "East" with "Down" to produce "North" (parallel to the ground)
-    CrossProduct(&accel, &E, &N);
-    Normalize(&N);
-
-    // compute heading
-    float heading = atan2f(vector_dot(&E, &from), vector_dot(&N, &from)) * 180.0f / PI;
-
-    if (heading < 0)
-        heading += 360;
-
-    headingHistory[headingIndex++] = heading;
-    if (headingIndex >= HEADING_HISTORY_LENGTH)
+    if (!navCompassDetected)
     {
-        headingIndex = 0;
+        return;
     }
 
-    bool firstQ     = false;
-    bool lastQ      = false;
-    bool shiftAngle = false;
-    for (int i = 0; i < HEADING_HISTORY_LENGTH; i++)
+    if (samplingStep == COMPASS_STEP_ACCELERATION)
     {
-        if (headingHistory[i] < 90.0)
-            firstQ = true;
-        if (headingHistory[i] > 270.0)
-            lastQ = true;
+        // Oversample acceleration : average all measurements made by the accelerometer since the last step
+        vec batch[NAVCOMPASS_MAX_BATCH_SIZE];
+        int batchSize = navCompassDriver->GetAccelerationBatch(batch, NAVCOMPASS_MAX_BATCH_SIZE);
+
+        if (batchSize > 0)
+        {
+            pendingSample.acc = {0.0f, 0.0f, 0.0f};
+            for (int i = 0; i < batchSize; i++)
+            {
+                pendingSample.acc.x += batch[i].x;
+                pendingSample.acc.y += batch[i].y;
+                pendingSample.acc.z += batch[i].z;
+            }
+            pendingSample.acc.x /= batchSize;
+            pendingSample.acc.y /= batchSize;
+            pendingSample.acc.z /= batchSize;
+        }
+        samplingStep = COMPASS_STEP_MAGNETIC_FIELD;
     }
-    shiftAngle = firstQ && lastQ;
-
-    heading = 0.0f;
-    for (int i = 0; i < HEADING_HISTORY_LENGTH; i++)
+    else
     {
-        float value = headingHistory[i];
-        if (shiftAngle && (value > 270.0))
-            value -= 360.0;
-        heading += value;
+        navCompassDriver->GetMagneticField(&pendingSample.mag);
+        samplingStep      = COMPASS_STEP_ACCELERATION;
+        lastSampleTime_us = micros();
+
+        sampleRing[sampleIndex++] = pendingSample;
+        if (sampleIndex >= NAVCOMPASS_RING_LENGTH)
+        {
+            sampleIndex = 0;
+        }
+        if (nbSamples < NAVCOMPASS_RING_LENGTH)
+        {
+            nbSamples++;
+        }
     }
+}
 
-    return heading / HEADING_HISTORY_LENGTH;
+// Returns magnetic heading of HEADING_AXIS in degrees. This function does not access the compass : it only runs the
+// attitude filter on the samples acquired by SamplingStep.
+float NavCompass::GetHeading()
+{
+    ProcessSamples();
+    return attitudeFilter.GetHeading();
+}
+
+// Returns heel angle in degrees, positive when HEEL_AXIS goes down (heeling to starboard)
+float NavCompass::GetHeel()
+{
+    ProcessSamples();
+    return attitudeFilter.GetHeel();
+}
+
+// Returns pitch angle in degrees, positive when HEADING_AXIS goes up
+float NavCompass::GetPitch()
+{
+    ProcessSamples();
+    return attitudeFilter.GetPitch();
+}
+
+// Returns rate of turn in degrees per minute, negative when turning to port
+float NavCompass::GetRateOfTurn()
+{
+    ProcessSamples();
+    return attitudeFilter.GetRateOfTurn();
+}
+
+// Returns micros() time of the latest sample, which is the origin of heading, attitude and rate of turn
+uint32_t NavCompass::GetSampleTime_us()
+{
+    return lastSampleTime_us;
+}
+
+// Run attitude filter on all the samples acquired since the last call, oldest first
+void NavCompass::ProcessSamples()
+{
+    uint32_t index = (sampleIndex + NAVCOMPASS_RING_LENGTH - nbSamples) % NAVCOMPASS_RING_LENGTH;
+
+    while (nbSamples > 0)
+    {
+        vec accel = sampleRing[index].acc;
+        vec mag   = sampleRing[index].mag;
+
+        // Apply hard iron offsets then soft iron correction to magnetic readings
+        float mx = mag.x - gConfiguration.xMagOffset;
+        float my = mag.y - gConfiguration.yMagOffset;
+        float mz = mag.z - gConfiguration.zMagOffset;
+        mag.x    = gConfiguration.magSoftIron[0][0] * mx + gConfiguration.magSoftIron[0][1] * my + gConfiguration.magSoftIron[0][2] * mz;
+        mag.y    = gConfiguration.magSoftIron[1][0] * mx + gConfiguration.magSoftIron[1][1] * my + gConfiguration.magSoftIron[1][2] * mz;
+        mag.z    = gConfiguration.magSoftIron[2][0] * mx + gConfiguration.magSoftIron[2][1] * my + gConfiguration.magSoftIron[2][2] * mz;
+
+        attitudeFilter.Update(&accel, &mag, ATTITUDE_DT_S);
+
+        index = (index + 1) % NAVCOMPASS_RING_LENGTH;
+        nbSamples--;
+    }
 }
 
 void NavCompass::GetMagneticField(float *magX, float *magY, float *magZ)
@@ -195,22 +242,3 @@ void NavCompass::GetAcceleration(float *accX, float *accY, float *accZ)
     }
 }
 
-void NavCompass::Normalize(vec *a)
-{
-    float mag = sqrt(vector_dot(a, a));
-    a->x /= mag;
-    a->y /= mag;
-    a->z /= mag;
-}
-
-void NavCompass::CrossProduct(vec *a, vec *b, vec *out)
-{
-    out->x = (a->y * b->z) - (a->z * b->y);
-    out->y = (a->z * b->x) - (a->x * b->z);
-    out->z = (a->x * b->y) - (a->y * b->x);
-}
-
-float NavCompass::vector_dot(vec *a, vec *b)
-{
-    return (a->x * b->x) + (a->y * b->y) + (a->z * b->z);
-}
@@ -33,6 +33,7 @@
 /*                              Includes                                   */
 /***************************************************************************/
 
+#include "AttitudeFilter.h"
 #include "NavCompassDriver.h"
 
 #include <stdint.h>
@@ -42,7 +43,8 @@
 /*                              Constants                                  */
 /***************************************************************************/
 
-#define HEADING_HISTORY_LENGTH 4
+// Number of samples which can be stored in acquisition ring before being processed by attitude filter
+#define NAVCOMPASS_RING_LENGTH 4
 
 /***************************************************************************/
 /*                                Types                                    */
@@ -50,6 +52,18 @@
 
 using string = std::string;
 
+typedef enum
+{
+    COMPASS_STEP_ACCELERATION = 0,
+    COMPASS_STEP_MAGNETIC_FIELD
+} CompassSamplingStep_t;
+
+typedef struct
+{
+    vec acc;
+    vec mag;
+} CompassSample_t;
+
 /***************************************************************************/
 /*                               Classes                                   */
 /***************************************************************************/
@@ -60,21 +74,29 @@ class NavCompass
     NavCompass();
     virtual ~NavCompass();
 
-    bool   Init();
-    string GetDeviceName();
-    float  GetHeading();
-    void   GetMagneticField(float *magX, float *magY, float *magZ);
-    void   GetAcceleration(float *accX, float *accY, float *accZ);
+    bool     Init();
+    string   GetDeviceName();
+    void     SamplingStep();
+    float    GetHeading();
+    float    GetHeel();
+    float    GetPitch();
+    float    GetRateOfTurn();
+    uint32_t GetSampleTime_us();
+    void     GetMagneticField(float *magX, float *magY, float *magZ);
+    void     GetAcceleration(float *accX, float *accY, float *accZ);
 
   private:
-    float             headingHistory[HEADING_HISTORY_LENGTH];
-    uint32_t          headingIndex;
-    bool              navCompassDetected;
-    NavCompassDriver *navCompassDriver;
-
-    void  Normalize(vec *a);
-    void  CrossProduct(vec *a, vec *b, vec *out);
-    float vector_dot(vec *a, vec *b);
+    CompassSample_t       sampleRing[NAVCOMPASS_RING_LENGTH];
+    uint32_t              sampleIndex;
+    uint32_t              nbSamples;
+    AttitudeFilter        attitudeFilter;
+    uint32_t              lastSampleTime_us;
+    CompassSample_t       pendingSample;
+    CompassSamplingStep_t samplingStep;
+    bool                  navCompassDetected;
+    NavCompassDriver     *navCompassDriver;
+
+    void ProcessSamples();
 };
 
 #endif /* NAVCOMPASS_H_ */
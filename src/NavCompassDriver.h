@@ -12,6 +12,9 @@
 
 using string = std::string;
 
+// Maximum number of samples returned by GetAccelerationBatch
+#define NAVCOMPASS_MAX_BATCH_SIZE 32
+
 struct vec
 {
     float x, y, z;
@@ -20,11 +23,12 @@ struct vec
 class NavCompassDriver
 {
   public:
-    virtual ~NavCompassDriver()               = 0;
-    virtual bool   Init()                     = 0;
-    virtual string GetDeviceName()            = 0;
-    virtual void   GetMagneticField(vec *mag) = 0;
-    virtual void   GetAcceleration(vec *acc)  = 0;
+    virtual ~NavCompassDriver()                                   = 0;
+    virtual bool   Init()                                         = 0;
+    virtual string GetDeviceName()                                = 0;
+    virtual void   GetMagneticField(vec *mag)                     = 0;
+    virtual void   GetAcceleration(vec *acc)                      = 0;
+    virtual int    GetAccelerationBatch(vec *acc, int maxSamples) = 0;
 };
 
 #endif /* NAVCOMPASSDRIVER_H_ */
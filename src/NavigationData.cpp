@@ -40,10 +40,17 @@
 #define VALIDITY_TIME_FAST_MS 3000
 #define VALIDITY_TIME_SLOW_MS 10000
 
+// Maximum number of notification rounds made by Dispatch, subscribers being allowed to publish values themselves
+#define NAV_MAX_DISPATCH_PASSES 4
+
 /***************************************************************************/
 /*                                Macros                                   */
 /***************************************************************************/
 
+// Teensy has a single core : keeping the compiler from reordering memory accesses is enough for ISRs and main loop to
+// see them in program order
+#define NAV_COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
 /***************************************************************************/
 /*                             Local types                                 */
 /***************************************************************************/
@@ -60,30 +67,74 @@
 /*                              Functions                                  */
 /***************************************************************************/
 
+static_assert(NAV_NB_VALUES <= 32, "Navigation value masks are 32-bit wide");
+
+// Must follow NavValueId_t order
+const NavValueDesc_t NavigationData::valueDesc[NAV_NB_VALUES] = {
+    {"SPD", VALIDITY_TIME_FAST_MS},        // NAV_ID_SPD_KT
+    {"AWA", VALIDITY_TIME_FAST_MS},        // NAV_ID_AWA_DEG
+    {"AWS", VALIDITY_TIME_FAST_MS},        // NAV_ID_AWS_KT
+    {"TWA", VALIDITY_TIME_FAST_MS},        // NAV_ID_TWA_DEG
+    {"TWS", VALIDITY_TIME_FAST_MS},        // NAV_ID_TWS_KT
+    {"TWD", VALIDITY_TIME_FAST_MS},        // NAV_ID_TWD_DEG
+    {"Damped TWA", VALIDITY_TIME_FAST_MS}, // NAV_ID_DAMPED_TWA_DEG
+    {"Damped TWS", VALIDITY_TIME_FAST_MS}, // NAV_ID_DAMPED_TWS_KT
+    {"Damped TWD", VALIDITY_TIME_FAST_MS}, // NAV_ID_DAMPED_TWD_DEG
+    {"TWD shift", VALIDITY_TIME_FAST_MS},  // NAV_ID_TWD_SHIFT_DEG
+    {"GWD", VALIDITY_TIME_FAST_MS},        // NAV_ID_GWD_DEG
+    {"GWS", VALIDITY_TIME_FAST_MS},        // NAV_ID_GWS_KT
+    {"DPT", VALIDITY_TIME_FAST_MS},        // NAV_ID_DPT_M
+    {"VCC", VALIDITY_TIME_FAST_MS},        // NAV_ID_VCC_V
+    {"LOG", VALIDITY_TIME_FAST_MS},        // NAV_ID_LOG_NM
+    {"TRIP", VALIDITY_TIME_FAST_MS},       // NAV_ID_TRIP_NM
+    {"STP", VALIDITY_TIME_FAST_MS},        // NAV_ID_STP_DEGC
+    {"Latitude", VALIDITY_TIME_SLOW_MS},   // NAV_ID_LATITUDE_DEG
+    {"Longitude", VALIDITY_TIME_SLOW_MS},  // NAV_ID_LONGITUDE_DEG
+    {"COG", VALIDITY_TIME_SLOW_MS},        // NAV_ID_COG_DEG
+    {"SOG", VALIDITY_TIME_SLOW_MS},        // NAV_ID_SOG_KT
+    {"XTE", VALIDITY_TIME_SLOW_MS},        // NAV_ID_XTE_NM
+    {"DTW", VALIDITY_TIME_SLOW_MS},        // NAV_ID_DTW_NM
+    {"BTW", VALIDITY_TIME_SLOW_MS},        // NAV_ID_BTW_DEG
+    {"VMG to WP", VALIDITY_TIME_SLOW_MS},  // NAV_ID_VMGWP_KT
+    {"Heading", VALIDITY_TIME_FAST_MS},    // NAV_ID_MAG_HDG_DEG
+    {"ROT", VALIDITY_TIME_FAST_MS},        // NAV_ID_ROT_DEGPMIN
+    {"Heel", VALIDITY_TIME_FAST_MS},       // NAV_ID_HEEL_DEG
+    {"Pitch", VALIDITY_TIME_FAST_MS},      // NAV_ID_PITCH_DEG
+};
+
+// Must follow NavGroupId_t order
+const NavValueId_t NavigationData::groupValues[NAV_NB_GROUPS][NAV_GROUP_MAX_VALUES] = {
+    {NAV_ID_LATITUDE_DEG, NAV_ID_LONGITUDE_DEG}, // NAV_GROUP_POSITION
+    {NAV_ID_SOG_KT, NAV_ID_COG_DEG},             // NAV_GROUP_SOGCOG
+    {NAV_ID_AWA_DEG, NAV_ID_AWS_KT},             // NAV_GROUP_APPARENT_WIND
+};
+
 NavigationData::NavigationData()
 {
-    spd_kt.valid        = false;
-    awa_deg.valid       = false;
-    aws_kt.valid        = false;
-    twa_deg.valid       = false;
-    tws_kt.valid        = false;
-    dpt_m.valid         = false;
-    vcc_v.valid         = false;
-    log_nm.valid        = false;
-    trip_nm.valid       = false;
-    stp_degc.valid      = false;
-    time.valid          = false;
-    date.valid          = false;
-    latitude_deg.valid  = false;
-    longitude_deg.valid = false;
-    cog_deg.valid       = false;
-    sog_kt.valid        = false;
-    xte_nm.valid        = false;
-    dtw_nm.valid        = false;
-    btw_deg.valid       = false;
-    waypoint.valid      = false;
-    vmgwp_kt.valid      = false;
-    magHdg_deg.valid    = false;
+    memset(value, 0, sizeof(value));
+    memset(timeStamp, 0, sizeof(timeStamp));
+    memset(origin_us, 0, sizeof(origin_us));
+    memset(subscribers, 0, sizeof(subscribers));
+    memset(groupLatch, 0, sizeof(groupLatch));
+    validMask        = 0;
+    originSet        = false;
+    currentOrigin_us = 0;
+    nbSubscribers    = 0;
+    publishHook      = nullptr;
+    pendingGroupMask = 0;
+    groupedMask      = 0;
+    time.valid       = false;
+    date.valid       = false;
+    waypoint.valid   = false;
+    gnssFix.valid    = false;
+
+    for (int group = 0; group < NAV_NB_GROUPS; group++)
+    {
+        for (int i = 0; i < NAV_GROUP_MAX_VALUES; i++)
+        {
+            groupedMask |= NAV_BIT(groupValues[group][i]);
+        }
+    }
 
     calibrationUpdated          = false;
     waterSpeedFactor_per        = 0.0f;
@@ -100,52 +151,338 @@ NavigationData::~NavigationData()
 {
 }
 
+// Invalidate values which have not been updated for longer than their validity time
+// Only valid values are visited
 void NavigationData::UpdateValidity()
 {
     uint32_t currentTime = millis();
+    uint32_t mask        = validMask;
+
+    while (mask != 0)
+    {
+        int id = __builtin_ctz(mask);
+        mask &= mask - 1;
+        if (currentTime - timeStamp[id] > valueDesc[id].validityTime_ms)
+        {
+            Invalidate((NavValueId_t)id);
+        }
+    }
 
-    if (currentTime - awa_deg.timeStamp > VALIDITY_TIME_FAST_MS)
-        awa_deg.valid = false;
-    if (currentTime - aws_kt.timeStamp > VALIDITY_TIME_FAST_MS)
-        aws_kt.valid = false;
-    if (currentTime - dpt_m.timeStamp > VALIDITY_TIME_FAST_MS)
-        dpt_m.valid = false;
-    if (currentTime - log_nm.timeStamp > VALIDITY_TIME_FAST_MS)
-        log_nm.valid = false;
-    if (currentTime - stp_degc.timeStamp > VALIDITY_TIME_FAST_MS)
-        stp_degc.valid = false;
-    if (currentTime - spd_kt.timeStamp > VALIDITY_TIME_FAST_MS)
-        spd_kt.valid = false;
-    if (currentTime - trip_nm.timeStamp > VALIDITY_TIME_FAST_MS)
-        trip_nm.valid = false;
-    if (currentTime - twa_deg.timeStamp > VALIDITY_TIME_FAST_MS)
-        twa_deg.valid = false;
-    if (currentTime - tws_kt.timeStamp > VALIDITY_TIME_FAST_MS)
-        tws_kt.valid = false;
-    if (currentTime - vcc_v.timeStamp > VALIDITY_TIME_FAST_MS)
-        vcc_v.valid = false;
     if (currentTime - time.timeStamp > VALIDITY_TIME_SLOW_MS)
         time.valid = false;
     if (currentTime - date.timeStamp > VALIDITY_TIME_SLOW_MS)
         date.valid = false;
-    if (currentTime - latitude_deg.timeStamp > VALIDITY_TIME_SLOW_MS)
-        latitude_deg.valid = false;
-    if (currentTime - longitude_deg.timeStamp > VALIDITY_TIME_SLOW_MS)
-        longitude_deg.valid = false;
-    if (currentTime - cog_deg.timeStamp > VALIDITY_TIME_SLOW_MS)
-        cog_deg.valid = false;
-    if (currentTime - sog_kt.timeStamp > VALIDITY_TIME_SLOW_MS)
-        sog_kt.valid = false;
-    if (currentTime - xte_nm.timeStamp > VALIDITY_TIME_SLOW_MS)
-        xte_nm.valid = false;
-    if (currentTime - dtw_nm.timeStamp > VALIDITY_TIME_SLOW_MS)
-        dtw_nm.valid = false;
-    if (currentTime - btw_deg.timeStamp > VALIDITY_TIME_SLOW_MS)
-        btw_deg.valid = false;
     if (currentTime - waypoint.timeStamp > VALIDITY_TIME_SLOW_MS)
         waypoint.valid = false;
-    if (currentTime - vmgwp_kt.timeStamp > VALIDITY_TIME_SLOW_MS)
-        vmgwp_kt.valid = false;
-    if (currentTime - magHdg_deg.timeStamp > VALIDITY_TIME_FAST_MS)
-        magHdg_deg.valid = false;
+    if (currentTime - gnssFix.timeStamp > VALIDITY_TIME_SLOW_MS)
+        gnssFix.valid = false;
+}
+
+// Store a new valid value and publish its change
+// The value is given the origin set with SetOrigin, or the current time if none is set
+void NavigationData::Set(NavValueId_t id, float newValue)
+{
+    value[id]     = newValue;
+    timeStamp[id] = millis();
+    origin_us[id] = originSet ? currentOrigin_us : micros();
+    validMask |= NAV_BIT(id);
+    UpdateGroups(NAV_BIT(id));
+    Publish(NAV_BIT(id));
+}
+
+// Invalidate a value and publish its change
+void NavigationData::Invalidate(NavValueId_t id)
+{
+    uint32_t bit = NAV_BIT(id);
+
+    if (validMask & bit)
+    {
+        validMask &= ~bit;
+        UpdateGroups(bit);
+        Publish(bit);
+    }
+}
+
+float NavigationData::Get(NavValueId_t id)
+{
+    return value[id];
+}
+
+bool NavigationData::IsValid(NavValueId_t id)
+{
+    return (validMask & NAV_BIT(id)) != 0;
+}
+
+uint32_t NavigationData::GetTimeStamp(NavValueId_t id)
+{
+    return timeStamp[id];
+}
+
+uint32_t NavigationData::GetValidMask()
+{
+    return validMask;
+}
+
+const char *NavigationData::GetName(NavValueId_t id)
+{
+    return valueDesc[id].name;
+}
+
+// Set the origin of the values set from now on : the micros() time at which the RF frame, NMEA sentence or sensor sample
+// they are decoded from was received. This origin is carried with each value up to the NMEA sentences and Micronet fields
+// built from it, so that end-to-end latency can be measured. Grouped values set until ResetOrigin reach snapshot readers
+// together.
+void NavigationData::SetOrigin(uint32_t newOrigin_us)
+{
+    currentOrigin_us = newOrigin_us;
+    originSet        = true;
+}
+
+// Values set from now on get the time of their update as origin
+void NavigationData::ResetOrigin()
+{
+    originSet = false;
+
+    if (pendingGroupMask != 0)
+    {
+        uint32_t changedMask = pendingGroupMask;
+        pendingGroupMask     = 0;
+        UpdateGroups(changedMask);
+    }
+}
+
+uint32_t NavigationData::GetOrigin_us(NavValueId_t id)
+{
+    return origin_us[id];
+}
+
+// Returns the origin of the oldest value of a mask, current time if the mask is empty
+uint32_t NavigationData::GetOldestOrigin_us(uint32_t valueMask)
+{
+    uint32_t now    = micros();
+    uint32_t maxAge = 0;
+
+    while (valueMask != 0)
+    {
+        int id = __builtin_ctz(valueMask);
+        valueMask &= valueMask - 1;
+        if (now - origin_us[id] > maxAge)
+        {
+            maxAge = now - origin_us[id];
+        }
+    }
+
+    return now - maxAge;
+}
+
+// Get a consistent copy of the values of a group, without disabling interrupts. Can be called from ISR : the copy being
+// read is never the one a writer is updating, and a reader only retries if a new update was published during its copy.
+void NavigationData::GetSnapshot(NavGroupId_t group, NavGroupSnapshot_t *snapshot)
+{
+    NavGroupLatch_t *latch = &groupLatch[group];
+    uint32_t         sequence;
+
+    do
+    {
+        sequence = latch->sequence;
+        NAV_COMPILER_BARRIER();
+        *snapshot = latch->snapshot[sequence & 1];
+        NAV_COMPILER_BARRIER();
+    } while (sequence != latch->sequence);
+}
+
+// Publish the groups of changed values to snapshot readers, or defer them to ResetOrigin while an input is being decoded
+void NavigationData::UpdateGroups(uint32_t changedMask)
+{
+    if ((changedMask & groupedMask) == 0)
+    {
+        return;
+    }
+
+    if (originSet)
+    {
+        pendingGroupMask |= changedMask & groupedMask;
+        return;
+    }
+
+    for (int group = 0; group < NAV_NB_GROUPS; group++)
+    {
+        for (int i = 0; i < NAV_GROUP_MAX_VALUES; i++)
+        {
+            if (changedMask & NAV_BIT(groupValues[group][i]))
+            {
+                PublishGroup(group);
+                break;
+            }
+        }
+    }
+}
+
+// Latch writer : readers are moved to the other copy before each copy is rewritten, so that a writer never waits and a
+// reader interrupting it still gets the previous values. Only one writer context is allowed.
+void NavigationData::PublishGroup(int group)
+{
+    NavGroupLatch_t   *latch = &groupLatch[group];
+    NavGroupSnapshot_t snapshot;
+
+    snapshot.validMask = 0;
+    for (int i = 0; i < NAV_GROUP_MAX_VALUES; i++)
+    {
+        NavValueId_t id    = groupValues[group][i];
+        snapshot.value[i]  = value[id];
+        snapshot.validMask |= validMask & NAV_BIT(id);
+    }
+
+    latch->sequence++;
+    NAV_COMPILER_BARRIER();
+    latch->snapshot[0] = snapshot;
+    NAV_COMPILER_BARRIER();
+    latch->sequence++;
+    NAV_COMPILER_BARRIER();
+    latch->snapshot[1] = snapshot;
+}
+
+// Register a subscriber to a set of values
+// Returns the subscriber ID, -1 if no more subscriber can be registered
+int NavigationData::Subscribe(const char *name, uint32_t valueMask, NavSubscriberCallback_t callback, void *context)
+{
+    if (nbSubscribers >= NAV_MAX_SUBSCRIBERS)
+    {
+        return -1;
+    }
+
+    NavSubscriber_t *subscriber = &subscribers[nbSubscribers];
+    memset(subscriber, 0, sizeof(NavSubscriber_t));
+    subscriber->name      = name;
+    subscriber->valueMask = valueMask;
+    subscriber->callback  = callback;
+    subscriber->context   = context;
+
+    return nbSubscribers++;
+}
+
+void NavigationData::RemoveAllSubscribers()
+{
+    nbSubscribers = 0;
+    memset(subscribers, 0, sizeof(subscribers));
+}
+
+void NavigationData::SetPublishHook(NavPublishHook_t hook)
+{
+    publishHook = hook;
+}
+
+// Notify subscribers of the values which changed since their last notification
+// Subscribers are notified in registration order, values they publish are notified during the next round
+// Values set by a subscriber inherit the origin of the oldest change it is notified of, and the grouped ones reach snapshot
+// readers when its callback returns. Origin and deferred groups of the caller are restored on return.
+void NavigationData::Dispatch()
+{
+    bool     savedOriginSet        = originSet;
+    uint32_t savedOrigin_us        = currentOrigin_us;
+    uint32_t savedPendingGroupMask = pendingGroupMask;
+
+    pendingGroupMask = 0;
+
+    for (int pass = 0; pass < NAV_MAX_DISPATCH_PASSES; pass++)
+    {
+        bool notified = false;
+
+        for (int i = 0; i < nbSubscribers; i++)
+        {
+            NavSubscriber_t *subscriber = &subscribers[i];
+            uint32_t         changed    = subscriber->pendingMask;
+
+            if (changed != 0)
+            {
+                uint32_t latency_us     = micros() - subscriber->firstPending_us;
+                uint8_t  depth          = __builtin_popcount(changed);
+                subscriber->pendingMask = 0;
+                subscriber->nbNotifications++;
+                subscriber->totalDepth += depth;
+                if (depth > subscriber->maxDepth)
+                {
+                    subscriber->maxDepth = depth;
+                }
+                if (latency_us > subscriber->maxLatency_us)
+                {
+                    subscriber->maxLatency_us = latency_us;
+                }
+
+                SetOrigin(GetOldestOrigin_us(changed));
+                subscriber->callback(subscriber->context, changed);
+                ResetOrigin();
+                notified = true;
+            }
+        }
+
+        if (!notified)
+        {
+            break;
+        }
+    }
+
+    originSet        = savedOriginSet;
+    currentOrigin_us = savedOrigin_us;
+    pendingGroupMask = savedPendingGroupMask;
+}
+
+int NavigationData::GetNbSubscribers()
+{
+    return nbSubscribers;
+}
+
+bool NavigationData::GetSubscriberStatistics(int subscriberId, NavSubscriber_t *subscriber)
+{
+    if ((subscriberId < 0) || (subscriberId >= nbSubscribers))
+    {
+        return false;
+    }
+
+    *subscriber = subscribers[subscriberId];
+    return true;
+}
+
+void NavigationData::ResetStatistics()
+{
+    for (int i = 0; i < nbSubscribers; i++)
+    {
+        subscribers[i].nbEvents        = 0;
+        subscribers[i].nbCoalesced     = 0;
+        subscribers[i].nbNotifications = 0;
+        subscribers[i].totalDepth      = 0;
+        subscribers[i].maxDepth        = 0;
+        subscribers[i].maxLatency_us   = 0;
+    }
+}
+
+// Record a value change for all subscribers interested in it
+void NavigationData::Publish(uint32_t bit)
+{
+    bool wakeUp = false;
+
+    for (int i = 0; i < nbSubscribers; i++)
+    {
+        NavSubscriber_t *subscriber = &subscribers[i];
+
+        if (subscriber->valueMask & bit)
+        {
+            subscriber->nbEvents++;
+            if (subscriber->pendingMask & bit)
+            {
+                subscriber->nbCoalesced++;
+            }
+            else if (subscriber->pendingMask == 0)
+            {
+                subscriber->firstPending_us = micros();
+                wakeUp                      = true;
+            }
+            subscriber->pendingMask |= bit;
+        }
+    }
+
+    if (wakeUp && (publishHook != nullptr))
+    {
+        publishHook();
+    }
 }
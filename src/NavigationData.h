@@ -38,23 +38,113 @@
 /***************************************************************************/
 
 #define WAYPOINT_NAME_LENGTH 16
+#define NAV_MAX_SUBSCRIBERS  8
+#define NAV_GROUP_MAX_VALUES 2
+
+/***************************************************************************/
+/*                                Macros                                   */
+/***************************************************************************/
+
+// Bit of a value in valid and dirty masks
+#define NAV_BIT(id) (1UL << (id))
 
 /***************************************************************************/
 /*                                Types                                    */
 /***************************************************************************/
 
+// Identifiers of the scalar values of the navigation data store
+typedef enum
+{
+    NAV_ID_SPD_KT = 0,
+    NAV_ID_AWA_DEG,
+    NAV_ID_AWS_KT,
+    NAV_ID_TWA_DEG,
+    NAV_ID_TWS_KT,
+    NAV_ID_TWD_DEG,        // True wind direction, referenced to true north
+    NAV_ID_DAMPED_TWA_DEG, // Damped true wind angle
+    NAV_ID_DAMPED_TWS_KT,  // Damped true wind speed
+    NAV_ID_DAMPED_TWD_DEG, // Damped true wind direction
+    NAV_ID_TWD_SHIFT_DEG,  // Damped true wind direction minus its average over windShift_min
+    NAV_ID_GWD_DEG,        // Ground wind direction, referenced to true north
+    NAV_ID_GWS_KT,         // Ground wind speed
+    NAV_ID_DPT_M,
+    NAV_ID_VCC_V,
+    NAV_ID_LOG_NM,
+    NAV_ID_TRIP_NM,
+    NAV_ID_STP_DEGC,
+    NAV_ID_LATITUDE_DEG,
+    NAV_ID_LONGITUDE_DEG,
+    NAV_ID_COG_DEG,
+    NAV_ID_SOG_KT,
+    NAV_ID_XTE_NM,
+    NAV_ID_DTW_NM,
+    NAV_ID_BTW_DEG,
+    NAV_ID_VMGWP_KT,
+    NAV_ID_MAG_HDG_DEG, // Magnetic heading (includes heading offset but not magnetic variation or deviation)
+    NAV_ID_ROT_DEGPMIN, // Rate of turn, negative when bow turns to port
+    NAV_ID_HEEL_DEG,    // Heel angle, positive when heeling to starboard
+    NAV_ID_PITCH_DEG,   // Pitch angle, positive when bow goes up
+    NAV_NB_VALUES
+} NavValueId_t;
+
+// Groups of values decoded from the same input, which encoders must not mix from different updates
+typedef enum
+{
+    NAV_GROUP_POSITION = 0,  // Latitude, longitude
+    NAV_GROUP_SOGCOG,        // SOG, COG
+    NAV_GROUP_APPARENT_WIND, // AWA, AWS
+    NAV_NB_GROUPS
+} NavGroupId_t;
+
+// Consistent copy of the values of a group, in the order given by NavGroupId_t
 typedef struct
 {
-    bool     valid;
-    float    value;
-    uint32_t timeStamp;
-} FloatValue_t;
+    float    value[NAV_GROUP_MAX_VALUES];
+    uint32_t validMask; // NAV_BIT() of the valid values of the group
+} NavGroupSnapshot_t;
+
+// Seqlock latch of a group : readers copy snapshot[sequence & 1] and retry if sequence changed meanwhile
+typedef struct
+{
+    volatile uint32_t  sequence;
+    NavGroupSnapshot_t snapshot[2];
+} NavGroupLatch_t;
+
+// Called with the mask of subscribed values which changed since last notification
+typedef void (*NavSubscriberCallback_t)(void *context, uint32_t changedMask);
+// Called when a subscriber gets its first pending change, so that dispatching can be scheduled
+typedef void (*NavPublishHook_t)();
+
+typedef struct
+{
+    const char             *name;
+    uint32_t                valueMask; // Values this subscriber is interested in
+    NavSubscriberCallback_t callback;
+    void                   *context;
+    uint32_t                pendingMask; // Changed values not notified yet
+    uint32_t                firstPending_us;
+    uint32_t                nbEvents;    // Number of value changes published to this subscriber
+    uint32_t                nbCoalesced; // Number of value changes merged into an already pending one
+    uint32_t                nbNotifications;
+    uint32_t                totalDepth; // Sum of pending values at each notification
+    uint8_t                 maxDepth;
+    uint32_t                maxLatency_us;
+} NavSubscriber_t;
+
+// Static description of a navigation value
+typedef struct
+{
+    const char *name;
+    uint32_t    validityTime_ms;
+} NavValueDesc_t;
 
 typedef struct
 {
     bool     valid;
     uint8_t  hour;
     uint8_t  minute;
+    uint8_t  second;
+    uint8_t  centisecond;
     uint32_t timeStamp;
 } TimeValue_t;
 
@@ -75,6 +165,21 @@ typedef struct
     uint32_t timeStamp;
 } WaypointName_t;
 
+// GNSS fix quality, only provided by UBX NAV-PVT messages
+typedef struct
+{
+    bool     valid;
+    uint8_t  fixType; // 0 : no fix, 1 : dead reckoning only, 2 : 2D, 3 : 3D, 4 : GNSS + dead reckoning, 5 : time only
+    uint8_t  nbSatellites;
+    float    pdop;
+    float    altitude_m;    // Height above mean sea level
+    float    hAccuracy_m;   // Horizontal position accuracy estimate
+    float    vAccuracy_m;   // Vertical position accuracy estimate
+    float    sAccuracy_kt;  // Speed accuracy estimate
+    float    cAccuracy_deg; // Course accuracy estimate
+    uint32_t timeStamp;
+} GnssFix_t;
+
 /***************************************************************************/
 /*                               Classes                                   */
 /***************************************************************************/
@@ -85,32 +190,32 @@ class NavigationData
     NavigationData();
     virtual ~NavigationData();
 
-    void UpdateValidity();
-
-    FloatValue_t spd_kt;
-    FloatValue_t awa_deg;
-    FloatValue_t aws_kt;
-    FloatValue_t twa_deg;
-    FloatValue_t tws_kt;
-    FloatValue_t dpt_m;
-    FloatValue_t vcc_v;
-    FloatValue_t log_nm;
-    FloatValue_t trip_nm;
-    FloatValue_t stp_degc;
+    void        UpdateValidity();
+    void        Set(NavValueId_t id, float newValue);
+    void        Invalidate(NavValueId_t id);
+    float       Get(NavValueId_t id);
+    bool        IsValid(NavValueId_t id);
+    uint32_t    GetTimeStamp(NavValueId_t id);
+    uint32_t    GetValidMask();
+    const char *GetName(NavValueId_t id);
+    void        SetOrigin(uint32_t newOrigin_us);
+    void        ResetOrigin();
+    uint32_t    GetOrigin_us(NavValueId_t id);
+    uint32_t    GetOldestOrigin_us(uint32_t valueMask);
+    void        GetSnapshot(NavGroupId_t group, NavGroupSnapshot_t *snapshot);
+
+    int  Subscribe(const char *name, uint32_t valueMask, NavSubscriberCallback_t callback, void *context);
+    void RemoveAllSubscribers();
+    void SetPublishHook(NavPublishHook_t hook);
+    void Dispatch();
+    int  GetNbSubscribers();
+    bool GetSubscriberStatistics(int subscriberId, NavSubscriber_t *subscriber);
+    void ResetStatistics();
 
     TimeValue_t    time;
     DateValue_t    date;
-    FloatValue_t   latitude_deg;
-    FloatValue_t   longitude_deg;
-    FloatValue_t   cog_deg;
-    FloatValue_t   sog_kt;
-    FloatValue_t   xte_nm;
-    FloatValue_t   dtw_nm;
-    FloatValue_t   btw_deg;
     WaypointName_t waypoint;
-    FloatValue_t   vmgwp_kt;
-
-    FloatValue_t magHdg_deg; // Magnetic heading (includes heading offset but not magnetic variation or deviation)
+    GnssFix_t      gnssFix;
 
     bool  calibrationUpdated;
     float waterSpeedFactor_per;
@@ -121,6 +226,30 @@ class NavigationData
     float headingOffset_deg;
     float magneticVariation_deg;
     float windShift_min;
+
+  private:
+    static const NavValueDesc_t valueDesc[NAV_NB_VALUES];
+    static const NavValueId_t   groupValues[NAV_NB_GROUPS][NAV_GROUP_MAX_VALUES];
+
+    // Structure of arrays indexed by NavValueId_t
+    float    value[NAV_NB_VALUES];
+    uint32_t timeStamp[NAV_NB_VALUES];
+    uint32_t origin_us[NAV_NB_VALUES]; // micros() at which the input this value comes from was received
+    uint32_t validMask;
+    bool     originSet;
+    uint32_t currentOrigin_us; // Origin given to the next values set, if originSet is true
+
+    NavGroupLatch_t groupLatch[NAV_NB_GROUPS];
+    uint32_t        groupedMask;      // Values which belong to a group
+    uint32_t        pendingGroupMask; // Grouped values changed since SetOrigin, published to readers at ResetOrigin
+
+    NavSubscriber_t  subscribers[NAV_MAX_SUBSCRIBERS];
+    int              nbSubscribers;
+    NavPublishHook_t publishHook;
+
+    void Publish(uint32_t bit);
+    void UpdateGroups(uint32_t changedMask);
+    void PublishGroup(int group);
 };
 
 #endif /* NAVIGATIONDATA_H_ */
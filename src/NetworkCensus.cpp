@@ -0,0 +1,294 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Passive census of surrounding Micronet networks               *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "NetworkCensus.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Weight of the new sample in RSSI exponential average (1/2^RSSI_AVG_SHIFT)
+#define RSSI_AVG_SHIFT 3
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+NetworkCensus::NetworkCensus()
+{
+    memset(networks, 0, sizeof(networks));
+    memset(devices, 0, sizeof(devices));
+}
+
+NetworkCensus::~NetworkCensus()
+{
+}
+
+// Clear the census before RF reception starts feeding it
+void NetworkCensus::Init()
+{
+    Reset();
+}
+
+void NetworkCensus::Reset()
+{
+    noInterrupts();
+    memset(networks, 0, sizeof(networks));
+    memset(devices, 0, sizeof(devices));
+    interrupts();
+}
+
+// Account a received message into the census. This function is designed to be called from RF ISR : it only does a few comparisons
+// on small arrays and never blocks.
+void NetworkCensus::AddMessageIsr(MicronetMessage_t const &message)
+{
+    uint32_t networkId, deviceId;
+    uint8_t  crc = 0;
+
+    if (message.len < MICRONET_PAYLOAD_OFFSET)
+    {
+        return;
+    }
+
+    // Ignore messages with an invalid header : their IDs can't be trusted
+    for (int i = 0; i < MICRONET_CRC_OFFSET; i++)
+    {
+        crc += message.data[i];
+    }
+    if ((crc != message.data[MICRONET_CRC_OFFSET]) || (message.data[MICRONET_LEN_OFFSET_1] != message.data[MICRONET_LEN_OFFSET_2]))
+    {
+        return;
+    }
+
+    networkId = message.data[MICRONET_NUID_OFFSET];
+    networkId = (networkId << 8) | message.data[MICRONET_NUID_OFFSET + 1];
+    networkId = (networkId << 8) | message.data[MICRONET_NUID_OFFSET + 2];
+    networkId = (networkId << 8) | message.data[MICRONET_NUID_OFFSET + 3];
+    deviceId  = message.data[MICRONET_DUID_OFFSET];
+    deviceId  = (deviceId << 8) | message.data[MICRONET_DUID_OFFSET + 1];
+    deviceId  = (deviceId << 8) | message.data[MICRONET_DUID_OFFSET + 2];
+    deviceId  = (deviceId << 8) | message.data[MICRONET_DUID_OFFSET + 3];
+
+    uint32_t         now     = millis();
+    CensusNetwork_t *network = FindNetwork(networkId);
+    CensusDevice_t  *device  = FindDevice(networkId, deviceId);
+
+    if (network->nbFrames == 0)
+    {
+        network->rssiMin    = message.rssi;
+        network->rssiMax    = message.rssi;
+        network->rssiAvg_q4 = message.rssi * 16;
+    }
+    if (message.rssi < network->rssiMin)
+        network->rssiMin = message.rssi;
+    if (message.rssi > network->rssiMax)
+        network->rssiMax = message.rssi;
+    network->rssiAvg_q4 += ((message.rssi * 16) - network->rssiAvg_q4) >> RSSI_AVG_SHIFT;
+    network->nbFrames++;
+    network->lastSeen_ms = now;
+    if (message.data[MICRONET_MI_OFFSET] == MICRONET_MESSAGE_ID_MASTER_REQUEST)
+    {
+        network->masterDeviceId = deviceId;
+    }
+
+    if (device->nbFrames == 0)
+    {
+        device->rssiMin    = message.rssi;
+        device->rssiMax    = message.rssi;
+        device->rssiAvg_q4 = message.rssi * 16;
+        network->nbDevices++;
+    }
+    if (message.rssi < device->rssiMin)
+        device->rssiMin = message.rssi;
+    if (message.rssi > device->rssiMax)
+        device->rssiMax = message.rssi;
+    device->rssiAvg_q4 += ((message.rssi * 16) - device->rssiAvg_q4) >> RSSI_AVG_SHIFT;
+    device->nbFrames++;
+    device->lastSeen_ms = now;
+}
+
+// Get a copy of the network list, sorted by decreasing average RSSI
+// Returns the number of networks copied to networkList
+int NetworkCensus::GetNetworks(CensusNetwork_t *networkList, int maxNetworks)
+{
+    int nbNetworks = 0;
+
+    for (int i = 0; (i < CENSUS_MAX_NETWORKS) && (nbNetworks < maxNetworks); i++)
+    {
+        CensusNetwork_t network;
+
+        noInterrupts();
+        network = networks[i];
+        interrupts();
+
+        if (network.nbFrames == 0)
+        {
+            continue;
+        }
+
+        // Insert network in the list by order of reception power
+        int j = nbNetworks;
+        while ((j > 0) && (networkList[j - 1].rssiAvg_q4 < network.rssiAvg_q4))
+        {
+            networkList[j] = networkList[j - 1];
+            j--;
+        }
+        networkList[j] = network;
+        nbNetworks++;
+    }
+
+    return nbNetworks;
+}
+
+// Get a copy of the devices seen on a given network, sorted by device ID
+// Returns the number of devices copied to deviceList
+int NetworkCensus::GetDevices(uint32_t networkId, CensusDevice_t *deviceList, int maxDevices)
+{
+    int nbDevices = 0;
+
+    for (int i = 0; (i < CENSUS_MAX_DEVICES) && (nbDevices < maxDevices); i++)
+    {
+        CensusDevice_t device;
+
+        noInterrupts();
+        device = devices[i];
+        interrupts();
+
+        if ((device.nbFrames == 0) || (device.networkId != networkId))
+        {
+            continue;
+        }
+
+        int j = nbDevices;
+        while ((j > 0) && (deviceList[j - 1].deviceId > device.deviceId))
+        {
+            deviceList[j] = deviceList[j - 1];
+            j--;
+        }
+        deviceList[j] = device;
+        nbDevices++;
+    }
+
+    return nbDevices;
+}
+
+// Returns the entry of the given network. If the network is unknown, a free or the least recently seen entry is recycled.
+CensusNetwork_t *NetworkCensus::FindNetwork(uint32_t networkId)
+{
+    int oldestIndex = 0;
+
+    for (int i = 0; i < CENSUS_MAX_NETWORKS; i++)
+    {
+        if ((networks[i].networkId == networkId) && (networks[i].nbFrames != 0))
+        {
+            return &networks[i];
+        }
+        if ((networks[i].nbFrames == 0) ||
+            ((networks[oldestIndex].nbFrames != 0) && IsOlder(networks[i].lastSeen_ms, networks[oldestIndex].lastSeen_ms)))
+        {
+            oldestIndex = i;
+        }
+    }
+
+    // Devices of a recycled network must go with it
+    if (networks[oldestIndex].nbFrames != 0)
+    {
+        for (int i = 0; i < CENSUS_MAX_DEVICES; i++)
+        {
+            if (devices[i].networkId == networks[oldestIndex].networkId)
+            {
+                devices[i].nbFrames = 0;
+            }
+        }
+    }
+
+    memset(&networks[oldestIndex], 0, sizeof(CensusNetwork_t));
+    networks[oldestIndex].networkId = networkId;
+
+    return &networks[oldestIndex];
+}
+
+// Returns the entry of the given device. If the device is unknown, a free or the least recently seen entry is recycled.
+CensusDevice_t *NetworkCensus::FindDevice(uint32_t networkId, uint32_t deviceId)
+{
+    int oldestIndex = 0;
+
+    for (int i = 0; i < CENSUS_MAX_DEVICES; i++)
+    {
+        if ((devices[i].deviceId == deviceId) && (devices[i].networkId == networkId) && (devices[i].nbFrames != 0))
+        {
+            return &devices[i];
+        }
+        if ((devices[i].nbFrames == 0) || ((devices[oldestIndex].nbFrames != 0) && IsOlder(devices[i].lastSeen_ms, devices[oldestIndex].lastSeen_ms)))
+        {
+            oldestIndex = i;
+        }
+    }
+
+    // A recycled device is no longer counted in its network
+    if (devices[oldestIndex].nbFrames != 0)
+    {
+        for (int i = 0; i < CENSUS_MAX_NETWORKS; i++)
+        {
+            if ((networks[i].networkId == devices[oldestIndex].networkId) && (networks[i].nbFrames != 0) && (networks[i].nbDevices > 0))
+            {
+                networks[i].nbDevices--;
+                break;
+            }
+        }
+    }
+
+    memset(&devices[oldestIndex], 0, sizeof(CensusDevice_t));
+    devices[oldestIndex].networkId = networkId;
+    devices[oldestIndex].deviceId  = deviceId;
+
+    return &devices[oldestIndex];
+}
+
+// Compare two millis() time stamps, remaining correct when millis() wraps around
+bool NetworkCensus::IsOlder(uint32_t time1_ms, uint32_t time2_ms)
+{
+    return (int32_t)(time1_ms - time2_ms) < 0;
+}
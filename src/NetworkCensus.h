@@ -0,0 +1,99 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Passive census of surrounding Micronet networks               *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef NETWORKCENSUS_H_
+#define NETWORKCENSUS_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "Micronet.h"
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Maximum number of networks and devices tracked by the census. When full, the least recently seen entry is recycled.
+#define CENSUS_MAX_NETWORKS 8
+#define CENSUS_MAX_DEVICES  64
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+typedef struct
+{
+    uint32_t networkId;
+    uint32_t masterDeviceId; // Zero until a MASTER_REQUEST has been received from this network
+    uint32_t nbDevices;
+    uint32_t nbFrames;
+    int16_t  rssiMin;
+    int16_t  rssiMax;
+    int32_t  rssiAvg_q4; // Exponential average of RSSI, fixed point with 4 fractional bits
+    uint32_t lastSeen_ms;
+} CensusNetwork_t;
+
+typedef struct
+{
+    uint32_t deviceId;
+    uint32_t networkId;
+    uint32_t nbFrames;
+    int16_t  rssiMin;
+    int16_t  rssiMax;
+    int32_t  rssiAvg_q4; // Exponential average of RSSI, fixed point with 4 fractional bits
+    uint32_t lastSeen_ms;
+} CensusDevice_t;
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class NetworkCensus
+{
+  public:
+    NetworkCensus();
+    virtual ~NetworkCensus();
+
+    void Init();
+    void Reset();
+    void AddMessageIsr(MicronetMessage_t const &message);
+    int  GetNetworks(CensusNetwork_t *networkList, int maxNetworks);
+    int  GetDevices(uint32_t networkId, CensusDevice_t *deviceList, int maxDevices);
+
+  private:
+    CensusNetwork_t networks[CENSUS_MAX_NETWORKS];
+    CensusDevice_t  devices[CENSUS_MAX_DEVICES];
+
+    CensusNetwork_t *FindNetwork(uint32_t networkId);
+    CensusDevice_t  *FindDevice(uint32_t networkId, uint32_t deviceId);
+
+    static bool IsOlder(uint32_t time1_ms, uint32_t time2_ms);
+};
+
+#endif /* NETWORKCENSUS_H_ */
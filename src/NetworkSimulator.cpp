@@ -0,0 +1,673 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Discrete event simulation of a Micronet network               *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "NetworkSimulator.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define SIM_NETWORK_ID      0x83038c8e
+#define SIM_MASTER_ID       0x81038c8e
+#define SIM_SLAVE_ID        0x03123456
+#define SIM_CYCLE_PERIOD_US 1000000
+#define SIM_SIGNAL_STRENGTH 0x05
+#define SIM_RSSI            -60
+#define SIM_MAX_BACKOFF     4 // Simulated devices wait up to 2^4 cycles before requesting a slot again
+#define SIM_RF_WAKE_UP_US   800 // Time for CC1101 to receive again after a power up, as assumed by MicronetSlaveDevice
+
+#define SIM_SENDER_MASTER 0
+#define SIM_SENDER_DEVICE 1
+#define SIM_SENDER_SLAVE  2
+#define SIM_SENDER_RADIO  3 // Power change of our device's radio, not a frame
+
+#define SIM_FRAME_ENCODE  0 // Waiting for late encoding
+#define SIM_FRAME_PENDING 1 // Waiting for its start time
+#define SIM_FRAME_ON_AIR  2
+#define SIM_FRAME_DONE    3
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+static bool CarriesField(MicronetMessage_t const *message, uint8_t fieldId);
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+NetworkSimulator::NetworkSimulator()
+    : slaveCodec(nullptr), slaveDevice(nullptr), result(nullptr), nbMapDevices(0), nbFrames(0), slaveTxEnd_us(0), slaveRxEnd_us(0),
+      slaveRadioOn(true), slaveRadioOn_us(0), slaveListenFrom_us(0), nextGnss_us(0), randomState(1)
+{
+    memset(&config, 0, sizeof(config));
+}
+
+NetworkSimulator::~NetworkSimulator()
+{
+}
+
+// Simulate the given number of network cycles. Time is virtual : each event is processed as soon as the previous one is, so the
+// simulation runs much faster than the network it models.
+void NetworkSimulator::Run(SimConfig_t const &simConfig, SimResult_t *simResult)
+{
+    MicronetCodec       codec;
+    MicronetSlaveDevice device(&codec);
+    uint32_t            eventTime_us;
+    int                 index;
+
+    config = simConfig;
+    result = simResult;
+    if (config.nbDevices > SIM_MAX_DEVICES)
+    {
+        config.nbDevices = SIM_MAX_DEVICES;
+    }
+    if (config.gnssPeriod_us == 0)
+    {
+        config.gnssPeriod_us = SIM_CYCLE_PERIOD_US;
+    }
+    memset(result, 0, sizeof(SimResult_t));
+
+    slaveCodec         = &codec;
+    slaveDevice        = &device;
+    randomState        = (config.seed != 0) ? config.seed : 1;
+    nbMapDevices       = 0;
+    slaveTxEnd_us      = 0;
+    slaveRxEnd_us      = 0;
+    slaveRadioOn       = true;
+    slaveRadioOn_us    = SIM_CYCLE_PERIOD_US; // Radio time is accounted from the first cycle
+    slaveListenFrom_us = 0;
+    nextGnss_us        = SIM_CYCLE_PERIOD_US + Random(config.gnssPeriod_us);
+    txFifo.ResetFifo();
+    InitDevices();
+
+    device.SetNetworkId(SIM_NETWORK_ID);
+    device.SetDeviceId(SIM_SLAVE_ID);
+    // Same fields as during NMEA conversion with a compass
+    device.SetDataFields(DATA_FIELD_TIME | DATA_FIELD_SOGCOG | DATA_FIELD_DATE | DATA_FIELD_POSITION | DATA_FIELD_XTE | DATA_FIELD_DTW |
+                         DATA_FIELD_BTW | DATA_FIELD_VMGWP | DATA_FIELD_NODE_INFO | DATA_FIELD_HDG);
+    device.SetRxGating(config.rxGating);
+    // Latencies on the virtual clock must not be mixed with those measured by the converter
+    device.SetLatencyTracer(nullptr);
+
+    for (uint32_t cycle = 0; cycle < config.nbCycles; cycle++)
+    {
+        StartCycle(cycle);
+        while ((index = GetNextEvent(&eventTime_us)) >= 0)
+        {
+            UpdateGnss(eventTime_us);
+            ProcessEvent(index);
+        }
+    }
+    result->nbCycles = config.nbCycles;
+    if (slaveRadioOn)
+    {
+        result->radioOn_us += SIM_CYCLE_PERIOD_US * (config.nbCycles + 1) - slaveRadioOn_us;
+    }
+
+    slaveCodec  = nullptr;
+    slaveDevice = nullptr;
+}
+
+// Simulated devices are hull transmitters, wind transducers and displays in turn. They all start out of the network. Displays
+// only send their node information.
+void NetworkSimulator::InitDevices()
+{
+    NavigationData *navData = &deviceCodec.navData;
+
+    navData->waterSpeedFactor_per = 1.0f;
+    navData->windSpeedFactor_per  = 1.0f;
+    navData->Set(NAV_ID_SPD_KT, 6.2f);
+    navData->Set(NAV_ID_DPT_M, 12.5f);
+    navData->Set(NAV_ID_AWS_KT, 14.0f);
+    navData->Set(NAV_ID_AWA_DEG, 35.0f);
+
+    for (uint32_t i = 0; i < config.nbDevices; i++)
+    {
+        uint32_t deviceType;
+
+        switch (i % 3)
+        {
+        case 0:
+            deviceType            = MICRONET_DEVICE_TYPE_HULL_TRANSMITTER;
+            devices[i].dataFields = DATA_FIELD_SPD | DATA_FIELD_DPT;
+            break;
+        case 1:
+            deviceType            = MICRONET_DEVICE_TYPE_WIND_TRANSDUCER;
+            devices[i].dataFields = DATA_FIELD_AWS | DATA_FIELD_AWA;
+            break;
+        default:
+            deviceType            = MICRONET_DEVICE_TYPE_DUAL_DISPLAY;
+            devices[i].dataFields = DATA_FIELD_NODE_INFO;
+            break;
+        }
+
+        devices[i].deviceId         = (deviceType << 24) | (0x100000 + i);
+        devices[i].payloadBytes     = deviceCodec.GetDataMessageLength(devices[i].dataFields);
+        devices[i].nbRequests       = 0;
+        devices[i].nextRequestCycle = 0;
+    }
+}
+
+// Master sends its request with the slots allocated so far, then each device in the network sends its data in its slot while
+// the others ask for one in the asynchronous window
+void NetworkSimulator::StartCycle(uint32_t cycle)
+{
+    MicronetMessage_t message;
+    uint32_t          start_us = SIM_CYCLE_PERIOD_US * (cycle + 1);
+
+    nbFrames = 0;
+
+    deviceCodec.EncodeMasterRequestMessage(&message, SIM_SIGNAL_STRENGTH, SIM_NETWORK_ID, SIM_MASTER_ID, nbMapDevices, mapDeviceId, mapPayloadBytes);
+    message.startTime_us = start_us;
+    message.endTime_us   = start_us + PREAMBLE_LENGTH_IN_US + message.len * BYTE_LENGTH_IN_US + GUARD_TIME_IN_US;
+    deviceCodec.GetNetworkMap(&message, &networkMap);
+    AddFrame(message, SIM_SENDER_MASTER, start_us);
+
+    if (result->joinCycle == 0)
+    {
+        bool allJoined = true;
+        for (int i = 0; i < NUMBER_OF_VIRTUAL_SLAVES; i++)
+        {
+            allJoined &= (deviceCodec.GetSyncTransmissionSlot(&networkMap, SIM_SLAVE_ID + i).start_us != 0);
+        }
+        result->joinCycle = allJoined ? cycle : 0;
+    }
+
+    for (uint32_t i = 0; i < config.nbDevices; i++)
+    {
+        SimDevice_t *device = &devices[i];
+
+        if (IsInMap(device->deviceId))
+        {
+            TxSlotDesc_t slot = deviceCodec.GetSyncTransmissionSlot(&networkMap, device->deviceId);
+            if (slot.start_us != 0)
+            {
+                deviceCodec.EncodeDataMessage(&message, SIM_SIGNAL_STRENGTH, SIM_NETWORK_ID, device->deviceId, device->dataFields);
+                AddFrame(message, SIM_SENDER_DEVICE, slot.start_us);
+            }
+        }
+        else if (cycle >= device->nextRequestCycle)
+        {
+            // Exponential backoff, so that devices whose requests collided don't collide again at each cycle
+            deviceCodec.EncodeSlotRequestMessage(&message, SIM_SIGNAL_STRENGTH, SIM_NETWORK_ID, device->deviceId, device->payloadBytes);
+            AddAsyncFrame(message, SIM_SENDER_DEVICE);
+            device->nbRequests++;
+            device->nextRequestCycle = cycle + 1 + Random(1 << ((device->nbRequests < SIM_MAX_BACKOFF) ? device->nbRequests : SIM_MAX_BACKOFF));
+        }
+    }
+
+    if ((config.parameterPeriod != 0) && ((cycle % config.parameterPeriod) == (config.parameterPeriod - 1)))
+    {
+        deviceCodec.EncodeSetParameterMessage(&message, SIM_SIGNAL_STRENGTH, SIM_NETWORK_ID, SIM_MASTER_ID,
+                                              MICRONET_CALIBRATION_WIND_SPEED_FACTOR_ID, 1, Random(10));
+        AddAsyncFrame(message, SIM_SENDER_MASTER);
+    }
+}
+
+// Returns the index of the frame with the earliest pending event, or -1 when the cycle is complete
+int NetworkSimulator::GetNextEvent(uint32_t *eventTime_us)
+{
+    uint32_t minTime_us = 0xffffffff;
+    int      minIndex   = -1;
+
+    for (int i = 0; i < nbFrames; i++)
+    {
+        uint32_t time_us;
+
+        switch (frames[i].state)
+        {
+        case SIM_FRAME_ENCODE:
+            time_us = frames[i].message.startTime_us - LATE_ENCODING_LEAD_US;
+            break;
+        case SIM_FRAME_PENDING:
+            time_us = frames[i].message.startTime_us;
+            break;
+        case SIM_FRAME_ON_AIR:
+            time_us = frames[i].end_us;
+            break;
+        default:
+            continue;
+        }
+
+        if (time_us < minTime_us)
+        {
+            minTime_us = time_us;
+            minIndex   = i;
+        }
+    }
+
+    *eventTime_us = minTime_us;
+    return minIndex;
+}
+
+void NetworkSimulator::ProcessEvent(int index)
+{
+    SimFrame_t *frame = &frames[index];
+
+    switch (frame->state)
+    {
+    case SIM_FRAME_ENCODE:
+        // As RfDriver does, the payload is refreshed just before the slot, or sent as planned if the encoder fails
+        if (MicronetSlaveDevice::LateEncoderCallback(slaveDevice, &frame->message))
+        {
+            TakePositionOrigin(frame);
+        }
+        frame->message.action = MICRONET_ACTION_RF_NO_ACTION;
+        frame->state          = SIM_FRAME_PENDING;
+        break;
+    case SIM_FRAME_PENDING:
+        if (frame->sender == SIM_SENDER_RADIO)
+        {
+            ChangeSlavePower(frame);
+        }
+        else
+        {
+            StartFrame(frame);
+        }
+        break;
+    case SIM_FRAME_ON_AIR:
+        EndFrame(frame);
+        break;
+    }
+}
+
+void NetworkSimulator::StartFrame(SimFrame_t *frame)
+{
+    MicronetMessage_t *message   = &frame->message;
+    uint32_t           start_us  = message->startTime_us;
+    uint8_t            messageId = message->data[MICRONET_MI_OFFSET];
+
+    frame->end_us       = start_us + PREAMBLE_LENGTH_IN_US + message->len * BYTE_LENGTH_IN_US;
+    message->endTime_us = frame->end_us + GUARD_TIME_IN_US;
+
+    if ((messageId == MICRONET_MESSAGE_ID_REQUEST_SLOT) || (messageId == MICRONET_MESSAGE_ID_UPDATE_SLOT))
+    {
+        result->nbAsyncRequests++;
+    }
+
+    if (frame->sender == SIM_SENDER_SLAVE)
+    {
+        if (messageId == MICRONET_MESSAGE_ID_SEND_DATA)
+        {
+            result->nbDataMessages++;
+        }
+
+        // RfDriver drops a transmission whose time comes while its radio is still transmitting or receiving
+        if ((start_us < slaveTxEnd_us) || (start_us < slaveRxEnd_us))
+        {
+            result->nbDropped++;
+            frame->state = SIM_FRAME_DONE;
+            return;
+        }
+        slaveTxEnd_us = frame->end_us;
+
+        if (frame->carriesPosition)
+        {
+            uint32_t age_us = start_us - frame->positionOrigin_us;
+
+            result->nbAgeSamples++;
+            result->totalAge_us += age_us;
+            if (age_us > result->maxAge_us)
+            {
+                result->maxAge_us = age_us;
+            }
+        }
+    }
+    else if (slaveRadioOn && (start_us >= slaveListenFrom_us) && (start_us >= slaveTxEnd_us) && (start_us >= slaveRxEnd_us))
+    {
+        frame->heardBySlave = true;
+        slaveRxEnd_us       = frame->end_us;
+    }
+
+    // Frames overlapping on air are all lost
+    for (int i = 0; i < nbFrames; i++)
+    {
+        if ((frames[i].state == SIM_FRAME_ON_AIR) && (frames[i].end_us > start_us))
+        {
+            frames[i].collided = true;
+            frame->collided    = true;
+        }
+    }
+
+    frame->state = SIM_FRAME_ON_AIR;
+}
+
+void NetworkSimulator::EndFrame(SimFrame_t *frame)
+{
+    MicronetMessage_t *message    = &frame->message;
+    uint8_t            messageId  = message->data[MICRONET_MI_OFFSET];
+    uint32_t           deviceId   = deviceCodec.GetDeviceId(message);
+    uint32_t           airtime_us = frame->end_us - message->startTime_us;
+    MicronetMessage_t  ackMessage;
+    TxSlotDesc_t       slot;
+
+    frame->state = SIM_FRAME_DONE;
+    result->networkAirtime_us += airtime_us;
+    if (frame->sender == SIM_SENDER_SLAVE)
+    {
+        result->slaveAirtime_us += airtime_us;
+    }
+
+    if (frame->collided)
+    {
+        if (frame->sender == SIM_SENDER_SLAVE)
+        {
+            result->nbCollisions++;
+        }
+        if ((messageId == MICRONET_MESSAGE_ID_REQUEST_SLOT) || (messageId == MICRONET_MESSAGE_ID_UPDATE_SLOT))
+        {
+            result->nbAsyncCollisions++;
+        }
+        return;
+    }
+
+    switch (messageId)
+    {
+    case MICRONET_MESSAGE_ID_REQUEST_SLOT:
+        AllocateSlot(deviceId, message->data[MICRONET_PAYLOAD_OFFSET + 1]);
+        break;
+    case MICRONET_MESSAGE_ID_UPDATE_SLOT:
+        AllocateSlot(deviceId, message->data[MICRONET_PAYLOAD_OFFSET]);
+        break;
+    case MICRONET_MESSAGE_ID_SET_PARAMETER:
+        // Every device of the network acknowledges the parameter in its own window
+        for (uint32_t i = 0; i < config.nbDevices; i++)
+        {
+            slot = deviceCodec.GetAckTransmissionSlot(&networkMap, devices[i].deviceId);
+            if (slot.start_us != 0)
+            {
+                deviceCodec.EncodeAckParamMessage(&ackMessage, SIM_SIGNAL_STRENGTH, SIM_NETWORK_ID, devices[i].deviceId);
+                AddFrame(ackMessage, SIM_SENDER_DEVICE, slot.start_us);
+            }
+        }
+        for (int i = 0; i < NUMBER_OF_VIRTUAL_SLAVES; i++)
+        {
+            if (deviceCodec.GetAckTransmissionSlot(&networkMap, SIM_SLAVE_ID + i).start_us != 0)
+            {
+                result->nbAcksExpected++;
+            }
+        }
+        break;
+    case MICRONET_MESSAGE_ID_SEND_DATA:
+        if (frame->sender == SIM_SENDER_SLAVE)
+        {
+            slot = deviceCodec.GetSyncTransmissionSlot(&networkMap, deviceId);
+            if ((message->startTime_us >= slot.start_us) && (frame->end_us <= slot.start_us + slot.length_us))
+            {
+                result->nbSlotHits++;
+            }
+        }
+        break;
+    case MICRONET_MESSAGE_ID_ACK_PARAMETER:
+        if (frame->sender == SIM_SENDER_SLAVE)
+        {
+            slot = deviceCodec.GetAckTransmissionSlot(&networkMap, deviceId);
+            if ((message->startTime_us >= slot.start_us) && (frame->end_us <= slot.start_us + slot.length_us))
+            {
+                result->nbAcksSent++;
+            }
+        }
+        break;
+    }
+
+    if (frame->sender != SIM_SENDER_SLAVE)
+    {
+        bool useful = IsUsefulToSlave(frame);
+
+        result->nbOtherFrames++;
+        result->nbUsefulFrames += useful ? 1 : 0;
+        if (frame->heardBySlave)
+        {
+            result->nbOtherHeard++;
+            result->nbUsefulHeard += useful ? 1 : 0;
+            DeliverToSlave(frame);
+        }
+    }
+}
+
+// Our device uses everything master sends and the data of sensors
+bool NetworkSimulator::IsUsefulToSlave(SimFrame_t *frame)
+{
+    MicronetMessage_t *message = &frame->message;
+
+    if (frame->sender == SIM_SENDER_MASTER)
+    {
+        return true;
+    }
+
+    return (message->data[MICRONET_MI_OFFSET] == MICRONET_MESSAGE_ID_SEND_DATA) &&
+           MicronetSlaveDevice::IsListenedDevice(deviceCodec.GetDeviceId(message));
+}
+
+// Power our device's radio down or up as RfDriver does : the change is dropped during a transmission, and cuts any reception
+// in progress
+void NetworkSimulator::ChangeSlavePower(SimFrame_t *frame)
+{
+    uint32_t time_us = frame->message.startTime_us;
+
+    frame->state = SIM_FRAME_DONE;
+    if (time_us < slaveTxEnd_us)
+    {
+        return;
+    }
+
+    for (int i = 0; i < nbFrames; i++)
+    {
+        if (frames[i].state == SIM_FRAME_ON_AIR)
+        {
+            frames[i].heardBySlave = false;
+        }
+    }
+    if (slaveRxEnd_us > time_us)
+    {
+        slaveRxEnd_us = time_us;
+    }
+
+    if (frame->message.action == MICRONET_ACTION_RF_LOW_POWER)
+    {
+        if (slaveRadioOn)
+        {
+            result->radioOn_us += time_us - slaveRadioOn_us;
+            slaveRadioOn = false;
+        }
+    }
+    else
+    {
+        if (!slaveRadioOn)
+        {
+            slaveRadioOn    = true;
+            slaveRadioOn_us = time_us;
+        }
+        slaveListenFrom_us = time_us + SIM_RF_WAKE_UP_US;
+    }
+}
+
+// Let our device process a frame it received, then schedule what it pushed in its transmit FIFO as RfDriver would
+void NetworkSimulator::DeliverToSlave(SimFrame_t *frame)
+{
+    MicronetMessage_t message;
+
+    slaveDevice->ProcessMessage(&frame->message, &txFifo);
+    while (txFifo.Pop(&message))
+    {
+        // Transmissions without an allocated slot don't go on air
+        if (message.startTime_us == 0)
+        {
+            continue;
+        }
+        // Transmissions and power changes already in the past are deleted by RfDriver
+        if ((int32_t)(message.startTime_us - frame->end_us) <= 0)
+        {
+            result->nbDropped += (message.len != 0) ? 1 : 0;
+            continue;
+        }
+        AddFrame(message, (message.len != 0) ? SIM_SENDER_SLAVE : SIM_SENDER_RADIO, message.startTime_us);
+    }
+}
+
+void NetworkSimulator::AddFrame(MicronetMessage_t const &message, uint8_t sender, uint32_t start_us)
+{
+    if (nbFrames >= SIM_MAX_FRAMES)
+    {
+        return;
+    }
+
+    SimFrame_t *frame           = &frames[nbFrames++];
+    frame->message              = message;
+    frame->message.startTime_us = start_us;
+    frame->message.rssi         = SIM_RSSI;
+    frame->sender               = sender;
+    frame->collided             = false;
+    frame->heardBySlave         = false;
+    frame->end_us               = 0;
+    frame->carriesPosition      = false;
+
+    // Our device encoded the message when it pushed it
+    if (sender == SIM_SENDER_SLAVE)
+    {
+        TakePositionOrigin(frame);
+    }
+
+    if ((sender == SIM_SENDER_SLAVE) && (message.action == MICRONET_ACTION_RF_LATE_ENCODING) && config.lateEncoding)
+    {
+        frame->state = SIM_FRAME_ENCODE;
+    }
+    else
+    {
+        if (sender != SIM_SENDER_RADIO)
+        {
+            frame->message.action = MICRONET_ACTION_RF_NO_ACTION;
+        }
+        frame->state = SIM_FRAME_PENDING;
+    }
+}
+
+// Note the origin of the position carried by a data message of our device, at the time it is encoded
+void NetworkSimulator::TakePositionOrigin(SimFrame_t *frame)
+{
+    NavigationData *navData = &slaveCodec->navData;
+
+    frame->carriesPosition = (frame->message.data[MICRONET_MI_OFFSET] == MICRONET_MESSAGE_ID_SEND_DATA) &&
+                             navData->IsValid(NAV_ID_LATITUDE_DEG) && CarriesField(&frame->message, MICRONET_FIELD_ID_LATLON);
+    if (frame->carriesPosition)
+    {
+        frame->positionOrigin_us = navData->GetOrigin_us(NAV_ID_LATITUDE_DEG);
+    }
+}
+
+// Schedule a frame at a random time of the asynchronous window
+void NetworkSimulator::AddAsyncFrame(MicronetMessage_t const &message, uint8_t sender)
+{
+    uint32_t airtime_us = PREAMBLE_LENGTH_IN_US + message.len * BYTE_LENGTH_IN_US;
+    uint32_t offset_us  = (airtime_us < ASYNC_WINDOW_LENGTH) ? Random(ASYNC_WINDOW_LENGTH - airtime_us) : 0;
+
+    AddFrame(message, sender, networkMap.asyncSlot.start_us + offset_us);
+}
+
+// Master gives a slot to a new device, or resizes the slot of a known one. Slots are effective from the next cycle.
+void NetworkSimulator::AllocateSlot(uint32_t deviceId, uint8_t payloadBytes)
+{
+    for (uint32_t i = 0; i < nbMapDevices; i++)
+    {
+        if (mapDeviceId[i] == deviceId)
+        {
+            mapPayloadBytes[i] = payloadBytes;
+            return;
+        }
+    }
+
+    if (nbMapDevices < MICRONET_MAX_DEVICES_PER_REQUEST - 1)
+    {
+        mapDeviceId[nbMapDevices]     = deviceId;
+        mapPayloadBytes[nbMapDevices] = payloadBytes;
+        nbMapDevices++;
+    }
+}
+
+bool NetworkSimulator::IsInMap(uint32_t deviceId)
+{
+    for (uint32_t i = 0; i < nbMapDevices; i++)
+    {
+        if (mapDeviceId[i] == deviceId)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Give our device all the GNSS updates received up to the given time. Their origin is their virtual reception time.
+void NetworkSimulator::UpdateGnss(uint32_t time_us)
+{
+    NavigationData *navData = &slaveCodec->navData;
+
+    while (nextGnss_us <= time_us)
+    {
+        navData->SetOrigin(nextGnss_us);
+        navData->Set(NAV_ID_LATITUDE_DEG, 47.6f);
+        navData->Set(NAV_ID_LONGITUDE_DEG, -3.4f);
+        navData->Set(NAV_ID_SOG_KT, 6.5f);
+        navData->Set(NAV_ID_COG_DEG, 245.0f);
+        navData->ResetOrigin();
+        nextGnss_us += config.gnssPeriod_us;
+    }
+}
+
+// xorshift32 pseudo random generator, returns a value in [0, range[
+uint32_t NetworkSimulator::Random(uint32_t range)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    return (range != 0) ? (randomState % range) : 0;
+}
+
+// Walk the data fields of a SEND_DATA message. Each field is made of its size, its content and a checksum.
+static bool CarriesField(MicronetMessage_t const *message, uint8_t fieldId)
+{
+    int offset = MICRONET_PAYLOAD_OFFSET;
+
+    while (offset + 1 < message->len)
+    {
+        if (message->data[offset + 1] == fieldId)
+        {
+            return true;
+        }
+        offset += message->data[offset] + 2;
+    }
+
+    return false;
+}
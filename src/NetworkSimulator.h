@@ -0,0 +1,164 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Discrete event simulation of a Micronet network               *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef NETWORKSIMULATOR_H_
+#define NETWORKSIMULATOR_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "Micronet.h"
+#include "MicronetCodec.h"
+#include "MicronetMessageFifo.h"
+#include "MicronetSlaveDevice.h"
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Devices simulated besides the master and the virtual slaves of our device, limited by the size of MASTER_REQUEST
+#define SIM_MAX_DEVICES (MICRONET_MAX_DEVICES_PER_REQUEST - 1 - NUMBER_OF_VIRTUAL_SLAVES)
+// Frames exchanged and radio power changes of our device during one network cycle
+#define SIM_MAX_FRAMES 96
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+typedef struct
+{
+    uint32_t nbDevices;       // Simulated hull, wind and display devices, besides master and our device
+    uint32_t nbCycles;        // Network cycles to simulate
+    uint32_t gnssPeriod_us;   // Period of GNSS updates given to our device
+    uint32_t parameterPeriod; // Network cycles between two parameter changes from master, 0 for none
+    uint32_t seed;            // Seed of the pseudo random generator, so that runs are reproducible
+    bool     rxGating;        // Let our device power its radio down during the slots it doesn't listen to
+    bool     lateEncoding;    // Encode data messages again just before their slot, as RfDriver does for MICRONET_ACTION_RF_LATE_ENCODING
+} SimConfig_t;
+
+typedef struct
+{
+    uint32_t nbCycles;
+    uint32_t joinCycle;          // Cycle at which all our virtual slaves had a sync slot, 0 if never
+    uint32_t nbDataMessages;     // Data messages scheduled by our device in its sync slots
+    uint32_t nbSlotHits;         // Data messages sent entirely inside their slot without collision
+    uint32_t nbDropped;          // Transmissions of our device dropped because its radio was busy
+    uint32_t nbCollisions;       // Transmissions of our device overlapped by another one on air
+    uint32_t nbAsyncRequests;    // Slot requests and updates sent by all devices
+    uint32_t nbAsyncCollisions;  // Slot requests and updates lost in a collision
+    uint32_t nbAcksExpected;     // Parameter acknowledges due by our virtual slaves
+    uint32_t nbAcksSent;         // Parameter acknowledges sent by our device inside their window without collision
+    uint64_t slaveAirtime_us;    // Time on air of our device
+    uint64_t networkAirtime_us;  // Time on air of all devices
+    uint32_t nbAgeSamples;       // Data messages carrying a position
+    uint64_t totalAge_us;        // Age of position at the start of these messages
+    uint32_t maxAge_us;
+    uint64_t radioOn_us;         // Time the radio of our device was not powered down
+    uint32_t nbOtherFrames;      // Frames of other devices received without collision
+    uint32_t nbOtherHeard;       // Of these, frames our device received
+    uint32_t nbUsefulFrames;     // Frames of other devices our device uses : MASTER_REQUEST, parameters and sensor data
+    uint32_t nbUsefulHeard;      // Of these, frames our device received
+} SimResult_t;
+
+typedef struct
+{
+    uint32_t deviceId;
+    uint32_t dataFields;       // Fields of its data message
+    uint8_t  payloadBytes;     // Payload of its data message
+    uint32_t nbRequests;       // Slot requests sent so far
+    uint32_t nextRequestCycle; // Cycle of the next slot request, until master gives a slot
+} SimDevice_t;
+
+typedef struct
+{
+    MicronetMessage_t message;
+    uint8_t           sender; // SIM_SENDER_*
+    uint8_t           state;  // SIM_FRAME_*
+    bool              collided;
+    bool              heardBySlave;      // Our device's radio was listening when the frame started
+    uint32_t          end_us;            // End of the frame on air
+    bool              carriesPosition;   // Data message of our device with a valid position
+    uint32_t          positionOrigin_us; // Origin of the position it carries, taken when it was encoded
+} SimFrame_t;
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+// Runs a virtual master, simulated devices and our slave device on a virtual clock sharing one air interface. Our device is the
+// real MicronetSlaveDevice with its own codec, and its transmissions follow the scheduling rules of RfDriver.
+class NetworkSimulator
+{
+  public:
+    NetworkSimulator();
+    virtual ~NetworkSimulator();
+
+    void Run(SimConfig_t const &config, SimResult_t *result);
+
+  private:
+    MicronetCodec             deviceCodec; // Encodes frames of master and simulated devices
+    MicronetCodec            *slaveCodec;
+    MicronetSlaveDevice      *slaveDevice;
+    MicronetMessageFifo       txFifo;
+    MicronetCodec::NetworkMap networkMap; // Map of the current cycle, as built by master
+    SimConfig_t               config;
+    SimResult_t              *result;
+    SimDevice_t               devices[SIM_MAX_DEVICES];
+    uint32_t                  nbMapDevices; // Devices which got a slot from master, in order of allocation
+    uint32_t                  mapDeviceId[MICRONET_MAX_DEVICES_PER_REQUEST];
+    uint8_t                   mapPayloadBytes[MICRONET_MAX_DEVICES_PER_REQUEST];
+    SimFrame_t                frames[SIM_MAX_FRAMES];
+    int                       nbFrames;
+    uint32_t                  slaveTxEnd_us;      // End of the current transmission of our device
+    uint32_t                  slaveRxEnd_us;      // End of the frame our device is currently receiving
+    bool                      slaveRadioOn;       // Radio of our device is not powered down
+    uint32_t                  slaveRadioOn_us;    // Time at which the radio of our device was last powered up
+    uint32_t                  slaveListenFrom_us; // Time from which the radio of our device receives after its power up
+    uint32_t                  nextGnss_us;
+    uint32_t                  randomState;
+
+    void     InitDevices();
+    void     StartCycle(uint32_t cycle);
+    int      GetNextEvent(uint32_t *eventTime_us);
+    void     ProcessEvent(int index);
+    void     StartFrame(SimFrame_t *frame);
+    void     EndFrame(SimFrame_t *frame);
+    void     DeliverToSlave(SimFrame_t *frame);
+    void     ChangeSlavePower(SimFrame_t *frame);
+    bool     IsUsefulToSlave(SimFrame_t *frame);
+    void     TakePositionOrigin(SimFrame_t *frame);
+    void     AddFrame(MicronetMessage_t const &message, uint8_t sender, uint32_t start_us);
+    void     AddAsyncFrame(MicronetMessage_t const &message, uint8_t sender);
+    void     AllocateSlot(uint32_t deviceId, uint8_t payloadBytes);
+    bool     IsInMap(uint32_t deviceId);
+    void     UpdateGnss(uint32_t time_us);
+    uint32_t Random(uint32_t range);
+};
+
+#endif /* NETWORKSIMULATOR_H_ */
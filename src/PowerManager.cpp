@@ -0,0 +1,201 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  CPU sleep and power state statistics                          *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "PowerManager.h"
+#include "Globals.h"
+
+#include <Arduino.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Decay of the wake-up latency estimate (1/2^WAKEUP_LATENCY_DECAY_SHIFT per sleep), so that an exceptional
+// long wake-up does not forbid sleeping forever
+#define WAKEUP_LATENCY_DECAY_SHIFT 6
+// Initial wake-up latency estimate, before any measurement
+#define WAKEUP_LATENCY_INIT_US 50
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+PowerManager::PowerManager() : radioState(RADIO_STATE_RX), wakeUpEventTime_us(0), wakeUpIsrFlag(false), wakeUpLatency_us(WAKEUP_LATENCY_INIT_US)
+{
+    ResetStatistics();
+}
+
+PowerManager::~PowerManager()
+{
+}
+
+void PowerManager::Init()
+{
+#if defined(ARDUINO_TEENSY40)
+    // Make sure WFI only gates the core clock (RUN low power mode). WAIT and STOP modes would also stop the clocks of the
+    // peripheral timers and USB which we need to meet Micronet's slots and to keep NMEA links alive.
+    CCM_CLPCR = (CCM_CLPCR & ~CCM_CLPCR_LPM(3)) | CCM_CLPCR_LPM(0);
+#endif
+    ResetStatistics();
+}
+
+// Put CPU in sleep mode for at most maxSleepTime_us. CPU is woken-up by any interrupt : RF, timers, serial links or the
+// 1ms system tick. Sleep is skipped if an RF message is waiting to be processed or if the next deadline is closer than
+// the measured wake-up latency, which is the time from a timer expiry to the return to main loop.
+void PowerManager::Sleep(uint32_t maxSleepTime_us)
+{
+    uint32_t sleepStart_us, sleepEnd_us;
+
+    if (maxSleepTime_us < (wakeUpLatency_us + WAKEUP_GUARD_US))
+    {
+        return;
+    }
+
+    // Interrupts are masked while checking RX FIFO so that a message received in-between can't be left unprocessed until
+    // the next interrupt : a pending interrupt prevents WFI from sleeping, even when masked.
+    noInterrupts();
+    if (gRxMessageFifo.GetNbMessages() > 0)
+    {
+        interrupts();
+        return;
+    }
+    wakeUpIsrFlag = false;
+    sleepStart_us = micros();
+    asm("wfi\n");
+    interrupts();
+    sleepEnd_us = micros();
+
+    sleepTime_us += sleepEnd_us - sleepStart_us;
+
+    // Measure the time between the timer expiry which woke us up and the return to main loop. This includes the core
+    // wake-up, the ISR entry and the ISR itself. Timers fired before their expiry time, to split long delays, are ignored.
+    wakeUpLatency_us -= wakeUpLatency_us >> WAKEUP_LATENCY_DECAY_SHIFT;
+    if (wakeUpIsrFlag && ((int32_t)(wakeUpEventTime_us - sleepStart_us) >= 0) && ((int32_t)(sleepEnd_us - wakeUpEventTime_us) >= 0))
+    {
+        uint32_t latency_us = sleepEnd_us - wakeUpEventTime_us;
+        if (latency_us > wakeUpLatency_us)
+        {
+            wakeUpLatency_us = latency_us;
+        }
+    }
+}
+
+// Called by RF driver each time the CC1101 changes its power state
+void PowerManager::SetRadioState(RadioPowerState_t state)
+{
+    noInterrupts();
+    UpdateRadioTime();
+    radioState = state;
+    interrupts();
+}
+
+// Called at the beginning of timer ISRs with the time at which the timer was programmed to expire, to measure CPU
+// wake-up latency. RF interrupts are not accounted : the time of the event they signal is not known.
+void PowerManager::NotifyWakeUpIsr(uint32_t eventTime_us)
+{
+    wakeUpEventTime_us = eventTime_us;
+    wakeUpIsrFlag      = true;
+}
+
+void PowerManager::ResetStatistics()
+{
+    noInterrupts();
+    radioStateTime_us = micros();
+    memset(radioTime_us, 0, sizeof(radioTime_us));
+    sleepTime_us = 0;
+    interrupts();
+}
+
+float PowerManager::GetCpuSleepRatio_per()
+{
+    uint64_t totalTime_us = GetTotalTime_us();
+
+    if (totalTime_us == 0)
+    {
+        return 0;
+    }
+
+    return (100.0f * sleepTime_us) / totalTime_us;
+}
+
+float PowerManager::GetRadioStateRatio_per(RadioPowerState_t state)
+{
+    uint64_t totalTime_us = GetTotalTime_us();
+
+    if ((totalTime_us == 0) || (state >= RADIO_STATE_NB))
+    {
+        return 0;
+    }
+
+    return (100.0f * radioTime_us[state]) / totalTime_us;
+}
+
+uint32_t PowerManager::GetWakeUpLatency_us()
+{
+    return wakeUpLatency_us;
+}
+
+// Total time since the last reset of the statistics. The radio is always in one of its states so the sum of its state
+// times is used as time base : it is accumulated on 64 bits and does not suffer from micros() wrap-around.
+uint64_t PowerManager::GetTotalTime_us()
+{
+    uint64_t totalTime_us = 0;
+
+    noInterrupts();
+    UpdateRadioTime();
+    for (int i = 0; i < RADIO_STATE_NB; i++)
+    {
+        totalTime_us += radioTime_us[i];
+    }
+    interrupts();
+
+    return totalTime_us;
+}
+
+// Must be called with interrupts disabled
+void PowerManager::UpdateRadioTime()
+{
+    uint32_t now_us = micros();
+
+    radioTime_us[radioState] += now_us - radioStateTime_us;
+    radioStateTime_us = now_us;
+}
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  CPU sleep and power state statistics                          *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef POWERMANAGER_H_
+#define POWERMANAGER_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Fixed guard added to the measured wake-up latency before deciding to sleep
+#define WAKEUP_GUARD_US 100
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+typedef enum
+{
+    RADIO_STATE_RX = 0,
+    RADIO_STATE_TX,
+    RADIO_STATE_POWER_DOWN,
+    RADIO_STATE_NB
+} RadioPowerState_t;
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class PowerManager
+{
+  public:
+    PowerManager();
+    virtual ~PowerManager();
+
+    void     Init();
+    void     Sleep(uint32_t maxSleepTime_us);
+    void     SetRadioState(RadioPowerState_t state);
+    void     NotifyWakeUpIsr(uint32_t eventTime_us);
+    void     ResetStatistics();
+    float    GetCpuSleepRatio_per();
+    float    GetRadioStateRatio_per(RadioPowerState_t state);
+    uint32_t GetWakeUpLatency_us();
+
+  private:
+    volatile RadioPowerState_t radioState;
+    uint32_t                   radioStateTime_us;
+    uint64_t                   radioTime_us[RADIO_STATE_NB];
+    uint64_t                   sleepTime_us;
+    volatile uint32_t          wakeUpEventTime_us;
+    volatile bool              wakeUpIsrFlag;
+    uint32_t                   wakeUpLatency_us;
+
+    void     UpdateRadioTime();
+    uint64_t GetTotalTime_us();
+};
+
+#endif /* POWERMANAGER_H_ */
@@ -70,7 +70,8 @@ const uint8_t RfDriver::preambleAndSync[MICRONET_RF_PREAMBLE_LENGTH] = {
 /***************************************************************************/
 
 RfDriver::RfDriver()
-    : messageFifo(nullptr), rfState(RF_STATE_RX_WAIT_SYNC), nextTransmitIndex(-1), messageBytesSent(0), frequencyOffset_MHz(0), freqTrackingNID(0)
+    : messageFifo(nullptr), rfState(RF_STATE_RX_WAIT_SYNC), nextTransmitIndex(-1), activeTransmitIndex(-1), messageBytesSent(0),
+      timerExpiry_us(0), frequencyOffset_MHz(0), freqTrackingNID(0), encoderCallback(nullptr), encoderContext(nullptr), rxCallback(nullptr)
 {
     memset(transmitList, 0, sizeof(transmitList));
 }
@@ -152,7 +153,7 @@ void RfDriver::RfIsr_Tx()
     if (rfState == RF_STATE_TX_TRANSMIT)
     {
         int bytesInFifo;
-        int bytesToLoad = transmitList[nextTransmitIndex].len - messageBytesSent;
+        int bytesToLoad = transmitList[activeTransmitIndex].len - messageBytesSent;
 
         bytesInFifo = cc1101Driver.GetTxFifoLevel();
         if (bytesToLoad + bytesInFifo > CC1101_FIFO_MAX_SIZE)
@@ -160,10 +161,10 @@ void RfDriver::RfIsr_Tx()
             bytesToLoad = CC1101_FIFO_MAX_SIZE - bytesInFifo;
         }
 
-        cc1101Driver.WriteArrayTxFifo(&transmitList[nextTransmitIndex].data[messageBytesSent], bytesToLoad);
+        cc1101Driver.WriteArrayTxFifo(&transmitList[activeTransmitIndex].data[messageBytesSent], bytesToLoad);
         messageBytesSent += bytesToLoad;
 
-        if (messageBytesSent >= transmitList[nextTransmitIndex].len)
+        if (messageBytesSent >= transmitList[activeTransmitIndex].len)
         {
             rfState = RF_STATE_TX_LAST_TRANSMIT;
             cc1101Driver.IrqOnTxFifoUnderflow();
@@ -171,8 +172,8 @@ void RfDriver::RfIsr_Tx()
     }
     else
     {
-        transmitList[nextTransmitIndex].startTime_us = 0;
-        nextTransmitIndex                            = -1;
+        transmitList[activeTransmitIndex].startTime_us = 0;
+        activeTransmitIndex                            = -1;
 
         RestartReception();
         ScheduleTransmit();
@@ -276,6 +277,13 @@ void RfDriver::RfIsr_Rx()
     message.endTime_us   = startTime_us + PREAMBLE_LENGTH_IN_US + packetLength * BYTE_LENGTH_IN_US + GUARD_TIME_IN_US;
     message.action       = MICRONET_ACTION_RF_NO_ACTION;
     messageFifo->PushIsr(message);
+    gNetworkCensus.AddMessageIsr(message);
+
+    // Notify main loop that a new message is available
+    if (rxCallback != nullptr)
+    {
+        rxCallback();
+    }
 
     // Only perform frequency tracking if the feature has been explicitly enabled
     if (freqTrackingNID != 0)
@@ -288,7 +296,7 @@ void RfDriver::RfIsr_Rx()
         // Only track if message is from the master of our network
         if ((message.data[MICRONET_MI_OFFSET] == MICRONET_MESSAGE_ID_MASTER_REQUEST) && (networkId == freqTrackingNID))
         {
-            cc1101Driver.UpdateFreqOffset();
+            cc1101Driver.UpdateFreqOffset(message.rssi);
         }
     }
 }
@@ -304,6 +312,7 @@ void RfDriver::RestartReception()
     cc1101Driver.SetPacketLength(CC1101_FIFO_MAX_SIZE);
     rfState = RF_STATE_RX_WAIT_SYNC;
     cc1101Driver.SetRx();
+    gPowerManager.SetRadioState(RADIO_STATE_RX);
 }
 
 void RfDriver::Transmit(MicronetMessageFifo *txMessageFifo)
@@ -359,8 +368,20 @@ void RfDriver::ScheduleTransmit()
             continue;
         }
 
+        if (transmitList[transmitIndex].action == MICRONET_ACTION_RF_LATE_ENCODING)
+        {
+            transmitDelay -= LATE_ENCODING_LEAD_US;
+            if (transmitDelay <= 0)
+            {
+                // Encoding time has been missed but the transmission is still ahead : encode now
+                LateEncode(transmitIndex);
+                continue;
+            }
+        }
+
         // Schedule new transmit
         nextTransmitIndex = transmitIndex;
+        timerExpiry_us    = micros() + transmitDelay;
         timerInt.trigger(transmitDelay);
 
         return;
@@ -374,11 +395,13 @@ int RfDriver::GetNextTransmitIndex()
 
     for (int i = 0; i < TRANSMIT_LIST_SIZE; i++)
     {
-        if (transmitList[i].startTime_us != 0)
+        // The message under transmission is no longer part of the schedule
+        if ((transmitList[i].startTime_us != 0) && (i != activeTransmitIndex))
         {
-            if (transmitList[i].startTime_us <= minTime)
+            uint32_t eventTime = GetEventTime(i);
+            if (eventTime <= minTime)
             {
-                minTime  = transmitList[i].startTime_us;
+                minTime  = eventTime;
                 minIndex = i;
             }
         }
@@ -387,6 +410,30 @@ int RfDriver::GetNextTransmitIndex()
     return minIndex;
 }
 
+// Returns the time at which the timer must fire for an entry of the transmit list : its start time, or its encoding time
+// if its payload is still to be encoded
+uint32_t RfDriver::GetEventTime(int index)
+{
+    if (transmitList[index].action == MICRONET_ACTION_RF_LATE_ENCODING)
+    {
+        return transmitList[index].startTime_us - LATE_ENCODING_LEAD_US;
+    }
+
+    return transmitList[index].startTime_us;
+}
+
+// Let the registered encoder refresh the payload of a late encoded message with the latest data
+// Without encoder, or if the encoder fails, the message is sent as it was encoded at planning time
+void RfDriver::LateEncode(int index)
+{
+    if (encoderCallback != nullptr)
+    {
+        encoderCallback(encoderContext, &transmitList[index]);
+    }
+
+    transmitList[index].action = MICRONET_ACTION_RF_NO_ACTION;
+}
+
 int RfDriver::GetFreeTransmitSlot()
 {
     int freeIndex = -1;
@@ -405,6 +452,7 @@ int RfDriver::GetFreeTransmitSlot()
 
 void RfDriver::TimerHandler()
 {
+    gPowerManager.NotifyWakeUpIsr(rfDriver->timerExpiry_us);
     rfDriver->TransmitCallback();
 }
 
@@ -416,7 +464,7 @@ void RfDriver::TransmitCallback()
         return;
     }
 
-    int32_t triggerDelay = micros() - transmitList[nextTransmitIndex].startTime_us;
+    int32_t triggerDelay = micros() - GetEventTime(nextTransmitIndex);
 
     if (triggerDelay < 0)
     {
@@ -426,13 +474,26 @@ void RfDriver::TransmitCallback()
         return;
     }
 
-    if (transmitList[nextTransmitIndex].action == MICRONET_ACTION_RF_LOW_POWER)
+    if (transmitList[nextTransmitIndex].action == MICRONET_ACTION_RF_LATE_ENCODING)
+    {
+        LateEncode(nextTransmitIndex);
+        nextTransmitIndex = -1;
+
+        ScheduleTransmit();
+    }
+    else if ((rfState == RF_STATE_TX_TRANSMIT) || (rfState == RF_STATE_TX_LAST_TRANSMIT))
+    {
+        // Another message is still under transmission : this event is dropped
+        ScheduleTransmit();
+    }
+    else if (transmitList[nextTransmitIndex].action == MICRONET_ACTION_RF_LOW_POWER)
     {
         transmitList[nextTransmitIndex].startTime_us = 0;
         nextTransmitIndex                            = -1;
 
         cc1101Driver.LowPower();
         rfState = RF_STATE_RX_WAIT_SYNC;
+        gPowerManager.SetRadioState(RADIO_STATE_POWER_DOWN);
 
         ScheduleTransmit();
     }
@@ -448,7 +509,10 @@ void RfDriver::TransmitCallback()
     }
     else if (rfState == RF_STATE_RX_WAIT_SYNC)
     {
-        rfState = RF_STATE_TX_TRANSMIT;
+        rfState             = RF_STATE_TX_TRANSMIT;
+        messageBytesSent    = 0;
+        activeTransmitIndex = nextTransmitIndex;
+        nextTransmitIndex   = -1;
 
         // Change CC1101 configuration for transmission
         cc1101Driver.SetSidle();
@@ -463,11 +527,13 @@ void RfDriver::TransmitCallback()
 
         // Start transmission as soon as we have the first byte available in FIFO to minimize latency
         cc1101Driver.SetTx();
+        gPowerManager.SetRadioState(RADIO_STATE_TX);
 
         // Fill FIFO with rest of preamble and sync byte
         cc1101Driver.WriteArrayTxFifo(static_cast<const uint8_t *>(preambleAndSync), sizeof(preambleAndSync));
 
-        messageBytesSent = 0;
+        // Next message may have to be encoded while this one is being transmitted
+        ScheduleTransmit();
     }
     else
     {
@@ -484,3 +550,47 @@ void RfDriver::DisableFrequencyTracking()
 {
     freqTrackingNID = 0;
 }
+
+// Returns the total frequency offset : the one given at init or with SetFrequencyOffset plus the one learned by
+// the frequency tracking loop
+float RfDriver::GetFrequencyOffset()
+{
+    return frequencyOffset_MHz + cc1101Driver.GetFreqOffset_MHz();
+}
+
+bool RfDriver::IsFrequencyTrackingLocked()
+{
+    return cc1101Driver.IsFreqTrackingLocked();
+}
+
+// Set a function to be called from RF ISR each time a new message has been pushed in RX FIFO
+void RfDriver::SetRxCallback(void (*rxCallback)())
+{
+    this->rxCallback = rxCallback;
+}
+
+// Set a function to be called from RF timer ISR to encode late encoded messages just before their transmission
+void RfDriver::SetEncoderCallback(RfEncoderCallback_t encoderCallback, void *encoderContext)
+{
+    noInterrupts();
+    this->encoderCallback = encoderCallback;
+    this->encoderContext  = encoderContext;
+    interrupts();
+}
+
+// Returns the delay until the next scheduled transmission, encoding or power state change, 0xffffffff if there is none
+uint32_t RfDriver::GetNextEventDelay_us()
+{
+    uint32_t delay_us = 0xffffffff;
+
+    noInterrupts();
+    int transmitIndex = GetNextTransmitIndex();
+    if (transmitIndex >= 0)
+    {
+        int32_t transmitDelay = GetEventTime(transmitIndex) - micros();
+        delay_us              = (transmitDelay > 0) ? transmitDelay : 0;
+    }
+    interrupts();
+
+    return delay_us;
+}
@@ -39,7 +39,7 @@
 /*                              Constants                                  */
 /***************************************************************************/
 
-#define TRANSMIT_LIST_SIZE     16
+#define TRANSMIT_LIST_SIZE     24 // Transmissions and power transitions, RX gating included
 #define LOW_BANDWIDTH_VALUE    80
 #define MEDIUM_BANDWIDTH_VALUE 125
 #define HIGH_BANDWIDTH_VALUE   250
@@ -57,6 +57,10 @@ typedef enum
     RF_STATE_TX_LAST_TRANSMIT
 } RfDriverState_t;
 
+// Encoder called from RF timer ISR to refresh the payload of a late encoded message just before its transmission
+// Returns false if the message could not be refreshed, in which case it is sent as encoded at planning time
+typedef bool (*RfEncoderCallback_t)(void *context, MicronetMessage_t *message);
+
 /***************************************************************************/
 /*                               Classes                                   */
 /***************************************************************************/
@@ -74,17 +78,22 @@ class RfDriver
     RfDriver();
     virtual ~RfDriver();
 
-    bool Init(MicronetMessageFifo *messageFifo, float frequencyOffset_mHz);
-    void SetFrequencyOffset(float offset_MHz);
-    void SetFrequency(float frequency_MHz);
-    void SetBandwidth(RfBandwidth_t bandwidth);
-    void RestartReception();
-    void Transmit(MicronetMessageFifo *txMessageFifo);
-    void Transmit(MicronetMessage_t *message);
-    void EnableFrequencyTracking(uint32_t networkId);
-    void DisableFrequencyTracking();
-
-    void RfIsr();
+    bool     Init(MicronetMessageFifo *messageFifo, float frequencyOffset_mHz);
+    void     SetFrequencyOffset(float offset_MHz);
+    void     SetFrequency(float frequency_MHz);
+    void     SetBandwidth(RfBandwidth_t bandwidth);
+    void     RestartReception();
+    void     Transmit(MicronetMessageFifo *txMessageFifo);
+    void     Transmit(MicronetMessage_t *message);
+    void     EnableFrequencyTracking(uint32_t networkId);
+    void     DisableFrequencyTracking();
+    float    GetFrequencyOffset();
+    bool     IsFrequencyTrackingLocked();
+    uint32_t GetNextEventDelay_us();
+    void     SetRxCallback(void (*rxCallback)());
+    void     SetEncoderCallback(RfEncoderCallback_t encoderCallback, void *encoderContext);
+
+    void     RfIsr();
 
   private:
     CC1101Driver             cc1101Driver;
@@ -92,18 +101,25 @@ class RfDriver
     volatile RfDriverState_t rfState;
     MicronetMessage_t        transmitList[TRANSMIT_LIST_SIZE];
     volatile int             nextTransmitIndex;
+    volatile int             activeTransmitIndex;
     volatile int             messageBytesSent;
+    volatile uint32_t        timerExpiry_us; // Time at which timerInt has been programmed to expire
     float                    frequencyOffset_MHz;
     uint32_t                 freqTrackingNID;
+    RfEncoderCallback_t      encoderCallback;
+    void                    *encoderContext;
+    void (*volatile rxCallback)();
 
     static const uint8_t preambleAndSync[MICRONET_RF_PREAMBLE_LENGTH];
 
-    void ScheduleTransmit();
-    int  GetNextTransmitIndex();
-    int  GetFreeTransmitSlot();
-    void TransmitCallback();
-    void RfIsr_Rx();
-    void RfIsr_Tx();
+    void     ScheduleTransmit();
+    int      GetNextTransmitIndex();
+    uint32_t GetEventTime(int index);
+    void     LateEncode(int index);
+    int      GetFreeTransmitSlot();
+    void     TransmitCallback();
+    void     RfIsr_Rx();
+    void     RfIsr_Tx();
 
     static void      TimerHandler();
     static RfDriver *rfDriver;
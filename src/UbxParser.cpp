@@ -0,0 +1,218 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Streaming parser of u-blox UBX binary frames                  *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "UbxParser.h"
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+UbxParser::UbxParser()
+    : state(UBX_STATE_SYNC_1), msgClass(0), msgId(0), length(0), index(0), ckA(0), ckB(0), nbChecksumErrors(0), frameStart_us(0)
+{
+}
+
+UbxParser::~UbxParser()
+{
+}
+
+// Push one byte received from the GNSS link at time time_us
+// Returns true when the byte completes a frame with a valid checksum, which can then be read with GetClass(), GetId(),
+// GetLength(), GetPayload() and GetFrameStart_us() until next call
+bool UbxParser::PushByte(uint8_t c, uint32_t time_us)
+{
+    switch (state)
+    {
+    case UBX_STATE_SYNC_1:
+        if (c == UBX_SYNC_CHAR_1)
+        {
+            state         = UBX_STATE_SYNC_2;
+            frameStart_us = time_us;
+        }
+        break;
+    case UBX_STATE_SYNC_2:
+        // A second SYNC_1 may be the real start of frame
+        state = (c == UBX_SYNC_CHAR_2) ? UBX_STATE_CLASS : ((c == UBX_SYNC_CHAR_1) ? UBX_STATE_SYNC_2 : UBX_STATE_SYNC_1);
+        if (c == UBX_SYNC_CHAR_1)
+        {
+            frameStart_us = time_us;
+        }
+        break;
+    case UBX_STATE_CLASS:
+        ckA      = 0;
+        ckB      = 0;
+        msgClass = c;
+        AddToChecksum(c);
+        state = UBX_STATE_ID;
+        break;
+    case UBX_STATE_ID:
+        msgId = c;
+        AddToChecksum(c);
+        state = UBX_STATE_LENGTH_1;
+        break;
+    case UBX_STATE_LENGTH_1:
+        length = c;
+        AddToChecksum(c);
+        state = UBX_STATE_LENGTH_2;
+        break;
+    case UBX_STATE_LENGTH_2:
+        length |= ((uint16_t)c) << 8;
+        AddToChecksum(c);
+        index = 0;
+        if (length > UBX_MAX_PAYLOAD_LENGTH)
+        {
+            state = UBX_STATE_SYNC_1;
+        }
+        else
+        {
+            state = (length > 0) ? UBX_STATE_PAYLOAD : UBX_STATE_CK_A;
+        }
+        break;
+    case UBX_STATE_PAYLOAD:
+        payload[index++] = c;
+        AddToChecksum(c);
+        if (index >= length)
+        {
+            state = UBX_STATE_CK_A;
+        }
+        break;
+    case UBX_STATE_CK_A:
+        if (c == ckA)
+        {
+            state = UBX_STATE_CK_B;
+        }
+        else
+        {
+            nbChecksumErrors++;
+            state = UBX_STATE_SYNC_1;
+        }
+        break;
+    case UBX_STATE_CK_B:
+        state = UBX_STATE_SYNC_1;
+        if (c == ckB)
+        {
+            return true;
+        }
+        nbChecksumErrors++;
+        break;
+    }
+
+    return false;
+}
+
+uint8_t UbxParser::GetClass()
+{
+    return msgClass;
+}
+
+uint8_t UbxParser::GetId()
+{
+    return msgId;
+}
+
+uint16_t UbxParser::GetLength()
+{
+    return length;
+}
+
+uint8_t *UbxParser::GetPayload()
+{
+    return payload;
+}
+
+uint32_t UbxParser::GetNbChecksumErrors()
+{
+    return nbChecksumErrors;
+}
+
+// Returns time at which the first byte of the last frame was received
+uint32_t UbxParser::GetFrameStart_us()
+{
+    return frameStart_us;
+}
+
+// Little endian field readers
+uint8_t UbxParser::U1(const uint8_t *payload, int offset)
+{
+    return payload[offset];
+}
+
+uint16_t UbxParser::U2(const uint8_t *payload, int offset)
+{
+    return payload[offset] | (((uint16_t)payload[offset + 1]) << 8);
+}
+
+uint32_t UbxParser::U4(const uint8_t *payload, int offset)
+{
+    return payload[offset] | (((uint32_t)payload[offset + 1]) << 8) | (((uint32_t)payload[offset + 2]) << 16) |
+           (((uint32_t)payload[offset + 3]) << 24);
+}
+
+int32_t UbxParser::I4(const uint8_t *payload, int offset)
+{
+    return (int32_t)U4(payload, offset);
+}
+
+// 8-bit Fletcher checksum of a frame, computed from class byte to the end of payload
+void UbxParser::Checksum(const uint8_t *data, int length, uint8_t *ckA, uint8_t *ckB)
+{
+    uint8_t a = 0, b = 0;
+
+    for (int i = 0; i < length; i++)
+    {
+        a += data[i];
+        b += a;
+    }
+
+    *ckA = a;
+    *ckB = b;
+}
+
+void UbxParser::AddToChecksum(uint8_t c)
+{
+    ckA += c;
+    ckB += ckA;
+}
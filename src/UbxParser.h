@@ -0,0 +1,110 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Streaming parser of u-blox UBX binary frames                  *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef UBXPARSER_H_
+#define UBXPARSER_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define UBX_SYNC_CHAR_1 0xb5
+#define UBX_SYNC_CHAR_2 0x62
+
+#define UBX_CLASS_NAV   0x01
+#define UBX_CLASS_CFG   0x06
+#define UBX_ID_NAV_PVT  0x07
+#define UBX_ID_CFG_PRT  0x00
+#define UBX_ID_CFG_MSG  0x01
+#define UBX_ID_CFG_RATE 0x08
+
+#define UBX_NAV_PVT_LENGTH 92
+// Frames with a longer payload are ignored
+#define UBX_MAX_PAYLOAD_LENGTH 100
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+typedef enum
+{
+    UBX_STATE_SYNC_1 = 0,
+    UBX_STATE_SYNC_2,
+    UBX_STATE_CLASS,
+    UBX_STATE_ID,
+    UBX_STATE_LENGTH_1,
+    UBX_STATE_LENGTH_2,
+    UBX_STATE_PAYLOAD,
+    UBX_STATE_CK_A,
+    UBX_STATE_CK_B
+} UbxParserState_t;
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class UbxParser
+{
+  public:
+    UbxParser();
+    virtual ~UbxParser();
+
+    bool     PushByte(uint8_t c, uint32_t time_us);
+    uint8_t  GetClass();
+    uint8_t  GetId();
+    uint16_t GetLength();
+    uint8_t *GetPayload();
+    uint32_t GetNbChecksumErrors();
+    uint32_t GetFrameStart_us();
+
+    static uint8_t  U1(const uint8_t *payload, int offset);
+    static uint16_t U2(const uint8_t *payload, int offset);
+    static uint32_t U4(const uint8_t *payload, int offset);
+    static int32_t  I4(const uint8_t *payload, int offset);
+    static void     Checksum(const uint8_t *data, int length, uint8_t *ckA, uint8_t *ckB);
+
+  private:
+    UbxParserState_t state;
+    uint8_t          msgClass;
+    uint8_t          msgId;
+    uint16_t         length;
+    uint16_t         index;
+    uint8_t          ckA;
+    uint8_t          ckB;
+    uint32_t         nbChecksumErrors;
+    uint32_t         frameStart_us;
+    uint8_t          payload[UBX_MAX_PAYLOAD_LENGTH];
+
+    void AddToChecksum(uint8_t c);
+};
+
+#endif /* UBXPARSER_H_ */
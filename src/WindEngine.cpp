@@ -0,0 +1,211 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  True and ground wind computation from navigation data         *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "WindEngine.h"
+#include "BoardConfig.h"
+#include "FastMath.h"
+
+#include <Arduino.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+WindEngine::WindEngine()
+{
+    Reset();
+}
+
+WindEngine::~WindEngine()
+{
+}
+
+void WindEngine::Reset()
+{
+    dampingInitialized = false;
+    lastDampingTime_ms = 0;
+    dampedTwLon_kt     = 0.0f;
+    dampedTwLat_kt     = 0.0f;
+    shiftInitialized   = false;
+    lastShiftTime_ms   = 0;
+    averageTwdX        = 0.0f;
+    averageTwdY        = 0.0f;
+}
+
+// Recompute wind values depending on inputs which changed
+// Returns true if at least one wind value has been updated
+bool WindEngine::Update(NavigationData *navData, uint32_t changedMask)
+{
+    bool apparentDirty = (changedMask & (NAV_BIT(NAV_ID_AWA_DEG) | NAV_BIT(NAV_ID_AWS_KT))) != 0;
+    bool speedDirty    = (changedMask & NAV_BIT(NAV_ID_SPD_KT)) != 0;
+    bool headingDirty  = (changedMask & NAV_BIT(NAV_ID_MAG_HDG_DEG)) != 0;
+    bool groundDirty   = (changedMask & (NAV_BIT(NAV_ID_SOG_KT) | NAV_BIT(NAV_ID_COG_DEG))) != 0;
+
+    if (!(apparentDirty || speedDirty || headingDirty || groundDirty))
+    {
+        return false;
+    }
+
+    uint32_t now = millis();
+
+    if (apparentDirty || speedDirty)
+    {
+        UpdateTrueWind(navData, now);
+    }
+    if (apparentDirty || speedDirty || headingDirty)
+    {
+        UpdateTrueWindDirection(navData, now);
+    }
+    UpdateGroundWind(navData);
+
+    return true;
+}
+
+// True wind relative to water and its damped version, in boat frame
+void WindEngine::UpdateTrueWind(NavigationData *navData, uint32_t now)
+{
+    if (!(navData->IsValid(NAV_ID_AWA_DEG) && navData->IsValid(NAV_ID_AWS_KT) && navData->IsValid(NAV_ID_SPD_KT)))
+    {
+        return;
+    }
+
+    float awa_rad = navData->Get(NAV_ID_AWA_DEG) * FASTMATH_DEG_TO_RAD;
+    float twLon, twLat;
+    twLon = (navData->Get(NAV_ID_AWS_KT) * cosf(awa_rad)) - navData->Get(NAV_ID_SPD_KT);
+    twLat = (navData->Get(NAV_ID_AWS_KT) * sinf(awa_rad));
+
+    navData->Set(NAV_ID_TWS_KT, sqrtf(twLon * twLon + twLat * twLat));
+
+    navData->Set(NAV_ID_TWA_DEG, FastAtan2_deg(twLat, twLon));
+
+    // Damping is made on the wind vector so that angle wrapping does not disturb the filter
+    if (!dampingInitialized)
+    {
+        dampedTwLon_kt     = twLon;
+        dampedTwLat_kt     = twLat;
+        dampingInitialized = true;
+    }
+    else
+    {
+        float k = DampingFactor(now - lastDampingTime_ms, WIND_DAMPING_TIME_S);
+        dampedTwLon_kt += (twLon - dampedTwLon_kt) * k;
+        dampedTwLat_kt += (twLat - dampedTwLat_kt) * k;
+    }
+    lastDampingTime_ms = now;
+
+    navData->Set(NAV_ID_DAMPED_TWS_KT, sqrtf(dampedTwLon_kt * dampedTwLon_kt + dampedTwLat_kt * dampedTwLat_kt));
+
+    navData->Set(NAV_ID_DAMPED_TWA_DEG, FastAtan2_deg(dampedTwLat_kt, dampedTwLon_kt));
+}
+
+// True wind direction referenced to true north and its shift against the long term average
+// Averaging time is the wind shift calibration value set from Micronet displays
+void WindEngine::UpdateTrueWindDirection(NavigationData *navData, uint32_t now)
+{
+    if (!(navData->IsValid(NAV_ID_TWA_DEG) && navData->IsValid(NAV_ID_DAMPED_TWA_DEG) && navData->IsValid(NAV_ID_MAG_HDG_DEG)))
+    {
+        return;
+    }
+
+    float trueHeading_deg = navData->Get(NAV_ID_MAG_HDG_DEG) + navData->magneticVariation_deg;
+
+    navData->Set(NAV_ID_TWD_DEG, FastWrap360_deg(trueHeading_deg + navData->Get(NAV_ID_TWA_DEG)));
+
+    // Heading is not damped so that a tack or a gybe does not show up as a wind shift
+    navData->Set(NAV_ID_DAMPED_TWD_DEG, FastWrap360_deg(trueHeading_deg + navData->Get(NAV_ID_DAMPED_TWA_DEG)));
+
+    float twd_rad = navData->Get(NAV_ID_DAMPED_TWD_DEG) * FASTMATH_DEG_TO_RAD;
+    float twdX    = cosf(twd_rad);
+    float twdY    = sinf(twd_rad);
+    if (!shiftInitialized)
+    {
+        averageTwdX      = twdX;
+        averageTwdY      = twdY;
+        shiftInitialized = true;
+    }
+    else
+    {
+        float k = DampingFactor(now - lastShiftTime_ms, navData->windShift_min * 60.0f);
+        averageTwdX += (twdX - averageTwdX) * k;
+        averageTwdY += (twdY - averageTwdY) * k;
+    }
+    lastShiftTime_ms = now;
+
+    navData->Set(NAV_ID_TWD_SHIFT_DEG, FastWrap180_deg(navData->Get(NAV_ID_DAMPED_TWD_DEG) - FastAtan2_deg(averageTwdY, averageTwdX)));
+}
+
+// Wind relative to ground, from apparent wind, heading and GNSS velocity
+void WindEngine::UpdateGroundWind(NavigationData *navData)
+{
+    uint32_t inputs =
+        NAV_BIT(NAV_ID_AWA_DEG) | NAV_BIT(NAV_ID_AWS_KT) | NAV_BIT(NAV_ID_MAG_HDG_DEG) | NAV_BIT(NAV_ID_SOG_KT) | NAV_BIT(NAV_ID_COG_DEG);
+    if ((navData->GetValidMask() & inputs) != inputs)
+    {
+        return;
+    }
+
+    float awd_rad = (navData->Get(NAV_ID_MAG_HDG_DEG) + navData->magneticVariation_deg + navData->Get(NAV_ID_AWA_DEG)) * FASTMATH_DEG_TO_RAD;
+    float cog_rad = navData->Get(NAV_ID_COG_DEG) * FASTMATH_DEG_TO_RAD;
+    float gwX, gwY;
+    gwX = (navData->Get(NAV_ID_AWS_KT) * cosf(awd_rad)) - (navData->Get(NAV_ID_SOG_KT) * cosf(cog_rad));
+    gwY = (navData->Get(NAV_ID_AWS_KT) * sinf(awd_rad)) - (navData->Get(NAV_ID_SOG_KT) * sinf(cog_rad));
+
+    navData->Set(NAV_ID_GWS_KT, sqrtf(gwX * gwX + gwY * gwY));
+
+    navData->Set(NAV_ID_GWD_DEG, FastWrap360_deg(FastAtan2_deg(gwY, gwX)));
+}
+
+// Gain of a first order low-pass filter for a given elapsed time
+float WindEngine::DampingFactor(uint32_t elapsed_ms, float timeConstant_s)
+{
+    if (timeConstant_s <= 0.0f)
+    {
+        return 1.0f;
+    }
+
+    float elapsed_s = elapsed_ms / 1000.0f;
+    return elapsed_s / (timeConstant_s + elapsed_s);
+}
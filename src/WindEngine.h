@@ -0,0 +1,80 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  True and ground wind computation from navigation data         *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef WINDENGINE_H_
+#define WINDENGINE_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "NavigationData.h"
+
+#include <stdint.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Navigation values used by the wind engine
+#define WIND_ENGINE_INPUTS                                                                                                                           \
+    (NAV_BIT(NAV_ID_AWA_DEG) | NAV_BIT(NAV_ID_AWS_KT) | NAV_BIT(NAV_ID_SPD_KT) | NAV_BIT(NAV_ID_MAG_HDG_DEG) | NAV_BIT(NAV_ID_SOG_KT) |              \
+     NAV_BIT(NAV_ID_COG_DEG))
+
+/***************************************************************************/
+/*                                Types                                    */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+class WindEngine
+{
+  public:
+    WindEngine();
+    virtual ~WindEngine();
+
+    void Reset();
+    bool Update(NavigationData *navData, uint32_t changedMask);
+
+  private:
+    bool     dampingInitialized;
+    uint32_t lastDampingTime_ms;
+    float    dampedTwLon_kt;
+    float    dampedTwLat_kt;
+    bool     shiftInitialized;
+    uint32_t lastShiftTime_ms;
+    float    averageTwdX;
+    float    averageTwdY;
+
+    void         UpdateTrueWind(NavigationData *navData, uint32_t now);
+    void         UpdateTrueWindDirection(NavigationData *navData, uint32_t now);
+    void         UpdateGroundWind(NavigationData *navData);
+    static float DampingFactor(uint32_t elapsed_ms, float timeConstant_s);
+};
+
+#endif /* WINDENGINE_H_ */
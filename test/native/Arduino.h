@@ -0,0 +1,143 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Host stand-in of the Arduino functions used by native tests   *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+// Output of serial ports : what is written is dropped
+class Print
+{
+  public:
+    virtual ~Print()
+    {
+    }
+
+    virtual size_t write(uint8_t b)
+    {
+        (void)b;
+        return 1;
+    }
+
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            write(buffer[i]);
+        }
+        return size;
+    }
+
+    size_t print(const char *s)
+    {
+        return write((const uint8_t *)s, strlen(s));
+    }
+
+    size_t println(const char *s)
+    {
+        return print(s) + print("\r\n");
+    }
+};
+
+// Input of serial ports : nothing is ever received
+class Stream : public Print
+{
+  public:
+    virtual int available()
+    {
+        return 0;
+    }
+
+    virtual int read()
+    {
+        return -1;
+    }
+
+    virtual int peek()
+    {
+        return -1;
+    }
+};
+
+class HardwareSerial : public Stream
+{
+};
+
+class usb_serial_class : public Stream
+{
+};
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+// Host time returned by micros() and millis(). It only moves when a test sets it, so that runs are reproducible.
+inline uint32_t gHostTime_us = 0;
+
+inline usb_serial_class SerialUSB;
+inline HardwareSerial   Serial1;
+inline HardwareSerial   Serial2;
+inline HardwareSerial   Serial5;
+
+/***************************************************************************/
+/*                              Prototypes                                 */
+/***************************************************************************/
+
+inline uint32_t micros()
+{
+    return gHostTime_us;
+}
+
+inline uint32_t millis()
+{
+    return gHostTime_us / 1000;
+}
+
+// No interrupt on host
+inline void noInterrupts()
+{
+}
+
+inline void interrupts()
+{
+}
+
+#endif /* ARDUINO_H_ */
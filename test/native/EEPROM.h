@@ -0,0 +1,95 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Host stand-in of the Teensy EEPROM library used by native tests*
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Size of Teensy 4.0 emulated EEPROM
+#define HOST_EEPROM_SIZE 1080
+
+/***************************************************************************/
+/*                               Classes                                   */
+/***************************************************************************/
+
+// EEPROM in RAM, erased at start
+class EEPROMClass
+{
+  public:
+    EEPROMClass()
+    {
+        memset(data, 0xff, sizeof(data));
+    }
+
+    uint8_t read(int index)
+    {
+        return data[index];
+    }
+
+    void update(int index, uint8_t value)
+    {
+        data[index] = value;
+    }
+
+    template <typename T> T &get(int index, T &object)
+    {
+        memcpy(&object, data + index, sizeof(T));
+        return object;
+    }
+
+    template <typename T> const T &put(int index, const T &object)
+    {
+        memcpy(data + index, &object, sizeof(T));
+        return object;
+    }
+
+    uint16_t length()
+    {
+        return HOST_EEPROM_SIZE;
+    }
+
+  private:
+    uint8_t data[HOST_EEPROM_SIZE];
+};
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+inline EEPROMClass EEPROM;
+
+#endif /* EEPROM_H_ */
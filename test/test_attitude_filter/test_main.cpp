@@ -0,0 +1,478 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Host test bench of the compass attitude filter                *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "AttitudeFilter.h"
+#include "BoardConfig.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define SAMPLE_PERIOD_S       (NAVCOMPASS_SAMPLE_PERIOD_MS / 1000.0f)
+#define DEG_TO_RAD            (M_PI / 180.0)
+#define MAG_DIP_DEG           60.0 // Inclination of earth's magnetic field, positive downward
+#define LEGACY_HISTORY_LENGTH 4    // Averaging depth of the heading filter used before the attitude filter
+#define ACC_NOISE             0.02 // Standard deviation of accelerometer noise, relative to 1g
+#define MAG_NOISE             0.02 // Standard deviation of magnetometer noise, relative to field strength
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+typedef struct
+{
+    double heading_deg;
+    double heel_deg;
+    double pitch_deg;
+} Attitude_t;
+
+// Heading filter used before the attitude filter : instantaneous tilt compensated heading averaged on a few samples
+class LegacyHeadingFilter
+{
+  public:
+    LegacyHeadingFilter();
+    float Update(vec *accel, vec *mag);
+
+  private:
+    float history[LEGACY_HISTORY_LENGTH];
+    int   index;
+    bool  filled;
+};
+
+// Statistics of an angle error along a profile
+typedef struct
+{
+    double sum;
+    double sumSq;
+    double max;
+    int    nb;
+} ErrorStats_t;
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+static uint32_t noiseSeed;
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+// Deterministic gaussian noise, so that measurements are reproducible
+static double Gaussian()
+{
+    double u1, u2;
+
+    noiseSeed = noiseSeed * 1664525 + 1013904223;
+    u1        = ((noiseSeed >> 8) + 1.0) / 16777217.0;
+    noiseSeed = noiseSeed * 1664525 + 1013904223;
+    u2        = (noiseSeed >> 8) / 16777216.0;
+
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double WrapError_deg(double error_deg)
+{
+    while (error_deg > 180.0)
+        error_deg -= 360.0;
+    while (error_deg < -180.0)
+        error_deg += 360.0;
+    return error_deg;
+}
+
+static void AddError(ErrorStats_t *stats, double error_deg)
+{
+    stats->sum += error_deg;
+    stats->sumSq += error_deg * error_deg;
+    stats->nb++;
+    if (fabs(error_deg) > stats->max)
+    {
+        stats->max = fabs(error_deg);
+    }
+}
+
+static double StdDev(ErrorStats_t *stats)
+{
+    double mean = stats->sum / stats->nb;
+    return sqrt(stats->sumSq / stats->nb - mean * mean);
+}
+
+// Express an earth frame (North, West, Up) vector in compass frame, for a compass whose HEADING_AXIS is forward and
+// HEEL_AXIS is starboard. Compass to earth rotation is heading around Up, then pitch, then heel.
+static void EarthToCompass(const Attitude_t *attitude, double e[3], vec *out)
+{
+    double h = attitude->heading_deg * DEG_TO_RAD;
+    double p = attitude->pitch_deg * DEG_TO_RAD;
+    double r = attitude->heel_deg * DEG_TO_RAD;
+    double x, y, z, t;
+
+    // Heading is clockwise, i.e. a negative rotation around Up
+    x = e[0] * cos(h) - e[1] * sin(h);
+    y = e[0] * sin(h) + e[1] * cos(h);
+    z = e[2];
+    // Positive pitch raises the forward axis
+    t = x * cos(p) + z * sin(p);
+    z = -x * sin(p) + z * cos(p);
+    x = t;
+    // Positive heel lowers the starboard axis
+    t = y * cos(r) + z * sin(r);
+    z = -y * sin(r) + z * cos(r);
+    y = t;
+
+    // Map (forward, port, up) on HEADING_AXIS and HEEL_AXIS
+    vec forward   = HEADING_AXIS;
+    vec starboard = HEEL_AXIS;
+    vec up        = {forward.y * -starboard.z - forward.z * -starboard.y, forward.z * -starboard.x - forward.x * -starboard.z,
+                     forward.x * -starboard.y - forward.y * -starboard.x};
+    out->x        = x * forward.x - y * starboard.x + z * up.x;
+    out->y        = x * forward.y - y * starboard.y + z * up.y;
+    out->z        = x * forward.z - y * starboard.z + z * up.z;
+}
+
+// Heel is the elevation of HEEL_AXIS, which differs from the roll angle of the model when the compass is also pitched
+static double ExpectedHeel_deg(const Attitude_t *attitude)
+{
+    return asin(sin(attitude->heel_deg * DEG_TO_RAD) * cos(attitude->pitch_deg * DEG_TO_RAD)) / DEG_TO_RAD;
+}
+
+// Build the accelerometer and magnetometer readings of a static compass, with optional noise
+static void GetSensorReadings(const Attitude_t *attitude, bool noise, vec *accel, vec *mag)
+{
+    double up[3]    = {0.0, 0.0, 1.0};
+    double field[3] = {cos(MAG_DIP_DEG * DEG_TO_RAD), 0.0, -sin(MAG_DIP_DEG * DEG_TO_RAD)};
+
+    EarthToCompass(attitude, up, accel);
+    EarthToCompass(attitude, field, mag);
+    if (noise)
+    {
+        accel->x += ACC_NOISE * Gaussian();
+        accel->y += ACC_NOISE * Gaussian();
+        accel->z += ACC_NOISE * Gaussian();
+        mag->x += MAG_NOISE * Gaussian();
+        mag->y += MAG_NOISE * Gaussian();
+        mag->z += MAG_NOISE * Gaussian();
+    }
+}
+
+LegacyHeadingFilter::LegacyHeadingFilter() : index(0), filled(false)
+{
+}
+
+float LegacyHeadingFilter::Update(vec *accel, vec *mag)
+{
+    vec    from = HEADING_AXIS;
+    double a[3] = {accel->x, accel->y, accel->z};
+    double m[3] = {mag->x, mag->y, mag->z};
+    double e[3], n[3];
+
+    e[0] = m[1] * a[2] - m[2] * a[1];
+    e[1] = m[2] * a[0] - m[0] * a[2];
+    e[2] = m[0] * a[1] - m[1] * a[0];
+    n[0] = a[1] * e[2] - a[2] * e[1];
+    n[1] = a[2] * e[0] - a[0] * e[2];
+    n[2] = a[0] * e[1] - a[1] * e[0];
+
+    float heading = atan2(e[0] * from.x + e[1] * from.y + e[2] * from.z, n[0] * from.x + n[1] * from.y + n[2] * from.z) / DEG_TO_RAD;
+    if (heading < 0)
+        heading += 360;
+
+    if (!filled)
+    {
+        for (int i = 0; i < LEGACY_HISTORY_LENGTH; i++)
+            history[i] = heading;
+        filled = true;
+    }
+    history[index++] = heading;
+    if (index >= LEGACY_HISTORY_LENGTH)
+        index = 0;
+
+    bool firstQ = false;
+    bool lastQ  = false;
+    for (int i = 0; i < LEGACY_HISTORY_LENGTH; i++)
+    {
+        if (history[i] < 90.0)
+            firstQ = true;
+        if (history[i] > 270.0)
+            lastQ = true;
+    }
+
+    heading = 0.0f;
+    for (int i = 0; i < LEGACY_HISTORY_LENGTH; i++)
+    {
+        float value = history[i];
+        if (firstQ && lastQ && (value > 270.0))
+            value -= 360.0;
+        heading += value;
+    }
+
+    return heading / LEGACY_HISTORY_LENGTH;
+}
+
+void setUp()
+{
+    noiseSeed = 12345;
+}
+
+void tearDown()
+{
+}
+
+// Run the filter on a fixed attitude for a given time
+static void Hold(AttitudeFilter *filter, const Attitude_t *attitude, double duration_s)
+{
+    vec accel, mag;
+
+    for (int i = 0; i < (int)(duration_s / SAMPLE_PERIOD_S); i++)
+    {
+        GetSensorReadings(attitude, false, &accel, &mag);
+        filter->Update(&accel, &mag, SAMPLE_PERIOD_S);
+    }
+}
+
+// Started level, the filter converges to any heading, heel and pitch within a few response times. Rate of turn, which
+// has the longest response time, settles back to zero.
+void test_static_convergence()
+{
+    const double headings[] = {0.0, 45.0, 135.0, 200.0, 300.0, 359.0};
+    const double heels[]    = {-25.0, 0.0, 10.0, 30.0};
+    const double pitches[]  = {-10.0, 0.0, 8.0};
+
+    for (double heading : headings)
+    {
+        for (double heel : heels)
+        {
+            for (double pitch : pitches)
+            {
+                AttitudeFilter filter;
+                Attitude_t     level  = {0.0, 0.0, 0.0};
+                Attitude_t     target = {heading, heel, pitch};
+
+                Hold(&filter, &level, SAMPLE_PERIOD_S);
+                Hold(&filter, &target, 15 * NAVCOMPASS_ROT_RESPONSE_TIME_S);
+
+                TEST_ASSERT_FLOAT_WITHIN(0.3, 0.0, WrapError_deg(filter.GetHeading() - heading));
+                TEST_ASSERT_FLOAT_WITHIN(0.3, ExpectedHeel_deg(&target), filter.GetHeel());
+                TEST_ASSERT_FLOAT_WITHIN(0.3, pitch, filter.GetPitch());
+                TEST_ASSERT_FLOAT_WITHIN(1.0, 0.0, filter.GetRateOfTurn());
+            }
+        }
+    }
+}
+
+// First sample initializes attitude directly
+void test_initialization()
+{
+    AttitudeFilter filter;
+    Attitude_t     attitude = {250.0, -12.0, 5.0};
+
+    Hold(&filter, &attitude, SAMPLE_PERIOD_S);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 0.0, WrapError_deg(filter.GetHeading() - 250.0));
+    TEST_ASSERT_FLOAT_WITHIN(0.2, ExpectedHeel_deg(&attitude), filter.GetHeel());
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 5.0, filter.GetPitch());
+}
+
+// A heading step is followed as a first order response of NAVCOMPASS_RESPONSE_TIME_S, at least as fast as the legacy
+// filter
+void test_heading_step_lag()
+{
+    AttitudeFilter      filter;
+    LegacyHeadingFilter legacy;
+    Attitude_t          start       = {10.0, 10.0, 0.0};
+    Attitude_t          end         = {70.0, 10.0, 0.0};
+    double              filterLag_s = -1.0, legacyLag_s = -1.0;
+    vec                 accel, mag;
+
+    Hold(&filter, &start, 5 * NAVCOMPASS_RESPONSE_TIME_S);
+    GetSensorReadings(&start, false, &accel, &mag);
+    for (int i = 0; i < LEGACY_HISTORY_LENGTH; i++)
+    {
+        legacy.Update(&accel, &mag);
+    }
+
+    GetSensorReadings(&end, false, &accel, &mag);
+    for (int i = 1; i <= (int)(10 * NAVCOMPASS_RESPONSE_TIME_S / SAMPLE_PERIOD_S); i++)
+    {
+        filter.Update(&accel, &mag, SAMPLE_PERIOD_S);
+        float legacyHeading = legacy.Update(&accel, &mag);
+
+        // Time to reach 90% of the step
+        if ((filterLag_s < 0.0) && (filter.GetHeading() >= 64.0))
+            filterLag_s = i * SAMPLE_PERIOD_S;
+        if ((legacyLag_s < 0.0) && (legacyHeading >= 64.0))
+            legacyLag_s = i * SAMPLE_PERIOD_S;
+    }
+
+    printf("Heading step 90%% response time : attitude filter %.2fs, legacy filter %.2fs\n", filterLag_s, legacyLag_s);
+    TEST_ASSERT_FLOAT_WITHIN(2 * SAMPLE_PERIOD_S, NAVCOMPASS_RESPONSE_TIME_S * log(10.0), filterLag_s);
+    // Response times are multiples of the sample period
+    TEST_ASSERT_LESS_THAN_FLOAT(legacyLag_s + 0.5 * SAMPLE_PERIOD_S, filterLag_s);
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 0.0, WrapError_deg(filter.GetHeading() - 70.0));
+    // Heel is not disturbed by a heading change
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 10.0, filter.GetHeel());
+}
+
+// With noisy sensors, the attitude filter gives a heading about as steady as the legacy filter for the same lag. A first
+// order response is slightly noisier than an average of the same 90% response time.
+void test_sensor_noise()
+{
+    AttitudeFilter      filter;
+    LegacyHeadingFilter legacy;
+    Attitude_t          attitude      = {355.0, 15.0, -5.0};
+    ErrorStats_t        filterHeading = {}, legacyHeading = {}, heel = {}, pitch = {};
+    vec                 accel, mag;
+
+    Hold(&filter, &attitude, 5 * NAVCOMPASS_RESPONSE_TIME_S);
+    for (int i = 0; i < (int)(120.0 / SAMPLE_PERIOD_S); i++)
+    {
+        GetSensorReadings(&attitude, true, &accel, &mag);
+        filter.Update(&accel, &mag, SAMPLE_PERIOD_S);
+        float legacyValue = legacy.Update(&accel, &mag);
+
+        AddError(&filterHeading, WrapError_deg(filter.GetHeading() - attitude.heading_deg));
+        AddError(&legacyHeading, WrapError_deg(legacyValue - attitude.heading_deg));
+        AddError(&heel, filter.GetHeel() - ExpectedHeel_deg(&attitude));
+        AddError(&pitch, filter.GetPitch() - attitude.pitch_deg);
+    }
+
+    printf("Heading noise (std/max) : attitude filter %.2f/%.2fdeg, legacy filter %.2f/%.2fdeg\n", StdDev(&filterHeading),
+           filterHeading.max, StdDev(&legacyHeading), legacyHeading.max);
+    printf("Heel noise %.2f/%.2fdeg, pitch noise %.2f/%.2fdeg\n", StdDev(&heel), heel.max, StdDev(&pitch), pitch.max);
+    TEST_ASSERT_LESS_THAN_FLOAT(1.25 * StdDev(&legacyHeading), StdDev(&filterHeading));
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0, StdDev(&heel));
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0, StdDev(&pitch));
+}
+
+// While rolling, heading stays tilt compensated even though heel and pitch estimates lag the roll. The legacy filter has
+// no error on a steady heading : the lag of the estimated tilt only adds a small fraction of a degree to it.
+void test_rolling()
+{
+    AttitudeFilter      filter;
+    LegacyHeadingFilter legacy;
+    Attitude_t          attitude          = {120.0, 0.0, 0.0};
+    ErrorStats_t        filterHeading     = {}, legacyHeading = {};
+    double              maxHeel           = 0.0;
+    const double        rollAmplitude_deg = 20.0, rollPeriod_s = 8.0;
+
+    Hold(&filter, &attitude, 5 * NAVCOMPASS_RESPONSE_TIME_S);
+    for (int i = 0; i < (int)(5 * rollPeriod_s / SAMPLE_PERIOD_S); i++)
+    {
+        vec accel, mag;
+
+        attitude.heel_deg  = rollAmplitude_deg * sin(2.0 * M_PI * i * SAMPLE_PERIOD_S / rollPeriod_s);
+        attitude.pitch_deg = 0.3 * attitude.heel_deg;
+        GetSensorReadings(&attitude, false, &accel, &mag);
+        filter.Update(&accel, &mag, SAMPLE_PERIOD_S);
+        float legacyValue = legacy.Update(&accel, &mag);
+
+        AddError(&filterHeading, WrapError_deg(filter.GetHeading() - attitude.heading_deg));
+        AddError(&legacyHeading, WrapError_deg(legacyValue - attitude.heading_deg));
+        if (fabs(filter.GetHeel()) > maxHeel)
+            maxHeel = fabs(filter.GetHeel());
+    }
+
+    // Heel follows the roll as a first order response
+    double omega = 2.0 * M_PI / rollPeriod_s;
+    double gain  = 1.0 / sqrt(1.0 + omega * omega * NAVCOMPASS_RESPONSE_TIME_S * NAVCOMPASS_RESPONSE_TIME_S);
+    printf("Rolling %.0fdeg/%.0fs : heading error %.2fdeg max (legacy filter %.2fdeg), heel amplitude %.1fdeg\n", rollAmplitude_deg,
+           rollPeriod_s, filterHeading.max, legacyHeading.max, maxHeel);
+    TEST_ASSERT_LESS_THAN_FLOAT(legacyHeading.max + 0.2, filterHeading.max);
+    TEST_ASSERT_FLOAT_WITHIN(1.5, rollAmplitude_deg * gain, maxHeel);
+}
+
+// A constant turn is measured as rate of turn, and heading lags it by one response time
+void test_rate_of_turn()
+{
+    AttitudeFilter filter;
+    Attitude_t     attitude   = {0.0, 5.0, 0.0};
+    const double   rate_degps = 3.0;
+
+    Hold(&filter, &attitude, 5 * NAVCOMPASS_RESPONSE_TIME_S);
+    for (int i = 0; i < (int)(60.0 / SAMPLE_PERIOD_S); i++)
+    {
+        vec accel, mag;
+
+        attitude.heading_deg = fmod(attitude.heading_deg + rate_degps * SAMPLE_PERIOD_S, 360.0);
+        GetSensorReadings(&attitude, false, &accel, &mag);
+        filter.Update(&accel, &mag, SAMPLE_PERIOD_S);
+    }
+
+    printf("Turn at %.0fdeg/min : rate of turn %.1fdeg/min, heading lag %.2fdeg\n", rate_degps * 60.0, filter.GetRateOfTurn(),
+           WrapError_deg(attitude.heading_deg - filter.GetHeading()));
+    TEST_ASSERT_FLOAT_WITHIN(0.05 * rate_degps * 60.0, rate_degps * 60.0, filter.GetRateOfTurn());
+    TEST_ASSERT_FLOAT_WITHIN(0.5, rate_degps * NAVCOMPASS_RESPONSE_TIME_S, WrapError_deg(attitude.heading_deg - filter.GetHeading()));
+    TEST_ASSERT_FLOAT_WITHIN(0.3, 5.0, filter.GetHeel());
+}
+
+// A magnetic disturbance only affects heading : heel and pitch come from gravity
+void test_magnetic_disturbance()
+{
+    AttitudeFilter filter;
+    Attitude_t     attitude = {80.0, 12.0, -4.0};
+    double         up[3]    = {0.0, 0.0, 1.0};
+    double         field[3] = {cos(40.0 * DEG_TO_RAD) * cos(20.0 * DEG_TO_RAD), -cos(40.0 * DEG_TO_RAD) * sin(20.0 * DEG_TO_RAD),
+                               -sin(40.0 * DEG_TO_RAD)};
+    vec            accel, mag;
+
+    Hold(&filter, &attitude, 5 * NAVCOMPASS_RESPONSE_TIME_S);
+
+    // Field rotated by 20deg toward East with a different inclination
+    EarthToCompass(&attitude, up, &accel);
+    EarthToCompass(&attitude, field, &mag);
+    for (int i = 0; i < (int)(10 * NAVCOMPASS_RESPONSE_TIME_S / SAMPLE_PERIOD_S); i++)
+    {
+        filter.Update(&accel, &mag, SAMPLE_PERIOD_S);
+        TEST_ASSERT_FLOAT_WITHIN(0.2, ExpectedHeel_deg(&attitude), filter.GetHeel());
+        TEST_ASSERT_FLOAT_WITHIN(0.2, -4.0, filter.GetPitch());
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.3, 0.0, WrapError_deg(filter.GetHeading() - 60.0));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_initialization);
+    RUN_TEST(test_static_convergence);
+    RUN_TEST(test_heading_step_lag);
+    RUN_TEST(test_sensor_noise);
+    RUN_TEST(test_rolling);
+    RUN_TEST(test_rate_of_turn);
+    RUN_TEST(test_magnetic_disturbance);
+    return UNITY_END();
+}
@@ -0,0 +1,368 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Host benchmark of codec, bridge and FIFO hot paths            *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "Configuration.h"
+#include "DataBridge.h"
+#include "MicronetCodec.h"
+#include "MicronetMessageFifo.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+// Each benchmark is timed over an odd number of batches so that its median is one of them
+#define BENCHMARK_NB_BATCHES 11
+// Iterations of a batch are doubled until the batch lasts long enough for timer resolution and scheduling noise to be negligible
+#define BENCHMARK_MIN_BATCH_US   5000
+#define BENCHMARK_MAX_ITERATIONS 1048576
+
+#define BENCHMARK_NETWORK_ID  0x83038c8e
+#define BENCHMARK_DEVICE_ID   0x03123456
+#define BENCHMARK_DATA_FIELDS 0x00003fff
+
+// Machine-readable results of the last run, with the columns of recorded_results.csv
+#define BENCHMARK_RESULTS_FILE "benchmark_results.csv"
+
+#define FRAME_MASTER_REQUEST 0
+#define FRAME_HULL_DATA      1
+#define FRAME_WIND_DATA      2
+#define NB_FRAMES            3
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+typedef struct
+{
+    uint8_t len;
+    uint8_t data[MICRONET_MAX_MESSAGE_LENGTH];
+} RecordedFrame_t;
+
+typedef struct
+{
+    MicronetCodec            *micronetCodec;
+    DataBridge               *dataBridge;
+    MicronetMessageFifo      *messageFifo;
+    MicronetMessage_t         frame[NB_FRAMES];
+    MicronetMessage_t         message;
+    MicronetCodec::NetworkMap networkMap;
+} BenchmarkContext_t;
+
+typedef void (*BenchmarkFunction_t)(BenchmarkContext_t *context, int arg);
+
+typedef struct
+{
+    const char         *name;
+    BenchmarkFunction_t function;
+    int                 arg;
+    uint32_t            threshold_ns;
+} BenchmarkDesc_t;
+
+typedef struct
+{
+    uint32_t iterations; // Iterations per batch
+    uint32_t median_ns;  // Time per iteration
+    uint32_t min_ns;
+    uint32_t max_ns;
+} BenchmarkResult_t;
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+static void     InitContext(BenchmarkContext_t *context);
+static void     RunBenchmark(BenchmarkContext_t *context, const BenchmarkDesc_t *benchmark, BenchmarkResult_t *result);
+static uint32_t RunBatch(BenchmarkContext_t *context, const BenchmarkDesc_t *benchmark, uint32_t iterations);
+static void     BenchVerifyHeaderCrc(BenchmarkContext_t *context, int arg);
+static void     BenchGetNetworkMap(BenchmarkContext_t *context, int arg);
+static void     BenchDecodeMessage(BenchmarkContext_t *context, int arg);
+static void     BenchEncodeDataMessage(BenchmarkContext_t *context, int arg);
+static void     BenchPushNmeaSentence(BenchmarkContext_t *context, int arg);
+static void     BenchEncoder(BenchmarkContext_t *context, int arg);
+static void     BenchFifo(BenchmarkContext_t *context, int arg);
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+// Reference Micronet frames, indexed by FRAME_*
+static const RecordedFrame_t recordedFrames[NB_FRAMES] = {
+    // MASTER_REQUEST with 4 slave devices
+    {42, {0x83, 0x03, 0x8c, 0x8e, 0x81, 0x03, 0x8c, 0x8e, 0x01, 0x09, 0x05, 0x4d, 0x28, 0x28, 0x81, 0x03, 0x8c, 0x8e, 0x00, 0x01, 0x02, 0x34, 0x56,
+          0x0c, 0x02, 0x03, 0x45, 0x67, 0x0c, 0x81, 0x04, 0x56, 0x78, 0x00, 0x03, 0x12, 0x34, 0x56, 0x14, 0x00, 0x00, 0xfa}},
+    // SEND_DATA from a hull transmitter : SPD, DPT, STP, LOG/TRIP, VCC
+    {49, {0x83, 0x03, 0x8c, 0x8e, 0x01, 0x02, 0x34, 0x56, 0x02, 0x01, 0x05, 0x35, 0x2f, 0x2f, 0x04, 0x01, 0x05, 0x02, 0x8c, 0x98, 0x04, 0x04, 0x05,
+          0x01, 0x9c, 0xaa, 0x03, 0x03, 0x05, 0x24, 0x2f, 0x0a, 0x02, 0x05, 0x00, 0x00, 0x04, 0xd2, 0x00, 0x00, 0xdd, 0xd5, 0x99, 0x04, 0x1b, 0x05,
+          0x00, 0x80, 0xa4}},
+    // SEND_DATA from a wind transducer : AWS, AWA
+    {26, {0x83, 0x03, 0x8c, 0x8e, 0x02, 0x03, 0x45, 0x67, 0x02, 0x01, 0x05, 0x59, 0x18, 0x18, 0x04, 0x05, 0x05, 0x00, 0x7d, 0x8b, 0x04, 0x06, 0x05,
+          0xff, 0xd6, 0xe4}},
+};
+
+static const char *recordedSentences[] = {
+    "$GPRMB,A,0.66,L,003,004,4917.24,N,12309.57,W,001.3,052.5,000.5,V*20\r\n",
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n",
+    "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n",
+    "$GPGLL,4916.45,N,12311.12,W,225444,A,*1D\r\n",
+    "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48\r\n",
+    "$WIMWV,214.8,R,12.5,N,A*1A\r\n",
+    "$SDDPT,12.4,0.5*65\r\n",
+    "$VWVHW,,T,245.1,M,6.52,N,12.07,K*4D\r\n",
+    "$HCHDG,245.1,,,1.2,W*3A\r\n",
+};
+
+// Regression thresholds in ns per iteration, 2.5 times the median of recorded_results.csv rounded up. These results are the
+// median of 5 runs on the reference development computer (Intel Xeon, g++ 12.2, -O2), whose medians spread by up to 2 times
+// from one run to the other. Record the results again and update the thresholds when the reference changes.
+static const BenchmarkDesc_t benchmarks[] = {
+    {"VerifyHeaderCrc", BenchVerifyHeaderCrc, FRAME_MASTER_REQUEST, 28},
+    {"GetNetworkMap", BenchGetNetworkMap, FRAME_MASTER_REQUEST, 120},
+    {"DecodeMessage (hull)", BenchDecodeMessage, FRAME_HULL_DATA, 260},
+    {"DecodeMessage (wind)", BenchDecodeMessage, FRAME_WIND_DATA, 130},
+    {"EncodeDataMessage", BenchEncodeDataMessage, BENCHMARK_DATA_FIELDS, 390},
+    {"PushNmeaChar RMB", BenchPushNmeaSentence, 0, 4100},
+    {"PushNmeaChar RMC", BenchPushNmeaSentence, 1, 4200},
+    {"PushNmeaChar GGA", BenchPushNmeaSentence, 2, 2700},
+    {"PushNmeaChar GLL", BenchPushNmeaSentence, 3, 2200},
+    {"PushNmeaChar VTG", BenchPushNmeaSentence, 4, 2500},
+    {"PushNmeaChar MWV", BenchPushNmeaSentence, 5, 2000},
+    {"PushNmeaChar DPT", BenchPushNmeaSentence, 6, 1700},
+    {"PushNmeaChar VHW", BenchPushNmeaSentence, 7, 2100},
+    {"PushNmeaChar HDG", BenchPushNmeaSentence, 8, 1200},
+    {"EncodeMWV_R", BenchEncoder, ENCODER_MWV_R, 2200},
+    {"EncodeMWV_T", BenchEncoder, ENCODER_MWV_T, 2000},
+    {"EncodeMWD", BenchEncoder, ENCODER_MWD, 3100},
+    {"EncodeVWT", BenchEncoder, ENCODER_VWT, 3100},
+    {"EncodeDPT", BenchEncoder, ENCODER_DPT, 1700},
+    {"EncodeMTW", BenchEncoder, ENCODER_MTW, 1300},
+    {"EncodeVLW", BenchEncoder, ENCODER_VLW, 2300},
+    {"EncodeVHW", BenchEncoder, ENCODER_VHW, 2700},
+    {"EncodeHDG", BenchEncoder, ENCODER_HDG, 2000},
+    {"EncodeXDR", BenchEncoder, ENCODER_XDR, 1400},
+    {"EncodeROT", BenchEncoder, ENCODER_ROT, 1300},
+    {"EncodeXDR_Attitude", BenchEncoder, ENCODER_XDR_ATTITUDE, 2000},
+    {"EncodeRMC", BenchEncoder, ENCODER_RMC, 6200},
+    {"EncodeGGA", BenchEncoder, ENCODER_GGA, 5500},
+    {"EncodeVTG", BenchEncoder, ENCODER_VTG, 3100},
+    {"MicronetMessageFifo push/pop", BenchFifo, 0, 140},
+};
+
+#define NB_BENCHMARKS ((int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+static volatile uint32_t benchmarkSink; // Keeps results of benchmarked functions alive
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// Time the hot paths of Micronet codec, NMEA bridge and message FIFO on fixed recorded inputs, write the results file and
+// compare the median time of each of them to its regression threshold
+void test_benchmarks()
+{
+    MicronetCodec       micronetCodec;
+    Configuration       configuration;
+    MicronetMessageFifo messageFifo;
+    BenchmarkContext_t  context;
+    BenchmarkResult_t   results[NB_BENCHMARKS];
+    int                 nbRegressions = 0;
+    char                message[160];
+
+    // All NMEA data is decoded from the external link, so that each sentence goes through its decoder
+    for (int i = 0; i < DATA_SOURCE_NB; i++)
+    {
+        configuration.sourceLink[i] = LINK_NMEA_EXT;
+    }
+    configuration.spdEmulation = false;
+
+    // Sentences go to a serial port which drops them. No latency tracer is given to the bridge : benchmark iterations are
+    // not real latencies.
+    DataBridge dataBridge(&micronetCodec, &configuration);
+
+    context.micronetCodec = &micronetCodec;
+    context.dataBridge    = &dataBridge;
+    context.messageFifo   = &messageFifo;
+    InitContext(&context);
+
+    FILE *resultsFile = fopen(BENCHMARK_RESULTS_FILE, "w");
+    TEST_ASSERT_NOT_NULL(resultsFile);
+    fprintf(resultsFile, "benchmark,iterations,median_ns,min_ns,max_ns,threshold_ns,status\n");
+
+    for (int i = 0; i < NB_BENCHMARKS; i++)
+    {
+        bool regression;
+
+        RunBenchmark(&context, &benchmarks[i], &results[i]);
+        regression = (results[i].median_ns > benchmarks[i].threshold_ns);
+        nbRegressions += regression ? 1 : 0;
+
+        fprintf(resultsFile, "%s,%u,%u,%u,%u,%u,%s\n", benchmarks[i].name, results[i].iterations, results[i].median_ns, results[i].min_ns,
+                results[i].max_ns, benchmarks[i].threshold_ns, regression ? "REGRESSION" : "OK");
+        snprintf(message, sizeof(message), "%s : median %u ns, min %u, max %u, threshold %u%s", benchmarks[i].name, results[i].median_ns,
+                 results[i].min_ns, results[i].max_ns, benchmarks[i].threshold_ns, regression ? " /!\\ REGRESSION /!\\" : "");
+        TEST_MESSAGE(message);
+    }
+    fclose(resultsFile);
+
+    TEST_ASSERT_EQUAL_MESSAGE(0, nbRegressions, "Benchmark(s) above threshold");
+}
+
+// Load recorded frames and give a valid value to all navigation data, so that encoders run their complete path
+static void InitContext(BenchmarkContext_t *context)
+{
+    NavigationData *navData = &context->micronetCodec->navData;
+
+    // Host time stays still : values are stamped later than the last sentence time of encoders, which ForceEncoders resets
+    gHostTime_us = 10000000;
+
+    for (int i = 0; i < NB_FRAMES; i++)
+    {
+        memset(&context->frame[i], 0, sizeof(MicronetMessage_t));
+        context->frame[i].len = recordedFrames[i].len;
+        memcpy(context->frame[i].data, recordedFrames[i].data, recordedFrames[i].len);
+    }
+    context->frame[FRAME_MASTER_REQUEST].endTime_us = 3000;
+    memset(&context->message, 0, sizeof(MicronetMessage_t));
+
+    navData->waterSpeedFactor_per = 1.0f;
+    navData->windSpeedFactor_per  = 1.0f;
+    for (int i = 0; i < NAV_NB_VALUES; i++)
+    {
+        navData->Set((NavValueId_t)i, 10.0f + i);
+    }
+    navData->time     = {true, 12, 34, 56, 0, millis()};
+    navData->date     = {true, 23, 3, 94, millis()};
+    navData->waypoint = {true, "WPT001", 6, millis()};
+    navData->gnssFix  = {true, 3, 9, 1.2f, 45.0f, 2.5f, 4.0f, 0.2f, 1.5f, millis()};
+}
+
+// Calibrate the number of iterations of a batch, then keep median, min and max time of all batches
+static void RunBenchmark(BenchmarkContext_t *context, const BenchmarkDesc_t *benchmark, BenchmarkResult_t *result)
+{
+    uint32_t batchTime_us[BENCHMARK_NB_BATCHES];
+    uint32_t iterations = 1;
+
+    while ((RunBatch(context, benchmark, iterations) < BENCHMARK_MIN_BATCH_US) && (iterations < BENCHMARK_MAX_ITERATIONS))
+    {
+        iterations *= 2;
+    }
+
+    // Batches are insertion sorted as they complete
+    for (int i = 0; i < BENCHMARK_NB_BATCHES; i++)
+    {
+        uint32_t time_us = RunBatch(context, benchmark, iterations);
+        int      j       = i;
+
+        while ((j > 0) && (batchTime_us[j - 1] > time_us))
+        {
+            batchTime_us[j] = batchTime_us[j - 1];
+            j--;
+        }
+        batchTime_us[j] = time_us;
+    }
+
+    result->iterations = iterations;
+    result->median_ns  = (uint32_t)(((uint64_t)batchTime_us[BENCHMARK_NB_BATCHES / 2] * 1000) / iterations);
+    result->min_ns     = (uint32_t)(((uint64_t)batchTime_us[0] * 1000) / iterations);
+    result->max_ns     = (uint32_t)(((uint64_t)batchTime_us[BENCHMARK_NB_BATCHES - 1] * 1000) / iterations);
+}
+
+static uint32_t RunBatch(BenchmarkContext_t *context, const BenchmarkDesc_t *benchmark, uint32_t iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        benchmark->function(context, benchmark->arg);
+    }
+
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void BenchVerifyHeaderCrc(BenchmarkContext_t *context, int arg)
+{
+    benchmarkSink = context->micronetCodec->VerifyHeaderCrc(&context->frame[arg]);
+}
+
+static void BenchGetNetworkMap(BenchmarkContext_t *context, int arg)
+{
+    benchmarkSink = context->micronetCodec->GetNetworkMap(&context->frame[arg], &context->networkMap);
+}
+
+static void BenchDecodeMessage(BenchmarkContext_t *context, int arg)
+{
+    benchmarkSink = context->micronetCodec->DecodeMessage(&context->frame[arg]);
+}
+
+static void BenchEncodeDataMessage(BenchmarkContext_t *context, int arg)
+{
+    benchmarkSink = context->micronetCodec->EncodeDataMessage(&context->message, 0x05, BENCHMARK_NETWORK_ID, BENCHMARK_DEVICE_ID, arg);
+}
+
+// Push a complete sentence, including the end of line which triggers its decoding
+static void BenchPushNmeaSentence(BenchmarkContext_t *context, int arg)
+{
+    for (const char *c = recordedSentences[arg]; *c != 0; c++)
+    {
+        context->dataBridge->PushNmeaChar(*c, LINK_NMEA_EXT);
+    }
+}
+
+static void BenchEncoder(BenchmarkContext_t *context, int arg)
+{
+    context->dataBridge->ForceEncoders(arg);
+}
+
+static void BenchFifo(BenchmarkContext_t *context, int arg)
+{
+    context->messageFifo->Push(context->message);
+    benchmarkSink = context->messageFifo->Pop(&context->message);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmarks);
+    return UNITY_END();
+}
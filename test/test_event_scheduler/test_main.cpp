@@ -0,0 +1,419 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Host tests of the event scheduler                             *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "EventScheduler.h"
+
+#include <string.h>
+#include <unity.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define SIM_MAX_SOURCE_EVENTS 16
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+typedef struct
+{
+    uint32_t time_us;
+    int      taskId;
+} SimSourceEvent_t;
+
+// Virtual clock and interrupt controller. Simulated event sources play the role of ISRs : they signal tasks at a given
+// time, or as soon as interrupts are enabled again if the scheduler has masked them at that time.
+class SimulatedPlatform : public SchedulerPlatform
+{
+  public:
+    SimulatedPlatform();
+    virtual ~SimulatedPlatform();
+
+    uint32_t GetTime_us() override;
+    void     DisableInterrupts() override;
+    void     EnableInterrupts() override;
+
+    void     Reset(uint32_t start_us);
+    void     AddSourceEvent(uint32_t time_us, int taskId);
+    void     AdvanceTo(uint32_t time_us);
+    void     Advance(uint32_t delay_us);
+    uint32_t GetMaskDepth();
+
+    uint32_t now_us;
+    uint32_t timePerRead_us; // Time elapsed at each clock read, to make events occur inside masked sections
+
+  private:
+    SimSourceEvent_t events[SIM_MAX_SOURCE_EVENTS];
+    int              nbEvents;
+    uint32_t         maskDepth;
+
+    void RaiseDueEvents();
+};
+
+typedef struct
+{
+    int      nbRuns;
+    uint32_t runTime_us;  // Virtual time consumed by each run
+    int      signalTaskId; // Task signalled by an event raised during the run, -1 if none
+    int     *runLog;
+    int     *runLogLength;
+    int      logId;
+} SimTaskContext_t;
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+void SimTaskCallback(void *context);
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+SimulatedPlatform simPlatform;
+EventScheduler   *scheduler;
+int               runLog[64];
+int               runLogLength;
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+SimulatedPlatform::SimulatedPlatform()
+{
+    Reset(0);
+}
+
+SimulatedPlatform::~SimulatedPlatform()
+{
+}
+
+uint32_t SimulatedPlatform::GetTime_us()
+{
+    now_us += timePerRead_us;
+    if (maskDepth == 0)
+    {
+        RaiseDueEvents();
+    }
+    return now_us;
+}
+
+void SimulatedPlatform::DisableInterrupts()
+{
+    maskDepth++;
+}
+
+void SimulatedPlatform::EnableInterrupts()
+{
+    TEST_ASSERT_TRUE(maskDepth > 0);
+    if (--maskDepth == 0)
+    {
+        RaiseDueEvents();
+    }
+}
+
+void SimulatedPlatform::Reset(uint32_t start_us)
+{
+    now_us         = start_us;
+    timePerRead_us = 0;
+    nbEvents       = 0;
+    maskDepth      = 0;
+}
+
+// Schedule a simulated ISR signalling taskId at time_us
+void SimulatedPlatform::AddSourceEvent(uint32_t time_us, int taskId)
+{
+    TEST_ASSERT_TRUE(nbEvents < SIM_MAX_SOURCE_EVENTS);
+    events[nbEvents].time_us = time_us;
+    events[nbEvents].taskId  = taskId;
+    nbEvents++;
+}
+
+// Move the clock forward, raising the events met on the way at their own time
+void SimulatedPlatform::AdvanceTo(uint32_t time_us)
+{
+    while (true)
+    {
+        int next = -1;
+        for (int i = 0; i < nbEvents; i++)
+        {
+            if (((int32_t)(events[i].time_us - time_us) <= 0) && ((next < 0) || ((int32_t)(events[i].time_us - events[next].time_us) < 0)))
+            {
+                next = i;
+            }
+        }
+        if (next < 0)
+        {
+            break;
+        }
+        if ((int32_t)(events[next].time_us - now_us) > 0)
+        {
+            now_us = events[next].time_us;
+        }
+        RaiseDueEvents();
+    }
+    now_us = time_us;
+}
+
+void SimulatedPlatform::Advance(uint32_t delay_us)
+{
+    AdvanceTo(now_us + delay_us);
+}
+
+uint32_t SimulatedPlatform::GetMaskDepth()
+{
+    return maskDepth;
+}
+
+// Run the ISRs of all the events which are due, in time order
+void SimulatedPlatform::RaiseDueEvents()
+{
+    int i = 0;
+
+    while (i < nbEvents)
+    {
+        if ((int32_t)(events[i].time_us - now_us) <= 0)
+        {
+            int taskId = events[i].taskId;
+            events[i]  = events[--nbEvents];
+            scheduler->Signal(taskId);
+            i = 0;
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void SimTaskCallback(void *context)
+{
+    SimTaskContext_t *task = (SimTaskContext_t *)context;
+
+    TEST_ASSERT_EQUAL_UINT32(0, simPlatform.GetMaskDepth());
+    task->nbRuns++;
+    if (task->runLog != nullptr)
+    {
+        task->runLog[(*task->runLogLength)++] = task->logId;
+    }
+    if (task->signalTaskId >= 0)
+    {
+        simPlatform.AddSourceEvent(simPlatform.now_us + task->runTime_us / 2, task->signalTaskId);
+        task->signalTaskId = -1;
+    }
+    simPlatform.Advance(task->runTime_us);
+}
+
+void setUp()
+{
+    simPlatform.Reset(1000);
+    scheduler    = new EventScheduler(&simPlatform);
+    runLogLength = 0;
+}
+
+void tearDown()
+{
+    delete scheduler;
+}
+
+static void InitContext(SimTaskContext_t *context, int logId)
+{
+    memset(context, 0, sizeof(SimTaskContext_t));
+    context->signalTaskId = -1;
+    context->runLog       = runLog;
+    context->runLogLength = &runLogLength;
+    context->logId        = logId;
+}
+
+// Pending tasks run by priority, then by registration order
+void test_priority_order()
+{
+    SimTaskContext_t low, high1, high2;
+
+    InitContext(&low, 0);
+    InitContext(&high1, 1);
+    InitContext(&high2, 2);
+    int lowId   = scheduler->AddTask("low", 3, SimTaskCallback, &low, 0);
+    int high1Id = scheduler->AddTask("high1", 1, SimTaskCallback, &high1, 0);
+    int high2Id = scheduler->AddTask("high2", 1, SimTaskCallback, &high2, 0);
+
+    TEST_ASSERT_FALSE(scheduler->RunNext());
+    simPlatform.AddSourceEvent(1100, lowId);
+    simPlatform.AddSourceEvent(1200, high2Id);
+    simPlatform.AddSourceEvent(1300, high1Id);
+    simPlatform.AdvanceTo(1400);
+
+    while (scheduler->RunNext())
+        ;
+
+    TEST_ASSERT_EQUAL(3, runLogLength);
+    TEST_ASSERT_EQUAL(1, runLog[0]);
+    TEST_ASSERT_EQUAL(2, runLog[1]);
+    TEST_ASSERT_EQUAL(0, runLog[2]);
+}
+
+// Events received while a task is pending are coalesced and latency is measured from the oldest one
+void test_signal_coalescing()
+{
+    SimTaskContext_t context;
+    SchedulerTask_t  stats;
+
+    InitContext(&context, 0);
+    int taskId = scheduler->AddTask("event", 0, SimTaskCallback, &context, 0);
+
+    simPlatform.AddSourceEvent(1100, taskId);
+    simPlatform.AddSourceEvent(1300, taskId);
+    simPlatform.AdvanceTo(1500);
+    TEST_ASSERT_TRUE(scheduler->RunNext());
+    TEST_ASSERT_FALSE(scheduler->RunNext());
+
+    TEST_ASSERT_EQUAL(1, context.nbRuns);
+    TEST_ASSERT_TRUE(scheduler->GetTaskStatistics(taskId, &stats));
+    TEST_ASSERT_EQUAL_UINT32(400, stats.maxLatency_us);
+}
+
+// An event occurring while its task runs wakes the task up again
+void test_signal_during_run()
+{
+    SimTaskContext_t context;
+
+    InitContext(&context, 0);
+    int taskId           = scheduler->AddTask("event", 0, SimTaskCallback, &context, 0);
+    context.runTime_us   = 200;
+    context.signalTaskId = taskId;
+
+    scheduler->Signal(taskId);
+    TEST_ASSERT_TRUE(scheduler->RunNext());
+    TEST_ASSERT_TRUE(scheduler->RunNext());
+    TEST_ASSERT_FALSE(scheduler->RunNext());
+    TEST_ASSERT_EQUAL(2, context.nbRuns);
+}
+
+// An event raised while the scheduler masks interrupts is delivered when they are enabled again, never lost
+void test_event_in_masked_section()
+{
+    SimTaskContext_t context;
+
+    InitContext(&context, 0);
+    int taskId = scheduler->AddTask("event", 0, SimTaskCallback, &context, 0);
+
+    // Each clock read takes 10us : the event falls inside the masked section of Signal()
+    simPlatform.AddSourceEvent(1005, taskId);
+    simPlatform.timePerRead_us = 10;
+    scheduler->Signal(taskId);
+    TEST_ASSERT_EQUAL_UINT32(0, simPlatform.GetMaskDepth());
+    TEST_ASSERT_TRUE(scheduler->RunNext());
+    TEST_ASSERT_FALSE(scheduler->RunNext());
+    TEST_ASSERT_EQUAL(1, context.nbRuns);
+}
+
+// Periodic tasks are released on their period, report their lateness and don't try to catch-up when late
+void test_periodic_release()
+{
+    SimTaskContext_t context;
+    SchedulerTask_t  stats;
+
+    InitContext(&context, 0);
+    int taskId = scheduler->AddTask("periodic", 0, SimTaskCallback, &context, 1000);
+
+    TEST_ASSERT_EQUAL_UINT32(1000, scheduler->GetNextDeadlineDelay_us());
+    simPlatform.AdvanceTo(1999);
+    TEST_ASSERT_FALSE(scheduler->RunNext());
+    simPlatform.AdvanceTo(2050);
+    TEST_ASSERT_TRUE(scheduler->RunNext());
+    TEST_ASSERT_EQUAL_UINT32(950, scheduler->GetNextDeadlineDelay_us());
+
+    // Late by more than one period : a single run, and the next release is one period later
+    simPlatform.AdvanceTo(5500);
+    TEST_ASSERT_TRUE(scheduler->RunNext());
+    TEST_ASSERT_FALSE(scheduler->RunNext());
+    TEST_ASSERT_EQUAL_UINT32(1000, scheduler->GetNextDeadlineDelay_us());
+
+    TEST_ASSERT_TRUE(scheduler->GetTaskStatistics(taskId, &stats));
+    TEST_ASSERT_EQUAL_UINT32(2, stats.nbRuns);
+    TEST_ASSERT_EQUAL_UINT32(2500, stats.maxLatency_us);
+}
+
+// Periodic releases are not disturbed by the wrap-around of the microsecond clock
+void test_periodic_wrap_around()
+{
+    SimTaskContext_t context;
+
+    simPlatform.Reset(0xfffff000);
+    InitContext(&context, 0);
+    scheduler->AddTask("periodic", 0, SimTaskCallback, &context, 1000);
+
+    for (int i = 0; i < 10; i++)
+    {
+        simPlatform.Advance(scheduler->GetNextDeadlineDelay_us());
+        TEST_ASSERT_TRUE(scheduler->RunNext());
+        TEST_ASSERT_FALSE(scheduler->RunNext());
+    }
+    TEST_ASSERT_EQUAL(10, context.nbRuns);
+    TEST_ASSERT_EQUAL_UINT32(0xfffff000 + 10000, simPlatform.now_us);
+}
+
+// SignalAt arms a single wake-up of an event task, which a new call replaces
+void test_signal_at()
+{
+    SimTaskContext_t context;
+
+    InitContext(&context, 0);
+    int taskId = scheduler->AddTask("deadline", 0, SimTaskCallback, &context, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(0xffffffff, scheduler->GetNextDeadlineDelay_us());
+    scheduler->SignalAt(taskId, 3000);
+    scheduler->SignalAt(taskId, 2000);
+    TEST_ASSERT_EQUAL_UINT32(1000, scheduler->GetNextDeadlineDelay_us());
+
+    simPlatform.AdvanceTo(1999);
+    TEST_ASSERT_FALSE(scheduler->RunNext());
+    simPlatform.AdvanceTo(2000);
+    TEST_ASSERT_TRUE(scheduler->RunNext());
+    simPlatform.AdvanceTo(4000);
+    TEST_ASSERT_FALSE(scheduler->RunNext());
+    TEST_ASSERT_EQUAL(1, context.nbRuns);
+    TEST_ASSERT_EQUAL_UINT32(0xffffffff, scheduler->GetNextDeadlineDelay_us());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_priority_order);
+    RUN_TEST(test_signal_coalescing);
+    RUN_TEST(test_signal_during_run);
+    RUN_TEST(test_event_in_masked_section);
+    RUN_TEST(test_periodic_release);
+    RUN_TEST(test_periodic_wrap_around);
+    RUN_TEST(test_signal_at);
+    return UNITY_END();
+}
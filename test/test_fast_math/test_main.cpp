@@ -0,0 +1,176 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Host accuracy and speed benchmark of fast math                *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "FastMath.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define SWEEP_LENGTH 200000
+#define BENCH_LENGTH 1000000
+#define DEG_TO_RAD   (M_PI / 180.0)
+
+// Maximum errors, as documented in FastMath.h
+#define ATAN2_MAX_ERROR_RAD 3e-7
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+static volatile float benchSink;
+static float          benchInput[1024];
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// Time a function on BENCH_LENGTH calls, in ns per call
+template <typename F> static double Bench(F function)
+{
+    float sum   = 0.0f;
+    auto  start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < BENCH_LENGTH; i++)
+    {
+        sum += function(benchInput[i & 1023]);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    benchSink = sum;
+
+    return std::chrono::duration<double, std::nano>(stop - start).count() / BENCH_LENGTH;
+}
+
+static void PrintBench(const char *name, double fast_ns, double libm_ns)
+{
+    printf("%-16s %6.2f ns/call, libm %6.2f ns/call (x%.2f)\n", name, fast_ns, libm_ns, libm_ns / fast_ns);
+}
+
+void test_atan2_accuracy()
+{
+    const float radii[] = {1e-3f, 1.0f, 1e4f};
+    double      maxError = 0.0;
+
+    // Whole circle, on several radii
+    for (int i = 0; i <= SWEEP_LENGTH; i++)
+    {
+        double angle = -M_PI + 2.0 * M_PI * i / SWEEP_LENGTH;
+        for (float radius : radii)
+        {
+            float  y     = radius * sin(angle);
+            float  x     = radius * cos(angle);
+            double error = fabs(FastAtan2(y, x) - atan2((double)y, (double)x));
+            if (error > maxError)
+                maxError = error;
+        }
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, FastAtan2(0.0f, 0.0f));
+    TEST_ASSERT_FLOAT_WITHIN(ATAN2_MAX_ERROR_RAD, M_PI_2, FastAtan2(1.0f, 0.0f));
+    TEST_ASSERT_FLOAT_WITHIN(ATAN2_MAX_ERROR_RAD, -M_PI_2, FastAtan2(-1.0f, 0.0f));
+    TEST_ASSERT_FLOAT_WITHIN(ATAN2_MAX_ERROR_RAD, M_PI, FastAtan2(0.0f, -1.0f));
+
+    printf("FastAtan2 max error %.3g rad\n", maxError);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(ATAN2_MAX_ERROR_RAD, maxError);
+}
+
+void test_wrap()
+{
+    for (int i = 0; i <= SWEEP_LENGTH; i++)
+    {
+        float  angle    = -7200.0f + 14400.0f * i / SWEEP_LENGTH;
+        float  wrap360  = FastWrap360_deg(angle);
+        float  wrap180  = FastWrap180_deg(angle);
+        double expected = fmod((double)angle, 360.0);
+        if (expected < 0.0)
+            expected += 360.0;
+
+        TEST_ASSERT_TRUE((wrap360 >= 0.0f) && (wrap360 < 360.0f));
+        TEST_ASSERT_TRUE((wrap180 >= -180.0f) && (wrap180 < 180.0f));
+        // Results may only differ from the exact ones by rounding, or by a full turn at the bounds
+        TEST_ASSERT_FLOAT_WITHIN(1e-3, 0.0, remainder(wrap360 - expected, 360.0));
+        TEST_ASSERT_FLOAT_WITHIN(1e-3, 0.0, remainder(wrap180 - expected, 360.0));
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, FastWrap360_deg(360.0f));
+    TEST_ASSERT_EQUAL_FLOAT(359.5f, FastWrap360_deg(-0.5f));
+    TEST_ASSERT_EQUAL_FLOAT(-180.0f, FastWrap180_deg(180.0f));
+}
+
+// Approximations are only kept where they are faster than libm. The host FPU is not the Cortex-M7 one, but a function
+// slower than libm here has no reason to be faster on target, where sqrtf is a single instruction.
+void test_speed()
+{
+    double fast_ns, libm_ns;
+
+    for (int i = 0; i < 1024; i++)
+    {
+        benchInput[i] = -0.999f + 1.998f * i / 1023;
+    }
+
+    fast_ns = Bench([](float v) { return FastAtan2(v, 0.5f); });
+    libm_ns = Bench([](float v) { return atan2f(v, 0.5f); });
+    PrintBench("FastAtan2", fast_ns, libm_ns);
+    TEST_ASSERT_GREATER_THAN_FLOAT(1.0, libm_ns / fast_ns);
+
+    fast_ns = Bench([](float v) { return FastWrap360_deg(v * 1000.0f); });
+    libm_ns = Bench([](float v) { return fmodf(fmodf(v * 1000.0f, 360.0f) + 360.0f, 360.0f); });
+    PrintBench("FastWrap360_deg", fast_ns, libm_ns);
+    TEST_ASSERT_GREATER_THAN_FLOAT(1.0, libm_ns / fast_ns);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_atan2_accuracy);
+    RUN_TEST(test_wrap);
+    RUN_TEST(test_speed);
+    return UNITY_END();
+}
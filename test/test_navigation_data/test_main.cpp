@@ -0,0 +1,135 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Host tests of the event scheduler                             *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "NavigationData.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define SPEED_ORIGIN_US 1000
+#define INPUT_ORIGIN_US 5000
+#define SOG_KT          6.5f
+#define COG_DEG         215.0f
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+void setUp()
+{
+    gHostTime_us = 100000;
+}
+
+void tearDown()
+{
+}
+
+// Subscriber deriving a grouped value from water speed, as the wind engine derives its outputs from its inputs
+static void SetSogCog(void *context, uint32_t changedMask)
+{
+    NavigationData *navData = static_cast<NavigationData *>(context);
+
+    (void)changedMask;
+    navData->Set(NAV_ID_SOG_KT, SOG_KT);
+    navData->Set(NAV_ID_COG_DEG, COG_DEG);
+}
+
+// Grouped values set by a subscriber reach snapshot readers, with the origin of the value it was notified of
+void test_subscriber_sets_group()
+{
+    NavigationData     navData;
+    NavGroupSnapshot_t sogCog;
+
+    navData.Subscribe("SOG/COG", NAV_BIT(NAV_ID_SPD_KT), SetSogCog, &navData);
+    navData.SetOrigin(SPEED_ORIGIN_US);
+    navData.Set(NAV_ID_SPD_KT, 5.0f);
+    navData.ResetOrigin();
+    navData.Dispatch();
+
+    navData.GetSnapshot(NAV_GROUP_SOGCOG, &sogCog);
+    TEST_ASSERT_EQUAL_UINT32(NAV_BIT(NAV_ID_SOG_KT) | NAV_BIT(NAV_ID_COG_DEG), sogCog.validMask);
+    TEST_ASSERT_EQUAL_FLOAT(SOG_KT, sogCog.value[0]);
+    TEST_ASSERT_EQUAL_FLOAT(COG_DEG, sogCog.value[1]);
+    TEST_ASSERT_EQUAL_UINT32(SPEED_ORIGIN_US, navData.GetOrigin_us(NAV_ID_SOG_KT));
+}
+
+// Dispatching inside the origin bracket of an input keeps that bracket : its origin still applies after Dispatch and its
+// grouped values are only published at ResetOrigin, while the ones set by subscribers are published by Dispatch
+void test_dispatch_inside_origin_bracket()
+{
+    NavigationData     navData;
+    NavGroupSnapshot_t position, sogCog;
+
+    navData.Subscribe("SOG/COG", NAV_BIT(NAV_ID_SPD_KT), SetSogCog, &navData);
+    navData.SetOrigin(SPEED_ORIGIN_US);
+    navData.Set(NAV_ID_SPD_KT, 5.0f);
+    navData.ResetOrigin();
+
+    navData.SetOrigin(INPUT_ORIGIN_US);
+    navData.Set(NAV_ID_LATITUDE_DEG, 47.5f);
+    navData.Dispatch();
+    navData.Set(NAV_ID_LONGITUDE_DEG, -3.25f);
+
+    navData.GetSnapshot(NAV_GROUP_SOGCOG, &sogCog);
+    navData.GetSnapshot(NAV_GROUP_POSITION, &position);
+    TEST_ASSERT_EQUAL_UINT32(NAV_BIT(NAV_ID_SOG_KT) | NAV_BIT(NAV_ID_COG_DEG), sogCog.validMask);
+    TEST_ASSERT_EQUAL_UINT32(0, position.validMask);
+    TEST_ASSERT_EQUAL_UINT32(INPUT_ORIGIN_US, navData.GetOrigin_us(NAV_ID_LONGITUDE_DEG));
+
+    navData.ResetOrigin();
+    navData.GetSnapshot(NAV_GROUP_POSITION, &position);
+    TEST_ASSERT_EQUAL_UINT32(NAV_BIT(NAV_ID_LATITUDE_DEG) | NAV_BIT(NAV_ID_LONGITUDE_DEG), position.validMask);
+    TEST_ASSERT_EQUAL_FLOAT(47.5f, position.value[0]);
+    TEST_ASSERT_EQUAL_FLOAT(-3.25f, position.value[1]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_subscriber_sets_group);
+    RUN_TEST(test_dispatch_inside_origin_bracket);
+    return UNITY_END();
+}
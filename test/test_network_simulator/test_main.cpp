@@ -0,0 +1,176 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Host test of our slave device on simulated Micronet networks  *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "NetworkSimulator.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define TEST_NB_CYCLES        300
+#define TEST_GNSS_PERIOD_US   100000
+#define TEST_PARAMETER_PERIOD 10
+#define TEST_SEED             0x2f6b8a13
+// GNSS period not dividing the network cycle, so that GNSS updates fall at every time of the cycle along the run
+#define TEST_DRIFTING_GNSS_PERIOD_US 97000
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+static NetworkSimulator simulator;
+static SimConfig_t      config;
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+void setUp()
+{
+    config.nbDevices       = 4;
+    config.nbCycles        = TEST_NB_CYCLES;
+    config.gnssPeriod_us   = TEST_GNSS_PERIOD_US;
+    config.parameterPeriod = TEST_PARAMETER_PERIOD;
+    config.seed            = TEST_SEED;
+    config.rxGating        = false;
+    config.lateEncoding    = true;
+}
+
+void tearDown()
+{
+}
+
+// Same configuration gives the same results : the device only runs on the virtual clock of the simulator
+void test_reproducible()
+{
+    SimResult_t result1, result2;
+
+    simulator.Run(config, &result1);
+    gHostTime_us = 123456789;
+    simulator.Run(config, &result2);
+    gHostTime_us = 0;
+
+    TEST_ASSERT_EQUAL(0, memcmp(&result1, &result2, sizeof(SimResult_t)));
+}
+
+// From an empty network to a full one, our device joins and keeps its slots. Only its slot requests may collide, with
+// those of the other devices joining.
+void test_slot_keeping()
+{
+    for (uint32_t nbDevices = 0; nbDevices <= SIM_MAX_DEVICES; nbDevices++)
+    {
+        SimResult_t result;
+
+        config.nbDevices = nbDevices;
+        config.seed      = TEST_SEED + nbDevices;
+        simulator.Run(config, &result);
+
+        TEST_ASSERT_NOT_EQUAL(0, result.joinCycle);
+        TEST_ASSERT_GREATER_THAN(0, result.nbDataMessages);
+        TEST_ASSERT_EQUAL(result.nbDataMessages, result.nbSlotHits);
+        TEST_ASSERT_EQUAL(result.nbAcksExpected, result.nbAcksSent);
+    }
+}
+
+// RX gating powers the radio down without losing any frame our device uses
+void test_rx_gating()
+{
+    SimResult_t ungated, gated;
+
+    simulator.Run(config, &ungated);
+    config.rxGating = true;
+    simulator.Run(config, &gated);
+
+    TEST_ASSERT_LESS_THAN(ungated.radioOn_us, gated.radioOn_us);
+    TEST_ASSERT_EQUAL(gated.nbUsefulFrames, gated.nbUsefulHeard);
+    TEST_ASSERT_EQUAL(gated.nbDataMessages, gated.nbSlotHits);
+}
+
+// Data messages encoded again just before their slot carry fresher positions than when encoded at MASTER_REQUEST. A late
+// encoded position can't be older than one GNSS period plus the encoding lead time.
+void test_late_encoding_age()
+{
+    uint64_t lateTotalAge_us  = 0;
+    uint64_t earlyTotalAge_us = 0;
+    uint32_t nbSamples        = 0;
+
+    config.gnssPeriod_us = TEST_DRIFTING_GNSS_PERIOD_US;
+    for (uint32_t nbDevices = 0; nbDevices <= SIM_MAX_DEVICES; nbDevices++)
+    {
+        SimResult_t late, early;
+
+        config.nbDevices    = nbDevices;
+        config.seed         = TEST_SEED + nbDevices;
+        config.lateEncoding = true;
+        simulator.Run(config, &late);
+        config.lateEncoding = false;
+        simulator.Run(config, &early);
+
+        // Same network, same messages : only their content differs
+        TEST_ASSERT_EQUAL(early.nbAgeSamples, late.nbAgeSamples);
+        TEST_ASSERT_GREATER_THAN(0, late.nbAgeSamples);
+        TEST_ASSERT_LESS_THAN(early.totalAge_us, late.totalAge_us);
+        TEST_ASSERT_LESS_THAN(TEST_DRIFTING_GNSS_PERIOD_US + LATE_ENCODING_LEAD_US, late.maxAge_us);
+        TEST_ASSERT_GREATER_OR_EQUAL(TEST_DRIFTING_GNSS_PERIOD_US + LATE_ENCODING_LEAD_US, early.maxAge_us);
+
+        lateTotalAge_us += late.totalAge_us;
+        earlyTotalAge_us += early.totalAge_us;
+        nbSamples += late.nbAgeSamples;
+    }
+
+    char message[128];
+    snprintf(message, sizeof(message), "Average position age : %u us at MASTER_REQUEST, %u us with late encoding",
+             (uint32_t)(earlyTotalAge_us / nbSamples), (uint32_t)(lateTotalAge_us / nbSamples));
+    TEST_MESSAGE(message);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reproducible);
+    RUN_TEST(test_slot_keeping);
+    RUN_TEST(test_rx_gating);
+    RUN_TEST(test_late_encoding_age);
+    return UNITY_END();
+}
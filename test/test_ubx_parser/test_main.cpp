@@ -0,0 +1,236 @@
+/***************************************************************************
+ *                                                                         *
+ * Project:  MicronetToNMEA                                                *
+ * Purpose:  Host test of the UBX parser on an M8N output stream           *
+ * Author:   Ronan Demoment                                                *
+ *                                                                         *
+ ***************************************************************************
+ *   Copyright (C) 2021 by Ronan Demoment                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+
+/***************************************************************************/
+/*                              Includes                                   */
+/***************************************************************************/
+
+#include "UbxParser.h"
+
+#include <string.h>
+#include <unity.h>
+
+/***************************************************************************/
+/*                              Constants                                  */
+/***************************************************************************/
+
+#define BYTE_PERIOD_US 260 // One byte at 38400 baud
+
+// NMEA banner sent by the M8N at power up, before UBX output is enabled
+static const char STARTUP_BANNER[] = "$GNTXT,01,01,02,u-blox AG - www.u-blox.com*4E\r\n";
+
+// ACK-ACK of CFG-PRT, answered by the M8N once UBX output is enabled
+static const uint8_t ACK_CFG_PRT[] = {0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x06, 0x00, 0x0E, 0x37};
+
+// NAV-PVT frame, laid out as described in the u-blox M8 protocol specification :
+// 2026-10-18 12:34:56.5, 3D fix, 11 satellites, 48.3801234N 4.4861234W, 1.5 m MSL, 2.570 m/s, 215.0 deg
+static const uint8_t NAV_PVT_FRAME[] = {
+    0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0xC4, 0x85, 0x26, 0x12, 0xEA, 0x07, 0x0A, 0x12, 0x0C, 0x22, 0x38, 0x07, 0x19, 0x00,
+    0x00, 0x00, 0x00, 0x65, 0xCD, 0x1D, 0x03, 0x01, 0xEA, 0x0B, 0xCE, 0x78, 0x53, 0xFD, 0x92, 0x38, 0xD6, 0x1C, 0x20, 0xCB,
+    0x00, 0x00, 0xDC, 0x05, 0x00, 0x00, 0xC4, 0x09, 0x00, 0x00, 0xD8, 0x0E, 0x00, 0x00, 0xC7, 0xF7, 0xFF, 0xFF, 0x3E, 0xFA,
+    0xFF, 0xFF, 0x0C, 0x00, 0x00, 0x00, 0x0A, 0x0A, 0x00, 0x00, 0x60, 0x10, 0x48, 0x01, 0x36, 0x01, 0x00, 0x00, 0x90, 0x3A,
+    0x1C, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFD, 0x93};
+
+/***************************************************************************/
+/*                             Local types                                 */
+/***************************************************************************/
+
+typedef struct
+{
+    int      nbFrames;
+    uint8_t  msgClass[8];
+    uint8_t  msgId[8];
+    uint16_t length[8];
+    uint32_t frameStart_us[8];
+    uint8_t  lastNavPvt[UBX_NAV_PVT_LENGTH];
+} FrameLog_t;
+
+/***************************************************************************/
+/*                           Local prototypes                              */
+/***************************************************************************/
+
+/***************************************************************************/
+/*                               Globals                                   */
+/***************************************************************************/
+
+static UbxParser  parser;
+static FrameLog_t frameLog;
+static uint32_t   streamTime_us;
+
+/***************************************************************************/
+/*                              Functions                                  */
+/***************************************************************************/
+
+void setUp()
+{
+    parser        = UbxParser();
+    streamTime_us = 1000000;
+    memset(&frameLog, 0, sizeof(frameLog));
+}
+
+void tearDown()
+{
+}
+
+// Feed bytes to the parser as the GNSS UART would, logging completed frames
+static void Feed(const uint8_t *data, int length)
+{
+    for (int i = 0; i < length; i++)
+    {
+        if (parser.PushByte(data[i], streamTime_us) && (frameLog.nbFrames < 8))
+        {
+            int n                     = frameLog.nbFrames++;
+            frameLog.msgClass[n]      = parser.GetClass();
+            frameLog.msgId[n]         = parser.GetId();
+            frameLog.length[n]        = parser.GetLength();
+            frameLog.frameStart_us[n] = parser.GetFrameStart_us();
+            if ((parser.GetClass() == UBX_CLASS_NAV) && (parser.GetId() == UBX_ID_NAV_PVT))
+            {
+                memcpy(frameLog.lastNavPvt, parser.GetPayload(), UBX_NAV_PVT_LENGTH);
+            }
+        }
+        streamTime_us += BYTE_PERIOD_US;
+    }
+}
+
+// Startup NMEA banner, CFG-PRT acknowledge and first NAV-PVT, as sent by the M8N during configuration
+void test_configuration_stream()
+{
+    Feed((const uint8_t *)STARTUP_BANNER, strlen(STARTUP_BANNER));
+    TEST_ASSERT_EQUAL(0, frameLog.nbFrames);
+
+    Feed(ACK_CFG_PRT, sizeof(ACK_CFG_PRT));
+    uint32_t navPvtStart_us = streamTime_us;
+    Feed(NAV_PVT_FRAME, sizeof(NAV_PVT_FRAME));
+
+    TEST_ASSERT_EQUAL(2, frameLog.nbFrames);
+    TEST_ASSERT_EQUAL(0x05, frameLog.msgClass[0]);
+    TEST_ASSERT_EQUAL(0x01, frameLog.msgId[0]);
+    TEST_ASSERT_EQUAL(2, frameLog.length[0]);
+    TEST_ASSERT_EQUAL(UBX_CLASS_NAV, frameLog.msgClass[1]);
+    TEST_ASSERT_EQUAL(UBX_ID_NAV_PVT, frameLog.msgId[1]);
+    TEST_ASSERT_EQUAL(UBX_NAV_PVT_LENGTH, frameLog.length[1]);
+    TEST_ASSERT_EQUAL(navPvtStart_us, frameLog.frameStart_us[1]);
+    TEST_ASSERT_EQUAL(0, parser.GetNbChecksumErrors());
+}
+
+// NAV-PVT fields at the offsets decoded by DataBridge
+void test_nav_pvt_fields()
+{
+    Feed(NAV_PVT_FRAME, sizeof(NAV_PVT_FRAME));
+    TEST_ASSERT_EQUAL(1, frameLog.nbFrames);
+
+    const uint8_t *payload = frameLog.lastNavPvt;
+    TEST_ASSERT_EQUAL(2026, UbxParser::U2(payload, 4));
+    TEST_ASSERT_EQUAL(10, UbxParser::U1(payload, 6));
+    TEST_ASSERT_EQUAL(18, UbxParser::U1(payload, 7));
+    TEST_ASSERT_EQUAL(12, UbxParser::U1(payload, 8));
+    TEST_ASSERT_EQUAL(34, UbxParser::U1(payload, 9));
+    TEST_ASSERT_EQUAL(56, UbxParser::U1(payload, 10));
+    TEST_ASSERT_EQUAL(0x07, UbxParser::U1(payload, 11));
+    TEST_ASSERT_EQUAL(500000000, UbxParser::I4(payload, 16));
+    TEST_ASSERT_EQUAL(3, UbxParser::U1(payload, 20));
+    TEST_ASSERT_EQUAL(0x01, UbxParser::U1(payload, 21) & 0x01);
+    TEST_ASSERT_EQUAL(11, UbxParser::U1(payload, 23));
+    TEST_ASSERT_EQUAL(-44861234, UbxParser::I4(payload, 24));
+    TEST_ASSERT_EQUAL(483801234, UbxParser::I4(payload, 28));
+    TEST_ASSERT_EQUAL(1500, UbxParser::I4(payload, 36));
+    TEST_ASSERT_EQUAL(2500, UbxParser::U4(payload, 40));
+    TEST_ASSERT_EQUAL(3800, UbxParser::U4(payload, 44));
+    TEST_ASSERT_EQUAL(2570, UbxParser::I4(payload, 60));
+    TEST_ASSERT_EQUAL(21500000, UbxParser::I4(payload, 64));
+    TEST_ASSERT_EQUAL(310, UbxParser::U4(payload, 68));
+    TEST_ASSERT_EQUAL(1850000, UbxParser::U4(payload, 72));
+    TEST_ASSERT_EQUAL(132, UbxParser::U2(payload, 76));
+}
+
+// A corrupted frame is dropped and counted, next frame is still decoded
+void test_checksum_error()
+{
+    uint8_t corrupted[sizeof(NAV_PVT_FRAME)];
+
+    memcpy(corrupted, NAV_PVT_FRAME, sizeof(corrupted));
+    corrupted[40] ^= 0x10;
+    Feed(corrupted, sizeof(corrupted));
+    TEST_ASSERT_EQUAL(0, frameLog.nbFrames);
+    TEST_ASSERT_EQUAL(1, parser.GetNbChecksumErrors());
+
+    Feed(NAV_PVT_FRAME, sizeof(NAV_PVT_FRAME));
+    TEST_ASSERT_EQUAL(1, frameLog.nbFrames);
+    TEST_ASSERT_EQUAL(UBX_ID_NAV_PVT, frameLog.msgId[0]);
+}
+
+// Frame cut by a UART overrun : parser resynchronizes on the following frames
+void test_truncated_frame()
+{
+    Feed(NAV_PVT_FRAME, 30);
+    Feed(NAV_PVT_FRAME, sizeof(NAV_PVT_FRAME));
+    Feed(NAV_PVT_FRAME, sizeof(NAV_PVT_FRAME));
+
+    // Frame following the truncated one is swallowed as its payload, the next one is decoded
+    TEST_ASSERT_EQUAL(1, frameLog.nbFrames);
+    TEST_ASSERT_EQUAL(UBX_ID_NAV_PVT, frameLog.msgId[0]);
+    TEST_ASSERT_EQUAL(1, parser.GetNbChecksumErrors());
+}
+
+// Header announcing a payload longer than UBX_MAX_PAYLOAD_LENGTH is dropped at once
+void test_oversized_length()
+{
+    const uint8_t oversized[] = {UBX_SYNC_CHAR_1, UBX_SYNC_CHAR_2, UBX_CLASS_NAV, 0x35, 0xFF, 0x7F};
+
+    Feed(oversized, sizeof(oversized));
+    Feed(NAV_PVT_FRAME, sizeof(NAV_PVT_FRAME));
+
+    TEST_ASSERT_EQUAL(1, frameLog.nbFrames);
+    TEST_ASSERT_EQUAL(UBX_ID_NAV_PVT, frameLog.msgId[0]);
+}
+
+// Sync character repeated before the real start of frame
+void test_repeated_sync()
+{
+    const uint8_t sync = UBX_SYNC_CHAR_1;
+
+    Feed(&sync, 1);
+    uint32_t frameStart_us = streamTime_us;
+    Feed(NAV_PVT_FRAME, sizeof(NAV_PVT_FRAME));
+
+    TEST_ASSERT_EQUAL(1, frameLog.nbFrames);
+    TEST_ASSERT_EQUAL(frameStart_us, frameLog.frameStart_us[0]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_configuration_stream);
+    RUN_TEST(test_nav_pvt_fields);
+    RUN_TEST(test_checksum_error);
+    RUN_TEST(test_truncated_frame);
+    RUN_TEST(test_oversized_length);
+    RUN_TEST(test_repeated_sync);
+    return UNITY_END();
+}